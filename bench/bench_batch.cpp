@@ -0,0 +1,81 @@
+// Writes the same rows into a fresh Table one insert at a time and then as
+// MutationBatches, with the commit log on, and prints rows/s for each. The
+// batch path pays one lock and one commit-log record per batch and inserts
+// each partition's sorted run with a finger search.
+//   factdb_batch_bench [rows] [batch_size] [partitions]
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "data/table.hpp"
+
+namespace {
+struct Mutation {
+    std::string partition_key;
+    std::string cluster_key;
+};
+
+factdb::MemtableRows make_value(const std::string& value) {
+    auto row = std::make_shared<factdb::MemtableRow>();
+    row->addcol_(std::make_shared<factdb::MemtableColumn>("val", factdb::ColumnType::STRING, value));
+    return std::make_shared<std::vector<std::shared_ptr<factdb::MemtableRow>>>(1, row);
+}
+
+double run(const std::string& dir, const std::vector<Mutation>& mutations, size_t batch_size) {
+    std::filesystem::remove_all(dir);
+    factdb::TableOptions options;
+    options.data_dir = dir;
+    factdb::Table table(options);
+    table.open();
+    std::string value(64, 'v');
+    auto start = std::chrono::steady_clock::now();
+    if (batch_size <= 1) {
+        for (const auto& mutation : mutations) {
+            table.insert(mutation.partition_key, mutation.cluster_key, make_value(value));
+        }
+    } else {
+        for (size_t i = 0; i < mutations.size(); i += batch_size) {
+            factdb::MutationBatch batch;
+            for (size_t j = i; j < std::min(i + batch_size, mutations.size()); j++) {
+                batch.insert(mutations[j].partition_key, mutations[j].cluster_key, make_value(value));
+            }
+            table.apply(batch);
+        }
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::filesystem::remove_all(dir);
+    return mutations.size() / seconds;
+}
+}
+
+int main(int argc, char** argv) {
+    size_t rows = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 200000;
+    size_t batch_size = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 1000;
+    size_t partitions = argc > 3 ? std::strtoull(argv[3], nullptr, 10) : 64;
+    std::string dir = (std::filesystem::temp_directory_path() / "factdb_batch_bench").string();
+
+    std::vector<Mutation> mutations;
+    mutations.reserve(rows);
+    std::mt19937_64 rng(42);
+    for (size_t i = 0; i < rows; i++) {
+        char partition_key[32];
+        char cluster_key[32];
+        std::snprintf(partition_key, sizeof(partition_key), "p%06zu", static_cast<size_t>(rng() % partitions));
+        std::snprintf(cluster_key, sizeof(cluster_key), "c%012llu", static_cast<unsigned long long>(rng()));
+        mutations.push_back(Mutation{partition_key, cluster_key});
+    }
+
+    double single = run(dir, mutations, 1);
+    double batched = run(dir, mutations, batch_size);
+    std::cout << "rows,batch_size,partitions,single_rows_per_s,batch_rows_per_s,speedup\n"
+              << rows << "," << batch_size << "," << partitions << "," << single << "," << batched << ","
+              << batched / single << "\n";
+    return 0;
+}
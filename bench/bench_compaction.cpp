@@ -0,0 +1,76 @@
+// Merges 4, 16 and 64 overlapping inputs through the Compactor and reports
+// throughput in MB/s per thread.
+//   factdb_compaction_bench [rows_per_input] [threads]
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "data/compaction.hpp"
+
+namespace {
+std::shared_ptr<factdb::SSTable> make_input(size_t rows, size_t input, std::mt19937_64& rng) {
+    std::vector<std::string> keys;
+    keys.reserve(rows);
+    for (size_t i = 0; i < rows; i++) {
+        char key[64];
+        std::snprintf(key, sizeof(key), "tenant%02zu/metric%08llu", input % 8,
+                      static_cast<unsigned long long>(rng() % (rows * 4)));
+        keys.emplace_back(key);
+    }
+    std::sort(keys.begin(), keys.end());
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+
+    std::vector<std::shared_ptr<factdb::Partition>> partitions;
+    for (const auto& key : keys) {
+        auto partition = std::make_shared<factdb::Partition>();
+        partition->header_.key_.assign(key.begin(), key.end());
+        auto row = std::make_shared<factdb::Row>();
+        auto block = std::make_shared<factdb::ClusteringBlock>();
+        factdb::CellValue clustering;
+        clustering.key_ = {'t', 's'};
+        block->clustering_cells_.emplace_back(clustering);
+        row->clustering_blocks_.push_back(block);
+        factdb::CellValue cell;
+        cell.key_ = {'v', 'a', 'l'};
+        cell.value_.assign(64, static_cast<char>('a' + input % 26));
+        row->cells_.emplace_back(cell);
+        partition->unfiltereds_.push_back(row);
+        partitions.push_back(partition);
+    }
+    return std::make_shared<factdb::SSTable>("bench-input.sst", partitions);
+}
+}
+
+int main(int argc, char** argv) {
+    size_t total_rows = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1 << 20;
+    size_t threads = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 1;
+    std::mt19937_64 rng(42);
+
+    std::cout << "inputs,threads,ranges,input_rows,output_rows,input_mb,seconds,mb_per_s_per_thread\n";
+    for (size_t inputs_count : {4, 16, 64}) {
+        std::vector<std::shared_ptr<factdb::SSTable>> inputs;
+        for (size_t i = 0; i < inputs_count; i++) {
+            inputs.push_back(make_input(total_rows / inputs_count, i, rng));
+        }
+        factdb::CompactionOptions options;
+        options.max_threads = threads;
+        options.min_rows_per_range = 1 << 14;
+        options.write_outputs = false;
+        factdb::Compactor compactor(options);
+
+        auto start = std::chrono::steady_clock::now();
+        auto result = compactor.compact(inputs);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        double mb = result.input_bytes / (1024.0 * 1024.0);
+        std::cout << inputs_count << "," << threads << "," << result.ranges << "," << result.input_rows << ","
+                  << result.output_rows << "," << mb << "," << seconds << ","
+                  << mb / seconds / result.ranges << "\n";
+    }
+    return 0;
+}
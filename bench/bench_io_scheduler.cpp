@@ -0,0 +1,89 @@
+// File-backed workload for the I/O scheduler: 4 KiB random query reads run
+// against a file while compaction streams large writes to another file.
+// Prints the per-class latency report with and without a compaction
+// bandwidth limit.
+//   factdb_io_scheduler_bench [directory] [seconds] [compaction_mb_per_s]
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "io/io_scheduler.hpp"
+
+namespace {
+constexpr size_t READ_SIZE = 4096;
+constexpr size_t WRITE_SIZE = 1 << 20;
+constexpr size_t DATA_FILE_SIZE = 256 << 20;
+
+void run(const std::string& dir, double seconds, uint64_t compaction_limit) {
+    std::string data_path = dir + "/io_bench_data.db";
+    std::string compaction_path = dir + "/io_bench_compaction.db";
+    int data_fd = ::open(data_path.c_str(), O_RDWR | O_CREAT, 0644);
+    int compaction_fd = ::open(compaction_path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (data_fd < 0 || compaction_fd < 0) {
+        std::cerr << "cannot open benchmark files in " << dir << "\n";
+        std::exit(1);
+    }
+    std::vector<char> block(WRITE_SIZE, 'x');
+    for (size_t off = 0; off < DATA_FILE_SIZE; off += WRITE_SIZE) {
+        if (::pwrite(data_fd, block.data(), block.size(), off) < 0) std::exit(1);
+    }
+    ::fsync(data_fd);
+
+    factdb::IoSchedulerOptions options;
+    options.max_in_flight = 4;
+    options.classes[static_cast<size_t>(factdb::IoPriorityClass::COMPACTION)].bandwidth_limit = compaction_limit;
+    factdb::IoScheduler scheduler(options);
+    std::atomic<bool> done{false};
+
+    std::thread compaction([&] {
+        off_t offset = 0;
+        while (!done) {
+            std::vector<std::future<ssize_t>> batch;
+            for (int i = 0; i < 8; i++) {
+                batch.push_back(scheduler.write(factdb::IoPriorityClass::COMPACTION, compaction_fd, block.data(), block.size(), offset));
+                offset = (offset + WRITE_SIZE) % (1LL << 30);
+            }
+            for (auto& f : batch) f.get();
+            scheduler.submit(factdb::IoPriorityClass::COMPACTION, 0, [&] { return ssize_t(::fdatasync(compaction_fd)); }).get();
+        }
+    });
+    std::vector<std::thread> readers;
+    for (int t = 0; t < 4; t++) {
+        readers.emplace_back([&, t] {
+            std::mt19937_64 rng(t);
+            std::vector<char> buffer(READ_SIZE);
+            while (!done) {
+                off_t offset = (rng() % (DATA_FILE_SIZE / READ_SIZE)) * READ_SIZE;
+                scheduler.read(factdb::IoPriorityClass::QUERY, data_fd, buffer.data(), READ_SIZE, offset).get();
+            }
+        });
+    }
+    std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+    done = true;
+    compaction.join();
+    for (auto& r : readers) r.join();
+
+    std::cout << "compaction limit: " << (compaction_limit ? std::to_string(compaction_limit >> 20) + " MB/s" : "none") << "\n"
+              << scheduler.latency_report() << "\n";
+    ::close(data_fd);
+    ::close(compaction_fd);
+    std::remove(data_path.c_str());
+    std::remove(compaction_path.c_str());
+}
+}
+
+int main(int argc, char** argv) {
+    std::string dir = argc > 1 ? argv[1] : ".";
+    double seconds = argc > 2 ? std::atof(argv[2]) : 5.0;
+    uint64_t limit_mb = argc > 3 ? std::strtoull(argv[3], nullptr, 10) : 64;
+    run(dir, seconds, 0);
+    run(dir, seconds, limit_mb << 20);
+    return 0;
+}
@@ -0,0 +1,65 @@
+// Times FACTDB_LOG_* calls from several threads at once and prints the mean
+// ns per call for the synchronous logger, the async logger in drop and block
+// mode, and a call whose level is disabled at runtime.
+//   factdb_logger_bench [threads] [calls_per_thread]
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "logger/logging.hpp"
+
+namespace {
+double ns_per_call(size_t threads, size_t calls) {
+    std::vector<std::thread> workers;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t t = 0; t < threads; t++) {
+        workers.emplace_back([t, calls]() {
+            for (size_t i = 0; i < calls; i++) {
+                FACTDB_LOG_DEBUG("thread %zu wrote row %zu to partition %s", t, i, "p000042");
+            }
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return seconds * 1e9 / (threads * calls);
+}
+}
+
+int main(int argc, char** argv) {
+    size_t threads = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 4;
+    size_t calls = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 200000;
+    std::string path = (std::filesystem::temp_directory_path() / "factdb_logger_bench.log").string();
+    std::filesystem::remove(path);
+    auto& logger = factdb::Logger::get_instance();
+
+    logger.configure(path, factdb::LogLevel::DEBUG);
+    double sync = ns_per_call(threads, calls);
+
+    factdb::AsyncLogOptions options;
+    options.overflow = factdb::LogOverflow::DROP;
+    logger.start_async(options);
+    uint64_t dropped_before = logger.stats().dropped;
+    double async_drop = ns_per_call(threads, calls);
+    logger.stop_async();
+    uint64_t dropped = logger.stats().dropped - dropped_before;
+
+    options.overflow = factdb::LogOverflow::BLOCK;
+    logger.start_async(options);
+    double async_block = ns_per_call(threads, calls);
+    logger.stop_async();
+
+    logger.configure(path, factdb::LogLevel::INFO);
+    double disabled = ns_per_call(threads, calls);
+
+    std::cout << "threads,calls_per_thread,sync_ns,async_drop_ns,async_block_ns,disabled_ns,dropped\n"
+              << threads << "," << calls << "," << sync << "," << async_drop << "," << async_block << ","
+              << disabled << "," << dropped << "\n";
+    std::filesystem::remove(path);
+    return 0;
+}
@@ -0,0 +1,46 @@
+// Measures the cost of recording into a Counter and a Histogram from
+// several threads at once, in ns per call.
+//   factdb_metrics_bench [threads] [calls_per_thread]
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "metrics/metrics.hpp"
+
+namespace {
+double ns_per_call(size_t threads, size_t calls, const std::function<void(size_t)>& record) {
+    std::vector<std::thread> workers;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t t = 0; t < threads; t++) {
+        workers.emplace_back([calls, &record]() {
+            for (size_t i = 0; i < calls; i++) {
+                record(i);
+            }
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return seconds * 1e9 / (threads * calls);
+}
+}
+
+int main(int argc, char** argv) {
+    size_t threads = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 4;
+    size_t calls = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 10000000;
+    auto& registry = factdb::MetricsRegistry::global();
+    factdb::Counter& counter = registry.counter("bench_counter_total", "benchmark counter");
+    factdb::Histogram& histogram = registry.histogram("bench_latency_ns", "benchmark histogram");
+
+    double counter_ns = ns_per_call(threads, calls, [&counter](size_t) { counter.add(); });
+    double histogram_ns = ns_per_call(threads, calls, [&histogram](size_t i) { histogram.record(i & 0xffff); });
+    double timer_ns = ns_per_call(threads, calls / 10, [&histogram](size_t) { factdb::LatencyTimer timer(histogram); });
+
+    std::cout << "threads,calls_per_thread,counter_ns,histogram_ns,latency_timer_ns\n"
+              << threads << "," << calls << "," << counter_ns << "," << histogram_ns << "," << timer_ns << "\n";
+    return counter.value() == threads * calls ? 0 : 1;
+}
@@ -0,0 +1,90 @@
+// Every shard drives inserts into a ShardedTable with a fixed number in
+// flight, so most land on another shard's memtable. Reports ops/s per shard
+// count; with one shard per core this should grow linearly.
+//   factdb_reactor_bench [ops_per_shard] [max_shards]
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <future>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "data/sharded_table.hpp"
+
+namespace {
+struct Driver {
+    factdb::ShardedTable& table;
+    factdb::MemtableRows value;
+    size_t shard;
+    size_t remaining;
+    size_t in_flight = 0;
+    size_t next_key = 0;
+    bool pumping = false;   // local inserts resolve inline; loop instead of recursing
+    std::promise<void> done;
+
+    void pump() {
+        if (pumping) return;
+        pumping = true;
+        while (remaining > 0 && in_flight < 64) {
+            remaining--;
+            in_flight++;
+            std::string key = "s" + std::to_string(shard) + "/k" + std::to_string(next_key++);
+            table.insert(key, "c", value).then([this](bool) {
+                in_flight--;
+                if (remaining == 0 && in_flight == 0) {
+                    done.set_value();
+                } else {
+                    pump();
+                }
+                return true;
+            });
+        }
+        pumping = false;
+    }
+};
+}
+
+int main(int argc, char** argv) {
+    size_t ops = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 200000;
+    size_t max_shards = argc > 2 ? std::strtoull(argv[2], nullptr, 10)
+                                 : std::max<unsigned>(1, std::thread::hardware_concurrency());
+    std::string dir = (std::filesystem::temp_directory_path() / "factdb_reactor_bench").string();
+
+    auto row = std::make_shared<factdb::MemtableRow>();
+    row->addcol_(std::make_shared<factdb::MemtableColumn>("val", factdb::ColumnType::STRING, std::string(32, 'v')));
+    auto value = std::make_shared<std::vector<std::shared_ptr<factdb::MemtableRow>>>(1, row);
+
+    std::cout << "shards,ops,seconds,ops_per_s,messages,overflows,wakeups\n";
+    for (size_t shards = 1; shards <= max_shards; shards *= 2) {
+        std::filesystem::remove_all(dir);
+        factdb::Reactor reactor(factdb::ReactorOptions{shards});
+        factdb::TableOptions options;
+        options.data_dir = dir;
+        options.use_commitlog = false;
+        factdb::ShardedTable table(reactor, options);
+        table.open();
+
+        std::vector<std::unique_ptr<Driver>> drivers;
+        std::vector<std::future<void>> finished;
+        for (size_t s = 0; s < shards; s++) {
+            drivers.push_back(std::unique_ptr<Driver>(new Driver{table, value, s, ops, 0, 0, false, {}}));
+            finished.push_back(drivers.back()->done.get_future());
+        }
+        auto start = std::chrono::steady_clock::now();
+        for (size_t s = 0; s < shards; s++) {
+            reactor.send(s, [driver = drivers[s].get()] { driver->pump(); });
+        }
+        for (auto& f : finished) f.wait();
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        auto stats = reactor.stats();
+        std::cout << shards << "," << ops * shards << "," << seconds << "," << ops * shards / seconds << ","
+                  << stats.messages << "," << stats.overflows << "," << stats.wakeups << "\n";
+        reactor.stop();
+    }
+    std::filesystem::remove_all(dir);
+    return 0;
+}
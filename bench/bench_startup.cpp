@@ -0,0 +1,64 @@
+// Flushes `tables` SSTables into a scratch directory, then times Table::open
+// (manifest plus summary and filter per table) against reading every data
+// file in full, which is what startup cost before the manifest.
+//   factdb_startup_bench [tables] [rows_per_table] [open_threads]
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "data/table.hpp"
+
+int main(int argc, char** argv) {
+    size_t tables = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 2000;
+    size_t rows = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 500;
+    size_t threads = argc > 3 ? std::strtoull(argv[3], nullptr, 10) : 8;
+    std::string dir = (std::filesystem::temp_directory_path() / "factdb_startup_bench").string();
+    std::filesystem::remove_all(dir);
+
+    factdb::TableOptions options;
+    options.data_dir = dir;
+    options.use_commitlog = false;
+    options.open_threads = threads;
+    {
+        factdb::Table table(options);
+        table.open();
+        std::string value(64, 'v');
+        for (size_t t = 0; t < tables; t++) {
+            for (size_t r = 0; r < rows; r++) {
+                char key[64];
+                std::snprintf(key, sizeof(key), "t%06zu/p%06zu", t, r);
+                auto row = std::make_shared<factdb::MemtableRow>();
+                row->addcol_(std::make_shared<factdb::MemtableColumn>("val", factdb::ColumnType::STRING, value));
+                table.insert(key, "c", std::make_shared<std::vector<std::shared_ptr<factdb::MemtableRow>>>(1, row));
+            }
+            table.flush();
+        }
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    factdb::Table table(options);
+    if (!table.open()) {
+        std::cerr << "open failed\n";
+        return 1;
+    }
+    double lazy = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    start = std::chrono::steady_clock::now();
+    size_t loaded_rows = 0;
+    for (const auto& sstable : table.sstables()) {
+        factdb::SSTable full(sstable->get_file_path());
+        full.read_from_file();
+        loaded_rows += full.row_count();
+    }
+    double full = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << "tables,rows_per_table,open_threads,lazy_open_s,full_read_s,rows_read\n"
+              << tables << "," << rows << "," << threads << "," << lazy << "," << full << "," << loaded_rows << "\n";
+    std::filesystem::remove_all(dir);
+    return 0;
+}
@@ -0,0 +1,149 @@
+// Load generator for a running factdb server. Every connection keeps
+// `depth` requests in flight on its own thread and reports throughput and
+// latency percentiles over the whole run.
+// Connections are spread round robin over --hosts when given.
+//   factdb_loadgen [--host H] [--port P] [--hosts H:P,...] [--connections N] [--depth D]
+//                  [--seconds S] [--read-ratio R] [--keys K] [--value-size V]
+//                  [--consistency LOCAL|ONE|QUORUM|ALL]
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "cluster/coordinator.hpp"
+#include "net/client.hpp"
+
+namespace {
+using Clock = std::chrono::steady_clock;
+
+struct Options {
+    std::string host = "127.0.0.1";
+    uint16_t port = 9042;
+    std::vector<std::pair<std::string, uint16_t>> hosts;
+    size_t connections = 4;
+    size_t depth = 32;
+    double seconds = 5;
+    double read_ratio = 0.5;
+    size_t keys = 100000;
+    size_t value_size = 100;
+    factdb::ConsistencyLevel consistency = factdb::ConsistencyLevel::LOCAL;
+};
+
+struct Result {
+    std::vector<uint64_t> latencies_ns;
+    uint64_t errors = 0;
+};
+
+factdb::Request next_request(const Options& options, std::mt19937_64& rng, const std::string& value) {
+    factdb::Request request;
+    request.partition_key = "key" + std::to_string(rng() % options.keys);
+    request.cluster_key = "c";
+    request.consistency = options.consistency;
+    if (std::uniform_real_distribution<double>(0, 1)(rng) < options.read_ratio) {
+        request.opcode = factdb::Opcode::GET;
+    } else {
+        request.opcode = factdb::Opcode::PUT;
+        request.columns.push_back(factdb::WireColumn{"val", value});
+    }
+    return request;
+}
+
+void run_connection(const Options& options, size_t id, std::atomic<bool>& done, Result& result) {
+    const auto& [host, port] = options.hosts[id % options.hosts.size()];
+    factdb::Client client(host, port);
+    std::mt19937_64 rng(id);
+    std::string value(options.value_size, 'v');
+    std::vector<Clock::time_point> started(1 << 16);
+    std::vector<factdb::Request> initial;
+    for (size_t i = 0; i < options.depth; i++) {
+        initial.push_back(next_request(options, rng, value));
+    }
+    auto now = Clock::now();
+    for (uint16_t stream : client.send_all(std::move(initial))) {
+        started[stream] = now;
+    }
+    size_t outstanding = options.depth;
+    while (outstanding > 0) {
+        factdb::Response response = client.receive();
+        outstanding--;
+        result.latencies_ns.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - started[response.stream]).count());
+        if (response.status == factdb::Status::ERROR) {
+            result.errors++;
+        }
+        if (!done) {
+            started[client.send(next_request(options, rng, value))] = Clock::now();
+            outstanding++;
+        }
+    }
+}
+
+double percentile(const std::vector<uint64_t>& sorted, double p) {
+    if (sorted.empty()) return 0;
+    return sorted[std::min(sorted.size() - 1, static_cast<size_t>(p * sorted.size()))] / 1000.0;
+}
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string arg = argv[i];
+        const char* value = argv[i + 1];
+        if (arg == "--host") options.host = value;
+        else if (arg == "--port") options.port = static_cast<uint16_t>(std::atoi(value));
+        else if (arg == "--hosts") {
+            std::string spec = value;
+            for (size_t begin = 0; begin < spec.size();) {
+                size_t end = std::min(spec.find(',', begin), spec.size());
+                std::string host = spec.substr(begin, end - begin);
+                size_t colon = host.rfind(':');
+                options.hosts.emplace_back(host.substr(0, colon), static_cast<uint16_t>(std::atoi(host.c_str() + colon + 1)));
+                begin = end + 1;
+            }
+        }
+        else if (arg == "--consistency") options.consistency = factdb::parse_consistency_level(value);
+        else if (arg == "--connections") options.connections = std::strtoull(value, nullptr, 10);
+        else if (arg == "--depth") options.depth = std::strtoull(value, nullptr, 10);
+        else if (arg == "--seconds") options.seconds = std::atof(value);
+        else if (arg == "--read-ratio") options.read_ratio = std::atof(value);
+        else if (arg == "--keys") options.keys = std::strtoull(value, nullptr, 10);
+        else if (arg == "--value-size") options.value_size = std::strtoull(value, nullptr, 10);
+        else {
+            std::cerr << "unknown option " << arg << "\n";
+            return 1;
+        }
+    }
+    if (options.hosts.empty()) {
+        options.hosts.emplace_back(options.host, options.port);
+    }
+    options.depth = std::clamp<size_t>(options.depth, 1, 1 << 15);
+
+    std::atomic<bool> done(false);
+    std::vector<Result> results(options.connections);
+    std::vector<std::thread> threads;
+    auto start = Clock::now();
+    for (size_t i = 0; i < options.connections; i++) {
+        threads.emplace_back([&, i] { run_connection(options, i, done, results[i]); });
+    }
+    std::this_thread::sleep_for(std::chrono::duration<double>(options.seconds));
+    done = true;
+    for (auto& t : threads) t.join();
+    double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+
+    std::vector<uint64_t> latencies;
+    uint64_t errors = 0;
+    for (auto& r : results) {
+        latencies.insert(latencies.end(), r.latencies_ns.begin(), r.latencies_ns.end());
+        errors += r.errors;
+    }
+    std::sort(latencies.begin(), latencies.end());
+    std::cout << "connections,depth,requests,errors,seconds,ops_per_s,p50_us,p99_us,p999_us\n"
+              << options.connections << "," << options.depth << "," << latencies.size() << "," << errors << ","
+              << elapsed << "," << latencies.size() / elapsed << "," << percentile(latencies, 0.50) << ","
+              << percentile(latencies, 0.99) << "," << percentile(latencies, 0.999) << "\n";
+    return 0;
+}
@@ -0,0 +1,48 @@
+#include <benchmark/benchmark.h>
+
+#include <string>
+#include <vector>
+
+#include "internal/bloomfilter.hpp"
+
+namespace {
+std::vector<std::string> make_keys(size_t count, const std::string& prefix) {
+    std::vector<std::string> keys;
+    keys.reserve(count);
+    for (size_t i = 0; i < count; i++) {
+        keys.push_back(prefix + std::to_string(i));
+    }
+    return keys;
+}
+
+void BM_BloomFilterInsert(benchmark::State& state) {
+    size_t count = state.range(0);
+    auto keys = make_keys(count, "partition-");
+    factdb::BloomFilter filter(count * 10, 7);
+    size_t i = 0;
+    for (auto _ : state) {
+        filter.insert(keys[i++ % count]);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_BloomFilterInsert)->Arg(1 << 10)->Arg(1 << 16);
+
+// range(1) is 1 for keys that were inserted, 0 for keys that were not
+void BM_BloomFilterContains(benchmark::State& state) {
+    size_t count = state.range(0);
+    auto keys = make_keys(count, "partition-");
+    factdb::BloomFilter filter(count * 10, 7);
+    for (const auto& key : keys) {
+        filter.insert(key);
+    }
+    auto probes = state.range(1) ? keys : make_keys(count, "absent-");
+    size_t i = 0;
+    size_t positives = 0;
+    for (auto _ : state) {
+        positives += filter.contains(probes[i++ % count]);
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.counters["positive_rate"] = static_cast<double>(positives) / state.iterations();
+}
+BENCHMARK(BM_BloomFilterContains)->ArgsProduct({{1 << 10, 1 << 16}, {0, 1}})->ArgNames({"keys", "present"});
+}
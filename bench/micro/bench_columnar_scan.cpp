@@ -0,0 +1,87 @@
+#include <benchmark/benchmark.h>
+
+#include <charconv>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "data/columnar_scan.hpp"
+#include "data/memtable.hpp"
+
+namespace {
+std::string key(const char* prefix, size_t i) {
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), "%s%08zu", prefix, i);
+    return buffer;
+}
+
+// a fact table section: 64 partitions, each row with an INT, a FLOAT and two STRING columns
+const std::string& fact_section(size_t rows) {
+    static std::string section;
+    static size_t built = 0;
+    if (built != rows) {
+        factdb::Memtable memtable;
+        for (size_t i = 0; i < rows; i++) {
+            auto row = std::make_shared<factdb::MemtableRow>();
+            row->addcol_(std::make_shared<factdb::MemtableColumn>("qty", factdb::ColumnType::INT, std::to_string(i % 1000)));
+            row->addcol_(std::make_shared<factdb::MemtableColumn>("price", factdb::ColumnType::FLOAT, std::to_string((i % 977) * 0.25)));
+            row->addcol_(std::make_shared<factdb::MemtableColumn>("region", factdb::ColumnType::STRING, i % 2 ? "east" : "west"));
+            row->addcol_(std::make_shared<factdb::MemtableColumn>("note", factdb::ColumnType::STRING, std::string(48, 'n')));
+            memtable.insert(key("p", i % 64), key("c", i), std::make_shared<std::vector<std::shared_ptr<factdb::MemtableRow>>>(1, row));
+        }
+        section = factdb::encode_sstable_section(memtable.get_partitions());
+        built = rows;
+    }
+    return section;
+}
+
+factdb::ColumnScan selective_scan() {
+    factdb::ColumnScan scan;
+    scan.projection = {"price"};
+    scan.predicates = {{"qty", factdb::ColumnType::INT, factdb::PredicateOp::RANGE, {"100", "109"}}};
+    return scan;
+}
+
+void BM_ColumnarScan(benchmark::State& state) {
+    const std::string& section = fact_section(state.range(0));
+    factdb::ColumnScan scan = selective_scan();
+    for (auto _ : state) {
+        double sum = 0;
+        factdb::scan_sections({section}, scan, [&](const factdb::ScanRow& row) { sum += row.values[0].size(); });
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+    state.SetBytesProcessed(state.iterations() * section.size());
+}
+BENCHMARK(BM_ColumnarScan)->Arg(1 << 16)->Unit(benchmark::kMillisecond);
+
+// the same query by decoding every Row and Cell first
+void BM_MaterializedScan(benchmark::State& state) {
+    const std::string& section = fact_section(state.range(0));
+    for (auto _ : state) {
+        double sum = 0;
+        for (const auto& partition : factdb::decode_sstable_section(section.data(), section.size())) {
+            for (const auto& unfiltered : partition->unfiltereds_) {
+                const auto& row = static_cast<const factdb::Row&>(*unfiltered);
+                const std::vector<char>* qty = nullptr;
+                const std::vector<char>* price = nullptr;
+                for (const auto& cell : row.cells_) {
+                    std::string name(cell.value_.key_.begin(), cell.value_.key_.end());
+                    if (name == "qty") qty = &cell.value_.value_;
+                    if (name == "price") price = &cell.value_.value_;
+                }
+                int64_t value = 0;
+                if (qty && std::from_chars(qty->data(), qty->data() + qty->size(), value).ec == std::errc() &&
+                    value >= 100 && value <= 109 && price) {
+                    sum += price->size();
+                }
+            }
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+    state.SetBytesProcessed(state.iterations() * section.size());
+}
+BENCHMARK(BM_MaterializedScan)->Arg(1 << 16)->Unit(benchmark::kMillisecond);
+}
@@ -0,0 +1,53 @@
+#include <benchmark/benchmark.h>
+
+#include <filesystem>
+#include <string>
+
+#include "logger/logging.hpp"
+
+namespace {
+std::string log_path() {
+    return (std::filesystem::temp_directory_path() / "factdb_bench_logger.log").string();
+}
+
+void BM_LoggerLogSync(benchmark::State& state) {
+    auto& logger = factdb::Logger::get_instance();
+    if (state.thread_index() == 0) {
+        logger.configure(log_path(), factdb::LogLevel::INFO);
+    }
+    std::string message = "flushed memtable of 4096 rows to fdb-17-Data.db";
+    for (auto _ : state) {
+        logger.log(factdb::LogLevel::INFO, message);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_LoggerLogSync)->Threads(1)->Threads(4);
+
+void BM_LoggerLogAsync(benchmark::State& state) {
+    auto& logger = factdb::Logger::get_instance();
+    if (state.thread_index() == 0) {
+        logger.configure(log_path(), factdb::LogLevel::INFO);
+        logger.start_async();
+    }
+    std::string message = "flushed memtable of 4096 rows to fdb-17-Data.db";
+    for (auto _ : state) {
+        logger.log(factdb::LogLevel::INFO, message);
+    }
+    state.SetItemsProcessed(state.iterations());
+    if (state.thread_index() == 0) {
+        logger.stop_async();
+        std::filesystem::remove(log_path());
+    }
+}
+BENCHMARK(BM_LoggerLogAsync)->Threads(1)->Threads(4);
+
+void BM_LoggerDisabledLevel(benchmark::State& state) {
+    auto& logger = factdb::Logger::get_instance();
+    logger.configure("", factdb::LogLevel::WARNING);
+    for (auto _ : state) {
+        FACTDB_LOG_DEBUG("row %d of partition %s", 42, "p000042");
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_LoggerDisabledLevel);
+}
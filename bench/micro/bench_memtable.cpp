@@ -0,0 +1,70 @@
+#include <benchmark/benchmark.h>
+
+#include <cstdio>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "data/memtable.hpp"
+
+namespace {
+factdb::MemtableRows make_value(const std::string& value) {
+    auto row = std::make_shared<factdb::MemtableRow>();
+    row->addcol_(std::make_shared<factdb::MemtableColumn>("val", factdb::ColumnType::STRING, value));
+    return std::make_shared<std::vector<std::shared_ptr<factdb::MemtableRow>>>(1, row);
+}
+
+std::string key(const char* prefix, size_t i) {
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), "%s%08zu", prefix, i);
+    return buffer;
+}
+
+// range(0) rows spread over range(1) partitions
+void BM_MemtableInsert(benchmark::State& state) {
+    size_t rows = state.range(0);
+    size_t partitions = state.range(1);
+    auto value = make_value(std::string(64, 'v'));
+    for (auto _ : state) {
+        factdb::Memtable memtable;
+        for (size_t i = 0; i < rows; i++) {
+            memtable.insert(key("p", i % partitions), key("c", i), value);
+        }
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * rows);
+}
+BENCHMARK(BM_MemtableInsert)->ArgsProduct({{1 << 12, 1 << 16}, {1, 64}})->ArgNames({"rows", "partitions"})
+    ->Unit(benchmark::kMillisecond);
+
+void BM_MemtableFlush(benchmark::State& state) {
+    size_t rows = state.range(0);
+    std::string path = (std::filesystem::temp_directory_path() / "factdb_bench_flush" / "fdb-1-Data.db").string();
+    auto value = make_value(std::string(64, 'v'));
+    for (auto _ : state) {
+        state.PauseTiming();
+        factdb::Memtable memtable;
+        for (size_t i = 0; i < rows; i++) {
+            memtable.insert(key("p", i % 64), key("c", i), value);
+        }
+        state.ResumeTiming();
+        benchmark::DoNotOptimize(memtable.flush_to_sstable(path));
+    }
+    state.SetItemsProcessed(state.iterations() * rows);
+    std::filesystem::remove_all(std::filesystem::path(path).parent_path());
+}
+BENCHMARK(BM_MemtableFlush)->Arg(1 << 12)->Arg(1 << 16)->ArgName("rows")->Unit(benchmark::kMillisecond);
+
+void BM_MemtableColumnSerialize(benchmark::State& state) {
+    factdb::MemtableColumn column("score", factdb::ColumnType::FLOAT, "");
+    double value = 0.5;
+    for (auto _ : state) {
+        column.serialize_col_(value);
+        benchmark::DoNotOptimize(column.deserialize_col_<double>());
+        value += 1.25;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_MemtableColumnSerialize);
+}
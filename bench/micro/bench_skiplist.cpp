@@ -0,0 +1,79 @@
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "internal/consts.hpp"
+#include "internal/skiplist.hpp"
+
+namespace {
+enum Distribution { SEQUENTIAL = 0, RANDOM = 1, REVERSE = 2 };
+
+std::vector<int64_t> make_keys(size_t count, int distribution) {
+    std::vector<int64_t> keys(count);
+    for (size_t i = 0; i < count; i++) {
+        keys[i] = static_cast<int64_t>(i);
+    }
+    if (distribution == RANDOM) {
+        std::shuffle(keys.begin(), keys.end(), std::mt19937_64(42));
+    } else if (distribution == REVERSE) {
+        std::reverse(keys.begin(), keys.end());
+    }
+    return keys;
+}
+
+void distribution_args(benchmark::internal::Benchmark* bench) {
+    for (int64_t size : {1 << 10, 1 << 14, 1 << 17}) {
+        for (int distribution : {SEQUENTIAL, RANDOM, REVERSE}) {
+            bench->Args({size, distribution});
+        }
+    }
+    bench->ArgNames({"size", "dist"});
+}
+
+void BM_SkipListInsert(benchmark::State& state) {
+    auto keys = make_keys(state.range(0), static_cast<int>(state.range(1)));
+    for (auto _ : state) {
+        factdb::SkipList<int64_t, int64_t> list(MAX_SKIPLIST_HEIGHT, NEW_SKIPLIST_LAYER_PROB);
+        for (int64_t key : keys) {
+            list.insert(key, key);
+        }
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * keys.size());
+}
+BENCHMARK(BM_SkipListInsert)->Apply(distribution_args)->Unit(benchmark::kMicrosecond);
+
+void BM_SkipListFind(benchmark::State& state) {
+    auto keys = make_keys(state.range(0), static_cast<int>(state.range(1)));
+    factdb::SkipList<int64_t, int64_t> list(MAX_SKIPLIST_HEIGHT, NEW_SKIPLIST_LAYER_PROB);
+    for (int64_t key : keys) {
+        list.insert(key, key);
+    }
+    size_t i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(list.find_entry(keys[i++ % keys.size()]));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_SkipListFind)->Apply(distribution_args);
+
+void BM_SkipListIterate(benchmark::State& state) {
+    auto keys = make_keys(state.range(0), RANDOM);
+    factdb::SkipList<int64_t, int64_t> list(MAX_SKIPLIST_HEIGHT, NEW_SKIPLIST_LAYER_PROB);
+    for (int64_t key : keys) {
+        list.insert(key, key);
+    }
+    for (auto _ : state) {
+        int64_t sum = 0;
+        for (auto& entry : list) {
+            sum += entry.key_;
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations() * keys.size());
+}
+BENCHMARK(BM_SkipListIterate)->Arg(1 << 10)->Arg(1 << 14)->Arg(1 << 17)->Unit(benchmark::kMicrosecond);
+}
@@ -0,0 +1,102 @@
+#include <benchmark/benchmark.h>
+
+#include <cstdio>
+#include <filesystem>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "data/sstable.hpp"
+#include "io/block_cache.hpp"
+
+namespace {
+constexpr size_t PARTITIONS = 50000;
+constexpr size_t ROWS_PER_PARTITION = 16;
+
+// tenant/date/metric partition keys and timestamp clustering keys, as in our fact tables
+std::vector<char> partition_key(size_t i) {
+    char buffer[64];
+    int n = std::snprintf(buffer, sizeof(buffer), "tenant-%04zu/2024-03-%02zu/metric-%06zu", i / 5000, 1 + (i / 500) % 10, i);
+    return std::vector<char>(buffer, buffer + n);
+}
+std::vector<char> clustering_key(size_t row) {
+    char buffer[64];
+    int n = std::snprintf(buffer, sizeof(buffer), "2024-03-01T10:%02zu:%02zu.%06zu", row / 60, row % 60, row);
+    return std::vector<char>(buffer, buffer + n);
+}
+
+struct Fixture {
+    std::string path = (std::filesystem::temp_directory_path() / "factdb_bench_lookup" / "fdb-1-Data.db").string();
+    factdb::BlockCache cache{1ull << 30};
+    std::shared_ptr<factdb::SSTable> table;
+
+    Fixture() {
+        std::vector<std::shared_ptr<factdb::Partition>> partitions;
+        for (size_t i = 0; i < PARTITIONS; i++) {
+            auto partition = std::make_shared<factdb::Partition>();
+            partition->header_.key_ = partition_key(i);
+            for (size_t r = 0; r < ROWS_PER_PARTITION; r++) {
+                auto row = std::make_shared<factdb::Row>();
+                auto block = std::make_shared<factdb::ClusteringBlock>();
+                factdb::CellValue key;
+                key.key_ = clustering_key(r);
+                block->clustering_cells_.emplace_back(key);
+                row->clustering_blocks_.push_back(block);
+                factdb::CellValue value;
+                value.key_ = {'v'};
+                value.value_ = std::vector<char>(16, 'x');
+                row->cells_.emplace_back(value);
+                partition->unfiltereds_.push_back(row);
+            }
+            partitions.push_back(partition);
+        }
+        factdb::SSTableWriteOptions options;
+        options.block_cache = &cache; // lookups measure decoding, not the file system
+        factdb::SSTable(path, partitions).write_to_file(options);
+        table = std::make_shared<factdb::SSTable>(path);
+        table->set_block_cache(&cache);
+        table->open();
+    }
+};
+Fixture& fixture() {
+    static Fixture instance;
+    return instance;
+}
+void report_sizes(benchmark::State& state) {
+    const std::string& path = fixture().path;
+    state.counters["index_bytes"] = std::filesystem::file_size(factdb::sstable_component_path(path, factdb::SSTableComponent::INDEX));
+    state.counters["data_bytes"] = std::filesystem::file_size(path);
+}
+
+void BM_SSTableReadPartition(benchmark::State& state) {
+    auto& table = *fixture().table;
+    std::mt19937_64 random(42);
+    std::vector<std::vector<char>> keys;
+    for (size_t i = 0; i < 4096; i++) {
+        keys.push_back(partition_key(random() % PARTITIONS));
+    }
+    size_t next = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(table.read_partition(keys[next++ % keys.size()]));
+    }
+    report_sizes(state);
+}
+BENCHMARK(BM_SSTableReadPartition);
+
+void BM_SSTableReadRow(benchmark::State& state) {
+    auto& table = *fixture().table;
+    std::mt19937_64 random(7);
+    std::vector<std::pair<std::vector<char>, std::vector<char>>> keys;
+    for (size_t i = 0; i < 4096; i++) {
+        keys.emplace_back(partition_key(random() % PARTITIONS), clustering_key(random() % ROWS_PER_PARTITION));
+    }
+    size_t next = 0;
+    for (auto _ : state) {
+        const auto& [partition, row] = keys[next++ % keys.size()];
+        benchmark::DoNotOptimize(table.read_row(partition, row));
+    }
+    report_sizes(state);
+}
+BENCHMARK(BM_SSTableReadRow);
+}
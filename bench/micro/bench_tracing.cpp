@@ -0,0 +1,29 @@
+#include <benchmark/benchmark.h>
+
+#include "metrics/tracing.hpp"
+
+namespace {
+// a request entry point with one stage span, as on Table::get
+void BM_TraceScopeDisabled(benchmark::State& state) {
+    factdb::Tracer::global().set_probability(0);
+    for (auto _ : state) {
+        auto request = factdb::TraceScope::request("request");
+        factdb::TraceScope span("stage");
+        benchmark::DoNotOptimize(request.active());
+    }
+}
+BENCHMARK(BM_TraceScopeDisabled);
+
+void BM_TraceScopeSampled(benchmark::State& state) {
+    auto& tracer = factdb::Tracer::global();
+    tracer.set_probability(1);
+    for (auto _ : state) {
+        auto request = factdb::TraceScope::request("request");
+        factdb::TraceScope span("stage");
+        benchmark::DoNotOptimize(request.active());
+    }
+    tracer.set_probability(0);
+    tracer.clear();
+}
+BENCHMARK(BM_TraceScopeSampled);
+}
@@ -0,0 +1,87 @@
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "data/typed_schema.hpp"
+
+namespace {
+struct Reading {
+    std::string sensor;
+    int64_t at;
+    double value;
+    int32_t quality;
+    std::string unit;
+
+    static constexpr auto columns = std::make_tuple(
+        factdb::column("sensor", &Reading::sensor, factdb::ColumnRole::PARTITION),
+        factdb::column("at", &Reading::at, factdb::ColumnRole::CLUSTERING),
+        factdb::column("value", &Reading::value),
+        factdb::column("quality", &Reading::quality),
+        factdb::column("unit", &Reading::unit));
+};
+using ReadingSchema = factdb::TypedSchema<Reading>;
+
+Reading sample(int64_t i) {
+    return Reading{"sensor-0042", i, i * 0.25, static_cast<int32_t>(i % 100), "kPa"};
+}
+
+// encode then decode one record through the compile-time codec
+void BM_TypedRowCodec(benchmark::State& state) {
+    int64_t i = 0;
+    std::string buffer;
+    for (auto _ : state) {
+        buffer.clear();
+        ReadingSchema::encode(sample(i++), buffer);
+        benchmark::DoNotOptimize(ReadingSchema::decode(buffer));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_TypedRowCodec);
+
+// the same record through MemtableRow: named columns, text values, hashed lookups
+void BM_DynamicRowCodec(benchmark::State& state) {
+    int64_t i = 0;
+    for (auto _ : state) {
+        Reading in = sample(i++);
+        factdb::MemtableRow row;
+        auto column = [&](const char* name, factdb::ColumnType type, const auto& value) {
+            auto col = std::make_shared<factdb::MemtableColumn>();
+            col->setcolname_(name);
+            col->setcoltype_(type);
+            col->serialize_col_(value);
+            row.addcol_(col);
+        };
+        column("sensor", factdb::ColumnType::STRING, in.sensor);
+        column("at", factdb::ColumnType::INT, in.at);
+        column("value", factdb::ColumnType::FLOAT, in.value);
+        column("quality", factdb::ColumnType::INT, in.quality);
+        column("unit", factdb::ColumnType::STRING, in.unit);
+        Reading out;
+        out.sensor = row.getcol_("sensor")->deserialize_col_<std::string>();
+        out.at = row.getcol_("at")->deserialize_col_<int64_t>();
+        out.value = row.getcol_("value")->deserialize_col_<double>();
+        out.quality = row.getcol_("quality")->deserialize_col_<int32_t>();
+        out.unit = row.getcol_("unit")->deserialize_col_<std::string>();
+        benchmark::DoNotOptimize(out);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_DynamicRowCodec);
+
+void BM_TypedCompare(benchmark::State& state) {
+    std::vector<Reading> readings;
+    for (int64_t i = 0; i < 1024; i++) {
+        readings.push_back(sample((i * 7919) % 1024));
+    }
+    size_t next = 0;
+    for (auto _ : state) {
+        const Reading& a = readings[next++ % readings.size()];
+        const Reading& b = readings[next % readings.size()];
+        benchmark::DoNotOptimize(ReadingSchema::compare(a, b));
+    }
+}
+BENCHMARK(BM_TypedCompare);
+}
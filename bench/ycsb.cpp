@@ -0,0 +1,372 @@
+// YCSB core workloads A-F run in process against a Table in a local data
+// directory. The load phase inserts --records records of --fields fields;
+// the run phase then drives --threads threads for --seconds, discarding the
+// first --warmup seconds, and prints throughput and latency percentiles per
+// operation every --interval-ms plus a summary at the end.
+// YCSB keys are spread over --partitions partitions with the key as the
+// cluster key, so a SCAN reads the next keys within the start key's partition.
+//   factdb_ycsb [--workload A|B|C|D|E|F] [--distribution zipfian|uniform|latest]
+//               [--records N] [--fields N] [--field-length N] [--threads N]
+//               [--seconds S] [--warmup S] [--interval-ms N] [--partitions N]
+//               [--max-scan N] [--memtable-rows N] [--data DIR] [--skip-load] [--no-commitlog]
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "data/table.hpp"
+#include "metrics/metrics.hpp"
+
+namespace {
+using Clock = std::chrono::steady_clock;
+
+enum Operation { READ = 0, UPDATE, INSERT, SCAN, READ_MODIFY_WRITE, OPERATION_COUNT };
+const char* OPERATION_NAMES[] = {"READ", "UPDATE", "INSERT", "SCAN", "READ_MODIFY_WRITE"};
+
+enum class Distribution { ZIPFIAN, UNIFORM, LATEST };
+
+struct Workload {
+    double proportions[OPERATION_COUNT];
+    Distribution distribution;
+};
+
+// the proportions of the YCSB core workload files
+Workload core_workload(char name) {
+    switch (name) {
+        case 'A': return {{0.5, 0.5, 0, 0, 0}, Distribution::ZIPFIAN};
+        case 'B': return {{0.95, 0.05, 0, 0, 0}, Distribution::ZIPFIAN};
+        case 'C': return {{1, 0, 0, 0, 0}, Distribution::ZIPFIAN};
+        case 'D': return {{0.95, 0, 0.05, 0, 0}, Distribution::LATEST};
+        case 'E': return {{0, 0, 0.05, 0.95, 0}, Distribution::ZIPFIAN};
+        case 'F': return {{0.5, 0, 0, 0, 0.5}, Distribution::ZIPFIAN};
+    }
+    throw std::invalid_argument(std::string("unknown workload ") + name);
+}
+
+struct Options {
+    char workload = 'A';
+    std::string distribution;   // overrides the workload's when set
+    uint64_t records = 100000;
+    size_t fields = 10;
+    size_t field_length = 100;
+    size_t threads = 4;
+    double seconds = 30;
+    double warmup = 5;
+    size_t interval_ms = 1000;
+    size_t partitions = 64;
+    size_t max_scan = 100;
+    uint64_t memtable_rows = 200000;
+    std::string data_dir = (std::filesystem::temp_directory_path() / "factdb_ycsb").string();
+    bool skip_load = false;
+    bool use_commitlog = true;
+};
+
+uint64_t fnv_hash64(uint64_t value) {
+    uint64_t hash = 0xCBF29CE484222325ull;
+    for (int i = 0; i < 8; i++) {
+        hash ^= value & 0xff;
+        hash *= 1099511628211ull;
+        value >>= 8;
+    }
+    return hash;
+}
+
+// record i's key, hashed so inserts are not in key order (YCSB's default)
+std::string record_key(uint64_t i) {
+    char key[32];
+    std::snprintf(key, sizeof(key), "user%020llu", static_cast<unsigned long long>(fnv_hash64(i)));
+    return key;
+}
+
+// Gray et al.'s Zipfian generator as YCSB implements it, over [0, items)
+// with constant 0.99; the constants are shared, the random source is not.
+class ZipfianGenerator {
+public:
+    explicit ZipfianGenerator(uint64_t items, double theta = 0.99) : items_(items), theta_(theta) {
+        double zeta2 = zeta_(2);
+        zetan_ = zeta_(items);
+        alpha_ = 1.0 / (1.0 - theta_);
+        eta_ = (1 - std::pow(2.0 / items_, 1 - theta_)) / (1 - zeta2 / zetan_);
+    }
+    uint64_t next(std::mt19937_64& rng) const {
+        double u = std::uniform_real_distribution<double>(0, 1)(rng);
+        double uz = u * zetan_;
+        if (uz < 1) return 0;
+        if (uz < 1 + std::pow(0.5, theta_)) return 1;
+        return std::min<uint64_t>(items_ - 1, static_cast<uint64_t>(items_ * std::pow(eta_ * u - eta_ + 1, alpha_)));
+    }
+
+private:
+    uint64_t items_;
+    double theta_;
+    double zetan_;
+    double alpha_;
+    double eta_;
+
+    double zeta_(uint64_t n) const {
+        double sum = 0;
+        for (uint64_t i = 1; i <= n; i++) sum += 1 / std::pow(static_cast<double>(i), theta_);
+        return sum;
+    }
+};
+
+class KeyChooser {
+public:
+    KeyChooser(Distribution distribution, uint64_t records) : distribution_(distribution), zipfian_(std::max<uint64_t>(records, 2)) {}
+
+    // record number among the `inserted` records written so far
+    uint64_t next(std::mt19937_64& rng, uint64_t inserted) const {
+        switch (distribution_) {
+            case Distribution::UNIFORM:
+                return rng() % inserted;
+            case Distribution::LATEST: // most recent inserts are the hottest
+                return inserted - 1 - std::min(zipfian_.next(rng), inserted - 1);
+            case Distribution::ZIPFIAN:
+                break;
+        }
+        return fnv_hash64(zipfian_.next(rng)) % inserted; // scrambled, so hot keys are not adjacent
+    }
+
+private:
+    Distribution distribution_;
+    ZipfianGenerator zipfian_;
+};
+
+class Driver {
+public:
+    explicit Driver(const Options& options)
+        : options_(options), workload_(core_workload(options.workload)),
+          chooser_(resolve_distribution_(), options.records), inserted_(options.records) {
+        factdb::TableOptions table_options;
+        table_options.data_dir = options.data_dir;
+        table_options.use_commitlog = options.use_commitlog;
+        table_ = std::make_unique<factdb::Table>(table_options);
+        for (auto& histogram : histograms_) histogram = std::make_unique<factdb::Histogram>();
+    }
+
+    bool open() { return table_->open(); }
+
+    void load() {
+        auto start = Clock::now();
+        std::vector<std::thread> threads;
+        std::atomic<uint64_t> next(0);
+        for (size_t t = 0; t < options_.threads; t++) {
+            threads.emplace_back([this, &next, t] {
+                std::mt19937_64 rng(t);
+                for (uint64_t i = next++; i < options_.records; i = next++) {
+                    table_->insert(partition_of_(i), record_key(i), make_record_(rng, options_.fields));
+                    count_write_();
+                }
+            });
+        }
+        for (auto& thread : threads) thread.join();
+        table_->flush();
+        double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+        std::cout << "# loaded " << options_.records << " records in " << elapsed << " s ("
+                  << options_.records / elapsed << " records/s), " << table_->sstables().size() << " sstables\n";
+    }
+
+    void run() {
+        std::atomic<bool> done(false);
+        std::atomic<bool> measuring(options_.warmup <= 0);
+        std::vector<std::thread> threads;
+        for (size_t t = 0; t < options_.threads; t++) {
+            threads.emplace_back([this, t, &done, &measuring] { client_(t, done, measuring); });
+        }
+        auto start = Clock::now();
+        auto warmup_end = start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(options_.warmup));
+        auto end = warmup_end + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(options_.seconds));
+        if (!measuring) {
+            std::this_thread::sleep_until(warmup_end);
+            measuring = true;
+        }
+        auto measured_start = Clock::now();
+        std::vector<factdb::HistogramSnapshot> previous(OPERATION_COUNT);
+        for (size_t i = 0; i < OPERATION_COUNT; i++) previous[i] = histograms_[i]->snapshot();
+        std::vector<factdb::HistogramSnapshot> first = previous;
+        std::cout << "elapsed_s,operation,ops_per_s,p50_us,p95_us,p99_us,p999_us\n";
+        auto interval = std::chrono::milliseconds(options_.interval_ms);
+        auto last = measured_start;
+        while (Clock::now() < end) {
+            std::this_thread::sleep_until(std::min(last + interval, end));
+            auto now = Clock::now();
+            report_(previous, std::chrono::duration<double>(now - measured_start).count(),
+                    std::chrono::duration<double>(now - last).count(), true);
+            last = now;
+        }
+        done = true;
+        for (auto& thread : threads) thread.join();
+        std::cout << "# summary over " << options_.seconds << " s after " << options_.warmup << " s of warm-up\n";
+        report_(first, std::chrono::duration<double>(last - measured_start).count(),
+                std::chrono::duration<double>(last - measured_start).count(), false);
+    }
+
+private:
+    const Options& options_;
+    Workload workload_;
+    KeyChooser chooser_;
+    std::unique_ptr<factdb::Table> table_;
+    std::unique_ptr<factdb::Histogram> histograms_[OPERATION_COUNT];
+    std::atomic<uint64_t> inserted_;            // records 0..inserted_-1 exist
+    std::atomic<uint64_t> writes_since_flush_{0};
+
+    Distribution resolve_distribution_() const {
+        if (options_.distribution == "uniform") return Distribution::UNIFORM;
+        if (options_.distribution == "latest") return Distribution::LATEST;
+        if (options_.distribution == "zipfian") return Distribution::ZIPFIAN;
+        return workload_.distribution;
+    }
+
+    std::string partition_of_(uint64_t record) const {
+        return "usertable-" + std::to_string(fnv_hash64(record) % options_.partitions);
+    }
+
+    factdb::MemtableRows make_record_(std::mt19937_64& rng, size_t fields, size_t first_field = 0) const {
+        auto row = std::make_shared<factdb::MemtableRow>();
+        for (size_t f = first_field; f < first_field + fields; f++) {
+            std::string value(options_.field_length, ' ');
+            for (auto& c : value) c = static_cast<char>(' ' + rng() % 95);
+            row->addcol_(std::make_shared<factdb::MemtableColumn>("field" + std::to_string(f), factdb::ColumnType::STRING, value));
+        }
+        return std::make_shared<std::vector<std::shared_ptr<factdb::MemtableRow>>>(1, row);
+    }
+
+    // the memtable has no size limit of its own, so writers take turns flushing it
+    void count_write_() {
+        if (++writes_since_flush_ == options_.memtable_rows) {
+            writes_since_flush_ = 0;
+            table_->flush();
+        }
+    }
+
+    Operation choose_operation_(std::mt19937_64& rng) const {
+        double u = std::uniform_real_distribution<double>(0, 1)(rng);
+        for (size_t i = 0; i < OPERATION_COUNT; i++) {
+            if (u < workload_.proportions[i]) return static_cast<Operation>(i);
+            u -= workload_.proportions[i];
+        }
+        return READ;
+    }
+
+    void client_(size_t id, std::atomic<bool>& done, std::atomic<bool>& measuring) {
+        std::mt19937_64 rng(1000 + id);
+        while (!done.load(std::memory_order_relaxed)) {
+            Operation operation = choose_operation_(rng);
+            auto start = Clock::now();
+            if (operation == INSERT) {
+                uint64_t record = inserted_.fetch_add(1);
+                table_->insert(partition_of_(record), record_key(record), make_record_(rng, options_.fields));
+                count_write_();
+            } else {
+                uint64_t record = chooser_.next(rng, inserted_.load(std::memory_order_relaxed));
+                std::string partition = partition_of_(record);
+                std::string key = record_key(record);
+                switch (operation) {
+                    case READ:
+                        table_->get(partition, key);
+                        break;
+                    case UPDATE: // one field, like YCSB's default writeallfields=false
+                        table_->update(partition, key, make_record_(rng, 1, rng() % options_.fields));
+                        count_write_();
+                        break;
+                    case SCAN:
+                        table_->scan(partition, key, "", 1 + rng() % options_.max_scan);
+                        break;
+                    case READ_MODIFY_WRITE:
+                        table_->get(partition, key);
+                        table_->update(partition, key, make_record_(rng, 1, rng() % options_.fields));
+                        count_write_();
+                        break;
+                    default:
+                        break;
+                }
+            }
+            if (measuring.load(std::memory_order_relaxed)) {
+                histograms_[operation]->record(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count());
+            }
+        }
+    }
+
+    // prints what was recorded since `since`, then moves `since` forward when rolling
+    void report_(std::vector<factdb::HistogramSnapshot>& since, double elapsed, double window, bool rolling) {
+        for (size_t i = 0; i < OPERATION_COUNT; i++) {
+            factdb::HistogramSnapshot now = histograms_[i]->snapshot();
+            factdb::HistogramSnapshot delta = now;
+            delta.count -= since[i].count;
+            delta.sum -= since[i].sum;
+            for (size_t b = 0; b < delta.buckets.size(); b++) delta.buckets[b] -= since[i].buckets[b];
+            if (rolling) since[i] = std::move(now);
+            if (delta.count == 0) continue;
+            std::printf("%.1f,%s,%.0f,%.1f,%.1f,%.1f,%.1f\n", elapsed, OPERATION_NAMES[i], delta.count / window,
+                        delta.quantile(0.5) / 1000, delta.quantile(0.95) / 1000, delta.quantile(0.99) / 1000,
+                        delta.quantile(0.999) / 1000);
+        }
+        std::fflush(stdout);
+    }
+};
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--skip-load") { options.skip_load = true; continue; }
+        if (arg == "--no-commitlog") { options.use_commitlog = false; continue; }
+        if (i + 1 >= argc) {
+            std::cerr << "missing value for " << arg << "\n";
+            return 1;
+        }
+        const char* value = argv[++i];
+        if (arg == "--workload") options.workload = static_cast<char>(std::toupper(value[0]));
+        else if (arg == "--distribution") options.distribution = value;
+        else if (arg == "--records") options.records = std::strtoull(value, nullptr, 10);
+        else if (arg == "--fields") options.fields = std::strtoull(value, nullptr, 10);
+        else if (arg == "--field-length") options.field_length = std::strtoull(value, nullptr, 10);
+        else if (arg == "--threads") options.threads = std::strtoull(value, nullptr, 10);
+        else if (arg == "--seconds") options.seconds = std::atof(value);
+        else if (arg == "--warmup") options.warmup = std::atof(value);
+        else if (arg == "--interval-ms") options.interval_ms = std::strtoull(value, nullptr, 10);
+        else if (arg == "--partitions") options.partitions = std::strtoull(value, nullptr, 10);
+        else if (arg == "--max-scan") options.max_scan = std::strtoull(value, nullptr, 10);
+        else if (arg == "--memtable-rows") options.memtable_rows = std::strtoull(value, nullptr, 10);
+        else if (arg == "--data") options.data_dir = value;
+        else {
+            std::cerr << "unknown option " << arg << "\n";
+            return 1;
+        }
+    }
+    if (options.records == 0 || options.fields == 0 || options.partitions == 0 || options.threads == 0 ||
+        options.max_scan == 0 || options.memtable_rows == 0) {
+        std::cerr << "--records, --fields, --partitions, --threads, --max-scan and --memtable-rows must be positive\n";
+        return 1;
+    }
+    try {
+        if (!options.skip_load) {
+            std::filesystem::remove_all(options.data_dir);
+        }
+        Driver driver(options);
+        if (!driver.open()) {
+            std::cerr << "failed to open " << options.data_dir << "\n";
+            return 1;
+        }
+        std::cout << "# workload " << options.workload << ", " << options.records << " records, " << options.threads
+                  << " threads, data in " << options.data_dir << "\n";
+        if (!options.skip_load) {
+            driver.load();
+        }
+        driver.run();
+    } catch (const std::exception& error) {
+        std::cerr << error.what() << "\n";
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,75 @@
+#ifndef COORDINATOR_FACTDB_HPP
+#define COORDINATOR_FACTDB_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "cluster/token_ring.hpp"
+#include "net/peer_connection.hpp"
+#include "net/protocol.hpp"
+#include "runtime/reactor.hpp"
+
+namespace factdb {
+
+struct CoordinatorOptions {
+    size_t replication_factor = 3;
+    std::chrono::milliseconds timeout{2000};  // per request, across all replicas
+};
+
+struct CoordinatorStats {
+    uint64_t requests = 0;
+    uint64_t replica_requests = 0;  // sent to other nodes
+    uint64_t unavailable = 0;       // too many replicas failed to meet the level
+    uint64_t timeouts = 0;
+};
+
+// Runs a request against every replica of its partition key in parallel
+// and answers as soon as the consistency level is met: one ack for ONE, a
+// majority for QUORUM, every replica for ALL. The local replica goes
+// through `local`; the others get the request with LOCAL consistency over
+// a pipelined connection owned by the calling shard. A read waits for as
+// many answers and returns every row any of them holds. Rows carry no write
+// timestamps, so overlapping read and write quorums do not make reads
+// consistent: a newer value and an older one cannot be told apart, and a
+// row deleted on some replicas is still returned from the others until
+// repair. Stop the reactor before destroying the coordinator.
+class Coordinator {
+public:
+    using LocalHandler = std::function<Future<Response>(const Request&)>;
+
+    Coordinator(Reactor& reactor, TokenRing ring, std::string local_id, CoordinatorOptions options = CoordinatorOptions());
+
+    // must be called from a reactor shard
+    Future<Response> coordinate(const Request& request, const LocalHandler& local);
+
+    static size_t required_acks(ConsistencyLevel level, size_t replicas);
+    const TokenRing& ring() const { return ring_; }
+    const std::string& local_id() const { return local_id_; }
+    CoordinatorStats stats() const;
+
+private:
+    Reactor& reactor_;
+    TokenRing ring_;
+    std::string local_id_;
+    CoordinatorOptions options_;
+    std::vector<std::unordered_map<std::string, std::shared_ptr<PeerConnection>>> peers_; // per shard, by node id
+    std::atomic<uint64_t> requests_{0};
+    std::atomic<uint64_t> replica_requests_{0};
+    std::atomic<uint64_t> unavailable_{0};
+    std::atomic<uint64_t> timeouts_{0};
+
+    Future<Response> replicate_(const Request& request, const LocalHandler& local);
+    std::shared_ptr<PeerConnection> peer_(size_t shard, const NodeEndpoint& node);
+};
+
+// parses "ONE", "QUORUM", "ALL" or "LOCAL", case-sensitively
+ConsistencyLevel parse_consistency_level(const std::string& name);
+
+}
+#endif
@@ -0,0 +1,87 @@
+#ifndef REPAIR_FACTDB_HPP
+#define REPAIR_FACTDB_HPP
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "cluster/token_ring.hpp"
+#include "data/sharded_table.hpp"
+#include "net/protocol.hpp"
+#include "runtime/future.hpp"
+
+namespace factdb {
+
+constexpr size_t MERKLE_MAX_DEPTH = 20;
+
+// Order-independent digest of one row version: the cells are summed, since
+// two nodes need not hold a row's columns in the same order.
+uint64_t row_digest(const std::vector<char>& partition_key, const Row& row);
+
+// Merkle tree over one token range. The 2^depth leaves split the range
+// evenly in token space and XOR the digests of the rows whose partition
+// token falls in them, so rows can be added in any order; inner nodes hash
+// their two children.
+class MerkleTree {
+public:
+    MerkleTree(TokenRange range, size_t depth);
+
+    void add(Token token, uint64_t digest);
+    void set_leaves(std::vector<uint64_t> leaves);
+
+    const TokenRange& range() const { return range_; }
+    size_t depth() const { return depth_; }
+    size_t leaf_count() const { return size_t(1) << depth_; }
+    size_t leaf_of(Token token) const;
+    TokenRange leaf_range(size_t leaf) const;
+    const std::vector<uint64_t>& leaves() const { return leaves_; }
+    uint64_t root() const;
+
+    // leaves whose hashes differ, descending only into differing subtrees
+    std::vector<size_t> difference(const MerkleTree& other) const;
+
+private:
+    TokenRange range_;
+    size_t depth_;
+    std::vector<uint64_t> leaves_;
+    mutable std::vector<uint64_t> inner_;  // heap order, rebuilt when dirty
+    mutable bool dirty_ = true;
+
+    unsigned __int128 width_() const;
+    void rehash_() const;
+    uint64_t node_(size_t index) const;
+};
+
+struct RepairOptions {
+    size_t depth = 10;   // leaves per range = 2^depth
+    std::chrono::milliseconds timeout{60000};  // per request to the peer; streams can be large
+};
+
+struct RepairResult {
+    size_t ranges = 0;
+    size_t leaves = 0;
+    size_t mismatched_leaves = 0;
+    uint64_t tree_bytes = 0;       // leaf hashes received from the peer
+    uint64_t received_bytes = 0;   // SSTable sections streamed from the peer
+    uint64_t sent_bytes = 0;       // SSTable sections streamed to the peer
+    uint64_t rows_received = 0;    // row versions ingested locally
+    uint64_t rows_sent = 0;        // row versions ingested by the peer
+    uint64_t dataset_bytes = 0;    // the local data as one section, what a full copy would move
+};
+
+// Repairs `ranges` between the local node's table and `peer`: fetches the
+// peer's leaf hashes, streams only the leaves that differ, and writes the
+// reconciled rows on each side as a new SSTable. A row that differs on both
+// sides becomes the peer's version with the local columns it lacks filled
+// in, or the tombstone if either side deleted it; there are no write
+// timestamps to decide by. Must be called from a reactor shard.
+Future<RepairResult> repair(Reactor& reactor, ShardedTable& table, const NodeEndpoint& peer,
+                            std::vector<TokenRange> ranges, RepairOptions options = RepairOptions());
+
+// executes MERKLE, STREAM and INGEST requests from a repairing peer
+Future<Response> handle_repair_request(ShardedTable& table, const Request& request);
+
+}
+#endif
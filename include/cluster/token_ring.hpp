@@ -0,0 +1,68 @@
+#ifndef TOKEN_RING_FACTDB_HPP
+#define TOKEN_RING_FACTDB_HPP
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace factdb {
+
+using Token = int64_t;
+
+// MurmurHash3 x64_128 with seed 0; the token is the first 64-bit half read
+// as signed, as in Cassandra's Murmur3Partitioner
+Token murmur3_token(const char* data, size_t length);
+inline Token murmur3_token(const std::string& key) { return murmur3_token(key.data(), key.size()); }
+
+struct NodeEndpoint {
+    std::string id;
+    std::string host;
+    uint16_t port = 0;
+
+    bool operator==(const NodeEndpoint& other) const { return id == other.id; }
+};
+
+// (start, end] on the ring; start == end covers the whole ring
+struct TokenRange {
+    Token start;
+    Token end;
+
+    bool contains(Token token) const {
+        if (start < end) return token > start && token <= end;
+        return token > start || token <= end;  // wraps past the maximum token
+    }
+};
+
+// Consistent-hash ring. Each node owns `vnodes` tokens derived from its id,
+// so every process that lists the same nodes builds the same ring. A key
+// belongs to the first vnode at or after its token; its replicas are the
+// first `replication_factor` distinct nodes walking on from there.
+class TokenRing {
+public:
+    explicit TokenRing(size_t vnodes = 16) : vnodes_(vnodes) {}
+
+    void add_node(const NodeEndpoint& node);
+    void remove_node(const std::string& id);
+
+    std::vector<NodeEndpoint> replicas(Token token, size_t replication_factor) const;
+    std::vector<NodeEndpoint> replicas(const std::string& partition_key, size_t replication_factor) const {
+        return replicas(murmur3_token(partition_key), replication_factor);
+    }
+    // ranges that `id` holds a replica of, one per vnode boundary
+    std::vector<TokenRange> ranges_for(const std::string& id, size_t replication_factor) const;
+
+    const std::vector<NodeEndpoint>& nodes() const { return nodes_; }
+    size_t vnodes() const { return vnodes_; }
+    const NodeEndpoint* find_node(const std::string& id) const;
+
+private:
+    size_t vnodes_;
+    std::vector<NodeEndpoint> nodes_;
+    std::map<Token, size_t> ring_;   // vnode token -> index into nodes_
+
+    std::vector<NodeEndpoint> walk_(std::map<Token, size_t>::const_iterator from, size_t replication_factor) const;
+};
+
+}
+#endif
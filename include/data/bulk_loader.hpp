@@ -0,0 +1,62 @@
+#ifndef BULK_LOADER_FACTDB_HPP
+#define BULK_LOADER_FACTDB_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "data/sstable.hpp"
+
+namespace factdb {
+
+enum class BulkLoadFormat {
+    CSV,      // a header line naming the columns, then one row per line
+    NDJSON    // one flat JSON object per line; null values are left out
+};
+
+struct BulkLoadOptions {
+    std::string data_dir = "./data";   // a Table's directory, or a ShardedTable's when shards > 0
+    size_t shards = 0;                 // routes partitions to "<data_dir>/shard-<i>" as ShardedTable does, and checks its SHARDS
+    BulkLoadFormat format = BulkLoadFormat::CSV;
+    std::string partition_column;      // input columns holding each row's keys
+    std::string clustering_column;
+    size_t threads = 0;                         // 0 means one per hardware thread
+    uint64_t memory_bytes = 256ull << 20;       // for the rows being sorted or written at once
+    uint64_t chunk_bytes = 8ull << 20;          // input a worker parses per work item
+    uint64_t sstable_bytes = 256ull << 20;      // SSTables are cut at partition boundaries past this
+    SSTableWriteOptions write_options;
+};
+
+struct BulkLoadResult {
+    uint64_t rows = 0;            // input rows; duplicates of a key merge into one row
+    uint64_t input_bytes = 0;
+    size_t runs = 0;              // sorted runs spilled to disk
+    std::vector<std::string> sstables;   // data paths written and registered
+};
+
+// Offline loader that writes input rows straight into SSTables, bypassing
+// the commit log and memtable. Workers parse the input in chunks and spill
+// sorted runs of at most their share of memory_bytes; the runs are then
+// merged with a LoserTree in key ranges, one per worker, each writing its
+// own SSTables. Every table's new generations are added to its manifest in
+// one commit at the end, after its schema is saved, so Table::open serves
+// them like flushed ones, and they shadow rows already there.
+//
+// The tables must not be open while loading. A row repeated in the input
+// is merged, later lines winning per column. CSV fields may be quoted but
+// not span lines; an empty unquoted field leaves its column out. Rows do
+// not reach secondary indexes.
+class BulkLoader {
+public:
+    explicit BulkLoader(BulkLoadOptions options);
+
+    // throws std::runtime_error naming the file and offset of a malformed
+    // line; on any failure nothing is registered and the files are removed
+    BulkLoadResult load(const std::vector<std::string>& inputs) const;
+
+private:
+    BulkLoadOptions options_;
+};
+
+}
+#endif
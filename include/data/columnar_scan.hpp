@@ -0,0 +1,100 @@
+#ifndef COLUMNAR_SCAN_FACTDB_HPP
+#define COLUMNAR_SCAN_FACTDB_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "data/memtable.hpp"
+#include "data/sstable/statisticsfile.hpp"
+
+namespace factdb {
+
+// rows are evaluated in blocks of this many, one decoded vector per predicate column
+constexpr size_t SCAN_BLOCK_ROWS = 1024;
+
+enum class PredicateOp {
+    EQ,
+    LT,
+    GT,
+    IN,
+    RANGE   // low <= value <= high
+};
+
+// Operands are in the text form MemtableColumn serializes values to. A row
+// whose value is missing or does not parse as `type` fails the predicate.
+struct ScanPredicate {
+    std::string column;
+    ColumnType type = ColumnType::STRING;   // INT, FLOAT or STRING
+    PredicateOp op = PredicateOp::EQ;
+    std::vector<std::string> operands;      // one; IN: the set; RANGE: low, high
+};
+
+struct ColumnScan {
+    std::vector<std::string> projection;
+    std::vector<ScanPredicate> predicates;  // all of them must hold
+    std::string start;                      // clustering keys in [start, end); an empty end is unbounded
+    std::string end;
+};
+
+enum class BlockMatch {
+    NONE,   // no live row of the block can match
+    SOME,
+    ALL     // every live row matches
+};
+// Judges blocks' zone maps against a scan with its operands parsed once.
+// Throws std::invalid_argument on a malformed predicate. Keeps a reference
+// to `scan`.
+class BlockPruner {
+public:
+    explicit BlockPruner(const ColumnScan& scan);
+
+    // what a block's zone maps prove about its rows under the scan's predicates and key range
+    BlockMatch match(const BlockStatistics& block) const;
+
+private:
+    struct Operands {
+        std::vector<int64_t> ints;
+        std::vector<double> floats;
+    };
+
+    const ColumnScan& scan_;
+    std::vector<Operands> operands_;    // per predicate; STRING operands are used as given
+};
+// BlockPruner(scan).match(block)
+BlockMatch match_block(const BlockStatistics& block, const ColumnScan& scan);
+
+// COUNT(*), then COUNT, MIN, MAX and SUM of one column per type, over the
+// rows a scan matches. String bounds are missing when a value was longer
+// than STATISTICS_MAX_STRING.
+struct ColumnAggregate {
+    uint64_t rows = 0;
+    ColumnStatistics column;
+    size_t blocks_skipped = 0;          // ruled out by their statistics
+    size_t blocks_from_statistics = 0;  // answered by their statistics alone
+    size_t blocks_read = 0;             // an SSTable read without consulting its statistics counts as one
+};
+
+// A matching row. The views point into the scanned data and are only valid
+// during the visitor call; values has one entry per projected column, with
+// a null data() when the row does not have that column.
+struct ScanRow {
+    std::string_view partition_key;
+    std::string_view clustering_key;
+    const std::string_view* values;
+};
+using ScanVisitor = std::function<void(const ScanRow&)>;
+
+// Visits the live rows of `sections` (encode_sstable_section() layouts, which
+// is also the data file layout, newest first) that satisfy every predicate
+// and the key range, in key order. Versions of a row are merged as
+// Table::get merges them. Returns the rows visited. Throws
+// std::invalid_argument on a malformed scan and std::runtime_error on a
+// truncated section.
+size_t scan_sections(const std::vector<std::string_view>& sections, const ColumnScan& scan, const ScanVisitor& visitor);
+
+}
+#endif
@@ -0,0 +1,98 @@
+#ifndef COMMITLOG_FACTDB_HPP
+#define COMMITLOG_FACTDB_HPP
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "io/async_file.hpp"
+
+namespace factdb {
+
+enum class CommitLogSync {
+    // wait() returns once an fdatasync begun after the record was written
+    // completes; concurrent waiters share one (group commit)
+    GROUP,
+    // a background thread fdatasyncs every sync_period and wait() returns
+    // once the record is written, so a crash loses at most a period of writes
+    PERIODIC
+};
+
+struct CommitLogOptions {
+    CommitLogSync sync = CommitLogSync::PERIODIC;
+    std::chrono::milliseconds sync_period{100};
+};
+
+// Append-only log of mutations. Each record is framed as
+//   u32 payload length, u32 crc32(payload), payload
+// and appended at an offset reserved up front, so concurrent appends are all
+// in flight on the I/O engine at once. sync() waits for them and fdatasyncs.
+// Once a write or sync fails the log refuses further appends.
+class CommitLog {
+public:
+    struct Append {
+        std::shared_future<ssize_t> written;    // the record size once its bytes reach the file
+        size_t size = 0;
+    };
+
+    CommitLog(const std::string& path, IoEngine& io_engine = default_io_engine(), CommitLogOptions options = {});
+    ~CommitLog();
+
+    CommitLog(const CommitLog&) = delete;
+    CommitLog& operator=(const CommitLog&) = delete;
+
+    // throws std::runtime_error once the log has failed
+    Append append(const std::string& payload);
+    // Blocks until the record is as durable as the sync policy promises;
+    // false when its write or the sync failed.
+    bool wait(const Append& append);
+    bool sync();
+    bool failed() const { return failed_.load(); }
+    uint64_t size() const { return offset_.load(); }
+    const std::string& get_file_path() const { return file_path_; }
+
+    // calls `apply` for every intact record, stopping at the first torn one
+    static size_t replay(const std::string& path, const std::function<void(const std::string&)>& apply);
+
+private:
+    struct PendingAppend {
+        std::shared_ptr<std::string> buffer;
+        std::shared_future<ssize_t> result;
+    };
+
+    std::string file_path_;
+    IoEngine& io_engine_;
+    CommitLogOptions options_;
+    int fd_;
+    std::atomic<uint64_t> offset_;
+    std::atomic<bool> failed_{false};
+    std::mutex pending_mutex_;
+    std::deque<PendingAppend> pending_;
+
+    // group commit: waiters take a ticket once their record is written and
+    // the leader's fdatasync covers every ticket taken before it started
+    std::mutex sync_mutex_;
+    std::condition_variable synced_;
+    uint64_t sync_tickets_ = 0;
+    uint64_t synced_tickets_ = 0;
+    bool syncing_ = false;
+
+    std::mutex syncer_mutex_;
+    std::condition_variable syncer_cv_;
+    bool stopping_ = false;
+    std::thread syncer_;    // PERIODIC only
+
+    void reap_completed_();
+    void syncer_loop_();
+};
+
+}
+#endif
@@ -0,0 +1,102 @@
+#ifndef COMPACTION_FACTDB_HPP
+#define COMPACTION_FACTDB_HPP
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "data/sstable.hpp"
+#include "data/sstable/datafile.hpp"
+#include "internal/keycompare.hpp"
+
+namespace factdb {
+
+// Row-at-a-time cursor over a sorted SSTable, restricted to partitions in
+// [lower, upper). An empty upper bound means unbounded.
+class SSTableCursor {
+public:
+    SSTableCursor(std::shared_ptr<SSTable> sstable, const std::vector<char>& lower, const std::vector<char>& upper);
+
+    bool exhausted() const { return partition_idx_ >= partition_end_; }
+    void advance();
+
+    const std::shared_ptr<Partition>& partition() const { return sstable_->get_partitions()[partition_idx_]; }
+    const std::shared_ptr<Row>& row() const { return row_; }
+    uint64_t partition_prefix() const { return partition_prefix_; }
+    uint64_t clustering_prefix() const { return clustering_prefix_; }
+
+private:
+    std::shared_ptr<SSTable> sstable_;
+    size_t partition_idx_;
+    size_t partition_end_;
+    size_t row_idx_;
+    std::shared_ptr<Row> row_;
+    uint64_t partition_prefix_;
+    uint64_t clustering_prefix_;
+
+    void load_();
+};
+
+struct SSTableCursorLess {
+    bool operator()(const SSTableCursor& a, const SSTableCursor& b) const {
+        const auto& a_key = a.partition()->header_.key_;
+        const auto& b_key = b.partition()->header_.key_;
+        int result = compare_binary_keys(a_key.data(), a_key.size(), a.partition_prefix(),
+                                         b_key.data(), b_key.size(), b.partition_prefix());
+        if (result != 0) return result < 0;
+        const auto& a_clustering = row_clustering_key(*a.row());
+        const auto& b_clustering = row_clustering_key(*b.row());
+        return compare_binary_keys(a_clustering.data(), a_clustering.size(), a.clustering_prefix(),
+                                   b_clustering.data(), b_clustering.size(), b.clustering_prefix()) < 0;
+    }
+};
+
+struct CompactionOptions {
+    size_t max_threads = 1;
+    size_t min_rows_per_range = 1 << 16;   // compactions smaller than this are not split
+    bool write_outputs = true;
+    SSTableWriteOptions write_options;     // e.g. O_DIRECT so compaction skips the page cache
+    std::function<std::string(size_t)> output_path; // path of the i-th output sstable
+    // merged rows it returns true for are left out of the outputs; called
+    // from every range's thread at once
+    std::function<bool(const Partition&, const Row&)> drop;
+};
+
+struct CompactionResult {
+    std::vector<std::shared_ptr<SSTable>> outputs;
+    uint64_t input_rows = 0;
+    uint64_t output_rows = 0;
+    uint64_t dropped_rows = 0;   // left out by CompactionOptions::drop
+    uint64_t input_bytes = 0;
+    size_t ranges = 0;
+    // distinct partition keys of the inputs, from their merged key sketches:
+    // what the outputs will hold, known before merging
+    uint64_t estimated_partitions = 0;
+};
+
+class Compactor {
+public:
+    explicit Compactor(CompactionOptions options) : options_(std::move(options)) {}
+
+    // inputs must be sorted and ordered oldest to newest; newer rows shadow older ones
+    CompactionResult compact(const std::vector<std::shared_ptr<SSTable>>& inputs) const;
+
+    // split points dividing the inputs' partition keys into `ranges` roughly equal sub-ranges
+    static std::vector<std::vector<char>> split_points(const std::vector<std::shared_ptr<SSTable>>& inputs, size_t ranges);
+    // The inputs' partition sketches merged. An input without them (written
+    // before they existed, or never written) is sketched from its partitions.
+    static PartitionStatistics partition_statistics(const std::vector<std::shared_ptr<SSTable>>& inputs);
+
+private:
+    CompactionOptions options_;
+
+    std::vector<std::shared_ptr<Partition>> merge_range_(const std::vector<std::shared_ptr<SSTable>>& inputs,
+                                                         const std::vector<char>& lower,
+                                                         const std::vector<char>& upper,
+                                                         uint64_t& output_rows, uint64_t& dropped_rows) const;
+};
+
+}
+#endif
@@ -0,0 +1,57 @@
+#ifndef MANIFEST_FACTDB_HPP
+#define MANIFEST_FACTDB_HPP
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "io/async_file.hpp"
+
+namespace factdb {
+
+constexpr uint32_t MANIFEST_MAGIC = 0x4d424446; // "FDBM"
+constexpr uint32_t MANIFEST_VERSION = 1;
+
+// Table of contents for one data directory: the live SSTable generations,
+// oldest first, and the next generation number to hand out. Every change is
+// written to MANIFEST.tmp, fsynced and renamed over MANIFEST, so a crash
+// leaves either the old or the new list and never a directory scan to redo.
+//
+// File layout: u32 magic, u32 version, u64 next generation, u32 table count,
+// u64 generation per table, u32 crc32 of everything before it.
+class Manifest {
+public:
+    Manifest(const std::string& directory, IoEngine& io_engine = default_io_engine());
+
+    // false if there is no manifest yet; throws if it exists but is corrupt
+    bool load();
+
+    uint64_t allocate_generation();
+    bool add_table(uint64_t generation);
+    // swaps `removed` for `added` in one manifest write; `added` takes the
+    // place of the oldest removed table so newer tables keep shadowing it
+    bool replace_tables(const std::vector<uint64_t>& removed, const std::vector<uint64_t>& added);
+
+    // writes a manifest listing `generations`, with this one's next
+    // generation, into another directory, as snapshots and backups keep
+    bool save_as(const std::string& directory, const std::vector<uint64_t>& generations) const;
+
+    std::vector<uint64_t> generations() const;
+    uint64_t next_generation() const;
+    std::string data_path(uint64_t generation) const; // "<dir>/fdb-<generation>-Data.db"
+    std::string get_file_path() const { return directory_ + "/MANIFEST"; }
+    const std::string& get_directory() const { return directory_; }
+
+private:
+    std::string directory_;
+    IoEngine& io_engine_;
+    mutable std::mutex mutex_;
+    std::vector<uint64_t> generations_;
+    uint64_t next_generation_ = 1;
+
+    bool commit_locked_(const std::vector<uint64_t>& generations);
+};
+
+}
+#endif
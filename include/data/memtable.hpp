@@ -1,6 +1,7 @@
 #ifndef MEMTABLE_FACTDB_HPP
 #define MEMTABLE_FACTDB_HPP
 
+#include <map>
 #include <unordered_map>
 #include <string>
 #include <memory>
@@ -15,6 +16,8 @@
 #include <fstream>
 
 #include "internal/skiplist.hpp"
+#include "data/mutation_batch.hpp"
+#include "data/schema_registry.hpp"
 #include "data/sstable.hpp"
 #include "data/sstable/datafile.hpp"
 
@@ -88,28 +91,96 @@ public:
     }
 
     const std::shared_ptr<MemtableColumn> getcol_(const std::string& col_name) const {
+        if (schema_ != nullptr) {
+            auto id = schema_->find(col_name);
+            return id ? getcol_(*id) : nullptr;
+        }
         auto it = columns_.find(col_name);
         if (it != columns_.end()) {
             return it->second;
         }
         return nullptr;
     }
+    // by column id, on a row the memtable holds
+    const std::shared_ptr<MemtableColumn> getcol_(ColumnId id) const {
+        return present_.test(id) ? interned_[present_.rank(id)] : nullptr;
+    }
     std::unordered_map<std::string, std::shared_ptr<MemtableColumn>> getallcols_(){
+        if (schema_ != nullptr) {
+            std::unordered_map<std::string, std::shared_ptr<MemtableColumn>> columns;
+            for (const auto& column : interned_) {
+                columns[column->getcolname_()] = column;
+            }
+            return columns;
+        }
         return columns_;
     }
 
+    // The row a memtable stores for one write: the columns of `rows` by id
+    // in `schema`, later rows winning, without the per-row name map.
+    static std::shared_ptr<MemtableRow> intern_(const std::vector<std::shared_ptr<MemtableRow>>& rows, SchemaRegistry& schema);
+    const ColumnBitmap& present_columns_() const { return present_; }
+    // the present columns in id order
+    const std::vector<std::shared_ptr<MemtableColumn>>& interned_columns_() const { return interned_; }
+
 private:
-    std::unordered_map<std::string, std::shared_ptr<MemtableColumn>> columns_;
+    std::unordered_map<std::string, std::shared_ptr<MemtableColumn>> columns_; // rows built by callers
+    const SchemaRegistry* schema_ = nullptr;                                   // set on interned rows
+    ColumnBitmap present_;
+    std::vector<std::shared_ptr<MemtableColumn>> interned_;
 };
+
+// records new partition skiplist nodes' heights in factdb_skiplist_node_height
+struct SkipListHeightMetric {
+    static void record(int height);
+};
+
+// A write may carry a sequence number: the rows built from the memtable give
+// each cell the sequence of the write that set it (delta_timestamp_) and the
+// row that of its newest write (liveness_info_), and the index entries a
+// write adds carry it too. 0 is no sequence.
 class Memtable {
 public:
-    void insert(std::string partition_key, std::string cluster_key, std::shared_ptr<std::vector<std::shared_ptr<factdb::MemtableRow>>> value);
-    bool update(std::string partition_key, std::string cluster_key, std::shared_ptr<std::vector<std::shared_ptr<factdb::MemtableRow>>> value);
+    void insert(std::string partition_key, std::string cluster_key, std::shared_ptr<std::vector<std::shared_ptr<factdb::MemtableRow>>> value, uint64_t sequence = 0);
+    bool update(std::string partition_key, std::string cluster_key, std::shared_ptr<std::vector<std::shared_ptr<factdb::MemtableRow>>> value, uint64_t sequence = 0);
     bool remove(std::string partition_key, std::string cluster_key);
+    // applies a sorted batch, one finger-search run per partition
+    void apply(const MutationBatch& batch, uint64_t sequence = 0);
     std::shared_ptr<factdb::SSTable> flush_to_sstable(std::string &table_id);
+    std::shared_ptr<factdb::SSTable> flush_to_sstable(std::string &table_id, const factdb::SSTableWriteOptions& options);
+    // Moves everything written so far into a new memtable and leaves this
+    // one empty. Nothing writes to the returned one, so it can be read and
+    // written out without holding the lock that guards this memtable.
+    std::shared_ptr<Memtable> freeze();
     std::shared_ptr<factdb::Row> convert_obj_to_row_(std::unordered_map<std::string, std::shared_ptr<factdb::MemtableColumn>> *obj, std::string* cluster_key);
+    // the row as it would be flushed, flagged HAS_DELETION when removed; nullptr if the memtable never saw it
+    std::shared_ptr<factdb::Row> get_row(const std::string& partition_key, const std::string& cluster_key);
+    // every row of a partition in cluster key order, tombstones included
+    std::vector<std::shared_ptr<factdb::Row>> get_partition_rows(const std::string& partition_key);
+    // every partition in key order as a flush would write it, tombstones included
+    std::vector<std::shared_ptr<factdb::Partition>> get_partitions();
+    bool empty() const { return skiplist_map_.empty(); }
+    // Rough bytes held by everything written since the last flush, versions
+    // and tombstones included; charged to a MemoryManager by Table.
+    size_t approximate_bytes() const { return approximate_bytes_; }
+
+    // Keeps a local index of `column` in `index`, laid out as described in
+    // data/secondary_index.hpp: every later write that sets the column adds
+    // an entry for the new value and removes the entry of the value it
+    // overwrites here. Overwritten values already flushed stay in the index.
+    void add_index(const std::string& column, Memtable* index);
+    // Column ids for the rows written from now on; a Table shares its
+    // registry so flushed SSTables use the table's ids.
+    void set_schema(std::shared_ptr<SchemaRegistry> schema) { schema_ = std::move(schema); }
+    SchemaRegistry& schema() { return *schema_; }
 private:
-    std::unordered_map<std::string, std::shared_ptr<factdb::SkipList<std::string, std::shared_ptr<std::vector<std::shared_ptr<factdb::MemtableRow>>>>>> skiplist_map_; //map<parititon_key, skiplist<cluster_key, value>>
+    std::shared_ptr<SchemaRegistry> schema_ = std::make_shared<SchemaRegistry>();
+    size_t approximate_bytes_ = 0;
+    MemtableRows intern_rows_(const MemtableRows& value);
+    std::shared_ptr<factdb::Row> build_row_(factdb::MemTableEntry<std::string, MemtableRows>& entry);
+    std::map<std::string, Memtable*> indexes_; // column -> index memtable
+    void index_write_(const std::string& partition_key, const std::string& cluster_key, const MemtableRows& value, bool remove, uint64_t sequence);
+    std::unordered_map<std::string, std::shared_ptr<factdb::SkipList<std::string, std::shared_ptr<std::vector<std::shared_ptr<factdb::MemtableRow>>>, SkipListHeightMetric>>> skiplist_map_; //map<parititon_key, skiplist<cluster_key, value>>
 };
 }
 #endif
\ No newline at end of file
@@ -0,0 +1,53 @@
+#ifndef MUTATION_BATCH_FACTDB_HPP
+#define MUTATION_BATCH_FACTDB_HPP
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace factdb {
+
+class MemtableRow;
+using MemtableRows = std::shared_ptr<std::vector<std::shared_ptr<MemtableRow>>>;
+
+struct BatchMutation {
+    std::string key;        // cluster key
+    MemtableRows value;     // null for a remove
+    bool remove = false;
+};
+
+// Row mutations across many partitions, grouped by partition as they are
+// added. Table::apply writes a batch as one commit-log record and applies
+// it under one lock, so readers and replay see all of it or none; each
+// partition's group goes into the memtable as one sorted finger-search run.
+class MutationBatch {
+public:
+    void insert(const std::string& partition_key, const std::string& cluster_key, MemtableRows value) {
+        partitions_[partition_key].push_back(BatchMutation{cluster_key, std::move(value), false});
+        size_++;
+        sorted_ = false;
+    }
+    void remove(const std::string& partition_key, const std::string& cluster_key) {
+        partitions_[partition_key].push_back(BatchMutation{cluster_key, nullptr, true});
+        size_++;
+        sorted_ = false;
+    }
+
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    std::unordered_map<std::string, std::vector<BatchMutation>>& partitions() { return partitions_; }
+    const std::unordered_map<std::string, std::vector<BatchMutation>>& partitions() const { return partitions_; }
+
+    // stable, so a key mutated twice still ends with its last mutation
+    void sort();
+    bool sorted() const { return sorted_; }
+
+private:
+    std::unordered_map<std::string, std::vector<BatchMutation>> partitions_;
+    size_t size_ = 0;
+    bool sorted_ = false;
+};
+
+}
+#endif
@@ -0,0 +1,159 @@
+#ifndef SCHEMA_REGISTRY_FACTDB_HPP
+#define SCHEMA_REGISTRY_FACTDB_HPP
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "data/sstable/datafile.hpp"
+#include "internal/encoding.hpp"
+#include "io/async_file.hpp"
+
+namespace factdb {
+
+using ColumnId = uint16_t;
+constexpr uint32_t SCHEMA_MAGIC = 0x48424446;  // "FDBH"
+constexpr size_t MAX_COLUMNS = 0xFFFF;         // ids of a table or SSTable
+
+// Column ids present in a row, one bit per id. Ids below 64 need no allocation.
+class ColumnBitmap {
+public:
+    void set(ColumnId id) {
+        if (id < 64) {
+            first_ |= uint64_t(1) << id;
+            return;
+        }
+        size_t word = id / 64 - 1;
+        if (word >= rest_.size()) {
+            rest_.resize(word + 1, 0);
+        }
+        rest_[word] |= uint64_t(1) << (id % 64);
+    }
+    bool test(ColumnId id) const { return (word_(id / 64) >> (id % 64)) & 1; }
+    // set ids below `id`: the position of id's entry in a row's columns
+    size_t rank(ColumnId id) const {
+        size_t below = 0;
+        for (size_t w = 0; w < id / 64; w++) {
+            below += __builtin_popcountll(word_(w));
+        }
+        uint64_t partial = word_(id / 64) & ((uint64_t(1) << (id % 64)) - 1);
+        return below + __builtin_popcountll(partial);
+    }
+    size_t count() const {
+        size_t total = __builtin_popcountll(first_);
+        for (uint64_t word : rest_) {
+            total += __builtin_popcountll(word);
+        }
+        return total;
+    }
+    bool empty() const { return count() == 0; }
+    // calls f(id) for every set id in ascending order
+    template <typename F>
+    void for_each(F f) const {
+        for (size_t w = 0; w < 1 + rest_.size(); w++) {
+            for (uint64_t bits = word_(w); bits != 0; bits &= bits - 1) {
+                f(static_cast<ColumnId>(w * 64 + __builtin_ctzll(bits)));
+            }
+        }
+    }
+    // u16 byte count, then the bitmap's bytes up to its highest set id
+    void serialize(std::string& out) const;
+
+private:
+    uint64_t first_ = 0;            // ids 0-63
+    std::vector<uint64_t> rest_;    // ids 64 and up
+
+    uint64_t word_(size_t w) const { return w == 0 ? first_ : (w - 1 < rest_.size() ? rest_[w - 1] : 0); }
+};
+
+// calls f(id) for every id set in a serialized bitmap's `length` bytes, ascending
+template <typename F>
+void for_each_column(const char* bitmap, size_t length, F f) {
+    for (size_t b = 0; b < length; b++) {
+        for (unsigned bits = static_cast<unsigned char>(bitmap[b]); bits != 0; bits &= bits - 1) {
+            f(static_cast<ColumnId>(b * 8 + __builtin_ctz(bits)));
+        }
+    }
+}
+
+struct ColumnNameHash {
+    using is_transparent = void;
+    size_t operator()(std::string_view name) const { return std::hash<std::string_view>()(name); }
+};
+
+// The column names an SSTable's cells refer to by id, stored in its data
+// and summary headers so every SSTable and section decodes on its own.
+//
+// Layout: u32 schema version, u32 column count, u16 + name per column.
+class ColumnDictionary {
+public:
+    uint32_t schema_version_ = 0;   // of the registry it was taken from; 0 without one
+
+    // the name's id, appended when new; throws std::length_error past MAX_COLUMNS
+    ColumnId add(std::string_view name);
+    std::optional<ColumnId> find(std::string_view name) const {
+        auto it = ids_.find(name);
+        return it == ids_.end() ? std::nullopt : std::optional<ColumnId>(it->second);
+    }
+    const std::string& name(ColumnId id) const { return names_[id]; }
+    size_t size() const { return names_.size(); }
+    // adds every cell name of the partitions' rows
+    void add_partitions(const std::vector<std::shared_ptr<Partition>>& partitions);
+
+    void serialize(std::string& out) const;
+    // throws std::runtime_error on truncated input
+    static ColumnDictionary deserialize(ByteReader& in);
+
+private:
+    std::deque<std::string> names_;    // by id; a deque keeps name() references valid as it grows
+    std::unordered_map<std::string, ColumnId, ColumnNameHash, std::equal_to<>> ids_;
+};
+
+// Dense ids for the columns of one table, kept in "<data_dir>/SCHEMA". Ids
+// are handed out in first-use order and never reused, so version N of the
+// schema is its first N columns and an id means the same column in the
+// memtable and in every SSTable the table writes.
+//
+// File layout: u32 magic, the columns as a ColumnDictionary, u32 crc32 of
+// everything before it. Saves go through SCHEMA.tmp and a rename, as the
+// manifest's do.
+class SchemaRegistry {
+public:
+    SchemaRegistry() : io_engine_(default_io_engine()) {}  // in memory only
+    explicit SchemaRegistry(const std::string& path, IoEngine& io_engine = default_io_engine())
+        : path_(path), io_engine_(io_engine) {}
+
+    SchemaRegistry(const SchemaRegistry&) = delete;
+    SchemaRegistry& operator=(const SchemaRegistry&) = delete;
+
+    // false if there is no file yet; throws std::runtime_error if it is corrupt
+    bool load();
+    // writes the columns added since the last load or save, if any
+    bool save();
+
+    // throws std::length_error once MAX_COLUMNS ids are taken
+    ColumnId intern(std::string_view name);
+    std::optional<ColumnId> find(std::string_view name) const;
+    std::string name(ColumnId id) const;
+    uint32_t version() const;
+    // the columns so far, to write an SSTable with
+    ColumnDictionary snapshot() const;
+    const std::string& get_file_path() const { return path_; }
+
+private:
+    std::string path_;
+    IoEngine& io_engine_;
+    mutable std::mutex mutex_;
+    ColumnDictionary columns_;
+    size_t saved_ = 0;
+};
+
+}
+#endif
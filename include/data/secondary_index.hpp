@@ -0,0 +1,40 @@
+#ifndef SECONDARY_INDEX_FACTDB_HPP
+#define SECONDARY_INDEX_FACTDB_HPP
+
+#include <memory>
+#include <string>
+
+#include "data/sstable/datafile.hpp"
+#include "internal/encoding.hpp"
+
+namespace factdb {
+
+// A local secondary index on one column is stored like a table of its own:
+// the partition key is the column value and the clustering key is
+// encode_index_key(base partition key, base clustering key), with no
+// columns. An entry's liveness_info_ holds the write sequence of the base
+// cell it indexes. Entries are never updated in place, so an entry may
+// outlive the value it points to; readers compare its sequence with the base
+// cell's, and Table::compact drops it.
+inline std::string encode_index_key(const std::string& partition_key, const std::string& cluster_key) {
+    std::string key;
+    key.reserve(sizeof(uint32_t) + partition_key.size() + cluster_key.size());
+    append_bytes(key, partition_key);
+    key.append(cluster_key);
+    return key;
+}
+
+// throws std::runtime_error on a key encode_index_key did not produce
+inline void decode_index_key(const std::string& key, std::string& partition_key, std::string& cluster_key) {
+    ByteReader in(key);
+    partition_key = in.read_string();
+    cluster_key.assign(in.position(), in.remaining());
+}
+
+struct IndexedRow {
+    std::string partition_key;
+    std::shared_ptr<Row> row;
+};
+
+}
+#endif
@@ -0,0 +1,26 @@
+#ifndef SHARD_MAP_FACTDB_HPP
+#define SHARD_MAP_FACTDB_HPP
+
+#include <cstddef>
+#include <string>
+
+#include "cluster/token_ring.hpp"
+
+namespace factdb {
+
+// How ShardedTable and the bulk loader lay partitions out: shard i of n
+// owns the i-th of n equal, contiguous slices of the Murmur3 token range,
+// and keeps its table in "<data_dir>/shard-<i>".
+size_t shard_of_token(Token token, size_t shards);
+inline size_t shard_of_key(const std::string& partition_key, size_t shards) {
+    return shard_of_token(murmur3_token(partition_key), shards);
+}
+std::string shard_dir(const std::string& data_dir, size_t shard);
+
+// Records `shards` in "<data_dir>/SHARDS" the first time and throws
+// std::runtime_error when the directory was laid out for another count,
+// since its partitions would then be looked for on the wrong shards.
+void check_shard_count(const std::string& data_dir, size_t shards);
+
+}
+#endif
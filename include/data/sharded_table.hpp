@@ -0,0 +1,66 @@
+#ifndef SHARDED_TABLE_FACTDB_HPP
+#define SHARDED_TABLE_FACTDB_HPP
+
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "data/table.hpp"
+#include "runtime/reactor.hpp"
+
+namespace factdb {
+
+// A Table per reactor shard under "<data_dir>/shard-<i>". Partition keys
+// map to one shard by token (see data/shard_map.hpp), and that shard's
+// thread is the only one to touch its memtable, commit log and SSTables.
+// Operations must be called from a reactor thread and resolve back on it.
+//
+// With a MemoryManager, background flushes are sent to the shard as reactor
+// tasks, and a write at the memtable hard limit does not block its shard:
+// it is retried on a timer until max_write_stall runs out, then fails with
+// MemoryLimitError. Stop the reactor before destroying the table.
+class ShardedTable {
+public:
+    ShardedTable(Reactor& reactor, TableOptions options);
+
+    // Opens every shard's table on its own thread; blocks until all are
+    // open. Throws std::runtime_error when data_dir was laid out for another
+    // shard count.
+    bool open();
+
+    size_t shard_of(const std::string& partition_key) const;
+    Table& local_table(size_t shard) { return *tables_[shard]; }
+
+    Future<bool> insert(const std::string& partition_key, const std::string& cluster_key, MemtableRows value);
+    Future<bool> update(const std::string& partition_key, const std::string& cluster_key, MemtableRows value);
+    Future<bool> remove(const std::string& partition_key, const std::string& cluster_key);
+    // splits the batch by shard; atomic within each shard's share
+    Future<bool> apply(MutationBatch batch);
+    Future<std::shared_ptr<Row>> get(const std::string& partition_key, const std::string& cluster_key);
+    Future<std::vector<std::shared_ptr<Row>>> scan(const std::string& partition_key, const std::string& start,
+                                                   const std::string& end, size_t limit = 0);
+    // flushes every shard's memtable; resolves to the number of SSTables written
+    Future<size_t> flush();
+    // Table::merged_partitions of every shard, in partition key order
+    Future<std::vector<std::shared_ptr<Partition>>> merged_partitions();
+    // hands each shard its share of `partitions` to Table::ingest
+    Future<bool> ingest(std::vector<std::shared_ptr<Partition>> partitions);
+    // Table::snapshot of every shard; resolves to their directories, by shard
+    Future<std::vector<std::string>> snapshot(const std::string& name);
+
+private:
+    Reactor& reactor_;
+    TableOptions options_;
+    std::vector<std::unique_ptr<Table>> tables_;
+
+    // Runs `write` on the calling shard, again on a timer while it is
+    // refused at the memtable hard limit; `stalled_since` is when it first was.
+    Future<bool> admitted_write_(std::function<bool()> write,
+                                 std::optional<std::chrono::steady_clock::time_point> stalled_since = std::nullopt);
+};
+
+}
+#endif
@@ -1,22 +1,126 @@
 #ifndef SSTABLE_FACTDB_HPP
 #define SSTABLE_FACTDB_HPP
 
-#include "data/sstable.hpp"
+#include <string>
+#include <vector>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
 #include "data/sstable/datafile.hpp"
+#include "data/sstable/indexfile.hpp"
+#include "data/sstable/statisticsfile.hpp"
+#include "data/sstable/summaryfile.hpp"
+#include "internal/bloomfilter.hpp"
+#include "io/aligned_buffer_pool.hpp"
+#include "io/async_file.hpp"
+#include "io/block_cache.hpp"
 
 namespace factdb{
+constexpr uint32_t SSTABLE_MAGIC = 0x33424446; // "FDB3"
+constexpr uint32_t SUMMARY_MAGIC = 0x33534446; // "FDS3"
+constexpr size_t KEY_RESTART_INTERVAL = 16;    // keys between uncompressed ones in index chunks and partitions
+constexpr size_t MAX_KEY_LENGTH = UINT16_MAX;  // partition and clustering keys are written with u16 lengths
+constexpr size_t FILTER_BITS_PER_PARTITION = 10;
+constexpr size_t FILTER_HASHES = 7;
+
+struct SSTableWriteOptions {
+    bool direct_io = false;                     // bypass the page cache when writing
+    AlignedBufferPool* buffer_pool = nullptr;   // defaults to default_buffer_pool()
+    BlockCache* block_cache = nullptr;          // receives the written blocks, serves later reads
+    const SchemaRegistry* schema = nullptr;     // column ids to write with; without one the SSTable numbers its own
+};
+
+enum class SSTableComponent {
+    DATA,
+    INDEX,
+    SUMMARY,
+    FILTER,
+    STATISTICS
+};
+constexpr SSTableComponent SSTABLE_COMPONENTS[] = {SSTableComponent::DATA, SSTableComponent::INDEX, SSTableComponent::SUMMARY,
+                                                   SSTableComponent::FILTER, SSTableComponent::STATISTICS};
+
+// "<dir>/fdb-7-Data.db" maps to "<dir>/fdb-7-Index.db" and so on; any other
+// data path gets a lowercase suffix, e.g. "table.sst.index"
+std::string sstable_component_path(const std::string& data_path, SSTableComponent component);
+
 class SSTable{
 public:
-    SSTable(): file_path_("./data/sstable1.sst"), partitions_() {};
-    SSTable(const std::string& file_path): file_path_(file_path), partitions_() {};
+    SSTable(): file_path_("./data/sstable1.sst"), partitions_(), io_engine_(default_io_engine()) {};
+    SSTable(const std::string& file_path): file_path_(file_path), partitions_(), io_engine_(default_io_engine()) {};
     SSTable(const std::string& file_path, const std::vector<std::shared_ptr<factdb::Partition>>& partitions)
-    : file_path_(file_path), partitions_(partitions) {};
+    : file_path_(file_path), partitions_(partitions), io_engine_(default_io_engine()) {};
+    SSTable(const std::string& file_path, IoEngine& io_engine): file_path_(file_path), partitions_(), io_engine_(io_engine) {};
+    ~SSTable();
+    // Writes the data file plus its index, summary, filter and statistics
+    // components, each fsynced along with their directory: once it returns
+    // true, a manifest may list the table and the commit log may let go.
     bool write_to_file();
+    bool write_to_file(const SSTableWriteOptions& options);
+    // loads every partition of the data file into memory
     bool read_from_file();
+    // the data file's bytes as written, through the block cache when set
+    bool read_data(std::string& out);
+    // The Statistics component, loaded on first use; null for tables
+    // written before it existed.
+    std::shared_ptr<const factdb::StatisticsFile> statistics();
+    // the given statistics blocks, in order, as one encode_sstable_section() layout
+    bool read_blocks(const std::vector<size_t>& blocks, std::string& out);
+    void set_block_cache(BlockCache* block_cache) { block_cache_ = block_cache; }
     bool compress();
+
+    // Loads only the summary and filter. Index chunks and partitions are
+    // then read on demand by read_partition/read_row.
+    bool open();
+    bool is_open() const { return opened_; }
+    bool might_contain(const std::vector<char>& partition_key) const;
+    std::shared_ptr<factdb::Partition> read_partition(const std::vector<char>& partition_key);
+    std::shared_ptr<factdb::Row> read_row(const std::vector<char>& partition_key, const std::vector<char>& clustering_key);
+    uint32_t partition_count() const;
+    const factdb::SummaryFile& summary() const { return summary_; }
+    size_t loaded_index_chunks() const;
+    bool remove_files() const;
+    // defers remove_files() until the last reader drops the table
+    void remove_on_close() { remove_on_close_ = true; }
+
+    const std::string& get_file_path() const { return file_path_; }
+    const std::vector<std::shared_ptr<factdb::Partition>>& get_partitions() const { return partitions_; }
+    size_t row_count() const;
+    uint64_t data_size() const; // key and value bytes held by all partitions
 private:
     std::string file_path_;
     std::vector<std::shared_ptr<factdb::Partition>> partitions_;
+    IoEngine& io_engine_;
+    BlockCache* block_cache_ = nullptr;
+
+    bool opened_ = false;
+    std::atomic<bool> remove_on_close_{false};
+    factdb::SummaryFile summary_;
+    std::unique_ptr<factdb::BloomFilter> filter_;
+    mutable std::mutex index_mutex_;
+    std::unordered_map<size_t, std::shared_ptr<const std::string>> index_chunks_; // summary slot -> encoded chunk
+    bool statistics_loaded_ = false;
+    std::shared_ptr<const factdb::StatisticsFile> statistics_;
+
+    std::shared_ptr<const std::string> index_chunk_(size_t slot);
+    // the encoded partition, via the filter, summary and index
+    bool read_partition_data_(const std::vector<char>& partition_key, std::string& data);
+    bool read_range_(const std::string& path, uint64_t offset, size_t length, std::string& out);
 };
+
+// A run of partitions in the data file layout, for shipping to another node:
+// the receiver can write it out as an SSTable without re-sorting.
+std::string encode_sstable_section(const std::vector<std::shared_ptr<factdb::Partition>>& partitions);
+// throws std::runtime_error on a truncated or foreign section
+std::vector<std::shared_ptr<factdb::Partition>> decode_sstable_section(const char* data, size_t length);
+
+// the clustering key of a flushed row is the key_ of its first clustering cell
+const std::vector<char>& row_clustering_key(const factdb::Row& row);
+uint64_t row_data_size(const factdb::Row& row);
+bool row_is_deleted(const factdb::Row& row);
+// fill in the columns of `newer` that only an older version of the row has
+void merge_older_cells(factdb::Row& newer, const factdb::Row& older);
 }
-#endif
\ No newline at end of file
+#endif
@@ -177,7 +177,7 @@ public:
     std::optional<LivenessInfo> liveness_info_;
     std::optional<DeltaDeletionTime> deletion_time_;
     std::vector<std::optional<uint64_t>> missing_columns_;
-    std::vector<Cell> cells_;
+    std::vector<SimpleCell> cells_;
 
     Row() : flags_(0), row_body_size_(0), prev_unfiltered_size_(0) {}
 };
@@ -5,14 +5,22 @@
 #include <optional>
 #include <vector>
 
+namespace factdb {
+
+// One entry per partition, in data file order: where the partition starts in
+// the data file and how many bytes it spans.
 class IndexEntry {
-    uint32_t length_;
-    char *key_;
+public:
+    std::vector<char> key_;
     uint64_t position_;
-    uint64_t promoted_index_length_;
-    char *promoted_index_;
+    uint32_t length_;
+
+    IndexEntry() : position_(0), length_(0) {}
+    IndexEntry(const std::vector<char>& key, uint64_t position, uint32_t length)
+        : key_(key), position_(position), length_(length) {}
 };
 class IndexFile {
+public:
     std::vector<IndexEntry> entries_;
 };
 
@@ -23,4 +31,5 @@ class PromotedIndex {
 class PromotedIndexBlock {
 
 };
-#endif
\ No newline at end of file
+}
+#endif
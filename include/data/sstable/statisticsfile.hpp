@@ -0,0 +1,153 @@
+#ifndef STATISTICSFILE_FACTDB_HPP
+#define STATISTICSFILE_FACTDB_HPP
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "data/sstable/datafile.hpp"
+#include "internal/encoding.hpp"
+
+namespace factdb {
+
+constexpr uint32_t STATISTICS_MAGIC = 0x54424446; // "FDBT"
+constexpr size_t STATISTICS_BLOCK_ROWS = 1024;     // a block closes after the partition reaching this
+constexpr size_t STATISTICS_MAX_STRING = 128;      // longer values drop a column's string bounds
+constexpr size_t PARTITION_SIZE_BUCKETS = 150;     // up to ~1.4e12 bytes
+constexpr size_t PARTITION_CELL_BUCKETS = 114;     // up to ~2e9 cells
+constexpr uint8_t PARTITION_KEY_PRECISION = 12;    // 4096 registers, about 1.6% error
+constexpr uint64_t LARGE_PARTITION_BYTES = 64ull << 20;
+
+// Zone map of one column over the live rows of a block or a whole SSTable.
+// Values are kept as text, so each is counted under every type it parses as.
+class ColumnStatistics {
+public:
+    uint64_t values_ = 0;           // rows holding the column; the rest are nulls
+    uint64_t ints_ = 0;             // values that parse as INT
+    int64_t int_min_ = 0;
+    int64_t int_max_ = 0;
+    int64_t int_sum_ = 0;
+    uint64_t floats_ = 0;           // values that parse as a FLOAT other than NaN
+    double float_min_ = 0;
+    double float_max_ = 0;
+    double float_sum_ = 0;
+    bool string_bounds_ = true;     // false once a value exceeded STATISTICS_MAX_STRING
+    std::string string_min_;
+    std::string string_max_;
+
+    void add(std::string_view value);
+    void merge(const ColumnStatistics& other);
+    bool has_string_bounds() const { return values_ > 0 && string_bounds_; }
+};
+
+// A run of whole partitions in the data file and the statistics of its rows.
+class BlockStatistics {
+public:
+    uint64_t position_ = 0;         // in the data file
+    uint64_t length_ = 0;
+    uint32_t partitions_ = 0;
+    uint64_t rows_ = 0;             // live rows
+    uint64_t deleted_rows_ = 0;
+    std::vector<char> first_partition_;
+    std::vector<char> last_partition_;
+    std::vector<char> min_clustering_;  // over live rows
+    std::vector<char> max_clustering_;
+    std::map<std::string, ColumnStatistics> columns_;
+
+    void add_partition(const Partition& partition, uint64_t position, uint64_t length);
+    void merge(const BlockStatistics& other);
+};
+
+// Counts of values in buckets whose bounds grow by about 20% each, so any
+// value is placed within 20% and histograms with the same bucket count
+// merge by adding counts. Values past the last bound go to an overflow
+// bucket.
+class EstimatedHistogram {
+public:
+    explicit EstimatedHistogram(size_t buckets = PARTITION_SIZE_BUCKETS) : counts_(buckets + 1, 0) {}
+
+    void add(uint64_t value, uint64_t count = 1) { counts_[bucket_(value)] += count; }
+    // throws std::invalid_argument when the bucket counts differ
+    void merge(const EstimatedHistogram& other);
+
+    uint64_t count() const;
+    bool empty() const { return count() == 0; }
+    bool overflowed() const { return counts_.back() > 0; }
+    // upper bound of the bucket holding the p-th fraction of values, 0 < p <= 1;
+    // UINT64_MAX in the overflow bucket and 0 when empty
+    uint64_t percentile(double p) const;
+    uint64_t max() const { return percentile(1.0); }
+    double mean() const;   // over bucket upper bounds
+    // values in buckets reaching `value`, so ones up to 20% below it may be counted
+    uint64_t count_at_least(uint64_t value) const;
+    size_t buckets() const { return counts_.size() - 1; }
+    // inclusive upper bound of bucket i: 1, 2, 3, ... then growing by 20%
+    static uint64_t bucket_bound(size_t i);
+
+    // u16 buckets, u16 count of nonzero buckets, then u16 index + u64 count each
+    void serialize(std::string& out) const;
+    static EstimatedHistogram deserialize(ByteReader& in);
+
+private:
+    std::vector<uint64_t> counts_;
+
+    size_t bucket_(uint64_t value) const;
+};
+
+// HyperLogLog sketch of distinct 64-bit hashes in 2^precision registers.
+// Sketches of the same precision merge into the sketch of the union.
+class HyperLogLog {
+public:
+    explicit HyperLogLog(uint8_t precision = PARTITION_KEY_PRECISION);
+
+    void add(uint64_t hash);
+    void add(const char* data, size_t length) { add(hash(data, length)); }
+    // throws std::invalid_argument when the precisions differ
+    void merge(const HyperLogLog& other);
+    uint64_t estimate() const;
+    uint8_t precision() const { return precision_; }
+    // 64-bit hash of a key, well mixed in every bit
+    static uint64_t hash(const char* data, size_t length);
+
+    // u8 precision, u8 encoding; dense: every register as a byte, sparse:
+    // u16 count of nonzero registers, then u16 index + u8 value each
+    void serialize(std::string& out) const;
+    static HyperLogLog deserialize(ByteReader& in);
+
+private:
+    uint8_t precision_;
+    std::vector<uint8_t> registers_;
+};
+
+// What compaction planning and filter sizing want to know about partitions:
+// their sizes in the data file, their cell counts and how many distinct keys
+// there are, all mergeable across SSTables.
+class PartitionStatistics {
+public:
+    EstimatedHistogram sizes_{PARTITION_SIZE_BUCKETS};   // data file bytes per partition
+    EstimatedHistogram cells_{PARTITION_CELL_BUCKETS};   // cells per partition, clustering keys excluded
+    HyperLogLog keys_;
+
+    void add_partition(const Partition& partition, uint64_t length);
+    void merge(const PartitionStatistics& other);
+    uint64_t estimated_partitions() const { return keys_.estimate(); }
+    uint64_t large_partitions(uint64_t bytes = LARGE_PARTITION_BYTES) const { return sizes_.count_at_least(bytes); }
+};
+
+// The Statistics component: per-block zone maps and their totals, and the
+// partition sketches (empty when read from a file written before them).
+class StatisticsFile {
+public:
+    BlockStatistics totals_;
+    std::vector<BlockStatistics> blocks_;
+    PartitionStatistics partitions_;
+
+    std::string serialize() const;
+    // throws std::runtime_error on a truncated or foreign file
+    static StatisticsFile deserialize(const std::string& data);
+};
+}
+#endif
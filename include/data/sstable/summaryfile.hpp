@@ -1,4 +1,35 @@
 #ifndef SUMMARYFILE_FACTDB_HPP
 #define SUMMARYFILE_FACTDB_HPP
 
-#endif
\ No newline at end of file
+#include <cstdint>
+#include <vector>
+
+#include "data/schema_registry.hpp"
+
+namespace factdb {
+
+constexpr uint32_t SUMMARY_INTERVAL = 128; // index entries per summary entry
+
+// Every SUMMARY_INTERVAL-th index key with the byte offset of that index
+// entry. It is small enough to keep in memory for every open table and
+// narrows a lookup to one chunk of the index file.
+class SummaryEntry {
+public:
+    std::vector<char> key_;
+    uint64_t index_position_;
+
+    SummaryEntry() : index_position_(0) {}
+    SummaryEntry(const std::vector<char>& key, uint64_t index_position)
+        : key_(key), index_position_(index_position) {}
+};
+class SummaryFile {
+public:
+    uint32_t partition_count_ = 0;
+    uint64_t index_size_ = 0;
+    std::vector<char> first_key_;
+    std::vector<char> last_key_;
+    ColumnDictionary columns_;      // the data file's, to decode partitions read on demand
+    std::vector<SummaryEntry> entries_;
+};
+}
+#endif
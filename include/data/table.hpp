@@ -0,0 +1,246 @@
+#ifndef TABLE_FACTDB_HPP
+#define TABLE_FACTDB_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "data/columnar_scan.hpp"
+#include "data/commitlog.hpp"
+#include "data/compaction.hpp"
+#include "data/manifest.hpp"
+#include "data/memtable.hpp"
+#include "data/schema_registry.hpp"
+#include "data/secondary_index.hpp"
+#include "data/sstable.hpp"
+#include "runtime/memory_manager.hpp"
+
+namespace factdb {
+
+class TraceScope;
+
+struct TableOptions {
+    std::string data_dir = "./data";
+    size_t open_threads = 8;             // SSTables opened in parallel at startup
+    SSTableWriteOptions write_options;   // used for flushes and compaction outputs
+    bool use_commitlog = true;
+    CommitLogOptions commitlog;          // when a write is acknowledged relative to its log record's fdatasync
+    // Columns with a local secondary index, each kept in "<data_dir>/index-<column>".
+    // An index added to a table that already has data is built at open().
+    std::vector<std::string> indexed_columns;
+    // Charged with the memtable's bytes and shared by every table of the
+    // process; nullptr leaves memtables bounded only by explicit flushes.
+    std::shared_ptr<MemoryManager> memory;
+    // Runs the background flushes `memory` asks for; unset, the table keeps
+    // a thread of its own for them.
+    std::function<void(std::function<void()>)> flush_executor;
+    // false refuses a write at the memtable hard limit at once, leaving the
+    // caller to wait and retry without holding its thread
+    bool wait_for_memory = true;
+    // Hard-links every SSTable the table writes into "<data_dir>/backups",
+    // with a manifest there listing the live ones; see Table::restore.
+    bool incremental_backups = false;
+};
+
+// One column family on disk: a memtable in front of the SSTables listed in
+// the directory's manifest. open() reads only the manifest and each table's
+// summary and filter; index chunks and partitions are loaded by get().
+//
+// A flush freezes the memtable and writes the frozen rows out without
+// holding the table's lock: writes go to a fresh memtable meanwhile and
+// reads see both until the SSTable is listed.
+//
+// With a MemoryManager, a write that leaves memtables past the soft limit
+// asks for this table's memtable to be flushed in the background (on its
+// flush_executor or its own thread) when it is among the larger, and goes
+// on. At the hard limit a write waits for up to max_write_stall while the
+// manager has the largest registered memtable, whichever table's it is,
+// flushed in the background, and is then refused with MemoryLimitError; it
+// never flushes inline.
+class Table {
+public:
+    Table(TableOptions options, IoEngine& io_engine = default_io_engine());
+    ~Table();
+
+    Table(const Table&) = delete;
+    Table& operator=(const Table&) = delete;
+
+    // loads the manifest, opens its SSTables and replays the commit log
+    bool open();
+
+    void insert(const std::string& partition_key, const std::string& cluster_key, MemtableRows value);
+    void update(const std::string& partition_key, const std::string& cluster_key, MemtableRows value);
+    void remove(const std::string& partition_key, const std::string& cluster_key);
+    // Sorts the batch, then writes it as one commit-log record and applies
+    // it under one lock: readers and replay see every mutation or none.
+    void apply(MutationBatch& batch);
+    // newest version of the row merged over older ones; nullptr if absent or deleted
+    std::shared_ptr<Row> get(const std::string& partition_key, const std::string& cluster_key);
+    // live rows of one partition with start <= cluster key < end (empty end is
+    // unbounded), in cluster key order, at most `limit` of them (0 is no limit)
+    std::vector<std::shared_ptr<Row>> scan(const std::string& partition_key, const std::string& start,
+                                           const std::string& end, size_t limit = 0);
+    // Live rows whose `column` holds `value`, found through the column's
+    // index; at most `limit` of them (0 is no limit). Index entries whose
+    // base row has been written since are skipped. Throws
+    // std::invalid_argument when the column has no index.
+    std::vector<IndexedRow> lookup(const std::string& column, const std::string& value, size_t limit = 0);
+    // Every live row satisfying all of scan.predicates, in key order, with
+    // only scan.projection decoded; see scan_sections(). Rows are never
+    // materialized, and SSTable blocks whose statistics rule them out are
+    // not read. Returns the rows visited.
+    size_t scan_columns(const ColumnScan& scan, const ScanVisitor& visitor);
+    // Aggregates `column` over the rows scan_columns() would visit. Blocks
+    // whose statistics settle every row are answered without reading them;
+    // pruning needs an SSTable no other source shares partitions with.
+    ColumnAggregate aggregate(const std::string& column, const ColumnScan& scan = ColumnScan());
+
+    // Writes the memtable as a new generation, and the index memtables into
+    // their own, after any rows a failed flush left frozen; nullptr when
+    // there was nothing to flush. Waits for a background flush in progress.
+    std::shared_ptr<SSTable> flush();
+    // merges every SSTable into new generations and retires the inputs, then
+    // does the same for each index, dropping its stale entries
+    CompactionResult compact(CompactionOptions options = CompactionOptions());
+
+    // Every partition with the newest version of each row, tombstones kept,
+    // read in full from the memtable and SSTables (a validation compaction
+    // whose output stays in memory).
+    std::vector<std::shared_ptr<Partition>> merged_partitions();
+    // Writes sorted partitions received from another node as a new
+    // generation that shadows everything already here. The memtable is
+    // flushed first so the ingested rows are the newest version.
+    std::shared_ptr<SSTable> ingest(std::vector<std::shared_ptr<Partition>> partitions);
+
+    // Flushes the memtable, then hard-links every live SSTable and the schema
+    // into snapshot_dir(name) under a manifest listing them, and each index's
+    // into its "index-<column>" subdirectory. No data is copied and writes go
+    // on meanwhile; the snapshot holds what the flush left on disk. Returns
+    // the directory; throws std::invalid_argument for an empty or taken name.
+    std::string snapshot(const std::string& name);
+    // Links the SSTables listed in the manifest of a snapshot or backup
+    // directory, and its indexes', into `data_dir`, writing the manifest last
+    // so an interrupted restore leaves no table behind; a Table opened there
+    // then serves them. Files are copied only across file systems. Throws
+    // std::runtime_error when data_dir already holds a table.
+    static void restore(const std::string& source, const std::string& data_dir);
+
+    std::vector<std::shared_ptr<SSTable>> sstables() const;
+    // The live SSTables' partition sketches merged: distinct partitions, and
+    // sizes and cells of each SSTable's part of a partition. SSTables written
+    // before the sketches existed are left out.
+    PartitionStatistics partition_statistics() const;
+    const Manifest& manifest() const { return manifest_; }
+    std::string snapshot_dir(const std::string& name) const { return options_.data_dir + "/snapshots/" + name; }
+    std::string backup_dir() const { return options_.data_dir + "/backups"; }
+    // the ids this table's memtable and SSTables give its columns
+    const SchemaRegistry& schema() const { return *schema_; }
+    std::string commitlog_path() const { return options_.data_dir + "/commitlog.log"; }
+    // the commit log of the frozen memtable, removed once its SSTable is listed
+    std::string flushing_commitlog_path() const { return commitlog_path() + ".flushing"; }
+
+private:
+    enum class MutationType : uint8_t { INSERT = 0, UPDATE = 1, REMOVE = 2, BATCH = 3 };
+
+    TableOptions options_;
+    IoEngine& io_engine_;
+    Manifest manifest_;
+    std::shared_ptr<SchemaRegistry> schema_;  // saved before each flush, so an SSTable's schema version is on disk
+    mutable std::mutex mutex_;             // guards memtable_, flushing_, commitlog_ and sstables_
+    std::mutex compaction_mutex_;
+    std::mutex flush_mutex_;               // one flush at a time; flushing_ only changes under it
+    Memtable memtable_;
+    std::shared_ptr<Memtable> flushing_;   // frozen rows being written, read along with memtable_
+    std::shared_ptr<CommitLog> commitlog_;   // shared with writers waiting on their records after a flush moves it aside
+    std::vector<std::shared_ptr<SSTable>> sstables_; // oldest first, as listed in the manifest
+    std::vector<uint64_t> generations_;
+    // An index is a Table without a commit log. Its memtable is written
+    // through memtable_, so it is guarded by this table's mutex_ rather than
+    // its own; rebuilt from the base commit log when the base replays. An
+    // index's flushing_ is guarded by its own mutex_, taken after this one.
+    std::map<std::string, std::unique_ptr<Table>> indexes_;
+    uint64_t sequence_ = 0;              // the last write sequence handed out, under mutex_
+    std::atomic<uint64_t> charged_{0};   // memtable bytes, frozen and indexes' included, charged to options_.memory
+    std::atomic<uint64_t> flushable_{0}; // the part of charged_ not frozen yet, which a flush would release
+    uint64_t memory_id_ = 0;             // this table's registration with options_.memory
+
+    // background flushes asked for by charge_memory_locked_ and by
+    // options_.memory for stalled writers, when options_.memory is set and
+    // options_.flush_executor is not
+    std::thread flusher_;
+    std::mutex flusher_mutex_;
+    std::condition_variable flusher_cv_;
+    bool flush_requested_ = false;
+    bool stopping_ = false;
+
+    // holds the caller back while options_.memory is at its hard limit;
+    // throws MemoryLimitError
+    void admit_write_();
+    void request_flush_();
+    // the flush request_flush_ asked for; a failure is only counted
+    void run_requested_flush_();
+    void flusher_loop_();
+    // charges the memtables' bytes to options_.memory and queues a background
+    // flush when they make this table one of the larger past the soft limit
+    void charge_memory_locked_();
+    // freezes memtable_ and the index memtables into flushing_, moving the
+    // commit log aside for them
+    void freeze_locked_();
+    // freezes the non-empty index memtables into their flushing_
+    void freeze_indexes_locked_();
+    // writes flushing_, the indexes' first, as new generations and lists
+    // them; flushing_ stays set if that fails. Needs flush_mutex_.
+    std::shared_ptr<SSTable> write_flushing_();
+    // hard-links the generations' SSTables, missing ones only, and the schema
+    // into `directory`, then writes a manifest there listing the generations
+    void link_tables_(const std::string& directory, const std::vector<uint64_t>& generations) const;
+    // mirrors generations_ into backup_dir() when incremental backups are on
+    void backup_locked_();
+    void snapshot_to_(const std::string& directory);
+
+    // a record appended under mutex_, waited for by durable_() once the lock is released
+    struct LoggedWrite {
+        std::shared_ptr<CommitLog> log;     // null without a commit log
+        CommitLog::Append append;
+    };
+    LoggedWrite log_mutation_(MutationType type, const std::string& partition_key, const std::string& cluster_key, const MemtableRows& value);
+    LoggedWrite log_batch_(const MutationBatch& batch);
+    // throws std::runtime_error when the record's write or sync failed
+    static void durable_(const LoggedWrite& logged);
+    // above every sequence handed out before, in this process or an earlier one
+    uint64_t next_sequence_locked_();
+    void apply_locked_(MutationType type, const std::string& partition_key, const std::string& cluster_key, MemtableRows value);
+    void replay_(const std::string& payload);
+    // The sections a column scan reads, newest first: the memtable, then
+    // each SSTable whole or only the blocks its statistics leave open.
+    // Blocks they answer are folded into `aggregate` when a column is given.
+    std::vector<std::string> scan_sources_(const ColumnScan& scan, const std::string& aggregate_column, ColumnAggregate& aggregate);
+    // newest version of the row merged over older ones as get() returns it;
+    // `visit` sees each version first, newest first, and returning false stops there
+    std::shared_ptr<Row> read_row_(const std::string& partition_key, const std::string& cluster_key,
+                                   const std::function<bool(const Row&)>& visit, TraceScope* trace);
+    // Whether an index entry of `column` for `value` is live: the newest base
+    // version holding the column carries the entry's write sequence, or for
+    // data written before sequences, the value. Older versions are read only
+    // to fill in `row`, which is left null for a stale entry.
+    bool indexed_row_(const std::string& column, const std::string& value, const std::string& partition_key,
+                      const std::string& cluster_key, const Row& entry, std::shared_ptr<Row>* row);
+    // adds entries for the live rows of `partitions` to the columns' index memtables
+    void index_partitions_(const std::vector<std::shared_ptr<Partition>>& partitions, const std::vector<std::string>& columns);
+    // rows of one partition from newest to oldest source merged as scan() returns
+    // them; `memtable_rows` holds the memtable's, then the frozen one's
+    static std::vector<std::shared_ptr<Row>> merge_partition_(const std::string& partition_key,
+                                                              const std::vector<std::vector<std::shared_ptr<Row>>>& memtable_rows,
+                                                              const std::vector<std::shared_ptr<SSTable>>& tables, const std::string& start,
+                                                              const std::string& end, size_t limit);
+};
+
+}
+#endif
@@ -0,0 +1,390 @@
+#ifndef TYPED_SCHEMA_FACTDB_HPP
+#define TYPED_SCHEMA_FACTDB_HPP
+
+#include <array>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "data/memtable.hpp"
+#include "data/table.hpp"
+#include "internal/encoding.hpp"
+
+namespace factdb {
+
+// A schema fixed at compile time: a struct lists its columns as a constexpr
+// tuple of column() declarations, and TypedSchema<Record> turns them into a
+// row codec with fixed field offsets, key encoders and a comparator, with
+// no name lookups or ColumnType switches at run time.
+//
+//   struct Reading {
+//       std::string sensor;
+//       int64_t at;
+//       double value;
+//       static constexpr auto columns = std::make_tuple(
+//           factdb::column("sensor", &Reading::sensor, factdb::ColumnRole::PARTITION),
+//           factdb::column("at", &Reading::at, factdb::ColumnRole::CLUSTERING),
+//           factdb::column("value", &Reading::value));
+//   };
+//
+// Column types are bool, integers, floating point and std::string. A schema
+// has exactly one partition and one clustering column.
+enum class ColumnRole {
+    PARTITION,
+    CLUSTERING,
+    REGULAR
+};
+
+template <typename Record, typename T>
+struct SchemaColumn {
+    using value_type = T;
+    const char* name;
+    T Record::*member;
+    ColumnRole role;
+};
+
+template <typename Record, typename T>
+constexpr SchemaColumn<Record, T> column(const char* name, T Record::*member, ColumnRole role = ColumnRole::REGULAR) {
+    return SchemaColumn<Record, T>{name, member, role};
+}
+
+namespace detail {
+template <typename T>
+constexpr bool is_fixed_width_v = std::is_arithmetic_v<T>;
+
+template <typename T>
+constexpr ColumnType column_type_of() {
+    if constexpr (std::is_same_v<T, bool>) {
+        return ColumnType::BOOL;
+    } else if constexpr (std::is_integral_v<T>) {
+        return ColumnType::INT;
+    } else if constexpr (std::is_floating_point_v<T>) {
+        return ColumnType::FLOAT;
+    } else {
+        static_assert(std::is_same_v<T, std::string>, "schema columns are bool, integers, floating point or std::string");
+        return ColumnType::STRING;
+    }
+}
+
+// the unsigned integer whose big endian bytes sort as `value` does
+template <typename T>
+auto ordered_bits(T value) {
+    if constexpr (std::is_same_v<T, bool>) {
+        return static_cast<uint8_t>(value ? 1 : 0);
+    } else if constexpr (std::is_integral_v<T>) {
+        using U = std::make_unsigned_t<T>;
+        U bits = static_cast<U>(value);
+        if constexpr (std::is_signed_v<T>) {
+            bits ^= U(1) << (sizeof(U) * 8 - 1);
+        }
+        return bits;
+    } else {
+        using U = std::conditional_t<sizeof(T) == 4, uint32_t, uint64_t>;
+        U bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        constexpr U sign = U(1) << (sizeof(U) * 8 - 1);
+        return (bits & sign) ? static_cast<U>(~bits) : static_cast<U>(bits | sign);
+    }
+}
+template <typename T, typename U>
+T from_ordered_bits(U bits) {
+    if constexpr (std::is_same_v<T, bool>) {
+        return bits != 0;
+    } else if constexpr (std::is_integral_v<T>) {
+        if constexpr (std::is_signed_v<T>) {
+            bits ^= U(1) << (sizeof(U) * 8 - 1);
+        }
+        return static_cast<T>(bits);
+    } else {
+        constexpr U sign = U(1) << (sizeof(U) * 8 - 1);
+        bits = (bits & sign) ? static_cast<U>(bits & ~sign) : static_cast<U>(~bits);
+        T value;
+        std::memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+}
+
+// Keys are compared as unsigned bytes, so numbers are written in an order
+// preserving big endian form and strings as they are.
+template <typename T>
+void append_key(std::string& out, const T& value) {
+    if constexpr (std::is_same_v<T, std::string>) {
+        out.append(value);
+    } else {
+        auto bits = ordered_bits(value);
+        for (size_t i = sizeof(bits); i-- > 0;) {
+            out.push_back(static_cast<char>(bits >> (i * 8)));
+        }
+    }
+}
+template <typename T>
+T decode_key(const std::string& key) {
+    if constexpr (std::is_same_v<T, std::string>) {
+        return key;
+    } else {
+        using U = decltype(ordered_bits(T()));
+        if (key.size() != sizeof(U)) {
+            throw std::runtime_error("Key does not match the schema's key type");
+        }
+        U bits = 0;
+        for (char c : key) {
+            bits = static_cast<U>((bits << 8) | static_cast<unsigned char>(c));
+        }
+        return from_ordered_bits<T>(bits);
+    }
+}
+
+// the text form MemtableColumn holds and column scans parse
+template <typename T>
+std::string to_text(const T& value) {
+    if constexpr (std::is_same_v<T, std::string>) {
+        return value;
+    } else if constexpr (std::is_same_v<T, bool>) {
+        return value ? "1" : "0";
+    } else {
+        char buffer[32];
+        auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+        return std::string(buffer, result.ptr);
+    }
+}
+template <typename T>
+T from_text(const char* data, size_t length) {
+    if constexpr (std::is_same_v<T, std::string>) {
+        return std::string(data, length);
+    } else if constexpr (std::is_same_v<T, bool>) {
+        if (length == 1 && (data[0] == '0' || data[0] == '1')) {
+            return data[0] == '1';
+        }
+        throw std::runtime_error("Column value is not a bool");
+    } else {
+        T value;
+        auto [end, error] = std::from_chars(data, data + length, value);
+        if (error != std::errc() || end != data + length) {
+            throw std::runtime_error("Column value does not parse as the schema's type");
+        }
+        return value;
+    }
+}
+
+template <typename Record, size_t I>
+using schema_value_t = typename std::tuple_element_t<I, std::decay_t<decltype(Record::columns)>>::value_type;
+
+// the one column with `role`, or the column count when there is not exactly one
+template <typename Record, size_t... I>
+constexpr size_t schema_index_of(ColumnRole role, std::index_sequence<I...>) {
+    size_t found = sizeof...(I);
+    size_t matches = 0;
+    ((std::get<I>(Record::columns).role == role ? (found = I, matches++) : 0), ...);
+    return matches == 1 ? found : sizeof...(I);
+}
+// offset of each fixed width column in an encoded row, then their total size
+template <typename Record, size_t... I>
+constexpr std::array<size_t, sizeof...(I) + 1> schema_offsets(std::index_sequence<I...>) {
+    std::array<size_t, sizeof...(I)> sizes{(is_fixed_width_v<schema_value_t<Record, I>> ? sizeof(schema_value_t<Record, I>) : 0)...};
+    std::array<size_t, sizeof...(I) + 1> offsets{};
+    for (size_t i = 0; i < sizeof...(I); i++) {
+        offsets[i + 1] = offsets[i] + sizes[i];
+    }
+    return offsets;
+}
+}
+
+template <typename Record>
+class TypedSchema {
+public:
+    static constexpr size_t COLUMN_COUNT = std::tuple_size_v<std::decay_t<decltype(Record::columns)>>;
+    template <size_t I>
+    using value_type = detail::schema_value_t<Record, I>;
+
+private:
+    using Sequence = std::make_index_sequence<COLUMN_COUNT>;
+    static constexpr std::array<size_t, COLUMN_COUNT + 1> OFFSETS = detail::schema_offsets<Record>(Sequence());
+
+public:
+    static constexpr size_t PARTITION = detail::schema_index_of<Record>(ColumnRole::PARTITION, Sequence());
+    static constexpr size_t CLUSTERING = detail::schema_index_of<Record>(ColumnRole::CLUSTERING, Sequence());
+    static constexpr size_t FIXED_SIZE = OFFSETS[COLUMN_COUNT];  // bytes before the first string
+    static_assert(PARTITION < COLUMN_COUNT, "a schema needs exactly one PARTITION column");
+    static_assert(CLUSTERING < COLUMN_COUNT, "a schema needs exactly one CLUSTERING column");
+
+    using partition_type = value_type<PARTITION>;
+    using clustering_type = value_type<CLUSTERING>;
+
+    template <size_t I>
+    static constexpr const char* name() { return std::get<I>(Record::columns).name; }
+    template <size_t I>
+    static constexpr ColumnType type() { return detail::column_type_of<value_type<I>>(); }
+
+    // Row codec: the fixed width columns at their OFFSETS in declaration
+    // order, then each string column as u32 length + bytes.
+    static void encode(const Record& record, std::string& out) {
+        size_t start = out.size();
+        out.resize(start + FIXED_SIZE);
+        encode_(record, out, start, Sequence());
+    }
+    static std::string encode(const Record& record) {
+        std::string out;
+        encode(record, out);
+        return out;
+    }
+    // throws std::runtime_error on a truncated row
+    static Record decode(const char* data, size_t length) {
+        if (length < FIXED_SIZE) {
+            throw std::runtime_error("Encoded row is shorter than its schema's fixed columns");
+        }
+        Record record{};
+        ByteReader strings(data + FIXED_SIZE, length - FIXED_SIZE);
+        decode_(record, data, strings, Sequence());
+        return record;
+    }
+    static Record decode(const std::string& data) { return decode(data.data(), data.size()); }
+
+    static std::string partition_key(const Record& record) { return encode_key(record.*std::get<PARTITION>(Record::columns).member); }
+    static std::string clustering_key(const Record& record) { return encode_key(record.*std::get<CLUSTERING>(Record::columns).member); }
+    // the engine key of a key column value; byte order matches value order
+    template <typename T>
+    static std::string encode_key(const T& value) {
+        std::string key;
+        detail::append_key(key, value);
+        return key;
+    }
+
+    // orders records by partition then clustering column value, as their keys sort
+    static int compare(const Record& a, const Record& b) {
+        int order = compare_(a.*std::get<PARTITION>(Record::columns).member, b.*std::get<PARTITION>(Record::columns).member);
+        return order != 0 ? order : compare_(a.*std::get<CLUSTERING>(Record::columns).member, b.*std::get<CLUSTERING>(Record::columns).member);
+    }
+    struct Less {
+        bool operator()(const Record& a, const Record& b) const { return compare(a, b) < 0; }
+    };
+
+    // The regular columns as the dynamic write path takes them, in their text form.
+    static MemtableRows to_rows(const Record& record) {
+        auto row = std::make_shared<MemtableRow>();
+        to_row_(record, *row, Sequence());
+        return std::make_shared<std::vector<std::shared_ptr<MemtableRow>>>(1, row);
+    }
+    // The record a stored row holds. Regular columns the row lacks keep their
+    // value-initialized default. Throws std::runtime_error when a key or value
+    // does not parse as its column's type.
+    static Record from_row(const std::string& partition_key, const Row& row) {
+        Record record{};
+        record.*std::get<PARTITION>(Record::columns).member = detail::decode_key<partition_type>(partition_key);
+        const auto& key = row_clustering_key(row);
+        record.*std::get<CLUSTERING>(Record::columns).member = detail::decode_key<clustering_type>(std::string(key.begin(), key.end()));
+        for (const auto& cell : row.cells_) {
+            from_cell_(record, cell.value_, Sequence());
+        }
+        return record;
+    }
+
+private:
+    template <size_t... I>
+    static void encode_(const Record& record, std::string& out, size_t start, std::index_sequence<I...>) {
+        (encode_field_<I>(record, out, start), ...);
+    }
+    template <size_t I>
+    static void encode_field_(const Record& record, std::string& out, size_t start) {
+        const auto& value = record.*std::get<I>(Record::columns).member;
+        if constexpr (detail::is_fixed_width_v<value_type<I>>) {
+            std::memcpy(out.data() + start + OFFSETS[I], &value, sizeof(value));
+        } else {
+            append_bytes(out, value);
+        }
+    }
+    template <size_t... I>
+    static void decode_(Record& record, const char* fixed, ByteReader& strings, std::index_sequence<I...>) {
+        (decode_field_<I>(record, fixed, strings), ...);
+    }
+    template <size_t I>
+    static void decode_field_(Record& record, const char* fixed, ByteReader& strings) {
+        auto& value = record.*std::get<I>(Record::columns).member;
+        if constexpr (detail::is_fixed_width_v<value_type<I>>) {
+            std::memcpy(&value, fixed + OFFSETS[I], sizeof(value));
+        } else {
+            value = strings.read_string();
+        }
+    }
+    template <typename T>
+    static int compare_(const T& a, const T& b) {
+        if constexpr (std::is_floating_point_v<T>) { // as the keys sort, so -0 < 0 and NaNs are ordered
+            auto x = detail::ordered_bits(a);
+            auto y = detail::ordered_bits(b);
+            return x < y ? -1 : (y < x ? 1 : 0);
+        } else {
+            return a < b ? -1 : (b < a ? 1 : 0);
+        }
+    }
+    template <size_t... I>
+    static void to_row_(const Record& record, MemtableRow& row, std::index_sequence<I...>) {
+        ((std::get<I>(Record::columns).role == ColumnRole::REGULAR
+              ? row.addcol_(std::make_shared<MemtableColumn>(std::get<I>(Record::columns).name, type<I>(),
+                                                             detail::to_text(record.*std::get<I>(Record::columns).member)))
+              : void()),
+         ...);
+    }
+    template <size_t... I>
+    static void from_cell_(Record& record, const CellValue& cell, std::index_sequence<I...>) {
+        // a fold that stops at the first column the cell's name matches
+        (void)((std::get<I>(Record::columns).role == ColumnRole::REGULAR && cell_is_(cell, std::get<I>(Record::columns).name)
+                    ? (record.*std::get<I>(Record::columns).member = detail::from_text<value_type<I>>(cell.value_.data(), cell.value_.size()), true)
+                    : false) ||
+               ...);
+    }
+    static bool cell_is_(const CellValue& cell, const char* column) {
+        size_t length = std::char_traits<char>::length(column);
+        return cell.key_.size() == length && std::memcmp(cell.key_.data(), column, length) == 0;
+    }
+};
+
+// A Table whose rows are Records. Rows go through the regular write path, so
+// column scans, statistics and secondary indexes see the regular columns in
+// their usual text form; only the keys are binary for numeric key columns.
+template <typename Record>
+class TypedTable {
+public:
+    using Schema = TypedSchema<Record>;
+    using partition_type = typename Schema::partition_type;
+    using clustering_type = typename Schema::clustering_type;
+
+    explicit TypedTable(Table& table) : table_(table) {}
+
+    void insert(const Record& record) {
+        table_.insert(Schema::partition_key(record), Schema::clustering_key(record), Schema::to_rows(record));
+    }
+    void remove(const partition_type& partition, const clustering_type& clustering) {
+        table_.remove(Schema::encode_key(partition), Schema::encode_key(clustering));
+    }
+    std::optional<Record> get(const partition_type& partition, const clustering_type& clustering) {
+        std::string partition_key = Schema::encode_key(partition);
+        auto row = table_.get(partition_key, Schema::encode_key(clustering));
+        if (!row) {
+            return std::nullopt;
+        }
+        return Schema::from_row(partition_key, *row);
+    }
+    // live records of one partition with start <= clustering < end, in order; see Table::scan()
+    std::vector<Record> scan(const partition_type& partition, const clustering_type& start, const clustering_type& end, size_t limit = 0) {
+        std::string partition_key = Schema::encode_key(partition);
+        std::vector<Record> records;
+        for (const auto& row : table_.scan(partition_key, Schema::encode_key(start), Schema::encode_key(end), limit)) {
+            records.push_back(Schema::from_row(partition_key, *row));
+        }
+        return records;
+    }
+    Table& table() { return table_; }
+
+private:
+    Table& table_;
+};
+
+}
+#endif
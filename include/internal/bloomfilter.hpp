@@ -1,6 +1,9 @@
 #ifndef BFILTER_FACTDB_HPP 
 #define BFILTER_FACTDB_HPP
 
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
 #include <vector>
 #include <string>
 #include <boost/functional/hash.hpp>
@@ -27,6 +30,42 @@ public:
         return true;
     }
 
+    size_t size() const { return bits.size(); }
+    size_t num_hashes() const { return numHashes; }
+
+    // u64 bit count, u32 hash count, then the bits packed eight to a byte
+    std::string serialize() const {
+        std::string out;
+        uint64_t bit_count = bits.size();
+        uint32_t hashes = static_cast<uint32_t>(numHashes);
+        out.append(reinterpret_cast<const char*>(&bit_count), sizeof(bit_count));
+        out.append(reinterpret_cast<const char*>(&hashes), sizeof(hashes));
+        std::string packed((bits.size() + 7) / 8, '\0');
+        for (size_t i = 0; i < bits.size(); ++i) {
+            if (bits[i]) packed[i / 8] |= static_cast<char>(1 << (i % 8));
+        }
+        return out + packed;
+    }
+
+    static BloomFilter deserialize(const std::string& data) {
+        uint64_t bit_count;
+        uint32_t hashes;
+        if (data.size() < sizeof(bit_count) + sizeof(hashes)) {
+            throw std::runtime_error("Truncated bloom filter");
+        }
+        std::memcpy(&bit_count, data.data(), sizeof(bit_count));
+        std::memcpy(&hashes, data.data() + sizeof(bit_count), sizeof(hashes));
+        size_t header = sizeof(bit_count) + sizeof(hashes);
+        if (bit_count == 0 || data.size() - header < (bit_count + 7) / 8) {
+            throw std::runtime_error("Truncated bloom filter");
+        }
+        BloomFilter filter(bit_count, hashes);
+        for (size_t i = 0; i < bit_count; ++i) {
+            filter.bits[i] = (data[header + i / 8] >> (i % 8)) & 1;
+        }
+        return filter;
+    }
+
 private:
     std::vector<bool> bits;
     size_t numHashes;
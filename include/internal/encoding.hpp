@@ -0,0 +1,98 @@
+#ifndef ENCODING_FACTDB_HPP
+#define ENCODING_FACTDB_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace factdb {
+
+// little endian fixed width integers and u32 length prefixed byte strings,
+// the building blocks of every on-disk format in the tree
+template <typename T>
+inline void append_int(std::string& out, T value) {
+    out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+inline void append_bytes(std::string& out, const char* data, size_t length) {
+    append_int<uint32_t>(out, static_cast<uint32_t>(length));
+    out.append(data, length);
+}
+
+inline void append_bytes(std::string& out, const std::vector<char>& bytes) {
+    append_bytes(out, bytes.data(), bytes.size());
+}
+
+inline void append_bytes(std::string& out, const std::string& bytes) {
+    append_bytes(out, bytes.data(), bytes.size());
+}
+
+class ByteReader {
+public:
+    ByteReader(const char* data, size_t length) : pos_(data), end_(data + length) {}
+    explicit ByteReader(const std::string& data) : ByteReader(data.data(), data.size()) {}
+
+    template <typename T>
+    T read_int() {
+        require_(sizeof(T));
+        T value;
+        std::memcpy(&value, pos_, sizeof(T));
+        pos_ += sizeof(T);
+        return value;
+    }
+
+    // An element count that sizes a vector before its elements are read;
+    // throws unless what is left could hold that many elements of at least
+    // `min_element_size` bytes.
+    uint32_t read_count(size_t min_element_size) {
+        uint32_t count = read_int<uint32_t>();
+        if (count > remaining() / min_element_size) {
+            throw std::runtime_error("Element count " + std::to_string(count) + " exceeds the encoded data");
+        }
+        return count;
+    }
+
+    std::vector<char> read_bytes() {
+        uint32_t length = read_int<uint32_t>();
+        return read_raw(length);
+    }
+
+    std::string read_string() {
+        uint32_t length = read_int<uint32_t>();
+        require_(length);
+        std::string value(pos_, length);
+        pos_ += length;
+        return value;
+    }
+
+    std::vector<char> read_raw(size_t length) {
+        require_(length);
+        std::vector<char> value(pos_, pos_ + length);
+        pos_ += length;
+        return value;
+    }
+
+    void skip(size_t length) {
+        require_(length);
+        pos_ += length;
+    }
+
+    const char* position() const { return pos_; }
+    size_t remaining() const { return end_ - pos_; }
+    bool done() const { return pos_ == end_; }
+
+private:
+    const char* pos_;
+    const char* end_;
+
+    void require_(size_t length) const {
+        if (static_cast<size_t>(end_ - pos_) < length) {
+            throw std::runtime_error("Unexpected end of encoded data");
+        }
+    }
+};
+
+}
+#endif
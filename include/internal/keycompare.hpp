@@ -0,0 +1,78 @@
+#ifndef KEYCOMPARE_FACTDB_HPP
+#define KEYCOMPARE_FACTDB_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace factdb {
+
+// Keys are raw byte strings compared as unsigned bytes. The first eight bytes
+// are loaded big endian into an integer so most comparisons are a single
+// integer compare; only keys sharing that prefix fall through to the byte
+// compare.
+inline uint64_t normalized_key_prefix(const char* data, size_t length) {
+    unsigned char buffer[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+    std::memcpy(buffer, data, length < 8 ? length : 8);
+    uint64_t prefix = 0;
+    for (int i = 0; i < 8; i++) {
+        prefix = (prefix << 8) | buffer[i];
+    }
+    return prefix;
+}
+
+// Index of the first byte where a and b differ within their first `length`
+// bytes, or `length` when they agree. Sixteen bytes per step with SSE2.
+inline size_t mismatch_offset(const char* a, const char* b, size_t length) {
+    size_t i = 0;
+#if defined(__SSE2__)
+    for (; i + 16 <= length; i += 16) {
+        __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+        __m128i y = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i));
+        unsigned equal = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(x, y)));
+        if (equal != 0xFFFF) {
+            return i + __builtin_ctz(~equal);
+        }
+    }
+#endif
+    for (; i < length && a[i] == b[i]; i++) {
+    }
+    return i;
+}
+
+// bytes shared at the start of both keys
+inline size_t shared_prefix_length(const char* a, size_t a_length, const char* b, size_t b_length) {
+    return mismatch_offset(a, b, a_length < b_length ? a_length : b_length);
+}
+
+inline int compare_binary_keys(const char* a, size_t a_length, uint64_t a_prefix,
+                               const char* b, size_t b_length, uint64_t b_prefix) {
+    if (a_prefix != b_prefix) {
+        return a_prefix < b_prefix ? -1 : 1;
+    }
+    size_t common = a_length < b_length ? a_length : b_length;
+    if (common > 8) {
+        size_t at = 8 + mismatch_offset(a + 8, b + 8, common - 8);
+        if (at < common) {
+            return static_cast<unsigned char>(a[at]) < static_cast<unsigned char>(b[at]) ? -1 : 1;
+        }
+    }
+    if (a_length == b_length) return 0;
+    return a_length < b_length ? -1 : 1;
+}
+
+inline int compare_binary_keys(const char* a, size_t a_length, const char* b, size_t b_length) {
+    return compare_binary_keys(a, a_length, normalized_key_prefix(a, a_length), b, b_length, normalized_key_prefix(b, b_length));
+}
+
+inline int compare_binary_keys(const std::vector<char>& a, const std::vector<char>& b) {
+    return compare_binary_keys(a.data(), a.size(), normalized_key_prefix(a.data(), a.size()),
+                               b.data(), b.size(), normalized_key_prefix(b.data(), b.size()));
+}
+
+}
+#endif
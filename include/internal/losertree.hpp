@@ -0,0 +1,84 @@
+#ifndef LOSERTREE_FACTDB_HPP
+#define LOSERTREE_FACTDB_HPP
+
+#include <vector>
+#include <cstddef>
+
+namespace factdb {
+
+// Tournament tree over k sorted sources. Each internal node keeps the loser of
+// the match played there, so replacing the winner costs log2(k) comparisons
+// against the stored losers instead of a full scan over every source.
+//
+// Source must provide `bool exhausted() const` and `void advance()`.
+// Less orders the current heads of two non-exhausted sources. When two heads
+// compare equal the source with the higher index wins, so callers that list
+// sources oldest to newest see the newest version of a key first.
+template <typename Source, typename Less>
+class LoserTree {
+public:
+    LoserTree(std::vector<Source*> sources, Less less)
+        : sources_(std::move(sources)), less_(less), tree_(sources_.size(), 0), winner_(0) {
+        if (!sources_.empty()) {
+            winner_ = init_(1);
+        }
+    }
+
+    bool empty() const {
+        return sources_.empty() || sources_[winner_]->exhausted();
+    }
+
+    Source& top() { return *sources_[winner_]; }
+    size_t top_index() const { return winner_; }
+
+    // advance the winning source and replay its path up to the root
+    void pop() {
+        sources_[winner_]->advance();
+        replay_(winner_);
+    }
+
+    size_t size() const { return sources_.size(); }
+
+private:
+    std::vector<Source*> sources_;
+    Less less_;
+    std::vector<size_t> tree_;  // tree_[node] = loser index, nodes 1..k-1, leaves at k..2k-1
+    size_t winner_;
+
+    bool beats_(size_t a, size_t b) const {
+        if (sources_[a]->exhausted()) return false;
+        if (sources_[b]->exhausted()) return true;
+        if (less_(*sources_[a], *sources_[b])) return true;
+        if (less_(*sources_[b], *sources_[a])) return false;
+        return a > b;
+    }
+
+    size_t init_(size_t node) {
+        size_t k = sources_.size();
+        if (node >= k) {
+            return node - k;
+        }
+        size_t left = init_(2 * node);
+        size_t right = init_(2 * node + 1);
+        if (beats_(left, right)) {
+            tree_[node] = right;
+            return left;
+        }
+        tree_[node] = left;
+        return right;
+    }
+
+    void replay_(size_t leaf) {
+        size_t k = sources_.size();
+        size_t winner = leaf;
+        for (size_t node = (leaf + k) / 2; node >= 1; node /= 2) {
+            if (beats_(tree_[node], winner)) {
+                std::swap(tree_[node], winner);
+            }
+        }
+        winner_ = winner;
+    }
+};
+
+}
+#endif
@@ -15,7 +15,7 @@ namespace factdb{
     template <typename ValueType>
     struct MemTableValue {
         ValueType value_;
-        uint64_t timestamp_;
+        uint64_t timestamp_; // the write's sequence number, 0 when the writer gave none
         bool deleted_;
 
         MemTableValue(ValueType v, uint64_t ts, bool del)
@@ -31,10 +31,10 @@ namespace factdb{
         MemTableEntry(const KeyType& k)
             : key_(k), values_{} {}
         
-        MemTableEntry(const KeyType& k, const ValueType v)
+        MemTableEntry(const KeyType& k, const ValueType v, uint64_t timestamp = 0)
             : key_(k) {
                 auto new_entry = std::make_shared<MemTableValue<ValueType>>(
-                                                                v, 1633036800, false);
+                                                                v, timestamp, false);
                 values_.push_back(new_entry);
             }
     };
@@ -96,7 +96,12 @@ namespace factdb{
     };
 
     // two directions: forward and down
-    template <typename KeyType, typename ValueType>
+    // the height of each new node goes to HeightObserver::record(level)
+    struct NoHeightObserver {
+        static void record(int) {}
+    };
+
+    template <typename KeyType, typename ValueType, typename HeightObserver = NoHeightObserver>
     class SkipList {
     public:
         SkipList(int max_level, float prob)
@@ -113,7 +118,7 @@ namespace factdb{
             highest_lvl_ = 0;
         }
 
-        void insert(KeyType key, ValueType value) {
+        void insert(KeyType key, ValueType value, uint64_t timestamp = 0) {
             std::shared_ptr<SkipListNode<KeyType, ValueType>> current = head_;
             std::shared_ptr<SkipListNode<KeyType, ValueType>> to_update[max_level_ + 1];
             memset(to_update, 0, sizeof(std::shared_ptr<SkipListNode<KeyType, ValueType>>) * (max_level_ + 1, 0));
@@ -137,7 +142,7 @@ namespace factdb{
                     }
                     highest_lvl_ = r_level;
                 }
-                auto new_entry = std::make_shared<MemTableEntry<KeyType, ValueType>>(key, value);
+                auto new_entry = std::make_shared<MemTableEntry<KeyType, ValueType>>(key, value, timestamp);
                 std::shared_ptr<SkipListNode<KeyType, ValueType>> new_node = std::make_shared<SkipListNode<KeyType, ValueType>>(
                                                                 max_level_, new_entry);
                 for(int i = 0; i <= r_level; i++){
@@ -145,11 +150,72 @@ namespace factdb{
                     to_update[i]->forward_[i] = new_node;
                 }
             }else if(current == NULL || current->entry_->key_ == key){
-                auto new_entry = std::make_shared<MemTableValue<ValueType>>(value, 1633036800, false);
+                auto new_entry = std::make_shared<MemTableValue<ValueType>>(value, timestamp, false);
+                if(current->entry_->is_deleted_){ // a reinsert after remove starts a fresh row
+                    current->entry_->values_.clear();
+                }
                 current->entry_->is_deleted_ = false;
                 current->entry_->values_.push_back(new_entry);
             }
         }
+        // Applies mutations in ascending key order: each inserts `value`, or
+        // with `remove` set marks the key deleted, leaving a tombstone when the
+        // key is absent. Every search resumes from the previous key's
+        // predecessors instead of the head and climbs only the levels the gap
+        // between the two keys spans (a finger search), so a sorted run costs
+        // O(log gap) per key rather than O(log n). Every version written
+        // carries `timestamp`.
+        template <typename Mutation>
+        void apply_sorted(const std::vector<Mutation>& mutations, uint64_t timestamp = 0) {
+            std::vector<std::shared_ptr<SkipListNode<KeyType, ValueType>>> to_update(max_level_ + 1, head_);
+            for (const auto& mutation : mutations) {
+                const KeyType& key = mutation.key;
+                int level = 0; // highest level whose predecessor moves past the previous key
+                while (level < highest_lvl_ && to_update[level + 1]->forward_[level + 1] != NULL &&
+                       to_update[level + 1]->forward_[level + 1]->entry_->key_ < key) {
+                    level++;
+                }
+                std::shared_ptr<SkipListNode<KeyType, ValueType>> current = to_update[level];
+                for (int i = level; i >= 0; i--) {
+                    if (i < level && to_update[i] != head_ &&
+                        (current == head_ || current->entry_->key_ < to_update[i]->entry_->key_)) {
+                        current = to_update[i]; // the previous key's predecessor here is further along
+                    }
+                    while (current->forward_[i] != NULL && current->forward_[i]->entry_->key_ < key) {
+                        current = current->forward_[i];
+                    }
+                    to_update[i] = current;
+                }
+                current = current->forward_[0];
+                if (current != NULL && current->entry_->key_ == key) {
+                    auto& entry = *current->entry_;
+                    if (mutation.remove) {
+                        entry.is_deleted_ = true;
+                    } else {
+                        if (entry.is_deleted_) { // a reinsert after remove starts a fresh row
+                            entry.values_.clear();
+                        }
+                        entry.is_deleted_ = false;
+                        entry.values_.push_back(std::make_shared<MemTableValue<ValueType>>(mutation.value, timestamp, false));
+                    }
+                    continue;
+                }
+                int r_level = random_level();
+                if (r_level > highest_lvl_) {
+                    for (int i = highest_lvl_ + 1; i <= r_level; i++) {
+                        to_update[i] = head_;
+                    }
+                    highest_lvl_ = r_level;
+                }
+                auto new_entry = std::make_shared<MemTableEntry<KeyType, ValueType>>(key, mutation.remove ? ValueType{} : mutation.value, timestamp);
+                new_entry->is_deleted_ = mutation.remove;
+                auto new_node = std::make_shared<SkipListNode<KeyType, ValueType>>(max_level_, new_entry);
+                for (int i = 0; i <= r_level; i++) {
+                    new_node->forward_[i] = to_update[i]->forward_[i];
+                    to_update[i]->forward_[i] = new_node;
+                }
+            }
+        }
         bool exists(KeyType key) {
             std::shared_ptr<SkipListNode<KeyType, ValueType>> current = head_;
             
@@ -181,10 +247,25 @@ namespace factdb{
             }
             return std::nullopt;
         }
+        // the entry for key even if it is deleted, so callers can see tombstones
+        std::shared_ptr<MemTableEntry<KeyType, ValueType>> find_entry(KeyType key) {
+            std::shared_ptr<SkipListNode<KeyType, ValueType>> current = head_;
+            for(int i = highest_lvl_; i >= 0; i--){
+                while(current->forward_[i] != NULL &&
+                        current->forward_[i]->entry_->key_ < key){
+                            current = current->forward_[i];
+                }
+            }
+            current = current->forward_[0];
+            if(current != NULL && current->entry_->key_ == key){
+                return current->entry_;
+            }
+            return nullptr;
+        }
         std::shared_ptr<SkipListNode<KeyType, ValueType>> get_head(){
             return head_;
         }
-        bool update(KeyType key, ValueType value){
+        bool update(KeyType key, ValueType value, uint64_t timestamp = 0){
             std::shared_ptr<SkipListNode<KeyType, ValueType>> current = head_;
             
             //start at highest level of skiplist, move current pointer forward 
@@ -199,7 +280,7 @@ namespace factdb{
                 return false;
             }
             if(current && current->entry_->key_ == key && current->entry_->is_deleted_ == false){
-                auto new_entry = std::make_shared<MemTableValue<ValueType>>(value, 1633036800, false);
+                auto new_entry = std::make_shared<MemTableValue<ValueType>>(value, timestamp, false);
                 current->entry_->values_.push_back(new_entry);
                 return true;
             }
@@ -257,6 +338,7 @@ namespace factdb{
             while (std::rand() % 2 == 0 && level < max_level_) {
                 level++;
             }
+            HeightObserver::record(level);
             return level;
         }
         bool remove_(KeyType key){
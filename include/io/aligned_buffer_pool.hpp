@@ -0,0 +1,84 @@
+#ifndef ALIGNED_BUFFER_POOL_FACTDB_HPP
+#define ALIGNED_BUFFER_POOL_FACTDB_HPP
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace factdb {
+
+constexpr size_t DIRECT_IO_ALIGNMENT = 4096;
+
+class MemoryManager;
+
+class AlignedBufferPool;
+
+// Handle to one pooled buffer; returns it to the pool when destroyed.
+class AlignedBuffer {
+public:
+    AlignedBuffer() : pool_(nullptr), data_(nullptr), size_(0) {}
+    AlignedBuffer(AlignedBufferPool* pool, char* data, size_t size) : pool_(pool), data_(data), size_(size) {}
+    AlignedBuffer(AlignedBuffer&& other) noexcept : pool_(other.pool_), data_(other.data_), size_(other.size_) {
+        other.pool_ = nullptr;
+        other.data_ = nullptr;
+    }
+    AlignedBuffer& operator=(AlignedBuffer&& other) noexcept;
+    AlignedBuffer(const AlignedBuffer&) = delete;
+    AlignedBuffer& operator=(const AlignedBuffer&) = delete;
+    ~AlignedBuffer() { release(); }
+
+    char* data() const { return data_; }
+    size_t size() const { return size_; }
+    explicit operator bool() const { return data_ != nullptr; }
+    void release();
+
+private:
+    AlignedBufferPool* pool_;
+    char* data_;
+    size_t size_;
+};
+
+// Bounded pool of reusable, 4 KiB aligned buffers for O_DIRECT writers.
+// Buffers are allocated on first use up to max_buffers and then recycled;
+// acquire() blocks while every buffer is checked out. With a MemoryManager
+// the pool holds no more buffers than the IO_BUFFERS limit allows (at
+// least one) and charges them to it.
+class AlignedBufferPool {
+public:
+    AlignedBufferPool(size_t buffer_size = 256 * 1024, size_t max_buffers = 16, MemoryManager* memory = nullptr);
+    ~AlignedBufferPool();
+
+    AlignedBufferPool(const AlignedBufferPool&) = delete;
+    AlignedBufferPool& operator=(const AlignedBufferPool&) = delete;
+
+    AlignedBuffer acquire();
+    AlignedBuffer try_acquire();
+
+    size_t buffer_size() const { return buffer_size_; }
+    size_t capacity() const { return max_buffers_; }
+    size_t in_use() const;
+    size_t allocated() const;
+    double occupancy() const;   // fraction of the pool checked out, exported as a metric
+
+private:
+    friend class AlignedBuffer;
+
+    size_t buffer_size_;
+    size_t max_buffers_;
+    MemoryManager* memory_;
+    mutable std::mutex mutex_;
+    std::condition_variable available_cv_;
+    std::vector<char*> free_;
+    size_t allocated_ = 0;
+    size_t in_use_ = 0;
+
+    AlignedBuffer take_locked_();
+    void give_back_(char* data);
+};
+
+AlignedBufferPool& default_buffer_pool();
+
+}
+#endif
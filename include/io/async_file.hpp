@@ -0,0 +1,168 @@
+#ifndef ASYNC_FILE_FACTDB_HPP
+#define ASYNC_FILE_FACTDB_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/types.h>
+#include <sys/uio.h>
+
+struct io_uring_sqe;
+struct io_uring_cqe;
+
+namespace factdb {
+
+struct IoEngineStats {
+    uint64_t submitted = 0;     // operations handed to the backend
+    uint64_t completed = 0;
+    uint64_t batches = 0;       // submissions to the kernel (or wakeups of the pool)
+};
+
+// Asynchronous positional file I/O. Every call returns a future holding the
+// byte count, or -errno on failure. Reads and writes may complete short.
+class IoEngine {
+public:
+    virtual ~IoEngine() = default;
+
+    virtual std::future<ssize_t> read(int fd, void* buffer, size_t length, off_t offset) = 0;
+    virtual std::future<ssize_t> write(int fd, const void* buffer, size_t length, off_t offset) = 0;
+    virtual std::future<ssize_t> fsync(int fd, bool datasync) = 0;
+
+    // Buffers registered once with the backend; read_fixed/write_fixed take
+    // an index into this list and skip per-request page pinning on io_uring.
+    // Must be called while no I/O is in flight.
+    virtual bool register_buffers(const std::vector<iovec>& buffers) = 0;
+    virtual std::future<ssize_t> read_fixed(int fd, size_t buffer_index, void* buffer, size_t length, off_t offset) = 0;
+    virtual std::future<ssize_t> write_fixed(int fd, size_t buffer_index, const void* buffer, size_t length, off_t offset) = 0;
+
+    virtual const char* name() const = 0;
+    virtual IoEngineStats stats() const = 0;
+
+    // loops over short transfers until `length` bytes moved, EOF or an error
+    ssize_t read_fully(int fd, void* buffer, size_t length, off_t offset);
+    ssize_t write_fully(int fd, const void* buffer, size_t length, off_t offset);
+};
+
+// Fallback for kernels without io_uring: blocking syscalls on worker threads.
+class ThreadPoolIoEngine : public IoEngine {
+public:
+    explicit ThreadPoolIoEngine(size_t threads = 4);
+    ~ThreadPoolIoEngine() override;
+
+    std::future<ssize_t> read(int fd, void* buffer, size_t length, off_t offset) override;
+    std::future<ssize_t> write(int fd, const void* buffer, size_t length, off_t offset) override;
+    std::future<ssize_t> fsync(int fd, bool datasync) override;
+    bool register_buffers(const std::vector<iovec>&) override { return true; }
+    std::future<ssize_t> read_fixed(int fd, size_t, void* buffer, size_t length, off_t offset) override {
+        return read(fd, buffer, length, offset);
+    }
+    std::future<ssize_t> write_fixed(int fd, size_t, const void* buffer, size_t length, off_t offset) override {
+        return write(fd, buffer, length, offset);
+    }
+    const char* name() const override { return "threadpool"; }
+    IoEngineStats stats() const override;
+
+private:
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<std::packaged_task<ssize_t()>> tasks_;
+    std::vector<std::thread> workers_;
+    bool stopping_ = false;
+    IoEngineStats stats_;
+
+    std::future<ssize_t> enqueue_(std::function<ssize_t()> op);
+    void worker_loop_();
+};
+
+// io_uring backend driven by raw syscalls. Callers queue operations; a
+// single ring thread moves everything queued since its last pass into the
+// submission queue, submits the batch with one io_uring_enter and reaps
+// completions. An eventfd poll kept armed on the ring wakes it up for new work.
+class IoUringEngine : public IoEngine {
+public:
+    explicit IoUringEngine(unsigned entries = 256);
+    ~IoUringEngine() override;
+
+    static bool supported();
+
+    std::future<ssize_t> read(int fd, void* buffer, size_t length, off_t offset) override;
+    std::future<ssize_t> write(int fd, const void* buffer, size_t length, off_t offset) override;
+    std::future<ssize_t> fsync(int fd, bool datasync) override;
+    bool register_buffers(const std::vector<iovec>& buffers) override;
+    std::future<ssize_t> read_fixed(int fd, size_t buffer_index, void* buffer, size_t length, off_t offset) override;
+    std::future<ssize_t> write_fixed(int fd, size_t buffer_index, const void* buffer, size_t length, off_t offset) override;
+    const char* name() const override { return "io_uring"; }
+    IoEngineStats stats() const override;
+
+private:
+    struct Operation {
+        uint8_t opcode;
+        int fd;
+        uint64_t addr;
+        uint32_t length;
+        off_t offset;
+        uint32_t op_flags;
+        int buffer_index;
+        std::promise<ssize_t> result;
+    };
+
+    int ring_fd_ = -1;
+    int event_fd_ = -1;
+    void* sq_ptr_ = nullptr;
+    size_t sq_size_ = 0;
+    void* cq_ptr_ = nullptr;
+    size_t cq_size_ = 0;
+    void* sqes_ptr_ = nullptr;
+    size_t sqes_size_ = 0;
+    unsigned sq_entries_ = 0;
+    unsigned cq_entries_ = 0;
+    unsigned* sq_head_ = nullptr;
+    unsigned* sq_tail_ = nullptr;
+    unsigned* sq_mask_ = nullptr;
+    unsigned* sq_array_ = nullptr;
+    unsigned* cq_head_ = nullptr;
+    unsigned* cq_tail_ = nullptr;
+    unsigned* cq_mask_ = nullptr;
+    ::io_uring_sqe* sqes_ = nullptr;
+    ::io_uring_cqe* cqes_ = nullptr;
+
+    std::mutex mutex_;
+    std::deque<std::unique_ptr<Operation>> pending_;
+    int failure_ = 0;  // -errno once io_uring_enter failed for good; later operations complete with it
+    std::thread ring_thread_;
+    std::atomic<bool> stopping_{false};
+    std::atomic<uint64_t> submitted_{0};
+    std::atomic<uint64_t> completed_{0};
+    std::atomic<uint64_t> batches_{0};
+
+    std::future<ssize_t> enqueue_(std::unique_ptr<Operation> op);
+    void ring_loop_();
+    void unmap_();
+};
+
+// io_uring when the kernel allows it, the thread pool otherwise
+std::unique_ptr<IoEngine> make_io_engine(size_t fallback_threads = 4);
+
+// process-wide engine used by SSTable and CommitLog files
+IoEngine& default_io_engine();
+
+constexpr size_t ASYNC_FILE_CHUNK_SIZE = 1 << 20;
+
+// Whole-file helpers: the file is split into chunks that are all in flight
+// at once. write_file truncates and optionally fsyncs before returning.
+bool write_file(IoEngine& engine, const std::string& path, const char* data, size_t length, bool sync = false);
+bool read_file(IoEngine& engine, const std::string& path, std::string& out);
+// fsyncs a directory so the files created or renamed in it survive a crash
+bool sync_directory(const std::string& directory);
+
+}
+#endif
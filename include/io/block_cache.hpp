@@ -0,0 +1,78 @@
+#ifndef BLOCK_CACHE_FACTDB_HPP
+#define BLOCK_CACHE_FACTDB_HPP
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "io/async_file.hpp"
+
+namespace factdb {
+
+class MemoryManager;
+
+struct BlockCacheStats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t evictions = 0;
+    uint64_t size_bytes = 0;
+    uint64_t capacity_bytes = 0;
+};
+
+// LRU cache of fixed-size file blocks keyed by (path, block index). Tables
+// written with O_DIRECT never enter the page cache, so their writer inserts
+// the blocks here and later reads of the table are served from memory.
+// With a MemoryManager the capacity is capped at the BLOCK_CACHE limit and
+// the cached bytes are charged to it.
+class BlockCache {
+public:
+    explicit BlockCache(uint64_t capacity_bytes, size_t block_size = 64 * 1024, MemoryManager* memory = nullptr);
+    ~BlockCache();
+
+    BlockCache(const BlockCache&) = delete;
+    BlockCache& operator=(const BlockCache&) = delete;
+
+    size_t block_size() const { return block_size_; }
+
+    std::shared_ptr<const std::string> get(const std::string& path, uint64_t block);
+    void put(const std::string& path, uint64_t block, std::string data);
+    // inserts every block of a file's contents, e.g. right after writing it
+    void populate(const std::string& path, const char* data, size_t length);
+    void invalidate(const std::string& path);
+
+    // reads a whole file, serving cached blocks and fetching only the misses
+    bool read_file(IoEngine& io_engine, const std::string& path, std::string& out);
+    // reads [offset, offset + length) of a file through the cache
+    bool read_range(IoEngine& io_engine, const std::string& path, uint64_t offset, size_t length, std::string& out);
+
+    BlockCacheStats stats() const;
+
+private:
+    struct Entry {
+        std::string path;
+        uint64_t block;
+        std::shared_ptr<const std::string> data;
+    };
+    using LruList = std::list<Entry>;
+
+    uint64_t capacity_bytes_;
+    size_t block_size_;
+    MemoryManager* memory_;
+    mutable std::mutex mutex_;
+    LruList lru_;   // front is most recently used
+    std::unordered_map<std::string, std::unordered_map<uint64_t, LruList::iterator>> index_;  // path -> block -> entry
+    uint64_t size_bytes_ = 0;
+    uint64_t hits_ = 0;
+    uint64_t misses_ = 0;
+    uint64_t evictions_ = 0;
+
+    void evict_locked_();
+    // charges the change in size_bytes_ since it was `before`
+    void charge_locked_(uint64_t before);
+};
+
+}
+#endif
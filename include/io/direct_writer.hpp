@@ -0,0 +1,61 @@
+#ifndef DIRECT_WRITER_FACTDB_HPP
+#define DIRECT_WRITER_FACTDB_HPP
+
+#include <cstdint>
+#include <deque>
+#include <future>
+#include <string>
+
+#include "io/aligned_buffer_pool.hpp"
+#include "io/async_file.hpp"
+
+namespace factdb {
+
+// Sequential file writer that bypasses the page cache. Data is staged in
+// pooled aligned buffers and each full buffer is written with O_DIRECT at an
+// aligned offset. seal() pads the tail block with zeros, trims the file back
+// to its logical length and fdatasyncs. Filesystems that reject O_DIRECT
+// (tmpfs, for example) fall back to buffered writes.
+class DirectFileWriter {
+public:
+    DirectFileWriter(const std::string& path, AlignedBufferPool& pool, IoEngine& io_engine,
+                     bool direct = true, size_t max_in_flight = 4);
+    ~DirectFileWriter();
+
+    DirectFileWriter(const DirectFileWriter&) = delete;
+    DirectFileWriter& operator=(const DirectFileWriter&) = delete;
+
+    bool is_open() const { return fd_ >= 0; }
+    bool direct() const { return direct_; }
+    uint64_t size() const { return logical_size_; }
+
+    bool append(const char* data, size_t length);
+    bool seal();
+
+private:
+    struct InFlight {
+        AlignedBuffer buffer;
+        size_t length;
+        std::future<ssize_t> result;
+    };
+
+    AlignedBufferPool& pool_;
+    IoEngine& io_engine_;
+    int fd_;
+    bool direct_;
+    bool failed_ = false;
+    bool sealed_ = false;
+    size_t max_in_flight_;
+    AlignedBuffer current_;
+    size_t current_fill_ = 0;
+    uint64_t file_offset_ = 0;      // where the next buffer lands
+    uint64_t logical_size_ = 0;
+    std::deque<InFlight> in_flight_;
+
+    bool next_buffer_();
+    bool complete_oldest_(AlignedBuffer* reuse);
+    void submit_current_(size_t length);
+};
+
+}
+#endif
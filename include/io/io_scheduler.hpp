@@ -0,0 +1,124 @@
+#ifndef IO_SCHEDULER_FACTDB_HPP
+#define IO_SCHEDULER_FACTDB_HPP
+
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/types.h>
+
+namespace factdb {
+
+enum class IoPriorityClass {
+    QUERY,
+    COMMITLOG,
+    FLUSH,
+    COMPACTION
+};
+constexpr size_t IO_PRIORITY_CLASS_COUNT = 4;
+
+struct IoClassConfig {
+    uint32_t shares = 100;
+    uint64_t bandwidth_limit = 0;   // bytes per second, 0 means unlimited
+};
+
+struct IoSchedulerOptions {
+    size_t max_in_flight = 8;       // requests executing at once, one worker thread each
+    size_t max_queue_depth = 256;   // queued requests per class before submit() blocks
+    std::array<IoClassConfig, IO_PRIORITY_CLASS_COUNT> classes = {{
+        {1000, 0},  // QUERY
+        {1000, 0},  // COMMITLOG
+        {200, 0},   // FLUSH
+        {100, 0},   // COMPACTION
+    }};
+};
+
+struct IoClassStats {
+    uint64_t submitted = 0;
+    uint64_t completed = 0;
+    uint64_t bytes = 0;
+    size_t queued = 0;
+    size_t in_flight = 0;
+    double p50_us = 0;
+    double p99_us = 0;
+    double p999_us = 0;
+    double max_us = 0;
+};
+
+// Userspace I/O scheduler. Every request belongs to a priority class; the
+// dispatcher always runs the eligible class with the lowest virtual time,
+// where a class's virtual time advances by request cost divided by its
+// shares. Classes with a bandwidth limit draw from a token bucket and are
+// skipped while it is empty, so background work cannot crowd out queries.
+// Standalone for now: flushes, compactions, the commit log and SSTable
+// reads still go straight to their IoEngine.
+class IoScheduler {
+public:
+    explicit IoScheduler(IoSchedulerOptions options = IoSchedulerOptions());
+    ~IoScheduler();
+
+    // `bytes` is the request size used for cost accounting and rate limiting
+    std::future<ssize_t> submit(IoPriorityClass cls, size_t bytes, std::function<ssize_t()> op);
+    std::future<ssize_t> read(IoPriorityClass cls, int fd, void* buffer, size_t length, off_t offset);
+    std::future<ssize_t> write(IoPriorityClass cls, int fd, const void* buffer, size_t length, off_t offset);
+
+    void set_shares(IoPriorityClass cls, uint32_t shares);
+    void set_bandwidth_limit(IoPriorityClass cls, uint64_t bytes_per_second);
+
+    IoClassStats stats(IoPriorityClass cls) const;
+    std::string latency_report() const;
+    void reset_stats();
+
+    static const char* class_name(IoPriorityClass cls);
+
+private:
+    using clock = std::chrono::steady_clock;
+    static constexpr size_t LATENCY_SAMPLES = 1 << 16;
+
+    struct Request {
+        size_t bytes;
+        std::function<ssize_t()> op;
+        std::promise<ssize_t> result;
+        clock::time_point submitted_at;
+    };
+    struct ClassState {
+        IoClassConfig config;
+        std::deque<Request> queue;
+        double vtime = 0;
+        double tokens = 0;
+        clock::time_point refilled_at;
+        size_t in_flight = 0;
+        uint64_t submitted = 0;
+        uint64_t completed = 0;
+        uint64_t bytes = 0;
+        std::vector<uint32_t> latencies_us;   // reservoir of completion latencies
+        uint64_t latency_count = 0;
+    };
+
+    IoSchedulerOptions options_;
+    mutable std::mutex mutex_;
+    std::condition_variable work_cv_;
+    std::condition_variable space_cv_;
+    std::array<ClassState, IO_PRIORITY_CLASS_COUNT> classes_;
+    std::vector<std::thread> workers_;
+    bool stopping_ = false;
+    uint64_t rng_state_ = 0x9e3779b97f4a7c15ULL;
+
+    void worker_loop_();
+    // picks the next class to dispatch, or returns -1 and the time to wait for tokens
+    int pick_class_(clock::time_point now, clock::duration& wait);
+    void refill_(ClassState& state, clock::time_point now);
+    void record_latency_(ClassState& state, uint32_t latency_us);
+    static double cost_(size_t bytes);
+};
+
+}
+#endif
@@ -1,12 +1,25 @@
 #ifndef LOGGING_FACTDB_HPP
 #define LOGGING_FACTDB_HPP
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdarg>
+#include <cstdint>
 #include <fstream>
 #include <iostream>
 #include <mutex>
 #include <string>
 #include <ctime>
 #include <memory>
+#include <thread>
+#include <vector>
+
+// Levels below this are compiled out of the FACTDB_LOG_* macros:
+// 0 keeps DEBUG and up, 1 INFO, 2 WARNING, 3 ERROR only.
+#ifndef FACTDB_MIN_LOG_LEVEL
+#define FACTDB_MIN_LOG_LEVEL 0
+#endif
 
 namespace factdb {
 
@@ -17,15 +30,50 @@ enum class LogLevel {
     DEBUG
 };
 
+enum class LogOverflow {
+    DROP,   // count the record as dropped and return
+    BLOCK   // wait for the writer to make room
+};
+
+struct AsyncLogOptions {
+    size_t ring_capacity = 4096;                        // records per logging thread
+    LogOverflow overflow = LogOverflow::DROP;
+    std::chrono::milliseconds flush_interval{10};       // writer wakes at least this often
+};
+
+struct LogStats {
+    uint64_t written = 0;   // lines written by the async writer
+    uint64_t dropped = 0;   // records lost to a full ring
+};
+
+// Fixed-size record handed from a logging thread to the async writer;
+// longer messages are cut to LOG_RECORD_TEXT bytes.
+constexpr size_t LOG_RECORD_TEXT = 232;
+struct LogRecord {
+    int64_t time_ns;
+    LogLevel level;
+    uint16_t length;
+    char text[LOG_RECORD_TEXT];
+};
+
+// By default every call formats and writes the line under one mutex.
+// start_async() switches to per-thread lock-free rings: a call copies the
+// message into its thread's ring and returns, and a writer thread drains
+// all rings, formats the lines in time order and writes each batch with a
+// single write and flush. Call stop_async() once logging threads are done
+// to drain what is left.
 class Logger {
 public:
+    ~Logger();
+
     static Logger& get_instance() {
         static Logger instance;
         return instance;
     }
 
     void configure(const std::string& log_file_path, LogLevel level = LogLevel::INFO) {
-        log_level_ = level;
+        std::lock_guard<std::mutex> guard(log_mutex_);
+        log_level_.store(level, std::memory_order_relaxed);
         if (!log_file_path.empty()) {
             log_file_ = std::make_unique<std::ofstream>(log_file_path, std::ios::out | std::ios::app);
             if (!log_file_ || !log_file_->is_open()) {
@@ -35,29 +83,57 @@ public:
         }
     }
 
+    bool enabled(LogLevel level) const { return severity(level) >= severity(log_level_.load(std::memory_order_relaxed)); }
+    // DEBUG ranks below INFO even though it is declared last
+    static int severity(LogLevel level) { return level == LogLevel::DEBUG ? 0 : static_cast<int>(level) + 1; }
+
     void log(LogLevel level, const std::string& message) {
-        if (level >= log_level_) {
-            std::lock_guard<std::mutex> guard(log_mutex_);
-            std::string log_message = format_message_(level, message);
-
-            if (log_file_ && log_file_->is_open()) {
-                *log_file_ << log_message << std::endl;
-            } else {
-                std::cerr << log_message << std::endl;
-            }
+        if (!enabled(level)) {
+            return;
+        }
+        if (async_.load(std::memory_order_acquire)) {
+            push_(level, message.data(), message.size());
+            return;
+        }
+        std::lock_guard<std::mutex> guard(log_mutex_);
+        std::string log_message = format_message_(level, message);
+
+        if (log_file_ && log_file_->is_open()) {
+            *log_file_ << log_message << std::endl;
+        } else {
+            std::cerr << log_message << std::endl;
         }
     }
+    // printf-style; in async mode formats straight into the ring record
+    void logf(LogLevel level, const char* format, ...) __attribute__((format(printf, 3, 4)));
 
     void info(const std::string& message) { log(LogLevel::INFO, message); }
     void warn(const std::string& message) { log(LogLevel::WARNING, message); }
     void error(const std::string& message) { log(LogLevel::ERROR, message); }
     void debug(const std::string& message) { log(LogLevel::DEBUG, message); }
 
+    void start_async(AsyncLogOptions options = AsyncLogOptions());
+    void stop_async();
+    bool is_async() const { return async_.load(std::memory_order_relaxed); }
+    LogStats stats() const;
+
 private:
+    class ThreadRing;
+
     std::unique_ptr<std::ofstream> log_file_;
-    LogLevel log_level_ = LogLevel::INFO;
+    std::atomic<LogLevel> log_level_{LogLevel::INFO};
     std::mutex log_mutex_;
 
+    std::atomic<bool> async_{false};
+    AsyncLogOptions async_options_;
+    std::mutex rings_mutex_;                        // guards rings_ and wakes the writer
+    std::condition_variable writer_wakeup_;
+    std::vector<std::shared_ptr<ThreadRing>> rings_;
+    std::thread writer_;
+    bool stopping_ = false;
+    std::atomic<uint64_t> written_{0};
+    std::atomic<uint64_t> dropped_{0};
+
     Logger() = default;
 
     std::string log_level_tostring_(LogLevel level) const {
@@ -79,10 +155,45 @@ private:
         return std::string("[") + timeBuffer + "] [" + log_level_tostring_(level) + "] " + message;
     }
 
+    ThreadRing& thread_ring_();
+    void push_(LogLevel level, const char* data, size_t length);
+    void vpush_(LogLevel level, const char* format, va_list args);
+    bool commit_(ThreadRing& ring, const LogRecord& record);
+    void run_writer_();
+    size_t drain_(std::vector<LogRecord>& records);
+    void write_batch_(std::vector<LogRecord>& records);
+
     Logger(const Logger&) = delete;
     Logger& operator=(const Logger&) = delete;
 };
 
-}  
-
-#endif
\ No newline at end of file
+}
+
+// Logging macros: levels under FACTDB_MIN_LOG_LEVEL expand to nothing, and
+// the arguments of the rest are only evaluated when the level is enabled.
+#define FACTDB_LOG_AT_(level, ...)                                      \
+    do {                                                                \
+        auto& factdb_logger_ = ::factdb::Logger::get_instance();        \
+        if (factdb_logger_.enabled(level)) {                            \
+            factdb_logger_.logf(level, __VA_ARGS__);                    \
+        }                                                               \
+    } while (0)
+
+#if FACTDB_MIN_LOG_LEVEL <= 0
+#define FACTDB_LOG_DEBUG(...) FACTDB_LOG_AT_(::factdb::LogLevel::DEBUG, __VA_ARGS__)
+#else
+#define FACTDB_LOG_DEBUG(...) ((void)0)
+#endif
+#if FACTDB_MIN_LOG_LEVEL <= 1
+#define FACTDB_LOG_INFO(...) FACTDB_LOG_AT_(::factdb::LogLevel::INFO, __VA_ARGS__)
+#else
+#define FACTDB_LOG_INFO(...) ((void)0)
+#endif
+#if FACTDB_MIN_LOG_LEVEL <= 2
+#define FACTDB_LOG_WARN(...) FACTDB_LOG_AT_(::factdb::LogLevel::WARNING, __VA_ARGS__)
+#else
+#define FACTDB_LOG_WARN(...) ((void)0)
+#endif
+#define FACTDB_LOG_ERROR(...) FACTDB_LOG_AT_(::factdb::LogLevel::ERROR, __VA_ARGS__)
+
+#endif
@@ -0,0 +1,55 @@
+#ifndef EXPORTER_FACTDB_HPP
+#define EXPORTER_FACTDB_HPP
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/steady_timer.hpp>
+
+#include "metrics/metrics.hpp"
+
+namespace factdb {
+
+struct MetricsExporterOptions {
+    std::string address = "127.0.0.1";
+    uint16_t port = 0;                                  // HTTP endpoint, 0 leaves it off
+    std::string dump_path;                              // rewritten every dump_interval when set
+    std::chrono::milliseconds dump_interval{10000};
+};
+
+// Serves MetricsRegistry::prometheus_text() to "GET /metrics" and the
+// recent traces to "GET /traces", and optionally dumps the metrics to a
+// file, on a thread of its own so scrapes never run on a reactor shard.
+class MetricsExporter {
+public:
+    explicit MetricsExporter(MetricsExporterOptions options, MetricsRegistry& registry = MetricsRegistry::global());
+    ~MetricsExporter();
+
+    MetricsExporter(const MetricsExporter&) = delete;
+    MetricsExporter& operator=(const MetricsExporter&) = delete;
+
+    void start();
+    // stops serving and writes a final dump
+    void stop();
+    uint16_t port() const { return port_; }
+
+private:
+    MetricsExporterOptions options_;
+    MetricsRegistry& registry_;
+    boost::asio::io_context io_;
+    std::unique_ptr<boost::asio::ip::tcp::acceptor> acceptor_;
+    std::unique_ptr<boost::asio::steady_timer> dump_timer_;
+    std::thread thread_;
+    uint16_t port_ = 0;
+
+    void accept_();
+    void schedule_dump_();
+};
+
+}
+#endif
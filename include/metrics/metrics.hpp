@@ -0,0 +1,165 @@
+#ifndef METRICS_FACTDB_HPP
+#define METRICS_FACTDB_HPP
+
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace factdb {
+
+// Counters and histograms keep one cache-line-aligned cell per slot and
+// each thread writes only its own, so recording is one relaxed atomic add
+// with no lock and no shared cache line. Readers sum the slots.
+constexpr size_t METRIC_SLOTS = 16;
+
+// slot of the calling thread, handed out round robin as threads first record
+inline size_t metric_slot() {
+    static std::atomic<size_t> next_slot{0};
+    thread_local size_t slot = next_slot.fetch_add(1, std::memory_order_relaxed) % METRIC_SLOTS;
+    return slot;
+}
+
+class Counter {
+public:
+    void add(uint64_t n = 1) { slots_[metric_slot()].value.fetch_add(n, std::memory_order_relaxed); }
+    uint64_t value() const {
+        uint64_t total = 0;
+        for (const auto& slot : slots_) total += slot.value.load(std::memory_order_relaxed);
+        return total;
+    }
+
+private:
+    struct alignas(64) Slot {
+        std::atomic<uint64_t> value{0};
+    };
+    Slot slots_[METRIC_SLOTS];
+};
+
+class Gauge {
+public:
+    void set(int64_t value) { value_.store(value, std::memory_order_relaxed); }
+    void add(int64_t delta) { value_.fetch_add(delta, std::memory_order_relaxed); }
+    int64_t value() const { return value_.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<int64_t> value_{0};
+};
+
+struct HistogramSnapshot {
+    uint64_t count = 0;
+    uint64_t sum = 0;
+    std::vector<uint64_t> buckets;
+
+    double mean() const { return count ? static_cast<double>(sum) / count : 0; }
+    // midpoint of the bucket holding the q-th sample, 0 when empty
+    double quantile(double q) const;
+};
+
+// Log-linear (HDR style) histogram of non-negative integers, usually
+// nanoseconds: values under 8 are exact, above that every power of two is
+// split into 8 linear sub-buckets, so any estimate is within 12.5%. Each
+// slot holds 4 KB of buckets; create histograms through the registry.
+class Histogram {
+public:
+    static constexpr int SUB_BUCKET_BITS = 3;
+    static constexpr size_t SUB_BUCKETS = size_t(1) << SUB_BUCKET_BITS;
+    static constexpr size_t BUCKETS = (64 - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+
+    static size_t bucket_of(uint64_t value) {
+        if (value < SUB_BUCKETS) return static_cast<size_t>(value);
+        int exponent = 63 - std::countl_zero(value);
+        size_t sub = static_cast<size_t>(value >> (exponent - SUB_BUCKET_BITS)) & (SUB_BUCKETS - 1);
+        return (exponent - SUB_BUCKET_BITS + 1) * SUB_BUCKETS + sub;
+    }
+    static uint64_t bucket_lower(size_t bucket) {
+        if (bucket < SUB_BUCKETS) return bucket;
+        int exponent = static_cast<int>(bucket / SUB_BUCKETS) + SUB_BUCKET_BITS - 1;
+        return (SUB_BUCKETS + bucket % SUB_BUCKETS) << (exponent - SUB_BUCKET_BITS);
+    }
+    static uint64_t bucket_width(size_t bucket) {
+        if (bucket < 2 * SUB_BUCKETS) return 1;
+        return uint64_t(1) << (bucket / SUB_BUCKETS - 1);
+    }
+
+    void record(uint64_t value) {
+        Slot& slot = slots_[metric_slot()];
+        slot.buckets[bucket_of(value)].fetch_add(1, std::memory_order_relaxed);
+        slot.sum.fetch_add(value, std::memory_order_relaxed);
+    }
+    HistogramSnapshot snapshot() const;
+
+private:
+    struct alignas(64) Slot {
+        std::atomic<uint64_t> sum{0};
+        std::atomic<uint64_t> buckets[BUCKETS] = {};
+    };
+    Slot slots_[METRIC_SLOTS];
+};
+
+// records the nanoseconds from construction to destruction
+class LatencyTimer {
+public:
+    explicit LatencyTimer(Histogram& histogram) : histogram_(histogram), start_(std::chrono::steady_clock::now()) {}
+    ~LatencyTimer() {
+        histogram_.record(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start_).count());
+    }
+
+    LatencyTimer(const LatencyTimer&) = delete;
+    LatencyTimer& operator=(const LatencyTimer&) = delete;
+
+private:
+    Histogram& histogram_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+enum class MetricType {
+    COUNTER,
+    GAUGE,
+    HISTOGRAM
+};
+
+// Named metrics, created on first use and kept for the registry's lifetime,
+// so hot paths look a metric up once and keep the reference. Components that already keep
+// their own stats are exported through callbacks read at export time.
+class MetricsRegistry {
+public:
+    static MetricsRegistry& global();
+
+    Counter& counter(const std::string& name, const std::string& help);
+    Gauge& gauge(const std::string& name, const std::string& help);
+    Histogram& histogram(const std::string& name, const std::string& help);
+    // `read` runs on the exporting thread and must stay valid until removed
+    void register_callback(const std::string& name, const std::string& help, MetricType type, std::function<double()> read);
+    void remove_callback(const std::string& name);
+
+    // Prometheus text exposition format; histograms are exported as
+    // summaries with p50, p90, p99 and p999
+    std::string prometheus_text() const;
+    // writes prometheus_text() to a temporary file renamed over `path`
+    bool dump(const std::string& path) const;
+
+private:
+    struct Entry {
+        std::string help;
+        MetricType type;
+        std::unique_ptr<Counter> counter;
+        std::unique_ptr<Gauge> gauge;
+        std::unique_ptr<Histogram> histogram;
+        std::function<double()> callback;
+    };
+
+    mutable std::mutex mutex_;
+    std::map<std::string, Entry> entries_; // sorted, so exports are stable
+
+    Entry& entry_(const std::string& name, const std::string& help, MetricType type);
+};
+
+}
+#endif
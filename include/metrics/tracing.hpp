@@ -0,0 +1,134 @@
+#ifndef TRACING_FACTDB_HPP
+#define TRACING_FACTDB_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace factdb {
+
+struct TraceSpan {
+    const char* name;       // a string literal
+    std::string detail;
+    int64_t start_ns;       // since the trace started
+    int64_t duration_ns;
+};
+
+struct TraceRecord {
+    uint64_t id = 0;
+    const char* request = "";
+    int64_t started_at_us = 0;      // system clock, microseconds since the epoch
+    int64_t duration_ns = 0;        // until the last thread working on it let go
+    std::vector<TraceSpan> spans;   // in the order they ended
+};
+
+// One traced request. Every thread working on it may add spans; the record
+// is handed to the Tracer when the last reference is dropped.
+class Trace : public std::enable_shared_from_this<Trace> {
+public:
+    Trace(uint64_t id, const char* request);
+    ~Trace();
+
+    Trace(const Trace&) = delete;
+    Trace& operator=(const Trace&) = delete;
+
+    uint64_t id() const { return record_.id; }
+    int64_t elapsed_ns() const {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start_).count();
+    }
+    void add_span(const char* name, int64_t start_ns, int64_t duration_ns, std::string detail);
+
+private:
+    std::chrono::steady_clock::time_point start_;
+    std::mutex mutex_;
+    TraceRecord record_;
+};
+
+// the trace of the request the calling thread is working on, if any
+inline thread_local Trace* this_thread_trace = nullptr;
+
+// To hand the current trace to work that runs on another thread.
+inline std::shared_ptr<Trace> current_trace() {
+    return this_thread_trace ? this_thread_trace->shared_from_this() : nullptr;
+}
+
+// Samples requests and keeps the most recent finished traces in a ring.
+class Tracer {
+public:
+    static Tracer& global();
+
+    // fraction of requests traced; 0, the default, traces forced requests only
+    void set_probability(double probability);
+    double probability() const;
+    static bool sampling() { return sample_threshold_.load(std::memory_order_relaxed) != 0; }
+    // finished traces kept, 1024 by default
+    void set_capacity(size_t capacity);
+
+    // newest first, at most `limit` of them (0 is all)
+    std::vector<TraceRecord> recent(size_t limit = 0) const;
+    // recent() as text, one header line per trace then one line per span
+    std::string text(size_t limit = 0) const;
+    void clear();
+
+private:
+    friend class Trace;
+    friend class TraceScope;
+
+    static inline std::atomic<uint64_t> sample_threshold_{0};  // a random u64 below it is sampled
+    std::atomic<uint64_t> next_id_{1};
+    mutable std::mutex mutex_;
+    std::deque<TraceRecord> finished_;
+    size_t capacity_ = 1024;
+
+    Tracer() = default;
+    static bool sample_();
+    void finish_(TraceRecord record);
+};
+
+// A timed span of the calling thread's trace. When the thread is not
+// tracing a request, construction and destruction are one branch each and
+// nothing else: all other state is allocated only for traced requests.
+class TraceScope {
+public:
+    explicit TraceScope(const char* name) : name_(name) {
+        if (this_thread_trace != nullptr) [[unlikely]] join_();
+    }
+    // continues `trace` (may be null) on this thread, e.g. after a hop to
+    // another shard; records no span of its own
+    explicit TraceScope(std::shared_ptr<Trace> trace);
+    // The scope of a request entry point: a span when a trace is already
+    // current, otherwise it starts a new trace if forced or sampled.
+    static TraceScope request(const char* name, bool force = false) { return TraceScope(name, force); }
+    ~TraceScope() {
+        if (active_ != nullptr) [[unlikely]] exit_();
+    }
+
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+
+    bool active() const { return active_ != nullptr; }
+    // detail shown next to the span; check active() before building it
+    void note(std::string detail);
+
+private:
+    struct Active;
+
+    const char* name_;
+    Active* active_ = nullptr;
+
+    TraceScope(const char* name, bool force) : name_(name) {
+        // one branch: the operands are combined without short-circuiting
+        if ((this_thread_trace != nullptr) | force | Tracer::sampling()) [[unlikely]] start_(force);
+    }
+    void join_();
+    void start_(bool force);
+    void exit_();
+};
+
+}
+#endif
@@ -0,0 +1,38 @@
+#ifndef CLIENT_FACTDB_HPP
+#define CLIENT_FACTDB_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ip/tcp.hpp>
+
+#include "net/protocol.hpp"
+
+namespace factdb {
+
+// Blocking client for one connection. send() assigns the next stream id and
+// returns it without waiting, so callers pipeline by sending several
+// requests before receiving; responses come back in completion order.
+class Client {
+public:
+    Client(const std::string& host, uint16_t port);
+
+    uint16_t send(Request request);
+    // writes every request in one vectored write, returning their stream ids
+    std::vector<uint16_t> send_all(std::vector<Request> requests);
+    Response receive();
+    // send + receive; only valid with nothing else in flight
+    Response call(Request request);
+
+private:
+    boost::asio::io_context io_;
+    boost::asio::ip::tcp::socket socket_;
+    uint16_t next_stream_ = 0;
+    std::vector<char> buffer_;
+    size_t buffered_ = 0;
+};
+
+}
+#endif
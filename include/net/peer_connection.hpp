@@ -0,0 +1,71 @@
+#ifndef PEER_CONNECTION_FACTDB_HPP
+#define PEER_CONNECTION_FACTDB_HPP
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/steady_timer.hpp>
+
+#include "net/protocol.hpp"
+#include "runtime/future.hpp"
+
+namespace factdb {
+
+// Asynchronous pipelined connection to another node, owned by one reactor
+// shard: send() and every completion run on that shard's io_context, so the
+// stream table needs no locks. Connects lazily and again after a failure;
+// a broken connection fails every request still in flight on it. A request
+// unanswered after `timeout` fails on its own; its stream stays reserved
+// until the late answer arrives, and a connection with too many of those
+// is dropped and reconnected.
+class PeerConnection : public std::enable_shared_from_this<PeerConnection> {
+public:
+    static constexpr size_t MAX_TIMED_OUT = 1024;
+
+    PeerConnection(boost::asio::io_context& io, std::string host, uint16_t port,
+                   std::chrono::milliseconds timeout = std::chrono::milliseconds(2000));
+
+    Future<Response> send(Request request);
+    bool connected() const { return state_ == State::CONNECTED; }
+    size_t in_flight() const { return pending_.size(); }
+    void close();
+
+private:
+    enum class State { DISCONNECTED, CONNECTING, CONNECTED };
+    struct Pending {
+        Promise<Response> promise;
+        std::unique_ptr<boost::asio::steady_timer> deadline;
+    };
+
+    boost::asio::io_context& io_;
+    std::string host_;
+    uint16_t port_;
+    std::chrono::milliseconds timeout_;
+    boost::asio::ip::tcp::socket socket_;
+    State state_ = State::DISCONNECTED;
+    uint16_t next_stream_ = 0;
+    std::unordered_map<uint16_t, Pending> pending_;
+    std::unordered_set<uint16_t> timed_out_;  // streams whose late answers are dropped
+    std::deque<std::string> queued_;     // encoded, waiting for the connection or the next write
+    std::vector<std::string> writing_;
+    bool write_active_ = false;
+    std::vector<char> buffer_;
+    size_t buffered_ = 0;
+
+    void connect_();
+    void read_();
+    void write_();
+    void fail_(const std::string& reason);
+    void expire_(uint16_t stream);
+};
+
+}
+#endif
@@ -0,0 +1,103 @@
+#ifndef PROTOCOL_FACTDB_HPP
+#define PROTOCOL_FACTDB_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace factdb {
+
+// Every frame, in both directions:
+//   u32 body length, u16 stream id, u8 opcode (requests) or status (responses),
+//   u8 consistency level (requests, 0 in responses), body
+// Bit 7 of a request's consistency byte asks every node it reaches to trace
+// it (PROTOCOL_TRACE_FLAG).
+// Strings are u32 length prefixed. A client may have many streams in flight
+// on one connection; responses carry the request's stream id and can arrive
+// in any order.
+//
+// Request bodies:
+//   GET     partition key, cluster key
+//   PUT     partition key, cluster key, u32 column count, (name, value)...
+//   REMOVE  partition key, cluster key
+//   SCAN    partition key, start cluster key, end cluster key (empty = unbounded), u32 limit
+//   BATCH   u32 count, then (u8 opcode, body) per PUT or REMOVE
+//   MERKLE, STREAM, INGEST  payload (node-to-node repair, see cluster/repair.hpp)
+// Response bodies:
+//   OK / NOT_FOUND  u32 row count, per row cluster key, u32 column count, (name, value)...,
+//                   payload
+//   ERROR           message
+constexpr size_t PROTOCOL_HEADER_SIZE = 8;
+constexpr uint32_t PROTOCOL_MAX_BODY = 16 << 20;
+constexpr uint8_t PROTOCOL_TRACE_FLAG = 0x80;
+
+enum class Opcode : uint8_t {
+    GET = 1,
+    PUT = 2,
+    REMOVE = 3,
+    SCAN = 4,
+    BATCH = 5,
+    MERKLE = 6,
+    STREAM = 7,
+    INGEST = 8
+};
+
+enum class Status : uint8_t {
+    OK = 0,
+    NOT_FOUND = 1,
+    ERROR = 2
+};
+
+// LOCAL applies the request on the receiving node only; that is what a
+// coordinator sends to each replica. The others make the receiving node
+// coordinate across the request's replicas.
+enum class ConsistencyLevel : uint8_t {
+    LOCAL = 0,
+    ONE = 1,
+    QUORUM = 2,
+    ALL = 3
+};
+
+struct WireColumn {
+    std::string name;
+    std::string value;
+};
+
+struct WireRow {
+    std::string cluster_key;
+    std::vector<WireColumn> columns;
+};
+
+struct Request {
+    uint16_t stream = 0;
+    Opcode opcode = Opcode::GET;
+    ConsistencyLevel consistency = ConsistencyLevel::LOCAL;
+    bool trace = false;             // traced whatever the sampling probability
+    std::string partition_key;
+    std::string cluster_key;        // start key for SCAN
+    std::string end_key;            // SCAN only
+    uint32_t limit = 0;             // SCAN only, 0 is unlimited
+    std::vector<WireColumn> columns;  // PUT only
+    std::vector<Request> batch;     // BATCH only
+    std::string payload;            // repair opcodes only
+};
+
+struct Response {
+    uint16_t stream = 0;
+    Status status = Status::OK;
+    std::vector<WireRow> rows;
+    std::string message;            // ERROR only
+    std::string payload;            // answers to repair opcodes
+};
+
+// total size of the frame at the front of `data`, or 0 if it is not all
+// buffered yet; throws std::runtime_error on an oversized frame
+size_t protocol_frame_size(const char* data, size_t available);
+
+std::string encode_request(const Request& request);
+Request decode_request(const char* frame, size_t length);
+std::string encode_response(const Response& response);
+Response decode_response(const char* frame, size_t length);
+
+}
+#endif
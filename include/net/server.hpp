@@ -0,0 +1,72 @@
+#ifndef SERVER_FACTDB_HPP
+#define SERVER_FACTDB_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include <boost/asio/ip/tcp.hpp>
+
+#include "cluster/coordinator.hpp"
+#include "data/sharded_table.hpp"
+#include "net/protocol.hpp"
+#include "runtime/reactor.hpp"
+
+namespace factdb {
+
+struct ServerOptions {
+    std::string address = "127.0.0.1";
+    uint16_t port = 9042;                     // 0 picks a free port, see Server::port()
+    size_t max_in_flight_per_connection = 1024; // reading pauses above this many unanswered requests
+    std::shared_ptr<Coordinator> coordinator; // requests above LOCAL consistency go through it when set
+};
+
+struct ServerStats {
+    uint64_t connections = 0;
+    uint64_t requests = 0;
+    uint64_t errors = 0;
+};
+
+// Accepts on shard 0 and hands each connection to the next shard round
+// robin; the socket and every handler for it then stay on that shard.
+// Requests are dispatched as soon as their frame is read and answered as
+// they complete, so one connection pipelines many streams. Responses that
+// finish while a write is in flight are gathered into one vectored write.
+// Open connections refer to the server, so stop the reactor before the
+// server is destroyed.
+class Server {
+public:
+    Server(Reactor& reactor, ShardedTable& table, ServerOptions options = ServerOptions());
+    ~Server();
+
+    Server(const Server&) = delete;
+    Server& operator=(const Server&) = delete;
+
+    void start();
+    void stop();
+    uint16_t port() const { return port_; }
+    ServerStats stats() const;
+
+    // executes one request on the calling shard
+    Future<Response> handle(const Request& request);
+
+private:
+    class Connection;
+
+    Reactor& reactor_;
+    ShardedTable& table_;
+    ServerOptions options_;
+    std::unique_ptr<boost::asio::ip::tcp::acceptor> acceptor_;
+    uint16_t port_ = 0;
+    size_t next_shard_ = 0;
+    std::atomic<uint64_t> connections_{0};
+    std::atomic<uint64_t> requests_{0};
+    std::atomic<uint64_t> errors_{0};
+
+    void accept_();
+    Future<Response> route_(const Request& request);
+};
+
+}
+#endif
@@ -0,0 +1,205 @@
+#ifndef FUTURE_FACTDB_HPP
+#define FUTURE_FACTDB_HPP
+
+#include <exception>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace factdb {
+
+template <typename T> class Future;
+template <typename T> class Promise;
+
+template <typename T> struct is_future : std::false_type {};
+template <typename T> struct is_future<Future<T>> : std::true_type {};
+
+// value type of a continuation's result, with Future<U> flattened to U
+template <typename R> struct future_value { using type = R; };
+template <typename U> struct future_value<Future<U>> { using type = U; };
+template <typename R> using future_value_t = typename future_value<R>::type;
+
+namespace detail {
+template <typename T>
+struct FutureState {
+    std::optional<T> value;
+    std::exception_ptr error;
+    std::function<void()> continuation;
+
+    bool ready() const { return value.has_value() || error != nullptr; }
+    void fire() {
+        if (continuation) {
+            auto next = std::move(continuation);
+            continuation = nullptr;
+            next();
+        }
+    }
+};
+}
+
+// Future owned by a single reactor shard. The promise is fulfilled and the
+// continuation runs on the same thread, so the shared state needs no locks
+// or atomics; cross-shard results travel back through the reactor's queues.
+// Use bool where a result carries no value.
+template <typename T>
+class Future {
+    static_assert(!std::is_void_v<T>, "Future<void> is not supported, use Future<bool>");
+public:
+    using value_type = T;
+
+    Future() = default;
+    explicit Future(std::shared_ptr<detail::FutureState<T>> state) : state_(std::move(state)) {}
+
+    bool valid() const { return state_ != nullptr; }
+    bool available() const { return state_ && state_->ready(); }
+    bool failed() const { return state_ && state_->error != nullptr; }
+    std::exception_ptr error() const { return state_->error; }
+    T& value() {
+        if (!available()) throw std::logic_error("Future is not ready");
+        if (state_->error) std::rethrow_exception(state_->error);
+        return *state_->value;
+    }
+
+    // runs `ready` once the future resolves, immediately if it already has
+    void on_ready(std::function<void()> ready) {
+        if (state_->ready()) {
+            ready();
+        } else {
+            state_->continuation = std::move(ready);
+        }
+    }
+
+    // f(T) -> U or Future<U>; errors skip f and propagate to the result
+    template <typename F>
+    Future<future_value_t<std::invoke_result_t<F, T&&>>> then(F f) {
+        using R = std::invoke_result_t<F, T&&>;
+        Promise<future_value_t<R>> promise;
+        auto result = promise.get_future();
+        auto state = state_;
+        on_ready([state, promise, f]() mutable {
+            if (state->error) {
+                promise.set_exception(state->error);
+                return;
+            }
+            try {
+                if constexpr (is_future<R>::value) {
+                    f(std::move(*state->value)).forward_to(promise);
+                } else {
+                    promise.set_value(f(std::move(*state->value)));
+                }
+            } catch (...) {
+                promise.set_exception(std::current_exception());
+            }
+        });
+        return result;
+    }
+
+    void forward_to(Promise<T> promise) {
+        auto state = state_;
+        on_ready([state, promise]() mutable {
+            if (state->error) {
+                promise.set_exception(state->error);
+            } else {
+                promise.set_value(std::move(*state->value));
+            }
+        });
+    }
+
+private:
+    std::shared_ptr<detail::FutureState<T>> state_;
+};
+
+template <typename T>
+class Promise {
+public:
+    Promise() : state_(std::make_shared<detail::FutureState<T>>()) {}
+
+    Future<T> get_future() const { return Future<T>(state_); }
+    void set_value(T value) {
+        state_->value.emplace(std::move(value));
+        state_->fire();
+    }
+    void set_exception(std::exception_ptr error) {
+        state_->error = error;
+        state_->fire();
+    }
+
+private:
+    std::shared_ptr<detail::FutureState<T>> state_;
+};
+
+template <typename T>
+Future<T> make_ready_future(T value) {
+    Promise<T> promise;
+    promise.set_value(std::move(value));
+    return promise.get_future();
+}
+
+template <typename T>
+Future<T> make_exception_future(std::exception_ptr error) {
+    Promise<T> promise;
+    promise.set_exception(error);
+    return promise.get_future();
+}
+
+// calls f() and wraps its result, or what it throws, in a ready-or-pending Future
+template <typename F>
+Future<future_value_t<std::invoke_result_t<F>>> futurize_invoke(F& f) {
+    using R = std::invoke_result_t<F>;
+    try {
+        if constexpr (is_future<R>::value) {
+            return f();
+        } else {
+            return make_ready_future<R>(f());
+        }
+    } catch (...) {
+        return make_exception_future<future_value_t<R>>(std::current_exception());
+    }
+}
+
+// resolves once every input has; the first error wins
+template <typename T>
+Future<std::vector<T>> when_all(std::vector<Future<T>> futures) {
+    struct Gather {
+        std::vector<std::optional<T>> values;
+        size_t pending;
+        std::exception_ptr error;
+        Promise<std::vector<T>> promise;
+    };
+    auto gather = std::make_shared<Gather>();
+    gather->values.resize(futures.size());
+    gather->pending = futures.size();
+    auto result = gather->promise.get_future();
+    if (futures.empty()) {
+        gather->promise.set_value({});
+        return result;
+    }
+    for (size_t i = 0; i < futures.size(); i++) {
+        auto future = futures[i];
+        future.on_ready([gather, future, i]() mutable {
+            if (future.failed()) {
+                if (!gather->error) gather->error = future.error();
+            } else {
+                gather->values[i].emplace(std::move(future.value()));
+            }
+            if (--gather->pending == 0) {
+                if (gather->error) {
+                    gather->promise.set_exception(gather->error);
+                    return;
+                }
+                std::vector<T> values;
+                values.reserve(gather->values.size());
+                for (auto& value : gather->values) values.push_back(std::move(*value));
+                gather->promise.set_value(std::move(values));
+            }
+        });
+    }
+    return result;
+}
+
+}
+#endif
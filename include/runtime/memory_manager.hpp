@@ -0,0 +1,133 @@
+#ifndef MEMORY_MANAGER_FACTDB_HPP
+#define MEMORY_MANAGER_FACTDB_HPP
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+
+namespace factdb {
+
+enum class MemorySubsystem {
+    MEMTABLE,
+    BLOCK_CACHE,
+    ROW_CACHE,
+    IO_BUFFERS
+};
+constexpr size_t MEMORY_SUBSYSTEM_COUNT = 4;
+
+// "memtable", "block_cache", ... as used in metric names
+const char* memory_subsystem_name(MemorySubsystem subsystem);
+
+struct MemoryManagerOptions {
+    uint64_t budget_bytes = 1ull << 30;   // for the whole process
+    // fraction of the budget each subsystem may hold at most (its hard limit)
+    std::array<double, MEMORY_SUBSYSTEM_COUNT> shares = {{
+        0.50,   // MEMTABLE
+        0.35,   // BLOCK_CACHE
+        0.0,    // ROW_CACHE, nothing caches rows yet
+        0.15,   // IO_BUFFERS
+    }};
+    double soft_limit = 0.75;   // fraction of a share; memtables start flushing past it
+    // longest a writer waits for memtable memory before its write is refused
+    std::chrono::milliseconds max_write_stall{100};
+};
+
+struct MemoryStats {
+    std::array<uint64_t, MEMORY_SUBSYSTEM_COUNT> usage = {};
+    uint64_t write_stalls = 0;      // writers that waited at the memtable hard limit
+    uint64_t stalled_ns = 0;        // total time they waited
+    uint64_t rejected_writes = 0;   // writers refused once max_write_stall ran out
+};
+
+// Thrown by writes refused at the memtable hard limit.
+class MemoryLimitError : public std::runtime_error {
+public:
+    using std::runtime_error::runtime_error;
+};
+
+// Divides one process-wide budget among the subsystems that hold memory.
+// Each subsystem charges what it allocates and releases what it frees;
+// the manager only counts, and the owners enforce their limits: the block
+// cache and the I/O buffer pool size themselves to their hard limit, and
+// tables flush memtables past the soft limit and hold writers back at the
+// hard one while the largest registered memtable is flushed (see Table).
+// Usage is exported per subsystem as metrics.
+class MemoryManager {
+public:
+    // throws std::invalid_argument when the shares add up to more than the budget
+    explicit MemoryManager(MemoryManagerOptions options = MemoryManagerOptions());
+
+    MemoryManager(const MemoryManager&) = delete;
+    MemoryManager& operator=(const MemoryManager&) = delete;
+
+    uint64_t limit(MemorySubsystem subsystem) const { return limits_[index_(subsystem)]; }
+    uint64_t soft_limit(MemorySubsystem subsystem) const { return soft_limits_[index_(subsystem)]; }
+    uint64_t usage(MemorySubsystem subsystem) const { return usage_[index_(subsystem)].value.load(std::memory_order_relaxed); }
+    bool over_soft_limit(MemorySubsystem subsystem) const { return usage(subsystem) >= soft_limit(subsystem); }
+    bool over_limit(MemorySubsystem subsystem) const { return usage(subsystem) >= limit(subsystem); }
+
+    // adds `bytes` to a subsystem's usage; a negative count releases them
+    void charge(MemorySubsystem subsystem, int64_t bytes);
+
+    // Memtables register so the flush policy knows how many share the budget
+    // and which to flush for a stalled writer: `bytes` is what a flush of it
+    // would release and `flush` asks for one without waiting. Returns the id
+    // to remove it by; its callbacks are not called once removal returns.
+    uint64_t add_memtable(std::function<uint64_t()> bytes = nullptr, std::function<void()> flush = nullptr);
+    void remove_memtable(uint64_t id);
+    // True once memtables are past their soft limit and one holding
+    // `memtable_bytes` holds at least the average, so the largest ones go first.
+    bool should_flush(uint64_t memtable_bytes) const;
+    // asks the registered memtable that would release the most to flush
+    void flush_largest_memtable();
+    // Blocks while memtables are at their hard limit, up to max_write_stall,
+    // having the largest flushed each time memory is released and they still
+    // are; false if they still are at the end.
+    bool wait_for_memtable_room();
+    // The same check without blocking, for callers that wait by their own
+    // means (see ShardedTable): asks for the largest memtable to be flushed
+    // when there is no room, and records nothing.
+    bool try_memtable_room();
+    std::chrono::milliseconds max_write_stall() const { return options_.max_write_stall; }
+    void record_write_stall(std::chrono::steady_clock::duration waited);
+    void record_rejected_write() { rejected_writes_.fetch_add(1, std::memory_order_relaxed); }
+
+    MemoryStats stats() const;
+
+private:
+    struct alignas(64) Usage {
+        std::atomic<uint64_t> value{0};
+    };
+
+    MemoryManagerOptions options_;
+    std::array<uint64_t, MEMORY_SUBSYSTEM_COUNT> limits_;
+    std::array<uint64_t, MEMORY_SUBSYSTEM_COUNT> soft_limits_;
+    std::array<Usage, MEMORY_SUBSYSTEM_COUNT> usage_;
+    std::atomic<size_t> memtables_{0};
+
+    struct RegisteredMemtable {
+        std::function<uint64_t()> bytes;
+        std::function<void()> flush;
+    };
+    std::mutex memtables_mutex_;   // guards registered_, held while their callbacks run
+    std::map<uint64_t, RegisteredMemtable> registered_;
+    uint64_t next_memtable_id_ = 1;
+
+    std::mutex mutex_;   // only for the waiters' condition variable
+    std::condition_variable room_cv_;
+    std::atomic<size_t> waiters_{0};
+    std::atomic<uint64_t> write_stalls_{0};
+    std::atomic<uint64_t> stalled_ns_{0};
+    std::atomic<uint64_t> rejected_writes_{0};
+
+    static size_t index_(MemorySubsystem subsystem) { return static_cast<size_t>(subsystem); }
+};
+
+}
+#endif
@@ -0,0 +1,152 @@
+#ifndef REACTOR_FACTDB_HPP
+#define REACTOR_FACTDB_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include <boost/asio/executor_work_guard.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/lockfree/spsc_queue.hpp>
+
+#include "runtime/future.hpp"
+
+namespace factdb {
+
+struct ReactorOptions {
+    size_t shards = 0;              // 0 means one per hardware thread
+    size_t queue_capacity = 4096;   // messages per (source, target) queue
+    bool pin_threads = true;        // pin shard i to cpu i % hardware threads
+};
+
+struct ReactorStats {
+    uint64_t messages = 0;    // delivered through the SPSC queues
+    uint64_t overflows = 0;   // queue was full, held in the pair's overflow list instead
+    uint64_t wakeups = 0;     // drain handlers posted to an idle shard
+    uint64_t external = 0;    // submitted from threads outside the reactor
+};
+
+// Shard-per-core runtime. Each shard is one thread running its own
+// boost::asio::io_context. Every ordered pair of shards has a lock-free SPSC
+// queue, so a message between shards costs one push and, only when the
+// target is idle, one post to wake it. Messages that find the queue full
+// wait in the pair's overflow list, and keep going there until the target
+// has drained it, so they still arrive in order. Threads outside the
+// reactor submit through io_context::post.
+class Reactor {
+public:
+    using Task = std::function<void()>;
+    static constexpr size_t NO_SHARD = SIZE_MAX;
+
+    explicit Reactor(ReactorOptions options = ReactorOptions());
+    ~Reactor();
+
+    Reactor(const Reactor&) = delete;
+    Reactor& operator=(const Reactor&) = delete;
+
+    size_t shard_count() const { return shards_.size(); }
+    // shard of the calling thread, NO_SHARD off the reactor
+    static size_t this_shard();
+    // for sockets and timers whose handlers must run on `shard`
+    boost::asio::io_context& io_context(size_t shard) { return shards_.at(shard)->io; }
+
+    // runs `task` on `shard`; from one shard to another, tasks arrive in order
+    void send(size_t shard, Task task);
+
+    // Runs fn on `shard` and resolves on the calling shard. fn may return a
+    // value or a Future. Must be called from a reactor thread.
+    template <typename F>
+    Future<future_value_t<std::invoke_result_t<F>>> submit_to(size_t shard, F fn) {
+        using U = future_value_t<std::invoke_result_t<F>>;
+        size_t source = this_shard();
+        if (source == NO_SHARD) {
+            throw std::logic_error("submit_to called outside the reactor, use run_on");
+        }
+        if (source == shard) {
+            return futurize_invoke(fn);
+        }
+        Promise<U> promise;
+        auto result = promise.get_future();
+        send(shard, [this, source, promise, fn]() mutable {
+            auto outcome = futurize_invoke(fn);
+            outcome.on_ready([this, source, promise, outcome]() mutable {
+                if (outcome.failed()) {
+                    send(source, [promise, error = outcome.error()]() mutable { promise.set_exception(error); });
+                } else {
+                    auto value = std::make_shared<U>(std::move(outcome.value()));
+                    send(source, [promise, value]() mutable { promise.set_value(std::move(*value)); });
+                }
+            });
+        });
+        return result;
+    }
+
+    // like submit_to, for threads outside the reactor
+    template <typename F>
+    std::future<future_value_t<std::invoke_result_t<F>>> run_on(size_t shard, F fn) {
+        using U = future_value_t<std::invoke_result_t<F>>;
+        auto promise = std::make_shared<std::promise<U>>();
+        auto result = promise->get_future();
+        send(shard, [promise, fn]() mutable {
+            auto outcome = futurize_invoke(fn);
+            outcome.on_ready([promise, outcome]() mutable {
+                if (outcome.failed()) {
+                    promise->set_exception(outcome.error());
+                } else {
+                    promise->set_value(std::move(outcome.value()));
+                }
+            });
+        });
+        return result;
+    }
+
+    // resolves on the calling shard after `delay`; true unless the reactor stopped first
+    Future<bool> sleep(std::chrono::steady_clock::duration delay);
+    void schedule_after(size_t shard, std::chrono::steady_clock::duration delay, Task task);
+
+    ReactorStats stats() const;
+    void stop();
+    bool stopped() const { return stopped_.load(); }
+
+private:
+    using Queue = boost::lockfree::spsc_queue<Task*>;
+    // messages from one source shard to one target
+    struct Inbound {
+        Queue ring;
+        std::mutex overflow_mutex;
+        std::deque<Task*> overflow;       // newer than everything in ring
+        std::atomic<bool> overflowing{false};
+
+        explicit Inbound(size_t capacity) : ring(capacity) {}
+    };
+    struct Shard {
+        boost::asio::io_context io;
+        boost::asio::executor_work_guard<boost::asio::io_context::executor_type> work;
+        std::thread thread;
+        std::vector<std::unique_ptr<Inbound>> inbound;   // indexed by source shard
+        std::atomic<bool> wakeup_pending{false};
+        std::atomic<uint64_t> messages{0};
+        std::atomic<uint64_t> overflows{0};
+        std::atomic<uint64_t> wakeups{0};
+        std::atomic<uint64_t> external{0};
+
+        Shard() : work(boost::asio::make_work_guard(io)) {}
+    };
+
+    std::vector<std::unique_ptr<Shard>> shards_;
+    std::atomic<bool> stopped_{false};
+
+    void wake_(Shard& target);
+    void drain_(Shard& shard);
+};
+
+}
+#endif
@@ -0,0 +1,63 @@
+#!/usr/bin/env python3
+# Compares two factdb_bench JSON result files and exits non-zero when any
+# benchmark got slower than the threshold allows.
+#   build/factdb_bench --benchmark_out=base.json --benchmark_out_format=json
+#   build/factdb_bench --benchmark_out=new.json --benchmark_out_format=json
+#   scripts/compare_bench.py base.json new.json [--threshold 0.10] [--metric cpu_time]
+import argparse
+import json
+import sys
+
+
+def load(path, metric):
+    with open(path) as f:
+        data = json.load(f)
+    results = {}
+    for bench in data.get("benchmarks", []):
+        # with --benchmark_repetitions keep the median, skip the other aggregates
+        if bench.get("run_type") == "aggregate" and bench.get("aggregate_name") != "median":
+            continue
+        name = bench.get("run_name", bench["name"])
+        if bench.get("run_type") == "iteration" and name in results:
+            continue
+        results[name] = float(bench[metric])
+    return results
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Compare two factdb_bench JSON result files.")
+    parser.add_argument("baseline")
+    parser.add_argument("contender")
+    parser.add_argument("--threshold", type=float, default=0.10,
+                        help="relative slowdown reported as a regression (default 0.10)")
+    parser.add_argument("--metric", default="cpu_time", choices=["cpu_time", "real_time"])
+    args = parser.parse_args()
+
+    baseline = load(args.baseline, args.metric)
+    contender = load(args.contender, args.metric)
+    regressions = 0
+    width = max((len(name) for name in baseline), default=10)
+    print(f"{'benchmark':<{width}}  {'baseline':>12}  {'contender':>12}  {'change':>8}")
+    for name, before in baseline.items():
+        after = contender.get(name)
+        if after is None:
+            print(f"{name:<{width}}  {before:>12.1f}  {'missing':>12}")
+            continue
+        change = (after - before) / before if before else 0.0
+        flag = ""
+        if change > args.threshold:
+            flag = "  REGRESSION"
+            regressions += 1
+        elif change < -args.threshold:
+            flag = "  improved"
+        print(f"{name:<{width}}  {before:>12.1f}  {after:>12.1f}  {change:>+7.1%}{flag}")
+    for name in contender.keys() - baseline.keys():
+        print(f"{name:<{width}}  {'new':>12}  {contender[name]:>12.1f}")
+    if regressions:
+        print(f"{regressions} benchmark(s) slower than {args.threshold:.0%}", file=sys.stderr)
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
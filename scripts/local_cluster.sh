@@ -0,0 +1,28 @@
+#!/usr/bin/env bash
+# Starts an N-node factdb cluster on 127.0.0.1..127.0.0.N, one process per
+# node, and stops every node on Ctrl-C.
+#   scripts/local_cluster.sh [nodes] [rf] [shards]
+# then, e.g.
+#   build/factdb_loadgen --hosts 127.0.0.1:9042,127.0.0.2:9042,127.0.0.3:9042 --consistency QUORUM
+set -euo pipefail
+
+NODES=${1:-3}
+RF=${2:-3}
+SHARDS=${3:-1}
+BIN=${FACTDB_BIN:-build/factdb}
+DATA=${FACTDB_DATA:-/tmp/factdb-cluster}
+PORT=9042
+
+cluster=""
+for i in $(seq 1 "$NODES"); do
+    cluster+="${cluster:+,}node$i=127.0.0.$i:$PORT"
+done
+
+pids=()
+trap 'kill "${pids[@]}" 2>/dev/null; wait' INT TERM EXIT
+for i in $(seq 1 "$NODES"); do
+    "$BIN" --address "127.0.0.$i" --port "$PORT" --data "$DATA/node$i" --shards "$SHARDS" \
+           --node-id "node$i" --cluster "$cluster" --rf "$RF" &
+    pids+=($!)
+done
+wait
@@ -0,0 +1,97 @@
+#include <io/aligned_buffer_pool.hpp>
+#include <runtime/memory_manager.hpp>
+
+#include <algorithm>
+#include <cstdlib>
+#include <new>
+
+factdb::AlignedBuffer& factdb::AlignedBuffer::operator=(AlignedBuffer&& other) noexcept{
+    if(this != &other){
+        release();
+        pool_ = other.pool_;
+        data_ = other.data_;
+        size_ = other.size_;
+        other.pool_ = nullptr;
+        other.data_ = nullptr;
+    }
+    return *this;
+}
+void factdb::AlignedBuffer::release(){
+    if(pool_ && data_){
+        pool_->give_back_(data_);
+    }
+    pool_ = nullptr;
+    data_ = nullptr;
+}
+
+factdb::AlignedBufferPool::AlignedBufferPool(size_t buffer_size, size_t max_buffers, MemoryManager* memory)
+    : buffer_size_((buffer_size + DIRECT_IO_ALIGNMENT - 1) / DIRECT_IO_ALIGNMENT * DIRECT_IO_ALIGNMENT),
+      max_buffers_(max_buffers == 0 ? 1 : max_buffers), memory_(memory){
+    if(memory_){
+        size_t allowed = memory_->limit(MemorySubsystem::IO_BUFFERS) / buffer_size_;
+        max_buffers_ = std::max<size_t>(1, std::min(max_buffers_, allowed));
+    }
+}
+factdb::AlignedBufferPool::~AlignedBufferPool(){
+    for(char* data : free_){
+        std::free(data);
+    }
+    if(memory_){
+        memory_->charge(MemorySubsystem::IO_BUFFERS, -static_cast<int64_t>(allocated_ * buffer_size_));
+    }
+}
+factdb::AlignedBuffer factdb::AlignedBufferPool::take_locked_(){
+    char* data = nullptr;
+    if(!free_.empty()){
+        data = free_.back();
+        free_.pop_back();
+    }else{
+        void* memory = nullptr;
+        if(posix_memalign(&memory, DIRECT_IO_ALIGNMENT, buffer_size_) != 0){
+            throw std::bad_alloc();
+        }
+        data = static_cast<char*>(memory);
+        allocated_++;
+        if(memory_){
+            memory_->charge(MemorySubsystem::IO_BUFFERS, static_cast<int64_t>(buffer_size_));
+        }
+    }
+    in_use_++;
+    return AlignedBuffer(this, data, buffer_size_);
+}
+factdb::AlignedBuffer factdb::AlignedBufferPool::acquire(){
+    std::unique_lock<std::mutex> lock(mutex_);
+    available_cv_.wait(lock, [this]{ return in_use_ < max_buffers_; });
+    return take_locked_();
+}
+factdb::AlignedBuffer factdb::AlignedBufferPool::try_acquire(){
+    std::lock_guard<std::mutex> guard(mutex_);
+    if(in_use_ >= max_buffers_){
+        return AlignedBuffer();
+    }
+    return take_locked_();
+}
+void factdb::AlignedBufferPool::give_back_(char* data){
+    {
+        std::lock_guard<std::mutex> guard(mutex_);
+        free_.push_back(data);
+        in_use_--;
+    }
+    available_cv_.notify_one();
+}
+size_t factdb::AlignedBufferPool::in_use() const{
+    std::lock_guard<std::mutex> guard(mutex_);
+    return in_use_;
+}
+size_t factdb::AlignedBufferPool::allocated() const{
+    std::lock_guard<std::mutex> guard(mutex_);
+    return allocated_;
+}
+double factdb::AlignedBufferPool::occupancy() const{
+    std::lock_guard<std::mutex> guard(mutex_);
+    return static_cast<double>(in_use_) / max_buffers_;
+}
+factdb::AlignedBufferPool& factdb::default_buffer_pool(){
+    static AlignedBufferPool pool;
+    return pool;
+}
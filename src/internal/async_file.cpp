@@ -0,0 +1,440 @@
+#include <io/async_file.hpp>
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <unordered_set>
+
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace {
+constexpr uint64_t EVENTFD_USER_DATA = 0; // operations use their (non-null) address as user_data
+
+int sys_io_uring_setup(unsigned entries, io_uring_params* params){
+    return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+}
+int sys_io_uring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags){
+    return static_cast<int>(syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, nullptr, 0));
+}
+int sys_io_uring_register(int fd, unsigned opcode, const void* arg, unsigned nr_args){
+    return static_cast<int>(syscall(__NR_io_uring_register, fd, opcode, arg, nr_args));
+}
+template <typename T>
+T* ring_field(void* base, uint32_t offset){
+    return reinterpret_cast<T*>(static_cast<char*>(base) + offset);
+}
+}
+
+ssize_t factdb::IoEngine::read_fully(int fd, void* buffer, size_t length, off_t offset){
+    size_t done = 0;
+    while(done < length){
+        ssize_t n = read(fd, static_cast<char*>(buffer) + done, length - done, offset + done).get();
+        if(n < 0) return n;
+        if(n == 0) break;
+        done += n;
+    }
+    return done;
+}
+ssize_t factdb::IoEngine::write_fully(int fd, const void* buffer, size_t length, off_t offset){
+    size_t done = 0;
+    while(done < length){
+        ssize_t n = write(fd, static_cast<const char*>(buffer) + done, length - done, offset + done).get();
+        if(n < 0) return n;
+        if(n == 0) return -EIO;
+        done += n;
+    }
+    return done;
+}
+
+factdb::ThreadPoolIoEngine::ThreadPoolIoEngine(size_t threads){
+    for(size_t i = 0; i < std::max<size_t>(1, threads); i++){
+        workers_.emplace_back(&ThreadPoolIoEngine::worker_loop_, this);
+    }
+}
+factdb::ThreadPoolIoEngine::~ThreadPoolIoEngine(){
+    {
+        std::lock_guard<std::mutex> guard(mutex_);
+        stopping_ = true;
+    }
+    cv_.notify_all();
+    for(auto& worker : workers_){
+        worker.join();
+    }
+}
+std::future<ssize_t> factdb::ThreadPoolIoEngine::enqueue_(std::function<ssize_t()> op){
+    std::packaged_task<ssize_t()> task(std::move(op));
+    std::future<ssize_t> result = task.get_future();
+    {
+        std::lock_guard<std::mutex> guard(mutex_);
+        tasks_.push_back(std::move(task));
+        stats_.submitted++;
+    }
+    cv_.notify_one();
+    return result;
+}
+void factdb::ThreadPoolIoEngine::worker_loop_(){
+    std::unique_lock<std::mutex> lock(mutex_);
+    while(true){
+        cv_.wait(lock, [this]{ return stopping_ || !tasks_.empty(); });
+        if(tasks_.empty()){
+            return;
+        }
+        std::packaged_task<ssize_t()> task = std::move(tasks_.front());
+        tasks_.pop_front();
+        stats_.batches++;
+        lock.unlock();
+        task();
+        lock.lock();
+        stats_.completed++;
+    }
+}
+std::future<ssize_t> factdb::ThreadPoolIoEngine::read(int fd, void* buffer, size_t length, off_t offset){
+    return enqueue_([=]() -> ssize_t {
+        ssize_t n = ::pread(fd, buffer, length, offset);
+        return n < 0 ? -errno : n;
+    });
+}
+std::future<ssize_t> factdb::ThreadPoolIoEngine::write(int fd, const void* buffer, size_t length, off_t offset){
+    return enqueue_([=]() -> ssize_t {
+        ssize_t n = ::pwrite(fd, buffer, length, offset);
+        return n < 0 ? -errno : n;
+    });
+}
+std::future<ssize_t> factdb::ThreadPoolIoEngine::fsync(int fd, bool datasync){
+    return enqueue_([=]() -> ssize_t {
+        int rc = datasync ? ::fdatasync(fd) : ::fsync(fd);
+        return rc < 0 ? -errno : 0;
+    });
+}
+factdb::IoEngineStats factdb::ThreadPoolIoEngine::stats() const{
+    std::lock_guard<std::mutex> guard(mutex_);
+    return stats_;
+}
+
+bool factdb::IoUringEngine::supported(){
+    io_uring_params params;
+    std::memset(&params, 0, sizeof(params));
+    int fd = sys_io_uring_setup(4, &params);
+    if(fd < 0){
+        return false;
+    }
+    ::close(fd);
+    // IORING_OP_READ/WRITE need 5.6; this feature bit arrived in the same release
+    return (params.features & IORING_FEAT_RW_CUR_POS) != 0;
+}
+factdb::IoUringEngine::IoUringEngine(unsigned entries){
+    io_uring_params params;
+    std::memset(&params, 0, sizeof(params));
+    ring_fd_ = sys_io_uring_setup(entries, &params);
+    if(ring_fd_ < 0){
+        throw std::runtime_error(std::string("io_uring_setup failed: ") + std::strerror(errno));
+    }
+    sq_entries_ = params.sq_entries;
+    cq_entries_ = params.cq_entries;
+    sq_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cq_size_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    bool single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if(single_mmap){
+        sq_size_ = cq_size_ = std::max(sq_size_, cq_size_);
+    }
+    sq_ptr_ = mmap(nullptr, sq_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQ_RING);
+    if(sq_ptr_ == MAP_FAILED){
+        sq_ptr_ = nullptr;
+        unmap_();
+        throw std::runtime_error("io_uring sq ring mmap failed");
+    }
+    if(single_mmap){
+        cq_ptr_ = sq_ptr_;
+    }else{
+        cq_ptr_ = mmap(nullptr, cq_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_CQ_RING);
+        if(cq_ptr_ == MAP_FAILED){
+            cq_ptr_ = nullptr;
+            unmap_();
+            throw std::runtime_error("io_uring cq ring mmap failed");
+        }
+    }
+    sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+    sqes_ptr_ = mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQES);
+    if(sqes_ptr_ == MAP_FAILED){
+        sqes_ptr_ = nullptr;
+        unmap_();
+        throw std::runtime_error("io_uring sqe mmap failed");
+    }
+    sq_head_ = ring_field<unsigned>(sq_ptr_, params.sq_off.head);
+    sq_tail_ = ring_field<unsigned>(sq_ptr_, params.sq_off.tail);
+    sq_mask_ = ring_field<unsigned>(sq_ptr_, params.sq_off.ring_mask);
+    sq_array_ = ring_field<unsigned>(sq_ptr_, params.sq_off.array);
+    cq_head_ = ring_field<unsigned>(cq_ptr_, params.cq_off.head);
+    cq_tail_ = ring_field<unsigned>(cq_ptr_, params.cq_off.tail);
+    cq_mask_ = ring_field<unsigned>(cq_ptr_, params.cq_off.ring_mask);
+    sqes_ = static_cast<io_uring_sqe*>(sqes_ptr_);
+    cqes_ = ring_field<io_uring_cqe>(cq_ptr_, params.cq_off.cqes);
+
+    event_fd_ = eventfd(0, EFD_CLOEXEC);
+    if(event_fd_ < 0){
+        unmap_();
+        throw std::runtime_error("eventfd failed");
+    }
+    ring_thread_ = std::thread(&IoUringEngine::ring_loop_, this);
+}
+factdb::IoUringEngine::~IoUringEngine(){
+    stopping_ = true;
+    uint64_t one = 1;
+    ssize_t ignored = ::write(event_fd_, &one, sizeof(one));
+    (void)ignored;
+    ring_thread_.join();
+    unmap_();
+}
+void factdb::IoUringEngine::unmap_(){
+    if(sqes_ptr_) munmap(sqes_ptr_, sqes_size_);
+    if(cq_ptr_ && cq_ptr_ != sq_ptr_) munmap(cq_ptr_, cq_size_);
+    if(sq_ptr_) munmap(sq_ptr_, sq_size_);
+    sqes_ptr_ = cq_ptr_ = sq_ptr_ = nullptr;
+    if(event_fd_ >= 0) ::close(event_fd_);
+    if(ring_fd_ >= 0) ::close(ring_fd_);
+    event_fd_ = ring_fd_ = -1;
+}
+std::future<ssize_t> factdb::IoUringEngine::enqueue_(std::unique_ptr<Operation> op){
+    std::future<ssize_t> result = op->result.get_future();
+    {
+        std::lock_guard<std::mutex> guard(mutex_);
+        if(failure_ != 0){
+            op->result.set_value(failure_); // no ring thread left to submit it
+            return result;
+        }
+        pending_.push_back(std::move(op));
+    }
+    uint64_t one = 1;
+    ssize_t ignored = ::write(event_fd_, &one, sizeof(one)); // wakes the ring thread
+    (void)ignored;
+    return result;
+}
+void factdb::IoUringEngine::ring_loop_(){
+    std::deque<std::unique_ptr<Operation>> batch;
+    std::unordered_set<Operation*> in_flight;  // submitted and owned through their user_data
+    int failure = -ECANCELED;
+    bool poll_armed = false;
+    uint64_t event_value = 0;
+    while(true){
+        {
+            std::lock_guard<std::mutex> guard(mutex_);
+            if(stopping_ && pending_.empty() && in_flight.empty()){
+                break;
+            }
+            // keep one slot in the completion queue for the eventfd poll
+            while(!pending_.empty() && in_flight.size() + batch.size() + 1 < std::min(sq_entries_, cq_entries_)){
+                batch.push_back(std::move(pending_.front()));
+                pending_.pop_front();
+            }
+        }
+        unsigned tail = *sq_tail_;
+        unsigned to_submit = 0;
+        auto push_sqe = [&](const io_uring_sqe& sqe){
+            unsigned index = tail & *sq_mask_;
+            sqes_[index] = sqe;
+            sq_array_[index] = index;
+            tail++;
+            to_submit++;
+        };
+        if(!poll_armed && !stopping_){
+            io_uring_sqe sqe;
+            std::memset(&sqe, 0, sizeof(sqe));
+            sqe.opcode = IORING_OP_POLL_ADD;
+            sqe.fd = event_fd_;
+            sqe.poll32_events = POLLIN;
+            sqe.user_data = EVENTFD_USER_DATA;
+            push_sqe(sqe);
+            poll_armed = true;
+        }
+        while(!batch.empty()){
+            Operation* op = batch.front().release();
+            batch.pop_front();
+            io_uring_sqe sqe;
+            std::memset(&sqe, 0, sizeof(sqe));
+            sqe.opcode = op->opcode;
+            sqe.fd = op->fd;
+            sqe.addr = op->addr;
+            sqe.len = op->length;
+            sqe.off = op->offset;
+            sqe.rw_flags = static_cast<__kernel_rwf_t>(op->op_flags);
+            if(op->buffer_index >= 0){
+                sqe.buf_index = static_cast<__u16>(op->buffer_index);
+            }
+            sqe.user_data = reinterpret_cast<uint64_t>(op);
+            push_sqe(sqe);
+            in_flight.insert(op);
+        }
+        __atomic_store_n(sq_tail_, tail, __ATOMIC_RELEASE);
+        if(to_submit > 0){
+            batches_++;
+        }
+
+        int rc = sys_io_uring_enter(ring_fd_, to_submit, (!in_flight.empty() || poll_armed) ? 1 : 0, IORING_ENTER_GETEVENTS);
+        if(rc < 0 && errno != EINTR && errno != EAGAIN && errno != EBUSY){
+            failure = -errno;
+            break;
+        }
+
+        unsigned head = *cq_head_;
+        unsigned cq_tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+        while(head != cq_tail){
+            const io_uring_cqe& cqe = cqes_[head & *cq_mask_];
+            if(cqe.user_data == EVENTFD_USER_DATA){
+                ssize_t ignored = ::read(event_fd_, &event_value, sizeof(event_value));
+                (void)ignored;
+                poll_armed = false;
+            }else{
+                std::unique_ptr<Operation> op(reinterpret_cast<Operation*>(cqe.user_data));
+                op->result.set_value(cqe.res);
+                in_flight.erase(op.get());
+                completed_++;
+            }
+            head++;
+        }
+        __atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+    }
+    // On a ring failure nothing will reap what was submitted: fail it all,
+    // and everything queued from now on, with the error instead of leaving
+    // callers waiting on futures no one completes.
+    for(Operation* op : in_flight){
+        std::unique_ptr<Operation> owned(op);
+        owned->result.set_value(failure);
+    }
+    for(auto& op : batch){
+        op->result.set_value(failure);
+    }
+    std::lock_guard<std::mutex> guard(mutex_);
+    failure_ = failure;
+    for(auto& op : pending_){
+        op->result.set_value(failure);
+    }
+    pending_.clear();
+}
+std::future<ssize_t> factdb::IoUringEngine::read(int fd, void* buffer, size_t length, off_t offset){
+    submitted_++;
+    return enqueue_(std::unique_ptr<Operation>(new Operation{IORING_OP_READ, fd, reinterpret_cast<uint64_t>(buffer),
+                                                             static_cast<uint32_t>(length), offset, 0, -1, {}}));
+}
+std::future<ssize_t> factdb::IoUringEngine::write(int fd, const void* buffer, size_t length, off_t offset){
+    submitted_++;
+    return enqueue_(std::unique_ptr<Operation>(new Operation{IORING_OP_WRITE, fd, reinterpret_cast<uint64_t>(buffer),
+                                                             static_cast<uint32_t>(length), offset, 0, -1, {}}));
+}
+std::future<ssize_t> factdb::IoUringEngine::fsync(int fd, bool datasync){
+    submitted_++;
+    return enqueue_(std::unique_ptr<Operation>(new Operation{IORING_OP_FSYNC, fd, 0, 0, 0,
+                                                             datasync ? IORING_FSYNC_DATASYNC : 0u, -1, {}}));
+}
+bool factdb::IoUringEngine::register_buffers(const std::vector<iovec>& buffers){
+    sys_io_uring_register(ring_fd_, IORING_UNREGISTER_BUFFERS, nullptr, 0);
+    if(buffers.empty()){
+        return true;
+    }
+    return sys_io_uring_register(ring_fd_, IORING_REGISTER_BUFFERS, buffers.data(), buffers.size()) == 0;
+}
+std::future<ssize_t> factdb::IoUringEngine::read_fixed(int fd, size_t buffer_index, void* buffer, size_t length, off_t offset){
+    submitted_++;
+    return enqueue_(std::unique_ptr<Operation>(new Operation{IORING_OP_READ_FIXED, fd, reinterpret_cast<uint64_t>(buffer),
+                                                             static_cast<uint32_t>(length), offset, 0,
+                                                             static_cast<int>(buffer_index), {}}));
+}
+std::future<ssize_t> factdb::IoUringEngine::write_fixed(int fd, size_t buffer_index, const void* buffer, size_t length, off_t offset){
+    submitted_++;
+    return enqueue_(std::unique_ptr<Operation>(new Operation{IORING_OP_WRITE_FIXED, fd, reinterpret_cast<uint64_t>(buffer),
+                                                             static_cast<uint32_t>(length), offset, 0,
+                                                             static_cast<int>(buffer_index), {}}));
+}
+factdb::IoEngineStats factdb::IoUringEngine::stats() const{
+    IoEngineStats stats;
+    stats.submitted = submitted_;
+    stats.completed = completed_;
+    stats.batches = batches_;
+    return stats;
+}
+
+std::unique_ptr<factdb::IoEngine> factdb::make_io_engine(size_t fallback_threads){
+    if(IoUringEngine::supported()){
+        try{
+            return std::make_unique<IoUringEngine>();
+        }catch(const std::runtime_error&){
+        }
+    }
+    return std::make_unique<ThreadPoolIoEngine>(fallback_threads);
+}
+factdb::IoEngine& factdb::default_io_engine(){
+    static std::unique_ptr<IoEngine> engine = make_io_engine();
+    return *engine;
+}
+
+bool factdb::write_file(IoEngine& engine, const std::string& path, const char* data, size_t length, bool sync){
+    int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if(fd < 0){
+        return false;
+    }
+    std::vector<std::pair<size_t, std::future<ssize_t>>> chunks;
+    for(size_t offset = 0; offset < length; offset += ASYNC_FILE_CHUNK_SIZE){
+        size_t chunk = std::min(ASYNC_FILE_CHUNK_SIZE, length - offset);
+        chunks.emplace_back(offset, engine.write(fd, data + offset, chunk, offset));
+    }
+    bool ok = true;
+    for(auto& [offset, result] : chunks){
+        size_t chunk = std::min(ASYNC_FILE_CHUNK_SIZE, length - offset);
+        ssize_t n = result.get();
+        if(n >= 0 && static_cast<size_t>(n) < chunk){ // finish a short write in place
+            ssize_t rest = engine.write_fully(fd, data + offset + n, chunk - n, offset + n);
+            n = rest < 0 ? rest : n + rest;
+        }
+        ok = ok && n == static_cast<ssize_t>(chunk);
+    }
+    if(ok && sync){
+        ok = engine.fsync(fd, true).get() == 0;
+    }
+    ::close(fd);
+    return ok;
+}
+bool factdb::sync_directory(const std::string& directory){
+    int fd = ::open(directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if(fd < 0){
+        return false;
+    }
+    bool ok = ::fsync(fd) == 0;
+    ::close(fd);
+    return ok;
+}
+bool factdb::read_file(IoEngine& engine, const std::string& path, std::string& out){
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if(fd < 0){
+        return false;
+    }
+    struct stat st;
+    if(fstat(fd, &st) != 0){
+        ::close(fd);
+        return false;
+    }
+    size_t length = st.st_size;
+    out.assign(length, '\0');
+    std::vector<std::pair<size_t, std::future<ssize_t>>> chunks;
+    for(size_t offset = 0; offset < length; offset += ASYNC_FILE_CHUNK_SIZE){
+        size_t chunk = std::min(ASYNC_FILE_CHUNK_SIZE, length - offset);
+        chunks.emplace_back(offset, engine.read(fd, out.data() + offset, chunk, offset));
+    }
+    bool ok = true;
+    for(auto& [offset, result] : chunks){
+        size_t chunk = std::min(ASYNC_FILE_CHUNK_SIZE, length - offset);
+        ssize_t n = result.get();
+        if(n >= 0 && static_cast<size_t>(n) < chunk){
+            ssize_t rest = engine.read_fully(fd, out.data() + offset + n, chunk - n, offset + n);
+            n = rest < 0 ? rest : n + rest;
+        }
+        ok = ok && n == static_cast<ssize_t>(chunk);
+    }
+    ::close(fd);
+    return ok;
+}
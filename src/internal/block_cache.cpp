@@ -0,0 +1,168 @@
+#include <io/block_cache.hpp>
+#include <runtime/memory_manager.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <future>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+factdb::BlockCache::BlockCache(uint64_t capacity_bytes, size_t block_size, MemoryManager* memory)
+    : capacity_bytes_(memory ? std::min(capacity_bytes, memory->limit(MemorySubsystem::BLOCK_CACHE)) : capacity_bytes),
+      block_size_(block_size == 0 ? 4096 : block_size), memory_(memory){}
+factdb::BlockCache::~BlockCache(){
+    if(memory_){
+        memory_->charge(MemorySubsystem::BLOCK_CACHE, -static_cast<int64_t>(size_bytes_));
+    }
+}
+
+std::shared_ptr<const std::string> factdb::BlockCache::get(const std::string& path, uint64_t block){
+    std::lock_guard<std::mutex> guard(mutex_);
+    auto file = index_.find(path);
+    if(file != index_.end()){
+        auto it = file->second.find(block);
+        if(it != file->second.end()){
+            lru_.splice(lru_.begin(), lru_, it->second);
+            hits_++;
+            return it->second->data;
+        }
+    }
+    misses_++;
+    return nullptr;
+}
+void factdb::BlockCache::put(const std::string& path, uint64_t block, std::string data){
+    std::lock_guard<std::mutex> guard(mutex_);
+    uint64_t before = size_bytes_;
+    auto& blocks = index_[path];
+    auto existing = blocks.find(block);
+    if(existing != blocks.end()){
+        size_bytes_ -= existing->second->data->size();
+        lru_.erase(existing->second);
+        blocks.erase(existing);
+    }
+    size_bytes_ += data.size();
+    lru_.push_front(Entry{path, block, std::make_shared<const std::string>(std::move(data))});
+    blocks[block] = lru_.begin();
+    evict_locked_();
+    charge_locked_(before);
+}
+void factdb::BlockCache::charge_locked_(uint64_t before){
+    if(memory_){
+        memory_->charge(MemorySubsystem::BLOCK_CACHE, static_cast<int64_t>(size_bytes_) - static_cast<int64_t>(before));
+    }
+}
+void factdb::BlockCache::evict_locked_(){
+    while(size_bytes_ > capacity_bytes_ && !lru_.empty()){
+        Entry& victim = lru_.back();
+        auto file = index_.find(victim.path);
+        file->second.erase(victim.block);
+        if(file->second.empty()){
+            index_.erase(file);
+        }
+        size_bytes_ -= victim.data->size();
+        evictions_++;
+        lru_.pop_back();
+    }
+}
+void factdb::BlockCache::populate(const std::string& path, const char* data, size_t length){
+    invalidate(path);
+    for(uint64_t block = 0; block * block_size_ < length; block++){
+        size_t offset = block * block_size_;
+        put(path, block, std::string(data + offset, std::min(block_size_, length - offset)));
+    }
+}
+void factdb::BlockCache::invalidate(const std::string& path){
+    std::lock_guard<std::mutex> guard(mutex_);
+    auto file = index_.find(path);
+    if(file == index_.end()){
+        return;
+    }
+    uint64_t before = size_bytes_;
+    for(auto& [block, entry] : file->second){
+        size_bytes_ -= entry->data->size();
+        lru_.erase(entry);
+    }
+    index_.erase(file);
+    charge_locked_(before);
+}
+bool factdb::BlockCache::read_file(IoEngine& io_engine, const std::string& path, std::string& out){
+    return read_range(io_engine, path, 0, SIZE_MAX, out);
+}
+bool factdb::BlockCache::read_range(IoEngine& io_engine, const std::string& path, uint64_t offset, size_t length, std::string& out){
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if(fd < 0){
+        return false;
+    }
+    struct stat st;
+    if(fstat(fd, &st) != 0 || offset > static_cast<uint64_t>(st.st_size)){
+        ::close(fd);
+        return false;
+    }
+    uint64_t file_size = st.st_size;
+    if(length == SIZE_MAX){
+        length = file_size - offset;
+    }else if(offset + length > file_size){
+        ::close(fd);
+        return false;
+    }
+    out.assign(length, '\0');
+    if(length == 0){
+        ::close(fd);
+        return true;
+    }
+    // whole blocks are fetched so every miss can be inserted for later readers
+    uint64_t first = offset / block_size_;
+    uint64_t last = (offset + length - 1) / block_size_;
+    std::vector<std::pair<uint64_t, std::future<ssize_t>>> misses;
+    std::vector<std::string> buffers(last - first + 1);
+    auto copy_out = [&](uint64_t block, const std::string& data){
+        uint64_t block_start = block * block_size_;
+        uint64_t from = std::max(offset, block_start);
+        uint64_t to = std::min<uint64_t>(offset + length, block_start + data.size());
+        std::copy(data.begin() + (from - block_start), data.begin() + (to - block_start), out.begin() + (from - offset));
+    };
+    for(uint64_t block = first; block <= last; block++){
+        uint64_t block_start = block * block_size_;
+        size_t chunk = std::min<uint64_t>(block_size_, file_size - block_start);
+        auto cached = get(path, block);
+        if(cached && cached->size() == chunk){
+            copy_out(block, *cached);
+        }else{
+            std::string& buffer = buffers[block - first];
+            buffer.assign(chunk, '\0');
+            misses.emplace_back(block, io_engine.read(fd, buffer.data(), chunk, block_start));
+        }
+    }
+    bool ok = true;
+    for(auto& [block, result] : misses){
+        uint64_t block_start = block * block_size_;
+        std::string& buffer = buffers[block - first];
+        size_t chunk = buffer.size();
+        ssize_t n = result.get();
+        if(n >= 0 && static_cast<size_t>(n) < chunk){
+            ssize_t rest = io_engine.read_fully(fd, buffer.data() + n, chunk - n, block_start + n);
+            n = rest < 0 ? rest : n + rest;
+        }
+        if(n != static_cast<ssize_t>(chunk)){
+            ok = false;
+            continue;
+        }
+        copy_out(block, buffer);
+        put(path, block, std::move(buffer));
+    }
+    ::close(fd);
+    return ok;
+}
+factdb::BlockCacheStats factdb::BlockCache::stats() const{
+    std::lock_guard<std::mutex> guard(mutex_);
+    BlockCacheStats stats;
+    stats.hits = hits_;
+    stats.misses = misses_;
+    stats.evictions = evictions_;
+    stats.size_bytes = size_bytes_;
+    stats.capacity_bytes = capacity_bytes_;
+    return stats;
+}
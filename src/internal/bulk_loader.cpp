@@ -0,0 +1,928 @@
+#include <data/bulk_loader.hpp>
+#include <data/manifest.hpp>
+#include <data/shard_map.hpp>
+#include <data/schema_registry.hpp>
+#include <internal/encoding.hpp>
+#include <internal/keycompare.hpp>
+#include <internal/losertree.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <unordered_map>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+// Run file: sorted records back to back, each
+//   u32 length of the rest, u16 shard, u32 + partition key, u32 + clustering
+//   key, u64 sequence, u16 cell count, per cell u16 column id and u32 + value
+// in (shard, partition key, clustering key, sequence) order. The sequence is
+// the row's input file and offset, so of two lines with one key the later
+// one sorts after the earlier.
+
+namespace {
+constexpr size_t READ_BLOCK = 1 << 20;
+constexpr size_t SPARSE_INTERVAL = 256;   // records between run index entries
+constexpr size_t ROW_OVERHEAD = 128;      // rough bytes of a built Row beyond its text
+constexpr int SEQUENCE_OFFSET_BITS = 40;  // of a sequence; the input's index is above them
+constexpr uint64_t MIN_WORKER_BYTES = 64 * 1024;
+
+template <typename T>
+T read_int(const char*& at){
+    T value;
+    std::memcpy(&value, at, sizeof(T));
+    at += sizeof(T);
+    return value;
+}
+std::string_view read_bytes(const char*& at){
+    uint32_t length = read_int<uint32_t>(at);
+    std::string_view bytes(at, length);
+    at += length;
+    return bytes;
+}
+
+// a record's fields, pointing into its encoding (after the length)
+struct RecordView {
+    uint16_t shard = 0;
+    std::string_view partition;
+    std::string_view clustering;
+    uint64_t sequence = 0;
+    uint16_t cell_count = 0;
+    const char* cells = nullptr;
+};
+RecordView view_record(const char* at){
+    RecordView record;
+    record.shard = read_int<uint16_t>(at);
+    record.partition = read_bytes(at);
+    record.clustering = read_bytes(at);
+    record.sequence = read_int<uint64_t>(at);
+    record.cell_count = read_int<uint16_t>(at);
+    record.cells = at;
+    return record;
+}
+int compare_records(const RecordView& a, const RecordView& b){
+    if(a.shard != b.shard){
+        return a.shard < b.shard ? -1 : 1;
+    }
+    if(int result = a.partition.compare(b.partition)){
+        return result;
+    }
+    if(int result = a.clustering.compare(b.clustering)){
+        return result;
+    }
+    return a.sequence < b.sequence ? -1 : (a.sequence > b.sequence ? 1 : 0);
+}
+
+// (shard, partition key) bound of a merge range
+struct RangeKey {
+    uint16_t shard = 0;
+    std::string partition;
+
+    bool operator<(const RangeKey& other) const {
+        return shard != other.shard ? shard < other.shard : partition < other.partition;
+    }
+    bool operator==(const RangeKey& other) const { return shard == other.shard && partition == other.partition; }
+};
+bool before(const RecordView& record, const RangeKey& bound){
+    return record.shard != bound.shard ? record.shard < bound.shard : record.partition < bound.partition;
+}
+
+struct SparseEntry {
+    RangeKey key;      // of the record at offset
+    uint64_t offset;
+};
+struct Run {
+    std::string path;
+    std::vector<SparseEntry> index;   // every SPARSE_INTERVAL-th record
+};
+
+using File = std::unique_ptr<std::FILE, int (*)(std::FILE*)>;
+File open_file(const std::string& path, const char* mode){
+    File file(std::fopen(path.c_str(), mode), &std::fclose);
+    if(!file){
+        throw std::runtime_error("Failed to open " + path + ": " + std::strerror(errno));
+    }
+    std::setvbuf(file.get(), nullptr, _IOFBF, READ_BLOCK);
+    return file;
+}
+
+// Lines starting in [begin, end) of a file, read in READ_BLOCK pieces. A
+// line starting before end is read to its newline even past end, and when
+// begin is not a line start the line holding it belongs to the chunk before.
+class LineReader {
+public:
+    LineReader(int fd, uint64_t begin, uint64_t end, uint64_t size, bool at_line_start)
+        : fd_(fd), end_(end), size_(size), buffer_offset_(at_line_start ? begin : begin - 1){
+        if(!at_line_start){
+            skip_line_();
+        }
+    }
+    // false past the chunk; `line` stays valid until the next call
+    bool next(std::string_view& line, uint64_t& offset){
+        while(true){
+            offset = buffer_offset_ + position_;
+            if(offset >= end_ || offset >= size_){
+                return false;
+            }
+            size_t newline = find_newline_();
+            line = std::string_view(buffer_.data() + position_, newline - position_);
+            position_ = std::min(newline + 1, buffer_.size());
+            if(!line.empty() && line.back() == '\r'){
+                line.remove_suffix(1);
+            }
+            if(!line.empty()){
+                return true;
+            }
+        }
+    }
+    // file offset just past the last line returned
+    uint64_t position() const { return buffer_offset_ + position_; }
+
+private:
+    int fd_;
+    uint64_t end_;
+    uint64_t size_;
+    std::string buffer_;
+    uint64_t buffer_offset_;   // file offset of buffer_[0]
+    size_t position_ = 0;
+
+    // the index of the newline ending the line at position_, or the buffer's end at end of file
+    size_t find_newline_(){
+        size_t from = position_;
+        while(true){
+            const char* found = static_cast<const char*>(std::memchr(buffer_.data() + from, '\n', buffer_.size() - from));
+            if(found){
+                return found - buffer_.data();
+            }
+            size_t scanned = buffer_.size() - position_;
+            if(!fill_()){
+                return buffer_.size();
+            }
+            from = position_ + scanned;
+        }
+    }
+    void skip_line_(){
+        size_t newline = find_newline_();   // before reading the size it may grow
+        position_ = std::min(newline + 1, buffer_.size());
+    }
+    // drops the consumed bytes and appends the next block; false at end of file
+    bool fill_(){
+        buffer_.erase(0, position_);
+        buffer_offset_ += position_;
+        position_ = 0;
+        uint64_t offset = buffer_offset_ + buffer_.size();
+        if(offset >= size_){
+            return false;
+        }
+        size_t length = static_cast<size_t>(std::min<uint64_t>(READ_BLOCK, size_ - offset));
+        size_t old_size = buffer_.size();
+        buffer_.resize(old_size + length);
+        ssize_t n;
+        do{
+            n = ::pread(fd_, buffer_.data() + old_size, length, static_cast<off_t>(offset));
+        }while(n < 0 && errno == EINTR);
+        if(n < 0){
+            throw std::runtime_error(std::string("Failed to read bulk load input: ") + std::strerror(errno));
+        }
+        buffer_.resize(old_size + n);
+        return n > 0;
+    }
+};
+
+// Splits a CSV line into `fields`; quoted fields may hold commas and "" for
+// a quote. `quoted` marks the fields that were quoted. False on an
+// unterminated quote.
+bool split_csv(std::string_view line, std::vector<std::string>& fields, std::vector<bool>& quoted){
+    fields.clear();
+    quoted.clear();
+    size_t i = 0;
+    while(true){
+        std::string& field = fields.emplace_back();
+        if(i < line.size() && line[i] == '"'){
+            quoted.push_back(true);
+            i++;
+            while(true){
+                size_t quote = line.find('"', i);
+                if(quote == std::string_view::npos){
+                    return false;
+                }
+                field.append(line.data() + i, quote - i);
+                i = quote + 1;
+                if(i < line.size() && line[i] == '"'){
+                    field.push_back('"');
+                    i++;
+                    continue;
+                }
+                break;
+            }
+            if(i < line.size() && line[i] != ','){
+                return false;
+            }
+        }else{
+            quoted.push_back(false);
+            size_t comma = std::min(line.find(',', i), line.size());
+            field.assign(line.data() + i, comma - i);
+            i = comma;
+        }
+        if(i >= line.size()){
+            return true;
+        }
+        i++; // the comma
+    }
+}
+
+void append_utf8(std::string& out, uint32_t code_point){
+    if(code_point < 0x80){
+        out.push_back(static_cast<char>(code_point));
+    }else if(code_point < 0x800){
+        out.push_back(static_cast<char>(0xC0 | (code_point >> 6)));
+        out.push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+    }else if(code_point < 0x10000){
+        out.push_back(static_cast<char>(0xE0 | (code_point >> 12)));
+        out.push_back(static_cast<char>(0x80 | ((code_point >> 6) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+    }else{
+        out.push_back(static_cast<char>(0xF0 | (code_point >> 18)));
+        out.push_back(static_cast<char>(0x80 | ((code_point >> 12) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | ((code_point >> 6) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+    }
+}
+
+// Flat JSON objects: string values are unescaped, numbers and booleans
+// kept as written and nulls dropped; nested values are rejected.
+class JsonObjectParser {
+public:
+    bool parse(std::string_view line, std::vector<std::pair<std::string, std::string>>& fields){
+        text_ = line;
+        at_ = 0;
+        fields.clear();
+        if(!consume_('{')){
+            return false;
+        }
+        if(consume_('}')){
+            return end_();
+        }
+        while(true){
+            auto& [name, value] = fields.emplace_back();
+            if(!string_(name) || !consume_(':')){
+                return false;
+            }
+            skip_space_();
+            if(at_ < text_.size() && text_[at_] == '"'){
+                if(!string_(value)){
+                    return false;
+                }
+            }else{
+                size_t start = at_;
+                while(at_ < text_.size() && text_[at_] != ',' && text_[at_] != '}' && !is_space_(text_[at_])){
+                    at_++;
+                }
+                std::string_view token = text_.substr(start, at_ - start);
+                if(token.empty() || token[0] == '{' || token[0] == '['){
+                    return false;
+                }
+                if(token == "null"){
+                    fields.pop_back();
+                }else{
+                    value.assign(token);
+                }
+            }
+            if(consume_('}')){
+                return end_();
+            }
+            if(!consume_(',')){
+                return false;
+            }
+        }
+    }
+
+private:
+    std::string_view text_;
+    size_t at_ = 0;
+
+    static bool is_space_(char c) { return c == ' ' || c == '\t' || c == '\r' || c == '\n'; }
+    void skip_space_(){
+        while(at_ < text_.size() && is_space_(text_[at_])){
+            at_++;
+        }
+    }
+    bool consume_(char c){
+        skip_space_();
+        if(at_ < text_.size() && text_[at_] == c){
+            at_++;
+            return true;
+        }
+        return false;
+    }
+    bool end_(){
+        skip_space_();
+        return at_ == text_.size();
+    }
+    bool hex4_(uint32_t& value){
+        if(at_ + 4 > text_.size()){
+            return false;
+        }
+        value = 0;
+        for(int i = 0; i < 4; i++){
+            char c = text_[at_++];
+            value <<= 4;
+            if(c >= '0' && c <= '9') value |= c - '0';
+            else if(c >= 'a' && c <= 'f') value |= c - 'a' + 10;
+            else if(c >= 'A' && c <= 'F') value |= c - 'A' + 10;
+            else return false;
+        }
+        return true;
+    }
+    bool string_(std::string& out){
+        out.clear();
+        if(!consume_('"')){
+            return false;
+        }
+        while(at_ < text_.size()){
+            char c = text_[at_++];
+            if(c == '"'){
+                return true;
+            }
+            if(c != '\\'){
+                out.push_back(c);
+                continue;
+            }
+            if(at_ >= text_.size()){
+                return false;
+            }
+            char escaped = text_[at_++];
+            switch(escaped){
+                case '"': case '\\': case '/': out.push_back(escaped); break;
+                case 'b': out.push_back('\b'); break;
+                case 'f': out.push_back('\f'); break;
+                case 'n': out.push_back('\n'); break;
+                case 'r': out.push_back('\r'); break;
+                case 't': out.push_back('\t'); break;
+                case 'u': {
+                    uint32_t code_point;
+                    if(!hex4_(code_point)){
+                        return false;
+                    }
+                    uint32_t low;
+                    if(code_point >= 0xD800 && code_point < 0xDC00 && text_.substr(at_, 2) == "\\u"){
+                        at_ += 2;
+                        if(!hex4_(low) || low < 0xDC00 || low >= 0xE000){
+                            return false;
+                        }
+                        code_point = 0x10000 + ((code_point - 0xD800) << 10) + (low - 0xDC00);
+                    }
+                    append_utf8(out, code_point);
+                    break;
+                }
+                default:
+                    return false;
+            }
+        }
+        return false;
+    }
+};
+
+struct Input {
+    std::string path;
+    uint64_t size = 0;
+    uint64_t data_start = 0;              // past the CSV header
+    std::vector<factdb::ColumnId> ids;    // of the CSV columns; unused for key columns
+    int partition_field = -1;
+    int clustering_field = -1;
+};
+struct Chunk {
+    size_t input;
+    uint64_t begin;
+    uint64_t end;
+};
+
+// One parsed line before it is encoded into a worker's arena.
+struct ParsedRow {
+    std::string partition;
+    std::string clustering;
+    bool has_partition = false;
+    bool has_clustering = false;
+    std::vector<std::pair<factdb::ColumnId, std::string_view>> cells;
+};
+
+// Sorts records into memory_bytes-bounded runs and spills them.
+class RunBuilder {
+public:
+    RunBuilder(std::string directory, size_t worker, uint64_t memory_bytes)
+        : directory_(std::move(directory)), worker_(worker), memory_bytes_(memory_bytes) {}
+
+    void add(uint16_t shard, const ParsedRow& row, uint64_t sequence){
+        if(row.cells.size() > UINT16_MAX){
+            throw std::runtime_error("Too many columns in one bulk load row");
+        }
+        size_t start = arena_.size();
+        factdb::append_int<uint32_t>(arena_, 0);
+        factdb::append_int<uint16_t>(arena_, shard);
+        factdb::append_bytes(arena_, row.partition);
+        factdb::append_bytes(arena_, row.clustering);
+        factdb::append_int<uint64_t>(arena_, sequence);
+        factdb::append_int<uint16_t>(arena_, static_cast<uint16_t>(row.cells.size()));
+        for(const auto& [id, value] : row.cells){
+            factdb::append_int<uint16_t>(arena_, id);
+            factdb::append_bytes(arena_, value.data(), value.size());
+        }
+        uint32_t length = static_cast<uint32_t>(arena_.size() - start - sizeof(uint32_t));
+        std::memcpy(arena_.data() + start, &length, sizeof(length));
+        refs_.push_back(Ref{start, shard, factdb::normalized_key_prefix(row.partition.data(), row.partition.size())});
+        if(arena_.size() + refs_.size() * sizeof(Ref) >= memory_bytes_){
+            spill();
+        }
+    }
+    void spill(){
+        if(refs_.empty()){
+            return;
+        }
+        std::sort(refs_.begin(), refs_.end(), [this](const Ref& a, const Ref& b){
+            if(a.shard != b.shard) return a.shard < b.shard;
+            if(a.prefix != b.prefix) return a.prefix < b.prefix;
+            return compare_records(view_(a), view_(b)) < 0;
+        });
+        Run run;
+        run.path = directory_ + "/run-" + std::to_string(worker_) + "-" + std::to_string(runs_.size());
+        File file = open_file(run.path, "wb");
+        uint64_t offset = 0;
+        for(size_t i = 0; i < refs_.size(); i++){
+            const char* record = arena_.data() + refs_[i].offset;
+            uint32_t length;
+            std::memcpy(&length, record, sizeof(length));
+            if(i % SPARSE_INTERVAL == 0){
+                RecordView view = view_record(record + sizeof(length));
+                run.index.push_back(SparseEntry{RangeKey{view.shard, std::string(view.partition)}, offset});
+            }
+            if(std::fwrite(record, 1, sizeof(length) + length, file.get()) != sizeof(length) + length){
+                throw std::runtime_error("Failed to write bulk load run " + run.path);
+            }
+            offset += sizeof(length) + length;
+        }
+        if(std::fflush(file.get()) != 0){
+            throw std::runtime_error("Failed to write bulk load run " + run.path);
+        }
+        runs_.push_back(std::move(run));
+        arena_.clear();
+        refs_.clear();
+    }
+    std::vector<Run>& runs() { return runs_; }
+
+private:
+    struct Ref {
+        size_t offset;
+        uint16_t shard;
+        uint64_t prefix;   // of the partition key
+    };
+
+    std::string directory_;
+    size_t worker_;
+    uint64_t memory_bytes_;
+    std::string arena_;
+    std::vector<Ref> refs_;
+    std::vector<Run> runs_;
+
+    RecordView view_(const Ref& ref) const { return view_record(arena_.data() + ref.offset + sizeof(uint32_t)); }
+};
+
+// The records of one run with (shard, partition) in [lower, upper); a null bound is open.
+class RunCursor {
+public:
+    RunCursor(const Run& run, const RangeKey* lower, const RangeKey* upper)
+        : path_(run.path), file_(open_file(run.path, "rb")), upper_(upper){
+        if(lower){
+            auto it = std::lower_bound(run.index.begin(), run.index.end(), *lower,
+                [](const SparseEntry& entry, const RangeKey& key){ return entry.key < key; });
+            if(it != run.index.begin()){
+                std::fseek(file_.get(), static_cast<long>(std::prev(it)->offset), SEEK_SET);
+            }
+        }
+        advance();
+        while(!exhausted_ && lower && before(record_, *lower)){
+            advance();
+        }
+    }
+
+    bool exhausted() const { return exhausted_; }
+    const RecordView& record() const { return record_; }
+    void advance(){
+        uint32_t length;
+        size_t read = std::fread(&length, 1, sizeof(length), file_.get());
+        if(read == 0){
+            exhausted_ = true;
+            return;
+        }
+        bytes_.resize(length);
+        if(read != sizeof(length) || std::fread(bytes_.data(), 1, length, file_.get()) != length){
+            throw std::runtime_error("Truncated bulk load run " + path_);
+        }
+        record_ = view_record(bytes_.data());
+        if(upper_ && !before(record_, *upper_)){
+            exhausted_ = true;
+        }
+    }
+
+private:
+    std::string path_;
+    File file_;
+    const RangeKey* upper_;
+    std::string bytes_;
+    RecordView record_;
+    bool exhausted_ = false;
+};
+struct RunCursorLess {
+    bool operator()(const RunCursor& a, const RunCursor& b) const { return compare_records(a.record(), b.record()) < 0; }
+};
+
+// One table the loader writes into.
+struct Target {
+    std::unique_ptr<factdb::Manifest> manifest;
+    std::unique_ptr<factdb::SchemaRegistry> schema;
+    factdb::SSTableWriteOptions write_options;
+    std::mutex mutex;                    // guards generations
+    std::vector<uint64_t> generations;   // written by this load
+};
+
+void remove_sstable(const std::string& data_path){
+    for(auto component : factdb::SSTABLE_COMPONENTS){
+        std::error_code ignored;
+        std::filesystem::remove(factdb::sstable_component_path(data_path, component), ignored);
+    }
+}
+
+// Builds the partitions of one merge range and writes them as SSTables.
+class RangeWriter {
+public:
+    RangeWriter(std::vector<std::unique_ptr<Target>>& targets, const factdb::ColumnDictionary& columns, uint64_t sstable_bytes,
+                std::vector<std::string>& written, std::mutex& written_mutex)
+        : targets_(targets), columns_(columns), sstable_bytes_(sstable_bytes), written_(written), written_mutex_(written_mutex) {}
+
+    // rows arrive in key order; cells in column id order
+    void add(uint16_t shard, const std::string& partition, const std::string& clustering,
+             const std::vector<std::pair<factdb::ColumnId, std::string>>& cells){
+        bool new_partition = partitions_.empty() || shard != shard_ || partition != current_partition_;
+        if(new_partition){
+            if(!partitions_.empty() && (shard != shard_ || bytes_ >= sstable_bytes_)){
+                write();
+            }
+            shard_ = shard;
+            current_partition_ = partition;
+            auto next = std::make_shared<factdb::Partition>();
+            next->header_.key_.assign(partition.begin(), partition.end());
+            next->header_.key_length_ = static_cast<uint16_t>(partition.size());
+            partitions_.push_back(next);
+            bytes_ += ROW_OVERHEAD + partition.size();
+        }
+        auto row = std::make_shared<factdb::Row>();
+        auto block = std::make_shared<factdb::ClusteringBlock>();
+        factdb::CellValue key;
+        key.key_.assign(clustering.begin(), clustering.end());
+        block->clustering_cells_.emplace_back(key);
+        row->clustering_blocks_.push_back(block);
+        bytes_ += ROW_OVERHEAD + clustering.size();
+        for(const auto& [id, value] : cells){
+            const std::string& name = columns_.name(id);
+            factdb::CellValue cell;
+            cell.key_.assign(name.begin(), name.end());
+            cell.value_.assign(value.begin(), value.end());
+            row->cells_.emplace_back(cell);
+            bytes_ += name.size() + value.size();
+        }
+        partitions_.back()->unfiltereds_.push_back(row);
+    }
+    void write(){
+        if(partitions_.empty()){
+            return;
+        }
+        Target& target = *targets_[shard_];
+        uint64_t generation = target.manifest->allocate_generation();
+        std::string path = target.manifest->data_path(generation);
+        {
+            std::lock_guard<std::mutex> guard(written_mutex_);
+            written_.push_back(path); // removed again if the load fails, even half written
+        }
+        if(!factdb::SSTable(path, partitions_).write_to_file(target.write_options)){
+            throw std::runtime_error("Failed to write bulk loaded SSTable " + path);
+        }
+        {
+            std::lock_guard<std::mutex> guard(target.mutex);
+            target.generations.push_back(generation);
+        }
+        partitions_.clear();
+        bytes_ = 0;
+    }
+
+private:
+    std::vector<std::unique_ptr<Target>>& targets_;
+    const factdb::ColumnDictionary& columns_;
+    uint64_t sstable_bytes_;
+    std::vector<std::string>& written_;
+    std::mutex& written_mutex_;
+    std::vector<std::shared_ptr<factdb::Partition>> partitions_;
+    uint16_t shard_ = 0;
+    std::string current_partition_;
+    uint64_t bytes_ = 0;
+};
+
+// runs fn(i) for i in [0, count) on their own threads and rethrows the first failure
+void run_parallel(size_t count, const std::function<void(size_t)>& fn){
+    std::vector<std::exception_ptr> errors(count);
+    std::vector<std::thread> workers;
+    for(size_t i = 0; i < count; i++){
+        workers.emplace_back([&, i]{
+            try{
+                fn(i);
+            }catch(...){
+                errors[i] = std::current_exception();
+            }
+        });
+    }
+    for(auto& worker : workers){
+        worker.join();
+    }
+    for(const auto& error : errors){
+        if(error){
+            std::rethrow_exception(error);
+        }
+    }
+}
+}
+
+factdb::BulkLoader::BulkLoader(BulkLoadOptions options) : options_(std::move(options)){
+    if(options_.partition_column.empty() || options_.clustering_column.empty()){
+        throw std::invalid_argument("A bulk load needs its partition and clustering columns");
+    }
+    if(options_.shards > UINT16_MAX){
+        throw std::invalid_argument("Too many shards to bulk load into");
+    }
+    if(options_.threads == 0){
+        options_.threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    options_.chunk_bytes = std::max<uint64_t>(options_.chunk_bytes, 1);
+}
+
+factdb::BulkLoadResult factdb::BulkLoader::load(const std::vector<std::string>& inputs) const{
+    BulkLoadResult result;
+    const size_t threads = options_.threads;
+    const size_t shards = std::max<size_t>(options_.shards, 1);
+    const uint64_t worker_memory = std::max(options_.memory_bytes / threads, MIN_WORKER_BYTES);
+    std::string temp_dir = options_.data_dir + "/bulk-load.tmp";
+
+    if(options_.shards){
+        check_shard_count(options_.data_dir, options_.shards);
+    }
+    std::vector<std::unique_ptr<Target>> targets;
+    for(size_t s = 0; s < shards; s++){
+        std::string dir = options_.shards ? shard_dir(options_.data_dir, s) : options_.data_dir;
+        auto target = std::make_unique<Target>();
+        target->manifest = std::make_unique<Manifest>(dir);
+        target->manifest->load();
+        target->schema = std::make_unique<SchemaRegistry>(dir + "/SCHEMA");
+        target->schema->load();
+        target->write_options = options_.write_options;
+        target->write_options.schema = target->schema.get();
+        targets.push_back(std::move(target));
+    }
+    std::filesystem::remove_all(temp_dir);
+    std::filesystem::create_directories(temp_dir);
+
+    std::vector<std::string> written;
+    std::mutex written_mutex;
+    try{
+        // column ids of the runs; each target's registry learns the names before its SSTables are written
+        SchemaRegistry columns;
+        std::vector<Input> files;
+        std::vector<Chunk> chunks;
+        for(const auto& path : inputs){
+            Input input;
+            input.path = path;
+            input.size = std::filesystem::file_size(path);
+            if(options_.format == BulkLoadFormat::CSV){
+                int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+                if(fd < 0){
+                    throw std::runtime_error("Failed to open " + path + ": " + std::strerror(errno));
+                }
+                LineReader reader(fd, 0, 1, input.size, true);
+                std::string_view header;
+                uint64_t offset;
+                bool found = reader.next(header, offset);
+                std::vector<std::string> names;
+                std::vector<bool> quoted;
+                bool parsed = found && split_csv(header, names, quoted);
+                ::close(fd);
+                if(!parsed){
+                    throw std::runtime_error(path + " has no CSV header");
+                }
+                input.data_start = reader.position();
+                for(size_t f = 0; f < names.size(); f++){
+                    if(names[f] == options_.partition_column){
+                        input.partition_field = static_cast<int>(f);
+                    }else if(names[f] == options_.clustering_column){
+                        input.clustering_field = static_cast<int>(f);
+                    }
+                    input.ids.push_back(f == static_cast<size_t>(input.partition_field) || f == static_cast<size_t>(input.clustering_field)
+                                            ? 0 : columns.intern(names[f]));
+                }
+                if(input.partition_field < 0 || input.clustering_field < 0){
+                    throw std::runtime_error(path + " lacks the partition or clustering column");
+                }
+            }
+            for(uint64_t begin = input.data_start; begin < input.size; begin += options_.chunk_bytes){
+                chunks.push_back(Chunk{files.size(), begin, std::min(input.size, begin + options_.chunk_bytes)});
+            }
+            result.input_bytes += input.size;
+            files.push_back(std::move(input));
+        }
+
+        // parse chunks into sorted runs
+        std::atomic<size_t> next_chunk(0);
+        std::vector<std::vector<Run>> worker_runs(threads);
+        run_parallel(threads, [&](size_t worker){
+            RunBuilder builder(temp_dir, worker, worker_memory);
+            std::unordered_map<std::string, ColumnId> ids; // NDJSON names seen by this worker
+            std::vector<std::string> fields;
+            std::vector<bool> quoted;
+            std::vector<std::pair<std::string, std::string>> json_fields;
+            JsonObjectParser json;
+            ParsedRow row;
+            for(size_t c = next_chunk++; c < chunks.size(); c = next_chunk++){
+                const Chunk& chunk = chunks[c];
+                const Input& input = files[chunk.input];
+                int fd = ::open(input.path.c_str(), O_RDONLY | O_CLOEXEC);
+                if(fd < 0){
+                    throw std::runtime_error("Failed to open " + input.path + ": " + std::strerror(errno));
+                }
+                std::unique_ptr<int, void (*)(int*)> closer(&fd, [](int* f){ ::close(*f); });
+                LineReader reader(fd, chunk.begin, chunk.end, input.size, chunk.begin == input.data_start);
+                std::string_view line;
+                uint64_t offset;
+                while(reader.next(line, offset)){
+                    auto malformed = [&](const char* what){
+                        return std::runtime_error(input.path + " at offset " + std::to_string(offset) + ": " + what);
+                    };
+                    row.has_partition = false;
+                    row.has_clustering = false;
+                    row.cells.clear();
+                    if(options_.format == BulkLoadFormat::CSV){
+                        if(!split_csv(line, fields, quoted)){
+                            throw malformed("unterminated quote");
+                        }
+                        if(fields.size() != input.ids.size()){
+                            throw malformed("wrong number of fields");
+                        }
+                        for(size_t f = 0; f < fields.size(); f++){
+                            if(static_cast<int>(f) == input.partition_field){
+                                row.partition = fields[f];
+                                row.has_partition = true;
+                            }else if(static_cast<int>(f) == input.clustering_field){
+                                row.clustering = fields[f];
+                                row.has_clustering = true;
+                            }else if(!fields[f].empty() || quoted[f]){
+                                row.cells.emplace_back(input.ids[f], fields[f]);
+                            }
+                        }
+                    }else{
+                        if(!json.parse(line, json_fields)){
+                            throw malformed("not a flat JSON object");
+                        }
+                        for(const auto& [name, value] : json_fields){
+                            if(name == options_.partition_column){
+                                row.partition = value;
+                                row.has_partition = true;
+                            }else if(name == options_.clustering_column){
+                                row.clustering = value;
+                                row.has_clustering = true;
+                            }else{
+                                auto it = ids.find(name);
+                                if(it == ids.end()){
+                                    it = ids.emplace(name, columns.intern(name)).first;
+                                }
+                                row.cells.emplace_back(it->second, value);
+                            }
+                        }
+                    }
+                    if(!row.has_partition || !row.has_clustering){
+                        throw malformed("missing the partition or clustering column");
+                    }
+                    if(row.partition.size() > MAX_KEY_LENGTH || row.clustering.size() > MAX_KEY_LENGTH){
+                        throw malformed("a key longer than MAX_KEY_LENGTH");
+                    }
+                    uint16_t shard = options_.shards ? static_cast<uint16_t>(shard_of_key(row.partition, options_.shards)) : 0;
+                    builder.add(shard, row, (static_cast<uint64_t>(chunk.input) << SEQUENCE_OFFSET_BITS) | offset);
+                }
+            }
+            builder.spill();
+            worker_runs[worker] = std::move(builder.runs());
+        });
+        std::vector<Run> runs;
+        for(auto& produced : worker_runs){
+            std::move(produced.begin(), produced.end(), std::back_inserter(runs));
+        }
+        result.runs = runs.size();
+
+        // the schema goes to disk before the SSTables naming its columns, as Table::flush does
+        ColumnDictionary dictionary = columns.snapshot();
+        for(auto& target : targets){
+            for(ColumnId id = 0; id < dictionary.size(); id++){
+                target->schema->intern(dictionary.name(id));
+            }
+            if(!target->schema->save()){
+                throw std::runtime_error("Failed to save the schema " + target->schema->get_file_path());
+            }
+        }
+
+        // merge key ranges split at run index quantiles, one per worker
+        std::vector<RangeKey> samples;
+        for(const auto& run : runs){
+            for(const auto& entry : run.index){
+                samples.push_back(entry.key);
+            }
+        }
+        std::sort(samples.begin(), samples.end());
+        samples.erase(std::unique(samples.begin(), samples.end()), samples.end());
+        std::vector<RangeKey> splits;
+        for(size_t i = 1; i < threads && !samples.empty(); i++){
+            const RangeKey& candidate = samples[i * samples.size() / threads];
+            if((splits.empty() || splits.back() < candidate) && samples.front() < candidate){
+                splits.push_back(candidate);
+            }
+        }
+        uint64_t sstable_bytes = std::min(options_.sstable_bytes, std::max(options_.memory_bytes / (splits.size() + 1), MIN_WORKER_BYTES));
+        std::atomic<uint64_t> merged_rows(0);
+        run_parallel(splits.size() + 1, [&](size_t range){
+            const RangeKey* lower = range == 0 ? nullptr : &splits[range - 1];
+            const RangeKey* upper = range == splits.size() ? nullptr : &splits[range];
+            std::vector<std::unique_ptr<RunCursor>> cursors;
+            std::vector<RunCursor*> sources;
+            for(const auto& run : runs){
+                cursors.push_back(std::make_unique<RunCursor>(run, lower, upper));
+                sources.push_back(cursors.back().get());
+            }
+            LoserTree<RunCursor, RunCursorLess> tree(sources, RunCursorLess());
+            RangeWriter writer(targets, dictionary, sstable_bytes, written, written_mutex);
+            std::string partition;
+            std::string clustering;
+            std::vector<std::pair<ColumnId, std::string>> cells;
+            uint64_t count = 0;
+            while(!tree.empty()){
+                const RecordView& head = tree.top().record();
+                uint16_t shard = head.shard;
+                partition.assign(head.partition);
+                clustering.assign(head.clustering);
+                cells.clear();
+                // lines with this key, oldest first, each overriding the columns it sets
+                do{
+                    const RecordView& record = tree.top().record();
+                    const char* at = record.cells;
+                    for(uint16_t c = 0; c < record.cell_count; c++){
+                        ColumnId id = read_int<uint16_t>(at);
+                        std::string_view value = read_bytes(at);
+                        auto it = std::find_if(cells.begin(), cells.end(), [id](const auto& cell){ return cell.first == id; });
+                        if(it == cells.end()){
+                            cells.emplace_back(id, std::string(value));
+                        }else{
+                            it->second.assign(value);
+                        }
+                    }
+                    tree.pop();
+                }while(!tree.empty() && tree.top().record().shard == shard && tree.top().record().partition == partition &&
+                       tree.top().record().clustering == clustering);
+                std::sort(cells.begin(), cells.end(), [](const auto& a, const auto& b){ return a.first < b.first; });
+                writer.add(shard, partition, clustering, cells);
+                count++;
+            }
+            writer.write();
+            merged_rows += count;
+        });
+        result.rows = merged_rows;
+
+        for(auto& target : targets){
+            std::sort(target->generations.begin(), target->generations.end());
+            if(!target->generations.empty() && !target->manifest->replace_tables({}, target->generations)){
+                throw std::runtime_error("Failed to record bulk loaded SSTables in " + target->manifest->get_file_path());
+            }
+        }
+    }catch(...){
+        for(const auto& path : written){
+            remove_sstable(path);
+        }
+        std::error_code ignored;
+        std::filesystem::remove_all(temp_dir, ignored);
+        throw;
+    }
+    std::filesystem::remove_all(temp_dir);
+    result.sstables = std::move(written);
+    std::sort(result.sstables.begin(), result.sstables.end());
+    return result;
+}
@@ -0,0 +1,53 @@
+#include <net/client.hpp>
+
+#include <boost/asio/buffer.hpp>
+#include <boost/asio/connect.hpp>
+#include <boost/asio/write.hpp>
+
+#include <cstring>
+
+factdb::Client::Client(const std::string& host, uint16_t port)
+    : socket_(io_), buffer_(64 * 1024){
+    boost::asio::ip::tcp::resolver resolver(io_);
+    boost::asio::connect(socket_, resolver.resolve(host, std::to_string(port)));
+    socket_.set_option(boost::asio::ip::tcp::no_delay(true));
+}
+uint16_t factdb::Client::send(Request request){
+    return send_all({std::move(request)}).front();
+}
+std::vector<uint16_t> factdb::Client::send_all(std::vector<Request> requests){
+    std::vector<uint16_t> streams;
+    std::vector<std::string> frames;
+    std::vector<boost::asio::const_buffer> buffers;
+    frames.reserve(requests.size());
+    for(auto& request : requests){
+        request.stream = next_stream_++;
+        streams.push_back(request.stream);
+        frames.push_back(encode_request(request));
+        buffers.emplace_back(boost::asio::buffer(frames.back()));
+    }
+    boost::asio::write(socket_, buffers);
+    return streams;
+}
+factdb::Response factdb::Client::receive(){
+    while(true){
+        if(size_t frame = protocol_frame_size(buffer_.data(), buffered_)){
+            Response response = decode_response(buffer_.data(), frame);
+            std::memmove(buffer_.data(), buffer_.data() + frame, buffered_ - frame);
+            buffered_ -= frame;
+            return response;
+        }
+        if(buffered_ >= PROTOCOL_HEADER_SIZE){
+            uint32_t body;
+            std::memcpy(&body, buffer_.data(), sizeof(body));
+            if(PROTOCOL_HEADER_SIZE + body > buffer_.size()){
+                buffer_.resize(PROTOCOL_HEADER_SIZE + body);
+            }
+        }
+        buffered_ += socket_.read_some(boost::asio::buffer(buffer_.data() + buffered_, buffer_.size() - buffered_));
+    }
+}
+factdb::Response factdb::Client::call(Request request){
+    send(std::move(request));
+    return receive();
+}
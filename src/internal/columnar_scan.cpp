@@ -0,0 +1,613 @@
+#include <data/columnar_scan.hpp>
+
+#include <internal/encoding.hpp>
+
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <type_traits>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#define FACTDB_SCAN_AVX2 1
+#endif
+
+namespace {
+constexpr size_t MASK_WORDS = factdb::SCAN_BLOCK_ROWS / 64;
+using BlockMask = uint64_t[MASK_WORDS];
+
+// Walks the rows of one encoded section in key order. The partition key is
+// a view into the section; the clustering key, rebuilt from its shared
+// prefix, is valid until the next advance(). A row's cells are left encoded
+// for find_cells().
+class SectionCursor {
+public:
+    explicit SectionCursor(std::string_view section) : in_(section.data(), section.size()) {
+        if(in_.read_int<uint32_t>() != factdb::SSTABLE_MAGIC){
+            throw std::runtime_error("Not an SSTable section");
+        }
+        columns_ = factdb::ColumnDictionary::deserialize(in_);
+        partitions_left_ = in_.read_int<uint32_t>();
+        advance();
+    }
+    const factdb::ColumnDictionary& columns() const { return columns_; }
+    bool done() const { return done_; }
+    void advance(){
+        while(rows_left_ == 0){
+            if(partitions_left_ == 0){
+                done_ = true;
+                return;
+            }
+            partitions_left_--;
+            if(restarts_left_ > 0){ // the previous partition's restart table
+                in_.skip(restarts_left_ * sizeof(uint32_t));
+            }
+            partition_key = raw_(in_.read_int<uint16_t>());
+            rows_left_ = in_.read_int<uint32_t>();
+            in_.read_int<uint32_t>(); // rows length
+            restarts_left_ = (rows_left_ + factdb::KEY_RESTART_INTERVAL - 1) / factdb::KEY_RESTART_INTERVAL;
+            key_.clear();
+        }
+        rows_left_--;
+        uint8_t flags = in_.read_int<uint8_t>();
+        deleted = (flags & static_cast<uint8_t>(factdb::RowFlags::HAS_DELETION)) != 0;
+        uint16_t clustering_count = in_.read_int<uint16_t>();
+        if(clustering_count == 0){
+            key_.clear();
+        }else{
+            uint16_t shared = in_.read_int<uint16_t>();
+            if(shared > key_.size()){
+                throw std::runtime_error("Clustering key shares more than the previous key holds");
+            }
+            key_.resize(shared);
+            key_.append(bytes_()); // as row_clustering_key() picks it
+            bytes_();
+            for(uint16_t c = 1; c < clustering_count; c++){
+                bytes_();
+                bytes_();
+            }
+        }
+        clustering_key = key_;
+        cells = in_.position();
+        uint16_t bitmap_length = in_.read_int<uint16_t>();
+        std::string_view bitmap = raw_(bitmap_length);
+        size_t present = 0;
+        factdb::for_each_column(bitmap.data(), bitmap.size(), [&](factdb::ColumnId id){
+            if(id >= columns_.size()){
+                throw std::runtime_error("Cell refers to a column past the section's dictionary");
+            }
+            bytes_();
+            present++;
+        });
+        if(flags & static_cast<uint8_t>(factdb::RowFlags::HAS_TIMESTAMP)){ // write sequences, which scans do not use
+            in_.skip((present + 1) * sizeof(uint64_t));
+        }
+    }
+
+    std::string_view partition_key;
+    std::string_view clustering_key;
+    const char* cells = nullptr;    // at the row's column bitmap
+    bool deleted = false;
+    // by column id of this section, the column's place among the
+    // predicate or projected columns, or -1
+    std::vector<int32_t> predicate_slots;
+    std::vector<int32_t> projection_slots;
+
+private:
+    factdb::ByteReader in_;
+    factdb::ColumnDictionary columns_;
+    uint32_t partitions_left_ = 0;
+    uint32_t rows_left_ = 0;
+    size_t restarts_left_ = 0;
+    bool done_ = false;
+    std::string key_;
+
+    std::string_view raw_(size_t length){
+        const char* start = in_.position();
+        in_.skip(length);
+        return std::string_view(start, length);
+    }
+    std::string_view bytes_(){
+        return raw_(in_.read_int<uint32_t>());
+    }
+};
+
+uint32_t load_u32(const char* at){
+    uint32_t value;
+    std::memcpy(&value, at, sizeof(value));
+    return value;
+}
+std::vector<int32_t> column_slots(const factdb::ColumnDictionary& columns, const std::vector<std::string>& wanted){
+    std::vector<int32_t> slots(columns.size(), -1);
+    for(size_t i = 0; i < wanted.size(); i++){
+        if(auto id = columns.find(wanted[i]); id && slots[*id] < 0){
+            slots[*id] = static_cast<int32_t>(i);
+        }
+    }
+    return slots;
+}
+// Fills the still empty views of `out` with the values a row's encoded
+// columns, which SectionCursor has already bounds checked, hold for the
+// wanted columns; slots maps the section's column ids to places in `out`.
+// Returns how many it filled.
+size_t find_cells(const char* cells, const std::vector<int32_t>& slots, size_t wanted, std::string_view* out){
+    uint16_t bitmap_length;
+    std::memcpy(&bitmap_length, cells, sizeof(bitmap_length));
+    const unsigned char* bitmap = reinterpret_cast<const unsigned char*>(cells + sizeof(bitmap_length));
+    const char* at = cells + sizeof(bitmap_length) + bitmap_length;
+    size_t filled = 0;
+    for(size_t b = 0; b < bitmap_length; b++){
+        for(unsigned bits = bitmap[b]; bits != 0; bits &= bits - 1){
+            int32_t slot = slots[b * 8 + __builtin_ctz(bits)];
+            uint32_t value_length = load_u32(at);
+            if(slot >= 0 && out[slot].data() == nullptr){
+                out[slot] = std::string_view(at + 4, value_length);
+                if(++filled == wanted){
+                    return filled;
+                }
+            }
+            at += 4 + value_length;
+        }
+    }
+    return filled;
+}
+
+struct BlockRow {
+    std::string_view partition_key;
+    uint32_t key_offset;        // of the clustering key in the block's key arena
+    uint32_t key_length;
+    uint32_t first_version;     // into the block's version list, newest first
+    uint32_t version_count;
+};
+
+struct Version {
+    const char* cells;
+    const SectionCursor* section;
+};
+using SlotList = std::vector<int32_t> SectionCursor::*;
+
+// the newest value of each of `wanted` columns over a row's live versions
+void gather(const BlockRow& row, const std::vector<Version>& versions, SlotList slots, size_t wanted, std::string_view* out){
+    for(size_t i = 0; i < wanted; i++){
+        out[i] = std::string_view();
+    }
+    size_t found = 0;
+    for(uint32_t v = 0; v < row.version_count && found < wanted; v++){
+        const Version& version = versions[row.first_version + v];
+        found += find_cells(version.cells, version.section->*slots, wanted - found, out);
+    }
+}
+
+void set_bit(uint64_t* mask, size_t row){
+    mask[row / 64] |= uint64_t(1) << (row % 64);
+}
+
+// Comparison kernels: set the bit of each of the n values that passes `op`
+// against a (and b for RANGE) in `out`, which starts zeroed.
+template <typename T>
+bool passes(factdb::PredicateOp op, T value, T a, T b){
+    switch(op){
+        case factdb::PredicateOp::EQ: return value == a;
+        case factdb::PredicateOp::LT: return value < a;
+        case factdb::PredicateOp::GT: return value > a;
+        case factdb::PredicateOp::RANGE: return a <= value && value <= b;
+        default: return false;
+    }
+}
+template <typename T>
+void compare_scalar(const T* values, size_t from, size_t n, factdb::PredicateOp op, T a, T b, uint64_t* out){
+    for(size_t i = from; i < n; i++){
+        out[i / 64] |= uint64_t(passes(op, values[i], a, b)) << (i % 64);
+    }
+}
+
+#ifdef FACTDB_SCAN_AVX2
+// four lanes per step; returns the first value left for compare_scalar
+template <factdb::PredicateOp OP>
+__attribute__((target("avx2"))) size_t compare_i64_avx2(const int64_t* values, size_t n, int64_t a, int64_t b, uint64_t* out){
+    const __m256i low = _mm256_set1_epi64x(a);
+    const __m256i high = _mm256_set1_epi64x(b);
+    size_t i = 0;
+    for(; i + 4 <= n; i += 4){
+        __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(values + i));
+        __m256i hit;
+        if constexpr(OP == factdb::PredicateOp::EQ){
+            hit = _mm256_cmpeq_epi64(x, low);
+        }else if constexpr(OP == factdb::PredicateOp::LT){
+            hit = _mm256_cmpgt_epi64(low, x);
+        }else if constexpr(OP == factdb::PredicateOp::GT){
+            hit = _mm256_cmpgt_epi64(x, low);
+        }else{ // RANGE: neither below low nor above high
+            hit = _mm256_andnot_si256(_mm256_or_si256(_mm256_cmpgt_epi64(low, x), _mm256_cmpgt_epi64(x, high)), _mm256_set1_epi64x(-1));
+        }
+        uint64_t bits = static_cast<uint32_t>(_mm256_movemask_pd(_mm256_castsi256_pd(hit)));
+        out[i / 64] |= bits << (i % 64);
+    }
+    return i;
+}
+template <factdb::PredicateOp OP>
+__attribute__((target("avx2"))) size_t compare_f64_avx2(const double* values, size_t n, double a, double b, uint64_t* out){
+    const __m256d low = _mm256_set1_pd(a);
+    const __m256d high = _mm256_set1_pd(b);
+    size_t i = 0;
+    for(; i + 4 <= n; i += 4){
+        __m256d x = _mm256_loadu_pd(values + i);
+        __m256d hit;
+        if constexpr(OP == factdb::PredicateOp::EQ){
+            hit = _mm256_cmp_pd(x, low, _CMP_EQ_OQ);
+        }else if constexpr(OP == factdb::PredicateOp::LT){
+            hit = _mm256_cmp_pd(x, low, _CMP_LT_OQ);
+        }else if constexpr(OP == factdb::PredicateOp::GT){
+            hit = _mm256_cmp_pd(x, low, _CMP_GT_OQ);
+        }else{
+            hit = _mm256_and_pd(_mm256_cmp_pd(x, low, _CMP_GE_OQ), _mm256_cmp_pd(x, high, _CMP_LE_OQ));
+        }
+        uint64_t bits = static_cast<uint32_t>(_mm256_movemask_pd(hit));
+        out[i / 64] |= bits << (i % 64);
+    }
+    return i;
+}
+bool have_avx2(){
+    static const bool supported = __builtin_cpu_supports("avx2");
+    return supported;
+}
+#endif
+
+void compare(const int64_t* values, size_t n, factdb::PredicateOp op, int64_t a, int64_t b, uint64_t* out){
+    size_t done = 0;
+#ifdef FACTDB_SCAN_AVX2
+    if(have_avx2()){
+        switch(op){
+            case factdb::PredicateOp::EQ: done = compare_i64_avx2<factdb::PredicateOp::EQ>(values, n, a, b, out); break;
+            case factdb::PredicateOp::LT: done = compare_i64_avx2<factdb::PredicateOp::LT>(values, n, a, b, out); break;
+            case factdb::PredicateOp::GT: done = compare_i64_avx2<factdb::PredicateOp::GT>(values, n, a, b, out); break;
+            case factdb::PredicateOp::RANGE: done = compare_i64_avx2<factdb::PredicateOp::RANGE>(values, n, a, b, out); break;
+            default: break;
+        }
+    }
+#endif
+    compare_scalar(values, done, n, op, a, b, out);
+}
+void compare(const double* values, size_t n, factdb::PredicateOp op, double a, double b, uint64_t* out){
+    size_t done = 0;
+#ifdef FACTDB_SCAN_AVX2
+    if(have_avx2()){
+        switch(op){
+            case factdb::PredicateOp::EQ: done = compare_f64_avx2<factdb::PredicateOp::EQ>(values, n, a, b, out); break;
+            case factdb::PredicateOp::LT: done = compare_f64_avx2<factdb::PredicateOp::LT>(values, n, a, b, out); break;
+            case factdb::PredicateOp::GT: done = compare_f64_avx2<factdb::PredicateOp::GT>(values, n, a, b, out); break;
+            case factdb::PredicateOp::RANGE: done = compare_f64_avx2<factdb::PredicateOp::RANGE>(values, n, a, b, out); break;
+            default: break;
+        }
+    }
+#endif
+    compare_scalar(values, done, n, op, a, b, out);
+}
+
+template <typename T>
+bool parse(std::string_view text, T& value){
+    auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), value);
+    return error == std::errc() && end == text.data() + text.size();
+}
+
+// Checks a predicate's type and operand count and parses its operands as
+// `T`; throws std::invalid_argument when they do not fit.
+template <typename T>
+std::vector<T> parse_operands(const factdb::ScanPredicate& predicate){
+    size_t expected = predicate.op == factdb::PredicateOp::RANGE ? 2 : 1;
+    if(predicate.op == factdb::PredicateOp::IN ? predicate.operands.empty() : predicate.operands.size() != expected){
+        throw std::invalid_argument("Wrong number of operands for the predicate on " + predicate.column);
+    }
+    if(predicate.type != factdb::ColumnType::INT && predicate.type != factdb::ColumnType::FLOAT && predicate.type != factdb::ColumnType::STRING){
+        throw std::invalid_argument("Predicates take INT, FLOAT or STRING columns, not " + predicate.column);
+    }
+    std::vector<T> operands;
+    if constexpr(!std::is_same_v<T, std::string>){
+        for(const auto& operand : predicate.operands){
+            operands.emplace_back();
+            if(!parse(operand, operands.back())){
+                throw std::invalid_argument("Operand " + operand + " does not parse as the type of " + predicate.column);
+            }
+        }
+    }else{
+        operands = predicate.operands;
+    }
+    return operands;
+}
+
+// A predicate with its operands parsed once, plus the scratch vectors a
+// block of its column is decoded into.
+class CompiledPredicate {
+public:
+    explicit CompiledPredicate(const factdb::ScanPredicate& predicate) : predicate_(predicate) {
+        if(predicate.type == factdb::ColumnType::INT){
+            ints_ = parse_operands<int64_t>(predicate);
+            int_values_.resize(factdb::SCAN_BLOCK_ROWS);
+        }else if(predicate.type == factdb::ColumnType::FLOAT){
+            floats_ = parse_operands<double>(predicate);
+            float_values_.resize(factdb::SCAN_BLOCK_ROWS);
+        }else{
+            parse_operands<std::string>(predicate);
+        }
+    }
+
+    // ANDs the rows of the block whose `cells` pass into `mask`
+    void evaluate(const std::string_view* cells, size_t n, uint64_t* mask){
+        BlockMask valid = {};
+        BlockMask hits = {};
+        switch(predicate_.type){
+            case factdb::ColumnType::INT: decode_(cells, n, int_values_.data(), valid); match_(int_values_.data(), n, ints_, hits); break;
+            case factdb::ColumnType::FLOAT: decode_(cells, n, float_values_.data(), valid); match_(float_values_.data(), n, floats_, hits); break;
+            default: match_strings_(cells, n, hits); break;
+        }
+        if(predicate_.type == factdb::ColumnType::STRING){
+            for(size_t w = 0; w < MASK_WORDS; w++){
+                mask[w] &= hits[w];
+            }
+        }else{
+            for(size_t w = 0; w < MASK_WORDS; w++){
+                mask[w] &= hits[w] & valid[w];
+            }
+        }
+    }
+
+private:
+    const factdb::ScanPredicate& predicate_;
+    std::vector<int64_t> ints_;
+    std::vector<double> floats_;
+    std::vector<int64_t> int_values_;
+    std::vector<double> float_values_;
+
+    // missing and unparsable values decode to 0 and are left out of `valid`
+    template <typename T>
+    static void decode_(const std::string_view* cells, size_t n, T* values, uint64_t* valid){
+        for(size_t i = 0; i < n; i++){
+            if(cells[i].data() != nullptr && parse(cells[i], values[i])){
+                set_bit(valid, i);
+            }else{
+                values[i] = 0;
+            }
+        }
+    }
+    template <typename T>
+    void match_(const T* values, size_t n, const std::vector<T>& operands, uint64_t* hits) const {
+        if(predicate_.op != factdb::PredicateOp::IN){
+            compare(values, n, predicate_.op, operands[0], operands.size() > 1 ? operands[1] : operands[0], hits);
+            return;
+        }
+        for(T operand : operands){
+            compare(values, n, factdb::PredicateOp::EQ, operand, operand, hits);
+        }
+    }
+    void match_strings_(const std::string_view* cells, size_t n, uint64_t* hits) const {
+        const auto& operands = predicate_.operands;
+        for(size_t i = 0; i < n; i++){
+            if(cells[i].data() == nullptr){
+                continue;
+            }
+            bool hit = false;
+            if(predicate_.op == factdb::PredicateOp::IN){
+                for(const auto& operand : operands){
+                    if(cells[i] == operand){
+                        hit = true;
+                        break;
+                    }
+                }
+            }else{
+                hit = passes<std::string_view>(predicate_.op, cells[i], operands[0], operands.size() > 1 ? operands[1] : operands[0]);
+            }
+            hits[i / 64] |= uint64_t(hit) << (i % 64);
+        }
+    }
+};
+
+class BlockScanner {
+public:
+    BlockScanner(const factdb::ColumnScan& scan, const factdb::ScanVisitor& visitor) : scan_(scan), visitor_(visitor) {
+        for(const auto& predicate : scan.predicates){
+            predicates_.emplace_back(predicate);
+            predicate_columns_.push_back(predicate.column);
+        }
+        rows_.reserve(factdb::SCAN_BLOCK_ROWS);
+        predicate_cells_.resize(factdb::SCAN_BLOCK_ROWS * predicate_columns_.size());
+        row_cells_.resize(predicate_columns_.size());
+        projected_.resize(scan.projection.size());
+    }
+
+    std::vector<Version> versions;  // cells of the block's row versions
+    const std::vector<std::string>& predicate_columns() const { return predicate_columns_; }
+
+    bool full() const { return rows_.size() == factdb::SCAN_BLOCK_ROWS; }
+    void add(std::string_view partition_key, std::string_view clustering_key, uint32_t first_version){
+        rows_.push_back(BlockRow{partition_key, static_cast<uint32_t>(keys_.size()), static_cast<uint32_t>(clustering_key.size()),
+                                 first_version, static_cast<uint32_t>(versions.size()) - first_version});
+        keys_.append(clustering_key); // the cursor's view changes when it advances
+    }
+    // evaluates and visits the block, then empties it
+    void flush(){
+        size_t n = rows_.size();
+        if(n == 0){
+            return;
+        }
+        BlockMask mask = {};
+        for(size_t i = 0; i < n; i++){
+            set_bit(mask, i);
+        }
+        size_t columns = predicate_columns_.size();
+        if(columns > 0){
+            for(size_t i = 0; i < n; i++){ // one walk over each row's cells for every predicate column
+                gather(rows_[i], versions, &SectionCursor::predicate_slots, columns, row_cells_.data());
+                for(size_t p = 0; p < columns; p++){
+                    predicate_cells_[p * factdb::SCAN_BLOCK_ROWS + i] = row_cells_[p];
+                }
+            }
+            for(size_t p = 0; p < columns; p++){
+                predicates_[p].evaluate(predicate_cells_.data() + p * factdb::SCAN_BLOCK_ROWS, n, mask);
+            }
+        }
+        for(size_t w = 0; w < MASK_WORDS; w++){
+            for(uint64_t bits = mask[w]; bits != 0; bits &= bits - 1){
+                const BlockRow& row = rows_[w * 64 + __builtin_ctzll(bits)];
+                gather(row, versions, &SectionCursor::projection_slots, scan_.projection.size(), projected_.data());
+                visitor_(factdb::ScanRow{row.partition_key, std::string_view(keys_.data() + row.key_offset, row.key_length), projected_.data()});
+                visited_++;
+            }
+        }
+        rows_.clear();
+        versions.clear();
+        keys_.clear();
+    }
+    size_t visited() const { return visited_; }
+
+private:
+    const factdb::ColumnScan& scan_;
+    const factdb::ScanVisitor& visitor_;
+    std::vector<CompiledPredicate> predicates_;
+    std::vector<std::string> predicate_columns_;
+    std::vector<BlockRow> rows_;
+    std::string keys_;
+    std::vector<std::string_view> predicate_cells_;    // [predicate][row]
+    std::vector<std::string_view> row_cells_;
+    std::vector<std::string_view> projected_;
+    size_t visited_ = 0;
+};
+
+// what [low, high] bounding `count` values (out of `rows`) proves about `predicate`
+template <typename T>
+factdb::BlockMatch match_bounds(const factdb::ScanPredicate& predicate, const std::vector<T>& operands, uint64_t count, uint64_t rows, T low, T high){
+    if(count == 0){
+        return factdb::BlockMatch::NONE;
+    }
+    bool some = false;
+    bool all = false;
+    const T& a = operands[0];
+    switch(predicate.op){
+        case factdb::PredicateOp::EQ: some = low <= a && a <= high; all = low == a && high == a; break;
+        case factdb::PredicateOp::LT: some = low < a; all = high < a; break;
+        case factdb::PredicateOp::GT: some = high > a; all = low > a; break;
+        case factdb::PredicateOp::RANGE: some = a <= high && operands[1] >= low && a <= operands[1]; all = a <= low && high <= operands[1]; break;
+        case factdb::PredicateOp::IN:
+            for(const auto& operand : operands){
+                some = some || (low <= operand && operand <= high);
+                all = all || (low == operand && high == operand);
+            }
+            break;
+    }
+    if(!some){
+        return factdb::BlockMatch::NONE;
+    }
+    return all && count == rows ? factdb::BlockMatch::ALL : factdb::BlockMatch::SOME;
+}
+factdb::BlockMatch match_predicate(const factdb::BlockStatistics& block, const factdb::ScanPredicate& predicate,
+                                   const std::vector<int64_t>& ints, const std::vector<double>& floats){
+    auto found = block.columns_.find(predicate.column);
+    if(found == block.columns_.end()){
+        return factdb::BlockMatch::NONE; // null in every row
+    }
+    const factdb::ColumnStatistics& column = found->second;
+    switch(predicate.type){
+        case factdb::ColumnType::INT:
+            return match_bounds(predicate, ints, column.ints_, block.rows_, column.int_min_, column.int_max_);
+        case factdb::ColumnType::FLOAT:
+            return match_bounds(predicate, floats, column.floats_, block.rows_, column.float_min_, column.float_max_);
+        default:
+            if(!column.has_string_bounds()){
+                return column.values_ > 0 ? factdb::BlockMatch::SOME : factdb::BlockMatch::NONE;
+            }
+            return match_bounds(predicate, predicate.operands, column.values_, block.rows_, column.string_min_, column.string_max_);
+    }
+}
+
+int compare_keys(const SectionCursor& a, const SectionCursor& b){
+    int result = a.partition_key.compare(b.partition_key);
+    return result != 0 ? result : a.clustering_key.compare(b.clustering_key);
+}
+}
+
+factdb::BlockPruner::BlockPruner(const ColumnScan& scan) : scan_(scan){
+    operands_.reserve(scan.predicates.size());
+    for(const auto& predicate : scan.predicates){
+        Operands& operands = operands_.emplace_back();
+        if(predicate.type == ColumnType::INT){
+            operands.ints = parse_operands<int64_t>(predicate);
+        }else if(predicate.type == ColumnType::FLOAT){
+            operands.floats = parse_operands<double>(predicate);
+        }else{
+            parse_operands<std::string>(predicate);
+        }
+    }
+}
+factdb::BlockMatch factdb::BlockPruner::match(const BlockStatistics& block) const{
+    if(block.rows_ == 0){
+        return BlockMatch::NONE;
+    }
+    std::string_view min_key(block.min_clustering_.data(), block.min_clustering_.size());
+    std::string_view max_key(block.max_clustering_.data(), block.max_clustering_.size());
+    if(max_key < scan_.start || (!scan_.end.empty() && min_key >= scan_.end)){
+        return BlockMatch::NONE;
+    }
+    BlockMatch result = min_key >= scan_.start && (scan_.end.empty() || max_key < scan_.end) ? BlockMatch::ALL : BlockMatch::SOME;
+    for(size_t p = 0; p < scan_.predicates.size(); p++){
+        BlockMatch match = match_predicate(block, scan_.predicates[p], operands_[p].ints, operands_[p].floats);
+        if(match == BlockMatch::NONE){
+            return BlockMatch::NONE;
+        }
+        if(match == BlockMatch::SOME){
+            result = BlockMatch::SOME;
+        }
+    }
+    return result;
+}
+factdb::BlockMatch factdb::match_block(const BlockStatistics& block, const ColumnScan& scan){
+    return BlockPruner(scan).match(block);
+}
+size_t factdb::scan_sections(const std::vector<std::string_view>& sections, const ColumnScan& scan, const ScanVisitor& visitor){
+    BlockScanner block(scan, visitor);
+    std::vector<SectionCursor> cursors;
+    cursors.reserve(sections.size());
+    for(const auto& section : sections){
+        SectionCursor& cursor = cursors.emplace_back(section);
+        cursor.predicate_slots = column_slots(cursor.columns(), block.predicate_columns());
+        cursor.projection_slots = column_slots(cursor.columns(), scan.projection);
+    }
+    std::vector<size_t> newest; // cursors on the smallest key, newest source first
+    while(true){
+        newest.clear();
+        for(size_t c = 0; c < cursors.size(); c++){
+            if(cursors[c].done()){
+                continue;
+            }
+            int order = newest.empty() ? -1 : compare_keys(cursors[c], cursors[newest[0]]);
+            if(order < 0){
+                newest.clear();
+            }
+            if(order <= 0){
+                newest.push_back(c);
+            }
+        }
+        if(newest.empty()){
+            break;
+        }
+        const SectionCursor& first = cursors[newest[0]];
+        bool in_range = first.clustering_key >= scan.start && (scan.end.empty() || first.clustering_key < scan.end);
+        if(!first.deleted && in_range){
+            auto first_version = static_cast<uint32_t>(block.versions.size());
+            for(size_t c : newest){
+                if(cursors[c].deleted){ // hides every older version
+                    break;
+                }
+                block.versions.push_back(Version{cursors[c].cells, &cursors[c]});
+            }
+            block.add(first.partition_key, first.clustering_key, first_version);
+        }
+        if(block.full()){
+            block.flush();
+        }
+        for(size_t c : newest){
+            cursors[c].advance();
+        }
+    }
+    block.flush();
+    return block.visited();
+}
@@ -0,0 +1,145 @@
+#include <data/commitlog.hpp>
+#include <internal/encoding.hpp>
+
+#include <boost/crc.hpp>
+
+#include <chrono>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+uint32_t crc32(const char* data, size_t length){
+    boost::crc_32_type crc;
+    crc.process_bytes(data, length);
+    return crc.checksum();
+}
+}
+
+factdb::CommitLog::CommitLog(const std::string& path, IoEngine& io_engine, CommitLogOptions options)
+    : file_path_(path), io_engine_(io_engine), options_(options), fd_(-1), offset_(0){
+    fd_ = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if(fd_ < 0){
+        throw std::runtime_error("Failed to open commit log " + path);
+    }
+    struct stat st;
+    if(fstat(fd_, &st) == 0){
+        offset_ = st.st_size;
+    }
+    if(options_.sync == CommitLogSync::PERIODIC){
+        syncer_ = std::thread([this](){ syncer_loop_(); });
+    }
+}
+factdb::CommitLog::~CommitLog(){
+    if(syncer_.joinable()){
+        {
+            std::lock_guard<std::mutex> guard(syncer_mutex_);
+            stopping_ = true;
+        }
+        syncer_cv_.notify_one();
+        syncer_.join();
+    }
+    sync();
+    ::close(fd_);
+}
+void factdb::CommitLog::syncer_loop_(){
+    std::unique_lock<std::mutex> lock(syncer_mutex_);
+    while(!stopping_){
+        if(!syncer_cv_.wait_for(lock, options_.sync_period, [this](){ return stopping_; })){
+            lock.unlock();
+            sync();
+            lock.lock();
+        }
+    }
+}
+void factdb::CommitLog::reap_completed_(){
+    while(!pending_.empty() &&
+          pending_.front().result.wait_for(std::chrono::seconds(0)) == std::future_status::ready){
+        pending_.pop_front();
+    }
+}
+factdb::CommitLog::Append factdb::CommitLog::append(const std::string& payload){
+    if(failed_){
+        throw std::runtime_error("Commit log " + file_path_ + " failed a write or sync");
+    }
+    auto buffer = std::make_shared<std::string>();
+    buffer->reserve(payload.size() + 2 * sizeof(uint32_t));
+    append_int<uint32_t>(*buffer, static_cast<uint32_t>(payload.size()));
+    append_int<uint32_t>(*buffer, crc32(payload.data(), payload.size()));
+    buffer->append(payload);
+
+    uint64_t offset = offset_.fetch_add(buffer->size());
+    std::shared_future<ssize_t> result = io_engine_.write(fd_, buffer->data(), buffer->size(), offset).share();
+    std::lock_guard<std::mutex> guard(pending_mutex_);
+    reap_completed_();
+    pending_.push_back(PendingAppend{buffer, result});
+    return Append{result, buffer->size()};
+}
+bool factdb::CommitLog::wait(const Append& append){
+    if(append.written.get() != static_cast<ssize_t>(append.size)){
+        failed_ = true;
+        return false;
+    }
+    if(options_.sync != CommitLogSync::GROUP){
+        return !failed_;
+    }
+    std::unique_lock<std::mutex> lock(sync_mutex_);
+    uint64_t ticket = ++sync_tickets_;
+    while(synced_tickets_ < ticket && !failed_){
+        if(syncing_){
+            synced_.wait(lock);
+            continue;
+        }
+        syncing_ = true;
+        uint64_t covered = sync_tickets_;
+        lock.unlock();
+        bool ok = io_engine_.fsync(fd_, true).get() == 0;
+        lock.lock();
+        syncing_ = false;
+        if(ok){
+            synced_tickets_ = covered;
+        }else{
+            failed_ = true;
+        }
+        synced_.notify_all();
+    }
+    return !failed_;
+}
+bool factdb::CommitLog::sync(){
+    std::deque<PendingAppend> waiting;
+    {
+        std::lock_guard<std::mutex> guard(pending_mutex_);
+        waiting.swap(pending_);
+    }
+    bool ok = true;
+    for(auto& append : waiting){
+        ok = append.result.get() == static_cast<ssize_t>(append.buffer->size()) && ok;
+    }
+    ok = io_engine_.fsync(fd_, true).get() == 0 && ok;
+    if(!ok){
+        failed_ = true;
+    }
+    return ok;
+}
+size_t factdb::CommitLog::replay(const std::string& path, const std::function<void(const std::string&)>& apply){
+    std::string contents;
+    if(!read_file(default_io_engine(), path, contents)){
+        return 0;
+    }
+    ByteReader in(contents);
+    size_t records = 0;
+    while(in.remaining() >= 2 * sizeof(uint32_t)){
+        uint32_t length = in.read_int<uint32_t>();
+        uint32_t checksum = in.read_int<uint32_t>();
+        if(in.remaining() < length || crc32(in.position(), length) != checksum){
+            break;
+        }
+        std::string payload(in.position(), length);
+        in.skip(length);
+        apply(payload);
+        records++;
+    }
+    return records;
+}
@@ -0,0 +1,214 @@
+#include <data/compaction.hpp>
+#include <internal/losertree.hpp>
+
+#include <algorithm>
+#include <exception>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+namespace {
+size_t lower_bound_partition(const std::vector<std::shared_ptr<factdb::Partition>>& partitions, const std::vector<char>& key){
+    auto it = std::lower_bound(partitions.begin(), partitions.end(), key,
+        [](const std::shared_ptr<factdb::Partition>& partition, const std::vector<char>& bound){
+            return factdb::compare_binary_keys(partition->header_.key_, bound) < 0;
+        });
+    return it - partitions.begin();
+}
+bool same_key(const factdb::Partition& partition, const factdb::Row& row, const factdb::SSTableCursor& cursor){
+    return factdb::compare_binary_keys(partition.header_.key_, cursor.partition()->header_.key_) == 0 &&
+           factdb::compare_binary_keys(factdb::row_clustering_key(row), factdb::row_clustering_key(*cursor.row())) == 0;
+}
+}
+
+factdb::SSTableCursor::SSTableCursor(std::shared_ptr<SSTable> sstable, const std::vector<char>& lower, const std::vector<char>& upper)
+    : sstable_(std::move(sstable)), row_idx_(0), partition_prefix_(0), clustering_prefix_(0) {
+    const auto& partitions = sstable_->get_partitions();
+    partition_idx_ = lower.empty() ? 0 : lower_bound_partition(partitions, lower);
+    partition_end_ = upper.empty() ? partitions.size() : lower_bound_partition(partitions, upper);
+    while(partition_idx_ < partition_end_ && partitions[partition_idx_]->unfiltereds_.empty()){
+        partition_idx_++;
+    }
+    load_();
+}
+void factdb::SSTableCursor::advance(){
+    const auto& partitions = sstable_->get_partitions();
+    row_idx_++;
+    if(row_idx_ >= partitions[partition_idx_]->unfiltereds_.size()){
+        row_idx_ = 0;
+        do{
+            partition_idx_++;
+        }while(partition_idx_ < partition_end_ && partitions[partition_idx_]->unfiltereds_.empty());
+    }
+    load_();
+}
+void factdb::SSTableCursor::load_(){
+    if(exhausted()){
+        row_ = nullptr;
+        return;
+    }
+    const auto& partition = sstable_->get_partitions()[partition_idx_];
+    if(row_idx_ == 0){
+        partition_prefix_ = normalized_key_prefix(partition->header_.key_.data(), partition->header_.key_.size());
+    }
+    row_ = std::static_pointer_cast<Row>(partition->unfiltereds_[row_idx_]);
+    const auto& clustering_key = row_clustering_key(*row_);
+    clustering_prefix_ = normalized_key_prefix(clustering_key.data(), clustering_key.size());
+}
+
+std::vector<std::vector<char>> factdb::Compactor::split_points(const std::vector<std::shared_ptr<SSTable>>& inputs, size_t ranges){
+    std::vector<std::vector<char>> samples;
+    if(ranges <= 1){
+        return samples;
+    }
+    const size_t samples_per_input = ranges * 16;
+    for(const auto& input : inputs){
+        const auto& partitions = input->get_partitions();
+        size_t stride = std::max<size_t>(1, partitions.size() / samples_per_input);
+        for(size_t i = 0; i < partitions.size(); i += stride){
+            if(!partitions[i]->header_.key_.empty()){
+                samples.push_back(partitions[i]->header_.key_);
+            }
+        }
+    }
+    auto less = [](const std::vector<char>& a, const std::vector<char>& b){ return compare_binary_keys(a, b) < 0; };
+    std::sort(samples.begin(), samples.end(), less);
+    samples.erase(std::unique(samples.begin(), samples.end()), samples.end());
+
+    std::vector<std::vector<char>> splits;
+    for(size_t i = 1; i < ranges && !samples.empty(); i++){
+        const auto& candidate = samples[i * samples.size() / ranges];
+        if(splits.empty() || less(splits.back(), candidate)){
+            splits.push_back(candidate);
+        }
+    }
+    return splits;
+}
+
+factdb::PartitionStatistics factdb::Compactor::partition_statistics(const std::vector<std::shared_ptr<SSTable>>& inputs){
+    PartitionStatistics merged;
+    for(const auto& input : inputs){
+        auto statistics = input->statistics();
+        if(statistics && (statistics->partitions_.sizes_.count() > 0 || input->get_partitions().empty())){
+            merged.merge(statistics->partitions_);
+            continue;
+        }
+        for(const auto& partition : input->get_partitions()){
+            uint64_t size = partition->header_.key_.size();
+            for(const auto& unfiltered : partition->unfiltereds_){
+                size += row_data_size(*std::static_pointer_cast<Row>(unfiltered));
+            }
+            merged.add_partition(*partition, size);
+        }
+    }
+    return merged;
+}
+
+std::vector<std::shared_ptr<factdb::Partition>> factdb::Compactor::merge_range_(const std::vector<std::shared_ptr<SSTable>>& inputs,
+                                                                                const std::vector<char>& lower,
+                                                                                const std::vector<char>& upper,
+                                                                                uint64_t& output_rows, uint64_t& dropped_rows) const{
+    std::vector<SSTableCursor> cursors;
+    cursors.reserve(inputs.size());
+    for(const auto& input : inputs){
+        cursors.emplace_back(input, lower, upper);
+    }
+    std::vector<SSTableCursor*> sources;
+    for(auto& cursor : cursors){
+        sources.push_back(&cursor);
+    }
+    LoserTree<SSTableCursor, SSTableCursorLess> tree(sources, SSTableCursorLess());
+
+    std::vector<std::shared_ptr<Partition>> partitions;
+    while(!tree.empty()){
+        std::shared_ptr<Partition> source_partition = tree.top().partition();
+        std::shared_ptr<Row> newest = tree.top().row();
+        std::shared_ptr<Row> merged = newest;
+        tree.pop();
+        while(!tree.empty() && same_key(*source_partition, *newest, tree.top())){
+            if(!row_is_deleted(*merged)){
+                if(merged == newest){
+                    merged = std::make_shared<Row>(*newest);
+                }
+                merge_older_cells(*merged, *tree.top().row());
+            }
+            tree.pop();
+        }
+        if(options_.drop && options_.drop(*source_partition, *merged)){
+            dropped_rows++;
+            continue;
+        }
+        if(partitions.empty() || compare_binary_keys(partitions.back()->header_.key_, source_partition->header_.key_) != 0){
+            auto partition = std::make_shared<Partition>();
+            partition->header_.key_ = source_partition->header_.key_;
+            partition->header_.key_length_ = source_partition->header_.key_.size();
+            partitions.push_back(partition);
+        }
+        partitions.back()->unfiltereds_.push_back(merged);
+        output_rows++;
+    }
+    return partitions;
+}
+
+factdb::CompactionResult factdb::Compactor::compact(const std::vector<std::shared_ptr<SSTable>>& inputs) const{
+    CompactionResult result;
+    for(const auto& input : inputs){
+        result.input_rows += input->row_count();
+        result.input_bytes += input->data_size();
+    }
+    result.estimated_partitions = partition_statistics(inputs).estimated_partitions();
+    size_t ranges = 1;
+    if(options_.max_threads > 1 && options_.min_rows_per_range > 0){
+        ranges = std::clamp<size_t>(result.input_rows / options_.min_rows_per_range, 1, options_.max_threads);
+    }
+    std::vector<std::vector<char>> splits = split_points(inputs, ranges);
+    ranges = splits.size() + 1;
+    result.ranges = ranges;
+
+    std::vector<std::shared_ptr<SSTable>> outputs(ranges);
+    std::vector<uint64_t> output_rows(ranges, 0);
+    std::vector<uint64_t> dropped_rows(ranges, 0);
+    std::vector<std::exception_ptr> errors(ranges);
+    auto run_range = [&](size_t i){
+        try{
+            static const std::vector<char> unbounded;
+            const auto& lower = i == 0 ? unbounded : splits[i - 1];
+            const auto& upper = i == ranges - 1 ? unbounded : splits[i];
+            auto partitions = merge_range_(inputs, lower, upper, output_rows[i], dropped_rows[i]);
+            if(partitions.empty()){
+                return;
+            }
+            std::string path = options_.output_path ? options_.output_path(i) : "compaction-" + std::to_string(i) + ".sst";
+            outputs[i] = std::make_shared<SSTable>(path, partitions);
+            if(options_.write_outputs && !outputs[i]->write_to_file(options_.write_options)){
+                throw std::runtime_error("Failed to write compaction output " + path);
+            }
+        }catch(...){
+            errors[i] = std::current_exception();
+        }
+    };
+    if(ranges == 1){
+        run_range(0);
+    }else{
+        std::vector<std::thread> workers;
+        for(size_t i = 0; i < ranges; i++){
+            workers.emplace_back(run_range, i);
+        }
+        for(auto& worker : workers){
+            worker.join();
+        }
+    }
+    for(const auto& error : errors){
+        if(error){
+            std::rethrow_exception(error);
+        }
+    }
+    for(size_t i = 0; i < ranges; i++){
+        result.output_rows += output_rows[i];
+        result.dropped_rows += dropped_rows[i];
+        if(outputs[i]){
+            result.outputs.push_back(outputs[i]);
+        }
+    }
+    return result;
+}
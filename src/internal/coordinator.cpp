@@ -0,0 +1,229 @@
+#include <cluster/coordinator.hpp>
+#include <metrics/tracing.hpp>
+
+#include <boost/asio/steady_timer.hpp>
+
+#include <map>
+#include <stdexcept>
+
+namespace {
+factdb::Response error_response(uint16_t stream, const std::string& message){
+    factdb::Response response;
+    response.stream = stream;
+    response.status = factdb::Status::ERROR;
+    response.message = message;
+    return response;
+}
+std::string error_message(const std::exception_ptr& error){
+    try{
+        std::rethrow_exception(error);
+    }catch(const std::exception& e){
+        return e.what();
+    }catch(...){
+        return "replica request failed";
+    }
+}
+
+// A read's answer from the replicas that acked it. Without write
+// timestamps no answer can be told newer than another, so none is taken to
+// shadow the rest: a row any answer holds is returned, with the columns of
+// all of them and the first answer's value on a conflict, in cluster key
+// order and cut at the scan's limit. A row deleted on only some replicas
+// comes back from the others until repair reaches them.
+factdb::Response reconcile_reads(factdb::Opcode opcode, uint32_t limit, std::vector<factdb::Response>& answers){
+    factdb::Response result = std::move(answers.front());
+    if(answers.size() == 1){
+        return result;
+    }
+    std::map<std::string, factdb::WireRow> rows;  // by cluster key
+    for(size_t i = 0; i < answers.size(); i++){
+        for(auto& row : i == 0 ? result.rows : answers[i].rows){
+            auto [it, added] = rows.try_emplace(row.cluster_key);
+            if(added){
+                it->second = std::move(row);
+                continue;
+            }
+            for(auto& column : row.columns){
+                bool held = false;
+                for(const auto& existing : it->second.columns){
+                    held = held || existing.name == column.name;
+                }
+                if(!held){
+                    it->second.columns.push_back(std::move(column));
+                }
+            }
+        }
+    }
+    result.rows.clear();
+    for(auto& [cluster_key, row] : rows){
+        if(limit > 0 && result.rows.size() == limit){
+            break;
+        }
+        result.rows.push_back(std::move(row));
+    }
+    if(opcode == factdb::Opcode::GET){
+        result.status = result.rows.empty() ? factdb::Status::NOT_FOUND : factdb::Status::OK;
+    }
+    return result;
+}
+
+// replica responses for one coordinated request; resolves once
+struct Round {
+    uint16_t stream;
+    factdb::Opcode opcode;
+    uint32_t limit;
+    size_t replicas;
+    size_t required;
+    size_t acks = 0;
+    size_t failures = 0;
+    bool done = false;
+    std::vector<factdb::Response> answers;  // kept for reads only
+    std::string last_error;
+    factdb::Promise<factdb::Response> promise;
+    std::unique_ptr<boost::asio::steady_timer> timer;
+
+    void finish(factdb::Response response){
+        done = true;
+        timer->cancel();
+        response.stream = stream;
+        promise.set_value(std::move(response));
+    }
+};
+}
+
+factdb::ConsistencyLevel factdb::parse_consistency_level(const std::string& name){
+    if(name == "LOCAL") return ConsistencyLevel::LOCAL;
+    if(name == "ONE") return ConsistencyLevel::ONE;
+    if(name == "QUORUM") return ConsistencyLevel::QUORUM;
+    if(name == "ALL") return ConsistencyLevel::ALL;
+    throw std::invalid_argument("unknown consistency level " + name);
+}
+
+factdb::Coordinator::Coordinator(Reactor& reactor, TokenRing ring, std::string local_id, CoordinatorOptions options)
+    : reactor_(reactor), ring_(std::move(ring)), local_id_(std::move(local_id)), options_(options),
+      peers_(reactor.shard_count()){
+    if(!ring_.find_node(local_id_)){
+        throw std::invalid_argument("local node " + local_id_ + " is not in the ring");
+    }
+}
+size_t factdb::Coordinator::required_acks(ConsistencyLevel level, size_t replicas){
+    switch(level){
+        case ConsistencyLevel::LOCAL:
+        case ConsistencyLevel::ONE:
+            return std::min<size_t>(1, replicas);
+        case ConsistencyLevel::QUORUM:
+            return replicas / 2 + 1;
+        case ConsistencyLevel::ALL:
+            return replicas;
+    }
+    return replicas;
+}
+factdb::CoordinatorStats factdb::Coordinator::stats() const{
+    CoordinatorStats stats;
+    stats.requests = requests_.load();
+    stats.replica_requests = replica_requests_.load();
+    stats.unavailable = unavailable_.load();
+    stats.timeouts = timeouts_.load();
+    return stats;
+}
+std::shared_ptr<factdb::PeerConnection> factdb::Coordinator::peer_(size_t shard, const NodeEndpoint& node){
+    auto& peers = peers_[shard];
+    auto it = peers.find(node.id);
+    if(it == peers.end()){
+        it = peers.emplace(node.id, std::make_shared<PeerConnection>(reactor_.io_context(shard), node.host, node.port, options_.timeout)).first;
+    }
+    return it->second;
+}
+factdb::Future<factdb::Response> factdb::Coordinator::coordinate(const Request& request, const LocalHandler& local){
+    requests_++;
+    if(request.opcode != Opcode::BATCH){
+        return replicate_(request, local);
+    }
+    // mutations of a batch can belong to different replica sets
+    std::vector<Future<Response>> applied;
+    for(const auto& mutation : request.batch){
+        Request single = mutation;
+        single.stream = request.stream;
+        single.consistency = request.consistency;
+        single.trace = request.trace;
+        applied.push_back(replicate_(single, local));
+    }
+    uint16_t stream = request.stream;
+    return when_all(std::move(applied)).then([stream](std::vector<Response> responses){
+        for(auto& response : responses){
+            if(response.status == Status::ERROR){
+                return response;
+            }
+        }
+        Response response;
+        response.stream = stream;
+        return response;
+    });
+}
+factdb::Future<factdb::Response> factdb::Coordinator::replicate_(const Request& request, const LocalHandler& local){
+    size_t shard = Reactor::this_shard();
+    if(shard == Reactor::NO_SHARD){
+        throw std::logic_error("coordinate called outside the reactor");
+    }
+    auto replicas = ring_.replicas(request.partition_key, options_.replication_factor);
+    auto round = std::make_shared<Round>();
+    round->stream = request.stream;
+    round->opcode = request.opcode;
+    round->limit = request.limit;
+    round->replicas = replicas.size();
+    round->required = required_acks(request.consistency, replicas.size());
+    auto result = round->promise.get_future();
+    if(replicas.empty()){
+        round->done = true;
+        round->promise.set_value(error_response(request.stream, "no replicas for key"));
+        return result;
+    }
+
+    round->timer = std::make_unique<boost::asio::steady_timer>(reactor_.io_context(shard), options_.timeout);
+    round->timer->async_wait([this, round](const boost::system::error_code& error){
+        if(error || round->done){
+            return;
+        }
+        timeouts_++;
+        round->finish(error_response(round->stream, "timed out with " + std::to_string(round->acks) + " of " +
+                                                    std::to_string(round->required) + " required replicas"));
+    });
+
+    Request replica_request = request;
+    replica_request.consistency = ConsistencyLevel::LOCAL;
+    replica_request.trace = request.trace || this_thread_trace != nullptr; // replicas trace a sampled request too
+    for(const auto& replica : replicas){
+        Future<Response> response;
+        if(replica.id == local_id_){
+            auto apply = [&]{ return local(replica_request); };
+            response = futurize_invoke(apply);
+        }else{
+            replica_requests_++;
+            response = peer_(shard, replica)->send(replica_request);
+        }
+        response.on_ready([this, round, response]() mutable {
+            if(round->done){
+                return;
+            }
+            if(response.failed() || response.value().status == Status::ERROR){
+                round->failures++;
+                round->last_error = response.failed() ? error_message(response.error()) : response.value().message;
+                if(round->replicas - round->failures < round->required){
+                    unavailable_++;
+                    round->finish(error_response(round->stream, "unavailable: " + std::to_string(round->failures) + " of " +
+                                                                std::to_string(round->replicas) + " replicas failed, last: " + round->last_error));
+                }
+                return;
+            }
+            round->acks++;
+            bool read = round->opcode == Opcode::GET || round->opcode == Opcode::SCAN;
+            if(read || round->answers.empty()){
+                round->answers.push_back(std::move(response.value()));
+            }
+            if(round->acks >= round->required){
+                round->finish(read ? reconcile_reads(round->opcode, round->limit, round->answers) : std::move(round->answers.front()));
+            }
+        });
+    }
+    return result;
+}
@@ -0,0 +1,110 @@
+#include <io/direct_writer.hpp>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+factdb::DirectFileWriter::DirectFileWriter(const std::string& path, AlignedBufferPool& pool, IoEngine& io_engine,
+                                           bool direct, size_t max_in_flight)
+    : pool_(pool), io_engine_(io_engine), fd_(-1), direct_(direct), max_in_flight_(std::max<size_t>(1, max_in_flight)){
+    int flags = O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC;
+    if(direct_){
+        fd_ = ::open(path.c_str(), flags | O_DIRECT, 0644);
+        if(fd_ < 0 && errno == EINVAL){
+            direct_ = false; // the filesystem does not support O_DIRECT
+        }
+    }
+    if(fd_ < 0){
+        fd_ = ::open(path.c_str(), flags, 0644);
+    }
+}
+factdb::DirectFileWriter::~DirectFileWriter(){
+    if(!sealed_){
+        while(!in_flight_.empty()){
+            complete_oldest_(nullptr);
+        }
+    }
+    if(fd_ >= 0){
+        ::close(fd_);
+    }
+}
+bool factdb::DirectFileWriter::complete_oldest_(AlignedBuffer* reuse){
+    InFlight oldest = std::move(in_flight_.front());
+    in_flight_.pop_front();
+    ssize_t written = oldest.result.get();
+    if(written != static_cast<ssize_t>(oldest.length)){
+        failed_ = true;
+    }
+    if(reuse){
+        *reuse = std::move(oldest.buffer);
+    }
+    return !failed_;
+}
+bool factdb::DirectFileWriter::next_buffer_(){
+    // recycle our own oldest write before waiting on the pool, so a writer
+    // that holds buffers never blocks on itself
+    if(in_flight_.size() >= max_in_flight_){
+        return complete_oldest_(&current_);
+    }
+    current_ = pool_.try_acquire();
+    if(!current_ && !in_flight_.empty()){
+        return complete_oldest_(&current_);
+    }
+    if(!current_){
+        current_ = pool_.acquire();
+    }
+    return true;
+}
+void factdb::DirectFileWriter::submit_current_(size_t length){
+    std::future<ssize_t> result = io_engine_.write(fd_, current_.data(), length, file_offset_);
+    file_offset_ += length;
+    in_flight_.push_back(InFlight{std::move(current_), length, std::move(result)});
+    current_fill_ = 0;
+}
+bool factdb::DirectFileWriter::append(const char* data, size_t length){
+    if(fd_ < 0 || failed_ || sealed_){
+        return false;
+    }
+    while(length > 0){
+        if(!current_ && !next_buffer_()){
+            return false;
+        }
+        size_t chunk = std::min(length, current_.size() - current_fill_);
+        std::memcpy(current_.data() + current_fill_, data, chunk);
+        current_fill_ += chunk;
+        logical_size_ += chunk;
+        data += chunk;
+        length -= chunk;
+        if(current_fill_ == current_.size()){
+            submit_current_(current_fill_);
+        }
+    }
+    return true;
+}
+bool factdb::DirectFileWriter::seal(){
+    if(fd_ < 0 || sealed_){
+        return false;
+    }
+    sealed_ = true;
+    if(current_ && current_fill_ > 0){
+        size_t padded = (current_fill_ + DIRECT_IO_ALIGNMENT - 1) / DIRECT_IO_ALIGNMENT * DIRECT_IO_ALIGNMENT;
+        std::memset(current_.data() + current_fill_, 0, padded - current_fill_);
+        submit_current_(padded);
+    }
+    current_.release();
+    while(!in_flight_.empty()){
+        complete_oldest_(nullptr);
+    }
+    if(!failed_ && file_offset_ != logical_size_ && ::ftruncate(fd_, logical_size_) != 0){
+        failed_ = true;
+    }
+    if(!failed_ && io_engine_.fsync(fd_, true).get() != 0){
+        failed_ = true;
+    }
+    ::close(fd_);
+    fd_ = -1;
+    return !failed_;
+}
@@ -0,0 +1,250 @@
+#include <io/io_scheduler.hpp>
+
+#include <algorithm>
+#include <cerrno>
+#include <limits>
+#include <sstream>
+#include <iomanip>
+
+#include <unistd.h>
+
+namespace {
+constexpr double TOKEN_BUCKET_WINDOW_S = 0.1; // burst allowed for a rate limited class
+
+double percentile(std::vector<uint32_t>& sorted, double p){
+    if(sorted.empty()){
+        return 0;
+    }
+    size_t idx = static_cast<size_t>(p * (sorted.size() - 1));
+    return sorted[idx];
+}
+}
+
+factdb::IoScheduler::IoScheduler(IoSchedulerOptions options) : options_(options){
+    auto now = clock::now();
+    for(size_t i = 0; i < IO_PRIORITY_CLASS_COUNT; i++){
+        classes_[i].config = options_.classes[i];
+        classes_[i].refilled_at = now;
+        classes_[i].tokens = classes_[i].config.bandwidth_limit * TOKEN_BUCKET_WINDOW_S;
+    }
+    size_t workers = std::max<size_t>(1, options_.max_in_flight);
+    for(size_t i = 0; i < workers; i++){
+        workers_.emplace_back(&IoScheduler::worker_loop_, this);
+    }
+}
+factdb::IoScheduler::~IoScheduler(){
+    {
+        std::lock_guard<std::mutex> guard(mutex_);
+        stopping_ = true;
+    }
+    work_cv_.notify_all();
+    space_cv_.notify_all();
+    for(auto& worker : workers_){
+        worker.join();
+    }
+}
+const char* factdb::IoScheduler::class_name(IoPriorityClass cls){
+    switch(cls){
+        case IoPriorityClass::QUERY: return "query";
+        case IoPriorityClass::COMMITLOG: return "commitlog";
+        case IoPriorityClass::FLUSH: return "flush";
+        case IoPriorityClass::COMPACTION: return "compaction";
+    }
+    return "unknown";
+}
+double factdb::IoScheduler::cost_(size_t bytes){
+    return 1.0 + static_cast<double>(bytes) / 4096.0; // fixed per-request cost plus one unit per 4 KiB
+}
+std::future<ssize_t> factdb::IoScheduler::submit(IoPriorityClass cls, size_t bytes, std::function<ssize_t()> op){
+    std::unique_lock<std::mutex> lock(mutex_);
+    ClassState& state = classes_[static_cast<size_t>(cls)];
+    space_cv_.wait(lock, [&]{ return stopping_ || state.queue.size() < options_.max_queue_depth; });
+    if(state.queue.empty() && state.in_flight == 0){
+        // an idle class does not bank credit: it rejoins at the lowest active virtual time
+        double min_vtime = std::numeric_limits<double>::max();
+        for(const auto& other : classes_){
+            if(!other.queue.empty() || other.in_flight > 0){
+                min_vtime = std::min(min_vtime, other.vtime);
+            }
+        }
+        if(min_vtime != std::numeric_limits<double>::max()){
+            state.vtime = std::max(state.vtime, min_vtime);
+        }
+    }
+    Request request{bytes, std::move(op), std::promise<ssize_t>(), clock::now()};
+    std::future<ssize_t> result = request.result.get_future();
+    state.queue.push_back(std::move(request));
+    state.submitted++;
+    lock.unlock();
+    work_cv_.notify_one();
+    return result;
+}
+std::future<ssize_t> factdb::IoScheduler::read(IoPriorityClass cls, int fd, void* buffer, size_t length, off_t offset){
+    return submit(cls, length, [fd, buffer, length, offset]() -> ssize_t {
+        ssize_t n = ::pread(fd, buffer, length, offset);
+        return n < 0 ? -errno : n;
+    });
+}
+std::future<ssize_t> factdb::IoScheduler::write(IoPriorityClass cls, int fd, const void* buffer, size_t length, off_t offset){
+    return submit(cls, length, [fd, buffer, length, offset]() -> ssize_t {
+        ssize_t n = ::pwrite(fd, buffer, length, offset);
+        return n < 0 ? -errno : n;
+    });
+}
+void factdb::IoScheduler::set_shares(IoPriorityClass cls, uint32_t shares){
+    std::lock_guard<std::mutex> guard(mutex_);
+    classes_[static_cast<size_t>(cls)].config.shares = std::max<uint32_t>(1, shares);
+}
+void factdb::IoScheduler::set_bandwidth_limit(IoPriorityClass cls, uint64_t bytes_per_second){
+    {
+        std::lock_guard<std::mutex> guard(mutex_);
+        ClassState& state = classes_[static_cast<size_t>(cls)];
+        state.config.bandwidth_limit = bytes_per_second;
+        state.tokens = bytes_per_second * TOKEN_BUCKET_WINDOW_S;
+        state.refilled_at = clock::now();
+    }
+    work_cv_.notify_all();
+}
+void factdb::IoScheduler::refill_(ClassState& state, clock::time_point now){
+    double elapsed = std::chrono::duration<double>(now - state.refilled_at).count();
+    double capacity = state.config.bandwidth_limit * TOKEN_BUCKET_WINDOW_S;
+    state.tokens = std::min(capacity, state.tokens + elapsed * state.config.bandwidth_limit);
+    state.refilled_at = now;
+}
+int factdb::IoScheduler::pick_class_(clock::time_point now, clock::duration& wait){
+    int best = -1;
+    wait = clock::duration::max();
+    for(size_t i = 0; i < IO_PRIORITY_CLASS_COUNT; i++){
+        ClassState& state = classes_[i];
+        if(state.queue.empty()){
+            continue;
+        }
+        if(state.config.bandwidth_limit > 0){
+            refill_(state, now);
+            if(state.tokens < 0){ // in debt until the bucket refills
+                auto until_ready = std::chrono::duration<double>(-state.tokens / state.config.bandwidth_limit);
+                wait = std::min(wait, std::chrono::duration_cast<clock::duration>(until_ready) + std::chrono::microseconds(1));
+                continue;
+            }
+        }
+        if(best < 0 || state.vtime < classes_[best].vtime){
+            best = static_cast<int>(i);
+        }
+    }
+    return best;
+}
+void factdb::IoScheduler::record_latency_(ClassState& state, uint32_t latency_us){
+    state.latency_count++;
+    if(state.latencies_us.size() < LATENCY_SAMPLES){
+        state.latencies_us.push_back(latency_us);
+        return;
+    }
+    rng_state_ ^= rng_state_ << 13;
+    rng_state_ ^= rng_state_ >> 7;
+    rng_state_ ^= rng_state_ << 17;
+    uint64_t slot = rng_state_ % state.latency_count;
+    if(slot < LATENCY_SAMPLES){
+        state.latencies_us[slot] = latency_us;
+    }
+}
+void factdb::IoScheduler::worker_loop_(){
+    std::unique_lock<std::mutex> lock(mutex_);
+    while(true){
+        clock::duration wait;
+        int idx = pick_class_(clock::now(), wait);
+        if(idx < 0){
+            bool any_queued = std::any_of(classes_.begin(), classes_.end(), [](const ClassState& s){ return !s.queue.empty(); });
+            if(!any_queued){
+                if(stopping_){
+                    return;
+                }
+                work_cv_.wait(lock);
+            }else{
+                work_cv_.wait_for(lock, wait);
+            }
+            continue;
+        }
+        ClassState& state = classes_[idx];
+        Request request = std::move(state.queue.front());
+        state.queue.pop_front();
+        state.vtime += cost_(request.bytes) / std::max<uint32_t>(1, state.config.shares);
+        if(state.config.bandwidth_limit > 0){
+            state.tokens -= request.bytes;
+        }
+        state.in_flight++;
+        lock.unlock();
+        space_cv_.notify_all();
+
+        ssize_t result = 0;
+        std::exception_ptr error;
+        try{
+            result = request.op();
+        }catch(...){
+            error = std::current_exception();
+        }
+        auto latency = std::chrono::duration_cast<std::chrono::microseconds>(clock::now() - request.submitted_at).count();
+
+        // stats first, so a caller woken by the promise sees its request counted
+        lock.lock();
+        state.in_flight--;
+        state.completed++;
+        state.bytes += request.bytes;
+        record_latency_(state, static_cast<uint32_t>(std::min<int64_t>(latency, UINT32_MAX)));
+        lock.unlock();
+        if(error){
+            request.result.set_exception(error);
+        }else{
+            request.result.set_value(result);
+        }
+        lock.lock();
+    }
+}
+factdb::IoClassStats factdb::IoScheduler::stats(IoPriorityClass cls) const{
+    std::vector<uint32_t> samples;
+    IoClassStats stats;
+    {
+        std::lock_guard<std::mutex> guard(mutex_);
+        const ClassState& state = classes_[static_cast<size_t>(cls)];
+        stats.submitted = state.submitted;
+        stats.completed = state.completed;
+        stats.bytes = state.bytes;
+        stats.queued = state.queue.size();
+        stats.in_flight = state.in_flight;
+        samples = state.latencies_us;
+    }
+    std::sort(samples.begin(), samples.end());
+    stats.p50_us = percentile(samples, 0.50);
+    stats.p99_us = percentile(samples, 0.99);
+    stats.p999_us = percentile(samples, 0.999);
+    stats.max_us = samples.empty() ? 0 : samples.back();
+    return stats;
+}
+void factdb::IoScheduler::reset_stats(){
+    std::lock_guard<std::mutex> guard(mutex_);
+    for(auto& state : classes_){
+        state.submitted = state.queue.size() + state.in_flight;
+        state.completed = 0;
+        state.bytes = 0;
+        state.latencies_us.clear();
+        state.latency_count = 0;
+    }
+}
+std::string factdb::IoScheduler::latency_report() const{
+    std::ostringstream out;
+    out << std::left << std::setw(12) << "class" << std::right
+        << std::setw(10) << "completed" << std::setw(12) << "MB"
+        << std::setw(10) << "p50(us)" << std::setw(10) << "p99(us)"
+        << std::setw(11) << "p999(us)" << std::setw(10) << "max(us)" << "\n";
+    for(size_t i = 0; i < IO_PRIORITY_CLASS_COUNT; i++){
+        auto cls = static_cast<IoPriorityClass>(i);
+        IoClassStats s = stats(cls);
+        out << std::left << std::setw(12) << class_name(cls) << std::right
+            << std::setw(10) << s.completed
+            << std::setw(12) << std::fixed << std::setprecision(1) << s.bytes / (1024.0 * 1024.0)
+            << std::setw(10) << std::setprecision(0) << s.p50_us
+            << std::setw(10) << s.p99_us
+            << std::setw(11) << s.p999_us
+            << std::setw(10) << s.max_us << "\n";
+    }
+    return out.str();
+}
@@ -0,0 +1,192 @@
+#include <logger/logging.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#include <boost/lockfree/spsc_queue.hpp>
+
+// One ring per logging thread, so a producer never contends with another;
+// the writer is the single consumer of every ring.
+class factdb::Logger::ThreadRing {
+public:
+    explicit ThreadRing(size_t capacity) : queue(capacity) {}
+    boost::lockfree::spsc_queue<LogRecord> queue;
+    std::atomic<bool> closed{false};    // owning thread exited, drop once drained
+};
+
+namespace {
+int64_t now_ns(){
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+}
+
+factdb::Logger::~Logger(){
+    stop_async();
+}
+void factdb::Logger::logf(LogLevel level, const char* format, ...){
+    if(!enabled(level)){
+        return;
+    }
+    va_list args;
+    va_start(args, format);
+    if(async_.load(std::memory_order_acquire)){
+        vpush_(level, format, args);
+        va_end(args);
+        return;
+    }
+    char buffer[1024];
+    int length = std::vsnprintf(buffer, sizeof(buffer), format, args);
+    va_end(args);
+    log(level, std::string(buffer, std::min<size_t>(length < 0 ? 0 : length, sizeof(buffer) - 1)));
+}
+void factdb::Logger::start_async(AsyncLogOptions options){
+    std::lock_guard<std::mutex> guard(rings_mutex_);
+    if(writer_.joinable()){
+        return;
+    }
+    async_options_ = options;
+    stopping_ = false;
+    writer_ = std::thread([this]{ run_writer_(); });
+    async_.store(true, std::memory_order_release);
+}
+void factdb::Logger::stop_async(){
+    {
+        std::lock_guard<std::mutex> guard(rings_mutex_);
+        if(!writer_.joinable()){
+            return;
+        }
+        async_.store(false, std::memory_order_release);
+        stopping_ = true;
+    }
+    writer_wakeup_.notify_all();
+    writer_.join();
+}
+factdb::LogStats factdb::Logger::stats() const{
+    LogStats stats;
+    stats.written = written_.load(std::memory_order_relaxed);
+    stats.dropped = dropped_.load(std::memory_order_relaxed);
+    return stats;
+}
+factdb::Logger::ThreadRing& factdb::Logger::thread_ring_(){
+    struct RingOwner { // marks the ring closed when its thread exits
+        std::shared_ptr<ThreadRing> ring;
+        ~RingOwner(){
+            if(ring){
+                ring->closed.store(true, std::memory_order_release);
+            }
+        }
+    };
+    thread_local RingOwner owner;
+    if(!owner.ring){
+        owner.ring = std::make_shared<ThreadRing>(async_options_.ring_capacity);
+        std::lock_guard<std::mutex> guard(rings_mutex_);
+        rings_.push_back(owner.ring);
+    }
+    return *owner.ring;
+}
+void factdb::Logger::push_(LogLevel level, const char* data, size_t length){
+    LogRecord record;
+    record.time_ns = now_ns();
+    record.level = level;
+    record.length = static_cast<uint16_t>(std::min(length, LOG_RECORD_TEXT));
+    std::memcpy(record.text, data, record.length);
+    commit_(thread_ring_(), record);
+}
+void factdb::Logger::vpush_(LogLevel level, const char* format, va_list args){
+    LogRecord record;
+    record.time_ns = now_ns();
+    record.level = level;
+    int length = std::vsnprintf(record.text, LOG_RECORD_TEXT, format, args);
+    record.length = static_cast<uint16_t>(std::min<size_t>(length < 0 ? 0 : length, LOG_RECORD_TEXT - 1));
+    commit_(thread_ring_(), record);
+}
+bool factdb::Logger::commit_(ThreadRing& ring, const LogRecord& record){
+    if(ring.queue.push(record)){
+        return true;
+    }
+    if(async_options_.overflow == LogOverflow::DROP){
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    writer_wakeup_.notify_one();
+    while(!ring.queue.push(record)){
+        if(!async_.load(std::memory_order_acquire)){ // the writer is gone and will not make room
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        std::this_thread::yield();
+    }
+    return true;
+}
+size_t factdb::Logger::drain_(std::vector<LogRecord>& records){
+    std::vector<std::shared_ptr<ThreadRing>> rings;
+    {
+        std::lock_guard<std::mutex> guard(rings_mutex_);
+        rings = rings_;
+    }
+    size_t drained = 0;
+    for(const auto& ring : rings){
+        bool closed = ring->closed.load(std::memory_order_acquire); // read before draining so nothing is missed
+        drained += ring->queue.consume_all([&records](const LogRecord& record){ records.push_back(record); });
+        if(closed){
+            std::lock_guard<std::mutex> guard(rings_mutex_);
+            rings_.erase(std::remove(rings_.begin(), rings_.end(), ring), rings_.end());
+        }
+    }
+    return drained;
+}
+void factdb::Logger::write_batch_(std::vector<LogRecord>& records){
+    std::stable_sort(records.begin(), records.end(), [](const LogRecord& a, const LogRecord& b){
+        return a.time_ns < b.time_ns;
+    });
+    std::string batch;
+    batch.reserve(records.size() * 64);
+    int64_t cached_second = -1;
+    char stamp[24];
+    for(const auto& record : records){
+        int64_t second = record.time_ns / 1000000000;
+        if(second != cached_second){ // one localtime per second of records, not per line
+            time_t seconds = static_cast<time_t>(second);
+            tm local_time;
+            localtime_r(&seconds, &local_time);
+            strftime(stamp, sizeof(stamp), "%Y-%m-%d %H:%M:%S", &local_time);
+            cached_second = second;
+        }
+        batch += '[';
+        batch += stamp;
+        batch += "] [";
+        batch += log_level_tostring_(record.level);
+        batch += "] ";
+        batch.append(record.text, record.length);
+        batch += '\n';
+    }
+    std::lock_guard<std::mutex> guard(log_mutex_);
+    if(log_file_ && log_file_->is_open()){
+        log_file_->write(batch.data(), batch.size());
+        log_file_->flush();
+    }else{
+        std::cerr.write(batch.data(), batch.size());
+        std::cerr.flush();
+    }
+    written_.fetch_add(records.size(), std::memory_order_relaxed);
+}
+void factdb::Logger::run_writer_(){
+    std::vector<LogRecord> records;
+    while(true){
+        bool stopping;
+        {
+            std::unique_lock<std::mutex> lock(rings_mutex_);
+            writer_wakeup_.wait_for(lock, async_options_.flush_interval, [this]{ return stopping_; });
+            stopping = stopping_;
+        }
+        records.clear();
+        drain_(records);
+        if(!records.empty()){
+            write_batch_(records);
+        }
+        if(stopping){
+            return;
+        }
+    }
+}
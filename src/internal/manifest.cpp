@@ -0,0 +1,122 @@
+#include <data/manifest.hpp>
+#include <internal/encoding.hpp>
+
+#include <boost/crc.hpp>
+
+#include <algorithm>
+#include <filesystem>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace {
+uint32_t crc32(const char* data, size_t length){
+    boost::crc_32_type crc;
+    crc.process_bytes(data, length);
+    return crc.checksum();
+}
+// "<directory>/MANIFEST" through MANIFEST.tmp and a rename
+bool write_manifest(factdb::IoEngine& io_engine, const std::string& directory, uint64_t next_generation,
+                    const std::vector<uint64_t>& generations){
+    std::string contents;
+    factdb::append_int<uint32_t>(contents, factdb::MANIFEST_MAGIC);
+    factdb::append_int<uint32_t>(contents, factdb::MANIFEST_VERSION);
+    factdb::append_int<uint64_t>(contents, next_generation);
+    factdb::append_int<uint32_t>(contents, static_cast<uint32_t>(generations.size()));
+    for(uint64_t generation : generations){
+        factdb::append_int<uint64_t>(contents, generation);
+    }
+    factdb::append_int<uint32_t>(contents, crc32(contents.data(), contents.size()));
+
+    std::string path = directory + "/MANIFEST";
+    std::string tmp_path = path + ".tmp";
+    if(!factdb::write_file(io_engine, tmp_path, contents.data(), contents.size(), true)){
+        return false;
+    }
+    return ::rename(tmp_path.c_str(), path.c_str()) == 0 && factdb::sync_directory(directory);
+}
+}
+
+factdb::Manifest::Manifest(const std::string& directory, IoEngine& io_engine)
+    : directory_(directory), io_engine_(io_engine){
+    std::filesystem::create_directories(directory_);
+}
+bool factdb::Manifest::load(){
+    std::string contents;
+    if(!std::filesystem::exists(get_file_path())){
+        return false;
+    }
+    if(!read_file(io_engine_, get_file_path(), contents)){
+        throw std::runtime_error("Failed to read manifest " + get_file_path());
+    }
+    if(contents.size() < sizeof(uint32_t)){
+        throw std::runtime_error("Corrupt manifest " + get_file_path());
+    }
+    size_t body = contents.size() - sizeof(uint32_t);
+    if(ByteReader(contents.data() + body, sizeof(uint32_t)).read_int<uint32_t>() != crc32(contents.data(), body)){
+        throw std::runtime_error("Corrupt manifest " + get_file_path());
+    }
+    ByteReader in(contents.data(), body);
+    if(in.read_int<uint32_t>() != MANIFEST_MAGIC || in.read_int<uint32_t>() != MANIFEST_VERSION){
+        throw std::runtime_error("Unknown manifest format " + get_file_path());
+    }
+    std::lock_guard<std::mutex> guard(mutex_);
+    next_generation_ = in.read_int<uint64_t>();
+    uint32_t count = in.read_int<uint32_t>();
+    generations_.clear();
+    generations_.reserve(count);
+    for(uint32_t i = 0; i < count; i++){
+        generations_.push_back(in.read_int<uint64_t>());
+    }
+    return true;
+}
+uint64_t factdb::Manifest::allocate_generation(){
+    std::lock_guard<std::mutex> guard(mutex_);
+    return next_generation_++;
+}
+bool factdb::Manifest::add_table(uint64_t generation){
+    std::lock_guard<std::mutex> guard(mutex_);
+    std::vector<uint64_t> generations = generations_;
+    generations.push_back(generation);
+    return commit_locked_(generations);
+}
+bool factdb::Manifest::replace_tables(const std::vector<uint64_t>& removed, const std::vector<uint64_t>& added){
+    std::lock_guard<std::mutex> guard(mutex_);
+    std::vector<uint64_t> generations;
+    bool inserted = false;
+    for(uint64_t generation : generations_){
+        if(std::find(removed.begin(), removed.end(), generation) == removed.end()){
+            generations.push_back(generation);
+        }else if(!inserted){
+            generations.insert(generations.end(), added.begin(), added.end());
+            inserted = true;
+        }
+    }
+    if(!inserted){
+        generations.insert(generations.end(), added.begin(), added.end());
+    }
+    return commit_locked_(generations);
+}
+bool factdb::Manifest::save_as(const std::string& directory, const std::vector<uint64_t>& generations) const{
+    std::lock_guard<std::mutex> guard(mutex_);
+    return write_manifest(io_engine_, directory, next_generation_, generations);
+}
+bool factdb::Manifest::commit_locked_(const std::vector<uint64_t>& generations){
+    if(!write_manifest(io_engine_, directory_, next_generation_, generations)){
+        return false;
+    }
+    generations_ = generations;
+    return true;
+}
+std::vector<uint64_t> factdb::Manifest::generations() const{
+    std::lock_guard<std::mutex> guard(mutex_);
+    return generations_;
+}
+uint64_t factdb::Manifest::next_generation() const{
+    std::lock_guard<std::mutex> guard(mutex_);
+    return next_generation_;
+}
+std::string factdb::Manifest::data_path(uint64_t generation) const{
+    return directory_ + "/fdb-" + std::to_string(generation) + "-Data.db";
+}
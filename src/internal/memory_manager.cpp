@@ -0,0 +1,137 @@
+#include <runtime/memory_manager.hpp>
+#include <metrics/metrics.hpp>
+
+#include <algorithm>
+
+namespace {
+factdb::Histogram& stall_latency(){
+    static factdb::Histogram& histogram = factdb::MetricsRegistry::global().histogram(
+        "factdb_memory_write_stall_ns", "Time writers waited for memtable memory at its hard limit");
+    return histogram;
+}
+}
+
+const char* factdb::memory_subsystem_name(MemorySubsystem subsystem){
+    switch(subsystem){
+        case MemorySubsystem::MEMTABLE:
+            return "memtable";
+        case MemorySubsystem::BLOCK_CACHE:
+            return "block_cache";
+        case MemorySubsystem::ROW_CACHE:
+            return "row_cache";
+        case MemorySubsystem::IO_BUFFERS:
+            return "io_buffers";
+    }
+    return "unknown";
+}
+
+factdb::MemoryManager::MemoryManager(MemoryManagerOptions options) : options_(options){
+    double total = 0;
+    for(double share : options_.shares){
+        if(share < 0){
+            throw std::invalid_argument("Memory shares cannot be negative");
+        }
+        total += share;
+    }
+    if(total > 1.0 + 1e-9){
+        throw std::invalid_argument("Memory shares add up to more than the budget");
+    }
+    if(options_.soft_limit <= 0 || options_.soft_limit > 1){
+        throw std::invalid_argument("The soft memory limit is a fraction of each share");
+    }
+    for(size_t s = 0; s < MEMORY_SUBSYSTEM_COUNT; s++){
+        limits_[s] = static_cast<uint64_t>(options_.budget_bytes * options_.shares[s]);
+        soft_limits_[s] = static_cast<uint64_t>(limits_[s] * options_.soft_limit);
+    }
+}
+void factdb::MemoryManager::charge(MemorySubsystem subsystem, int64_t bytes){
+    usage_[index_(subsystem)].value.fetch_add(static_cast<uint64_t>(bytes), std::memory_order_relaxed);
+    if(bytes < 0 && subsystem == MemorySubsystem::MEMTABLE && waiters_.load(std::memory_order_acquire) > 0){
+        // taking the mutex orders this release against a waiter about to sleep
+        { std::lock_guard<std::mutex> guard(mutex_); }
+        room_cv_.notify_all();
+    }
+}
+uint64_t factdb::MemoryManager::add_memtable(std::function<uint64_t()> bytes, std::function<void()> flush){
+    std::lock_guard<std::mutex> guard(memtables_mutex_);
+    uint64_t id = next_memtable_id_++;
+    registered_[id] = RegisteredMemtable{std::move(bytes), std::move(flush)};
+    memtables_.fetch_add(1, std::memory_order_relaxed);
+    return id;
+}
+void factdb::MemoryManager::remove_memtable(uint64_t id){
+    std::lock_guard<std::mutex> guard(memtables_mutex_);
+    if(registered_.erase(id) > 0){
+        memtables_.fetch_sub(1, std::memory_order_relaxed);
+    }
+}
+bool factdb::MemoryManager::should_flush(uint64_t memtable_bytes) const{
+    uint64_t used = usage(MemorySubsystem::MEMTABLE);
+    if(memtable_bytes == 0 || used < soft_limit(MemorySubsystem::MEMTABLE)){
+        return false;
+    }
+    size_t memtables = std::max<size_t>(1, memtables_.load(std::memory_order_relaxed));
+    return memtable_bytes * memtables >= used;
+}
+void factdb::MemoryManager::flush_largest_memtable(){
+    std::lock_guard<std::mutex> guard(memtables_mutex_);
+    const RegisteredMemtable* largest = nullptr;
+    uint64_t largest_bytes = 0;
+    for(const auto& [id, memtable] : registered_){
+        uint64_t bytes = memtable.bytes ? memtable.bytes() : 0;
+        if(bytes > largest_bytes && memtable.flush){
+            largest = &memtable;
+            largest_bytes = bytes;
+        }
+    }
+    if(largest){
+        largest->flush();
+    }
+}
+bool factdb::MemoryManager::wait_for_memtable_room(){
+    if(!over_limit(MemorySubsystem::MEMTABLE)){
+        return true;
+    }
+    auto start = std::chrono::steady_clock::now();
+    auto deadline = start + options_.max_write_stall;
+    bool room;
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        waiters_.fetch_add(1, std::memory_order_acq_rel);
+        for(;;){
+            lock.unlock();
+            flush_largest_memtable(); // after a release another memtable may be the largest
+            lock.lock();
+            if(!over_limit(MemorySubsystem::MEMTABLE) || room_cv_.wait_until(lock, deadline) == std::cv_status::timeout){
+                break;
+            }
+        }
+        room = !over_limit(MemorySubsystem::MEMTABLE);
+        waiters_.fetch_sub(1, std::memory_order_acq_rel);
+    }
+    record_write_stall(std::chrono::steady_clock::now() - start);
+    return room;
+}
+bool factdb::MemoryManager::try_memtable_room(){
+    if(!over_limit(MemorySubsystem::MEMTABLE)){
+        return true;
+    }
+    flush_largest_memtable();
+    return !over_limit(MemorySubsystem::MEMTABLE);
+}
+void factdb::MemoryManager::record_write_stall(std::chrono::steady_clock::duration waited){
+    uint64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(waited).count();
+    write_stalls_.fetch_add(1, std::memory_order_relaxed);
+    stalled_ns_.fetch_add(ns, std::memory_order_relaxed);
+    stall_latency().record(ns);
+}
+factdb::MemoryStats factdb::MemoryManager::stats() const{
+    MemoryStats stats;
+    for(size_t s = 0; s < MEMORY_SUBSYSTEM_COUNT; s++){
+        stats.usage[s] = usage_[s].value.load(std::memory_order_relaxed);
+    }
+    stats.write_stalls = write_stalls_.load(std::memory_order_relaxed);
+    stats.stalled_ns = stalled_ns_.load(std::memory_order_relaxed);
+    stats.rejected_writes = rejected_writes_.load(std::memory_order_relaxed);
+    return stats;
+}
@@ -1,32 +1,206 @@
 #include <data/memtable.hpp>
+#include <data/secondary_index.hpp>
 #include <internal/consts.hpp>
+#include <metrics/metrics.hpp>
 
-void factdb::Memtable::insert(std::string partition_key, std::string cluster_key, std::shared_ptr<std::vector<std::shared_ptr<factdb::MemtableRow>>> value){
+#include <algorithm>
+#include <optional>
+
+namespace {
+// the value a write gives `column`, the last one when its rows repeat it
+std::optional<std::string> written_value(const factdb::MemtableRows& value, const std::string& column){
+    std::optional<std::string> result;
+    if (value == nullptr) {
+        return result;
+    }
+    for (const auto& row : *value) {
+        if (auto found = row->getcol_(column)) {
+            result = found->get_serialized_val_();
+        }
+    }
+    return result;
+}
+// the column's value in a live memtable row, merged over its versions
+std::optional<std::string> current_value(const factdb::MemTableEntry<std::string, factdb::MemtableRows>& entry, const std::string& column){
+    std::optional<std::string> result;
+    if (entry.is_deleted_) {
+        return result;
+    }
+    for (const auto& version : entry.values_) {
+        if (auto value = written_value(version->value_, column)) {
+            result = std::move(value);
+        }
+    }
+    return result;
+}
+
+// rough allocator overheads of a skiplist partition, a row version and a column
+constexpr size_t PARTITION_OVERHEAD = 512;
+constexpr size_t VERSION_OVERHEAD = 96;
+constexpr size_t COLUMN_OVERHEAD = 64;
+// what one version of an interned row adds to a skiplist
+size_t version_bytes(const std::string& cluster_key, const factdb::MemtableRows& value){
+    size_t bytes = VERSION_OVERHEAD + cluster_key.size();
+    if (value) {
+        for (const auto& row : *value) {
+            for (const auto& column : row->interned_columns_()) {
+                bytes += COLUMN_OVERHEAD + column->get_serialized_val_().size();
+            }
+        }
+    }
+    return bytes;
+}
+}
+
+void factdb::SkipListHeightMetric::record(int height){
+    static Histogram& heights = MetricsRegistry::global().histogram(
+        "factdb_skiplist_node_height", "Levels above the base list given to new skiplist nodes");
+    heights.record(height);
+}
+std::shared_ptr<factdb::MemtableRow> factdb::MemtableRow::intern_(const std::vector<std::shared_ptr<MemtableRow>>& rows, SchemaRegistry& schema){
+    std::vector<std::pair<ColumnId, std::shared_ptr<MemtableColumn>>> columns;
+    for (const auto& row : rows) {
+        if (row->schema_ != nullptr) { // already interned, possibly into another registry
+            for (const auto& column : row->interned_) {
+                columns.emplace_back(schema.intern(column->getcolname_()), column);
+            }
+            continue;
+        }
+        for (const auto& [name, column] : row->columns_) {
+            columns.emplace_back(schema.intern(name), column);
+        }
+    }
+    std::stable_sort(columns.begin(), columns.end(), [](const auto& a, const auto& b){ return a.first < b.first; });
+    auto interned = std::make_shared<MemtableRow>();
+    interned->schema_ = &schema;
+    interned->interned_.reserve(columns.size());
+    for (size_t i = 0; i < columns.size(); i++) {
+        if (i + 1 < columns.size() && columns[i + 1].first == columns[i].first) { // a later row sets it again
+            continue;
+        }
+        interned->present_.set(columns[i].first);
+        interned->interned_.push_back(std::move(columns[i].second));
+    }
+    return interned;
+}
+factdb::MemtableRows factdb::Memtable::intern_rows_(const MemtableRows& value){
+    if (value == nullptr) {
+        return value;
+    }
+    return std::make_shared<std::vector<std::shared_ptr<MemtableRow>>>(1, MemtableRow::intern_(*value, *schema_));
+}
+void factdb::Memtable::insert(std::string partition_key, std::string cluster_key, std::shared_ptr<std::vector<std::shared_ptr<factdb::MemtableRow>>> value, uint64_t sequence){
+    if (!indexes_.empty()) {
+        index_write_(partition_key, cluster_key, value, false, sequence);
+    }
+    value = intern_rows_(value);
+    approximate_bytes_ += version_bytes(cluster_key, value);
     auto it = skiplist_map_.find(partition_key);
     if (it != skiplist_map_.end()) {
-        it->second->insert(cluster_key, value);
+        it->second->insert(cluster_key, value, sequence);
     } else {
-        auto partition_skiplist = std::make_shared<factdb::SkipList<std::string, std::shared_ptr<std::vector<std::shared_ptr<factdb::MemtableRow>>>>>(MAX_SKIPLIST_HEIGHT, NEW_SKIPLIST_LAYER_PROB);
-        partition_skiplist->insert(cluster_key, value);
+        approximate_bytes_ += PARTITION_OVERHEAD + partition_key.size();
+        auto partition_skiplist = std::make_shared<factdb::SkipList<std::string, std::shared_ptr<std::vector<std::shared_ptr<factdb::MemtableRow>>>, SkipListHeightMetric>>(MAX_SKIPLIST_HEIGHT, NEW_SKIPLIST_LAYER_PROB);
+        partition_skiplist->insert(cluster_key, value, sequence);
         skiplist_map_[partition_key] = partition_skiplist; 
     }
 }
-bool factdb::Memtable::update(std::string partition_key, std::string cluster_key, std::shared_ptr<std::vector<std::shared_ptr<factdb::MemtableRow>>> value){
+bool factdb::Memtable::update(std::string partition_key, std::string cluster_key, std::shared_ptr<std::vector<std::shared_ptr<factdb::MemtableRow>>> value, uint64_t sequence){
     auto it = skiplist_map_.find(partition_key);
-    if (it != skiplist_map_.end()) {
-        it->second->update(cluster_key, value);
-        return true;
+    if (it == skiplist_map_.end()) {
+        return false;
     }
-    return false;
+    if (!indexes_.empty()) {
+        auto entry = it->second->find_entry(cluster_key);
+        if (entry == nullptr || entry->is_deleted_) { // update() below fails the same way
+            return false;
+        }
+        index_write_(partition_key, cluster_key, value, false, sequence);
+    }
+    auto interned = intern_rows_(value);
+    if (!it->second->update(cluster_key, interned, sequence)) {
+        return false;
+    }
+    approximate_bytes_ += version_bytes(cluster_key, interned);
+    return true;
 }
 bool factdb::Memtable::remove(std::string partition_key, std::string cluster_key){
     auto it = skiplist_map_.find(partition_key);
     if (it != skiplist_map_.end()) {
-        it->second->remove(cluster_key);
+        if (!indexes_.empty()) {
+            index_write_(partition_key, cluster_key, nullptr, true, 0);
+        }
+        if (!it->second->remove(cluster_key)) { // leaves a row that is only on disk to the caller
+            return false;
+        }
+        approximate_bytes_ += version_bytes(cluster_key, nullptr);
         return true;
     }
     return false;
 }
+void factdb::MutationBatch::sort(){
+    for (auto& [partition_key, mutations] : partitions_) {
+        std::stable_sort(mutations.begin(), mutations.end(), [](const BatchMutation& a, const BatchMutation& b){
+            return a.key < b.key;
+        });
+    }
+    sorted_ = true;
+}
+void factdb::Memtable::apply(const MutationBatch& batch, uint64_t sequence){
+    if (!batch.sorted()) {
+        throw std::logic_error("MutationBatch must be sorted before it is applied");
+    }
+    for (const auto& [partition_key, mutations] : batch.partitions()) {
+        auto& partition_skiplist = skiplist_map_[partition_key];
+        if (!partition_skiplist) {
+            partition_skiplist = std::make_shared<factdb::SkipList<std::string, MemtableRows, SkipListHeightMetric>>(MAX_SKIPLIST_HEIGHT, NEW_SKIPLIST_LAYER_PROB);
+            approximate_bytes_ += PARTITION_OVERHEAD + partition_key.size();
+        }
+        std::vector<BatchMutation> interned(mutations);
+        for (auto& mutation : interned) {
+            mutation.value = intern_rows_(mutation.value);
+            approximate_bytes_ += version_bytes(mutation.key, mutation.value);
+        }
+        if (indexes_.empty()) {
+            partition_skiplist->apply_sorted(interned, sequence);
+            continue;
+        }
+        for (size_t m = 0; m < mutations.size(); m++) { // each index update must see the mutation before it
+            index_write_(partition_key, mutations[m].key, mutations[m].value, mutations[m].remove, sequence);
+            partition_skiplist->apply_sorted(std::vector<BatchMutation>{interned[m]}, sequence);
+        }
+    }
+}
+void factdb::Memtable::add_index(const std::string& column, Memtable* index){
+    indexes_[column] = index;
+}
+void factdb::Memtable::index_write_(const std::string& partition_key, const std::string& cluster_key, const MemtableRows& value, bool remove, uint64_t sequence){
+    std::shared_ptr<MemTableEntry<std::string, MemtableRows>> entry;
+    auto it = skiplist_map_.find(partition_key);
+    if (it != skiplist_map_.end()) {
+        entry = it->second->find_entry(cluster_key);
+    }
+    std::string index_key;
+    for (const auto& [column, index] : indexes_) {
+        std::optional<std::string> next = remove ? std::nullopt : written_value(value, column);
+        if (!next && !remove) { // the write leaves this column as it was
+            continue;
+        }
+        std::optional<std::string> previous = entry ? current_value(*entry, column) : std::nullopt;
+        if (previous == next && (!next || sequence == 0)) {
+            continue;
+        }
+        if (index_key.empty()) {
+            index_key = encode_index_key(partition_key, cluster_key);
+        }
+        if (previous && previous != next) {
+            index->remove(*previous, index_key);
+        }
+        if (next) { // entries carry no columns; a value written again takes the new sequence
+            index->insert(*next, index_key, nullptr, sequence);
+        }
+    }
+}
 std::shared_ptr<factdb::Row> factdb::Memtable::convert_obj_to_row_(std::unordered_map<std::string, std::shared_ptr<factdb::MemtableColumn>> *obj, std::string* cluster_key){
     if(obj == nullptr){
         return nullptr;
@@ -53,38 +227,132 @@ std::shared_ptr<factdb::Row> factdb::Memtable::convert_obj_to_row_(std::unordere
     }
     return new_row;
 }
+std::shared_ptr<factdb::Row> factdb::Memtable::build_row_(factdb::MemTableEntry<std::string, factdb::MemtableRows>& entry){
+    const std::string& clusterkey = entry.key_;
+    std::vector<const MemtableColumn*> newest; // by column id, merged over the updates to this (partition, cluster key)
+    std::vector<uint64_t> sequences;           // by column id, of the write that set newest[id]
+    uint64_t row_sequence = 0;
+    ColumnBitmap present;
+    if (!entry.is_deleted_) {
+        for (const auto& memtable_entry : entry.values_) {
+            row_sequence = std::max(row_sequence, memtable_entry->timestamp_);
+            const auto& memtable_cols = memtable_entry->value_;
+            if (memtable_cols == nullptr) continue;
+            for (const auto& curr_row : *memtable_cols) { // one interned row per write
+                const auto& columns = curr_row->interned_columns_();
+                size_t next = 0;
+                curr_row->present_columns_().for_each([&](ColumnId id) {
+                    if (id >= newest.size()) {
+                        newest.resize(id + 1, nullptr);
+                        sequences.resize(id + 1, 0);
+                    }
+                    newest[id] = columns[next++].get();
+                    sequences[id] = memtable_entry->timestamp_;
+                    present.set(id);
+                });
+            }
+        }
+    }
+    std::shared_ptr<factdb::Row> curr_row = std::make_shared<factdb::Row>();
+    std::optional<ColumnId> cluster_column = present.empty() ? std::nullopt : schema_->find(clusterkey);
+    present.for_each([&](ColumnId id) { // cells in column id order
+        const MemtableColumn& column = *newest[id];
+        const std::string& col_name = column.getcolname_();
+        const std::string& value = column.get_serialized_val_();
+        factdb::CellValue curr_cell(col_name.length(), value.length());
+        curr_cell.key_.assign(col_name.begin(), col_name.end());
+        curr_cell.value_.assign(value.begin(), value.end());
+        if (cluster_column && id == *cluster_column) { // a column named like the cluster key holds its clustering value
+            std::shared_ptr<factdb::ClusteringBlock> cb = std::make_shared<factdb::ClusteringBlock>();
+            cb->clustering_cells_.emplace_back(curr_cell);
+            curr_row->clustering_blocks_.emplace_back(cb);
+        } else {
+            curr_row->cells_.emplace_back(curr_cell);
+            if (sequences[id] != 0) {
+                curr_row->cells_.back().delta_timestamp_ = sequences[id];
+            }
+        }
+    });
+    if (row_sequence != 0) {
+        curr_row->liveness_info_.emplace();
+        curr_row->liveness_info_->delta_timestamp_ = row_sequence;
+    }
+    if (curr_row->clustering_blocks_.empty()) { // keep the clustering key even without a matching column
+        std::shared_ptr<factdb::ClusteringBlock> cb = std::make_shared<factdb::ClusteringBlock>();
+        factdb::CellValue key_cell;
+        key_cell.key_ = std::vector<char>(clusterkey.begin(), clusterkey.end());
+        cb->clustering_cells_.emplace_back(key_cell);
+        curr_row->clustering_blocks_.emplace_back(cb);
+    }
+    if (entry.is_deleted_) {
+        curr_row->flags_ |= static_cast<char>(factdb::RowFlags::HAS_DELETION);
+    }
+    return curr_row;
+}
+std::shared_ptr<factdb::Row> factdb::Memtable::get_row(const std::string& partition_key, const std::string& cluster_key){
+    auto it = skiplist_map_.find(partition_key);
+    if (it == skiplist_map_.end()) {
+        return nullptr;
+    }
+    auto entry = it->second->find_entry(cluster_key);
+    if (entry == nullptr) {
+        return nullptr;
+    }
+    return build_row_(*entry);
+}
+std::vector<std::shared_ptr<factdb::Row>> factdb::Memtable::get_partition_rows(const std::string& partition_key){
+    std::vector<std::shared_ptr<factdb::Row>> rows;
+    auto it = skiplist_map_.find(partition_key);
+    if (it == skiplist_map_.end()) {
+        return rows;
+    }
+    for (auto entry = it->second->begin(); entry != it->second->end(); ++entry) {
+        rows.push_back(build_row_(*entry));
+    }
+    return rows;
+}
 std::shared_ptr<factdb::SSTable> factdb::Memtable::flush_to_sstable(std::string &table_id){
-    std::shared_ptr<factdb::SSTable> sstable = std::make_shared<factdb::SSTable>();
-    std::ofstream datafile(table_id, std::ios::binary | std::ios::out);
-    if (!datafile.is_open()) {
+    return flush_to_sstable(table_id, factdb::SSTableWriteOptions());
+}
+std::shared_ptr<factdb::SSTable> factdb::Memtable::flush_to_sstable(std::string &table_id, const factdb::SSTableWriteOptions& options){
+    std::shared_ptr<factdb::SSTable> sstable = std::make_shared<factdb::SSTable>(table_id, get_partitions());
+    factdb::SSTableWriteOptions write_options = options;
+    if (write_options.schema == nullptr) {
+        write_options.schema = schema_.get();
+    }
+    if (!sstable->write_to_file(write_options)) {
         throw std::runtime_error("Failed to open SSTable file for writing");
     }
+    skiplist_map_.clear();
+    approximate_bytes_ = 0;
+    return sstable;
+}
+std::shared_ptr<factdb::Memtable> factdb::Memtable::freeze(){
+    auto frozen = std::make_shared<Memtable>();
+    frozen->schema_ = schema_;
+    frozen->approximate_bytes_ = approximate_bytes_;
+    frozen->skiplist_map_ = std::move(skiplist_map_);
+    skiplist_map_.clear();
+    approximate_bytes_ = 0;
+    return frozen;
+}
+std::vector<std::shared_ptr<factdb::Partition>> factdb::Memtable::get_partitions(){
+    std::vector<std::string> partition_keys;
+    partition_keys.reserve(skiplist_map_.size());
     for (const auto& partition_entry : skiplist_map_) {
-        const std::string& partition_key = partition_entry.first; // partition name
-        auto partition_skiplist = partition_entry.second;
+        partition_keys.push_back(partition_entry.first);
+    }
+    std::sort(partition_keys.begin(), partition_keys.end()); // sstables are sorted by partition key
+    std::vector<std::shared_ptr<factdb::Partition>> partitions;
+    for (const auto& partition_key : partition_keys) {
+        auto partition_skiplist = skiplist_map_.find(partition_key)->second; // find, not [], so frozen memtables can be read concurrently
         std::shared_ptr<factdb::Partition> partition = std::make_shared<factdb::Partition>();
         partition->header_.key_ = std::vector<char>(partition_key.begin(), partition_key.end());
-        bool cluster_key_found = false;
+        partition->header_.key_length_ = partition_key.size();
         for (auto it = partition_skiplist->begin(); it != partition_skiplist->end(); ++it){ // going through every partition
-            std::string clusterkey = it->key_;
-            std::vector<std::shared_ptr<factdb::MemTableValue<std::shared_ptr<std::vector<std::shared_ptr<factdb::MemtableRow>>>>>> value = it->values_;
-            std::unordered_map<std::string, std::shared_ptr<factdb::MemtableColumn>> objstate;
-            bool is_clusterkey_found = false;
-            for (const auto& memtable_entry : value) { // iterating through all updates to this (partition, cluster key) combo
-                const auto memtable_cols = memtable_entry->value_;
-                for(const auto& curr_row : *memtable_cols){ // iterating through all groups of rows
-                    for(const auto&curr_col : curr_row->getallcols_()){ // going through all cols for this update instance
-                        auto col_name = curr_col.first;
-                        std::shared_ptr<factdb::MemtableColumn> col_val = curr_col.second;
-                        if(col_name == clusterkey) cluster_key_found = true; // checking if we have the cluster key
-                        objstate[col_name] = col_val;
-                    }
-                }
-            }
-            std::shared_ptr<factdb::Row> curr_row = this->convert_obj_to_row_(&objstate, &clusterkey);
-            partition->unfiltereds_.emplace_back(curr_row);
+            partition->unfiltereds_.emplace_back(this->build_row_(*it));
         }
+        partitions.emplace_back(partition);
     }
-    skiplist_map_.clear();
-    return sstable;
-}
\ No newline at end of file
+    return partitions;
+}
@@ -0,0 +1,142 @@
+#include <metrics/metrics.hpp>
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+
+double factdb::HistogramSnapshot::quantile(double q) const{
+    if(count == 0){
+        return 0;
+    }
+    uint64_t rank = static_cast<uint64_t>(std::ceil(q * count));
+    rank = std::max<uint64_t>(rank, 1);
+    uint64_t seen = 0;
+    for(size_t bucket = 0; bucket < buckets.size(); bucket++){
+        seen += buckets[bucket];
+        if(seen >= rank){
+            return Histogram::bucket_lower(bucket) + (Histogram::bucket_width(bucket) - 1) / 2.0;
+        }
+    }
+    return static_cast<double>(Histogram::bucket_lower(buckets.size() - 1));
+}
+factdb::HistogramSnapshot factdb::Histogram::snapshot() const{
+    HistogramSnapshot snapshot;
+    snapshot.buckets.assign(BUCKETS, 0);
+    for(const auto& slot : slots_){
+        snapshot.sum += slot.sum.load(std::memory_order_relaxed);
+        for(size_t bucket = 0; bucket < BUCKETS; bucket++){
+            uint64_t samples = slot.buckets[bucket].load(std::memory_order_relaxed);
+            snapshot.buckets[bucket] += samples;
+            snapshot.count += samples;
+        }
+    }
+    return snapshot;
+}
+
+factdb::MetricsRegistry& factdb::MetricsRegistry::global(){
+    static MetricsRegistry registry;
+    return registry;
+}
+factdb::MetricsRegistry::Entry& factdb::MetricsRegistry::entry_(const std::string& name, const std::string& help, MetricType type){
+    auto [it, inserted] = entries_.try_emplace(name);
+    Entry& entry = it->second;
+    if(inserted){
+        entry.help = help;
+        entry.type = type;
+    }else if(entry.type != type){
+        throw std::logic_error("Metric " + name + " is already registered with another type");
+    }
+    return entry;
+}
+factdb::Counter& factdb::MetricsRegistry::counter(const std::string& name, const std::string& help){
+    std::lock_guard<std::mutex> guard(mutex_);
+    Entry& entry = entry_(name, help, MetricType::COUNTER);
+    if(!entry.counter){
+        entry.counter = std::make_unique<Counter>();
+    }
+    return *entry.counter;
+}
+factdb::Gauge& factdb::MetricsRegistry::gauge(const std::string& name, const std::string& help){
+    std::lock_guard<std::mutex> guard(mutex_);
+    Entry& entry = entry_(name, help, MetricType::GAUGE);
+    if(!entry.gauge){
+        entry.gauge = std::make_unique<Gauge>();
+    }
+    return *entry.gauge;
+}
+factdb::Histogram& factdb::MetricsRegistry::histogram(const std::string& name, const std::string& help){
+    std::lock_guard<std::mutex> guard(mutex_);
+    Entry& entry = entry_(name, help, MetricType::HISTOGRAM);
+    if(!entry.histogram){
+        entry.histogram = std::make_unique<Histogram>();
+    }
+    return *entry.histogram;
+}
+void factdb::MetricsRegistry::register_callback(const std::string& name, const std::string& help, MetricType type, std::function<double()> read){
+    if(type == MetricType::HISTOGRAM){
+        throw std::invalid_argument("Callback metrics are counters or gauges");
+    }
+    std::lock_guard<std::mutex> guard(mutex_);
+    Entry& entry = entry_(name, help, type);
+    if(entry.counter || entry.gauge){
+        throw std::logic_error("Metric " + name + " is already registered");
+    }
+    entry.callback = std::move(read);
+}
+void factdb::MetricsRegistry::remove_callback(const std::string& name){
+    std::lock_guard<std::mutex> guard(mutex_);
+    auto it = entries_.find(name);
+    if(it != entries_.end() && it->second.callback){
+        entries_.erase(it);
+    }
+}
+std::string factdb::MetricsRegistry::prometheus_text() const{
+    std::lock_guard<std::mutex> guard(mutex_);
+    std::string out;
+    char number[64];
+    auto append_sample = [&](const std::string& name, double value){
+        std::snprintf(number, sizeof(number), " %.17g\n", value);
+        out += name;
+        out += number;
+    };
+    for(const auto& [name, entry] : entries_){
+        out += "# HELP " + name + " " + entry.help + "\n";
+        switch(entry.type){
+            case MetricType::COUNTER:
+                out += "# TYPE " + name + " counter\n";
+                append_sample(name, entry.callback ? entry.callback() : static_cast<double>(entry.counter->value()));
+                break;
+            case MetricType::GAUGE:
+                out += "# TYPE " + name + " gauge\n";
+                append_sample(name, entry.callback ? entry.callback() : static_cast<double>(entry.gauge->value()));
+                break;
+            case MetricType::HISTOGRAM: {
+                out += "# TYPE " + name + " summary\n";
+                HistogramSnapshot snapshot = entry.histogram->snapshot();
+                for(const char* q : {"0.5", "0.9", "0.99", "0.999"}){
+                    append_sample(name + "{quantile=\"" + q + "\"}", snapshot.quantile(std::atof(q)));
+                }
+                append_sample(name + "_sum", static_cast<double>(snapshot.sum));
+                append_sample(name + "_count", static_cast<double>(snapshot.count));
+                break;
+            }
+        }
+    }
+    return out;
+}
+bool factdb::MetricsRegistry::dump(const std::string& path) const{
+    std::string text = prometheus_text();
+    std::string temporary = path + ".tmp";
+    {
+        std::ofstream out(temporary, std::ios::out | std::ios::trunc);
+        if(!out.write(text.data(), text.size())){
+            return false;
+        }
+    }
+    std::error_code error;
+    std::filesystem::rename(temporary, path, error);
+    return !error;
+}
@@ -0,0 +1,118 @@
+#include <metrics/exporter.hpp>
+#include <metrics/tracing.hpp>
+
+#include <boost/asio/read_until.hpp>
+#include <boost/asio/streambuf.hpp>
+#include <boost/asio/write.hpp>
+
+#include <istream>
+
+namespace {
+// one request per connection, answered and closed
+struct HttpExchange : std::enable_shared_from_this<HttpExchange> {
+    HttpExchange(boost::asio::ip::tcp::socket socket, factdb::MetricsRegistry& registry)
+        : socket(std::move(socket)), registry(registry) {}
+
+    boost::asio::ip::tcp::socket socket;
+    factdb::MetricsRegistry& registry;
+    boost::asio::streambuf request;
+    std::string response;
+
+    void start(){
+        auto self = shared_from_this();
+        boost::asio::async_read_until(socket, request, "\r\n\r\n",
+            [self](const boost::system::error_code& error, size_t){
+                if(error){
+                    return;
+                }
+                std::istream in(&self->request);
+                std::string method;
+                std::string target;
+                in >> method >> target;
+                std::string status = "200 OK";
+                std::string body;
+                if(method != "GET"){
+                    status = "405 Method Not Allowed";
+                }else if(target == "/traces"){
+                    body = factdb::Tracer::global().text();
+                }else if(target != "/metrics" && target != "/"){
+                    status = "404 Not Found";
+                }else{
+                    body = self->registry.prometheus_text();
+                }
+                self->response = "HTTP/1.1 " + status + "\r\n"
+                                 "Content-Type: text/plain; version=0.0.4\r\n"
+                                 "Content-Length: " + std::to_string(body.size()) + "\r\n"
+                                 "Connection: close\r\n\r\n" + body;
+                boost::asio::async_write(self->socket, boost::asio::buffer(self->response),
+                    [self](const boost::system::error_code&, size_t){
+                        boost::system::error_code ignored;
+                        self->socket.shutdown(boost::asio::ip::tcp::socket::shutdown_both, ignored);
+                    });
+            });
+    }
+};
+}
+
+factdb::MetricsExporter::MetricsExporter(MetricsExporterOptions options, MetricsRegistry& registry)
+    : options_(std::move(options)), registry_(registry){}
+
+factdb::MetricsExporter::~MetricsExporter(){
+    stop();
+}
+void factdb::MetricsExporter::start(){
+    using boost::asio::ip::tcp;
+    if(thread_.joinable()){
+        return;
+    }
+    if(options_.port != 0){
+        tcp::endpoint endpoint(boost::asio::ip::make_address(options_.address), options_.port);
+        acceptor_ = std::make_unique<tcp::acceptor>(io_);
+        acceptor_->open(endpoint.protocol());
+        acceptor_->set_option(tcp::acceptor::reuse_address(true));
+        acceptor_->bind(endpoint);
+        acceptor_->listen();
+        port_ = acceptor_->local_endpoint().port();
+        accept_();
+    }
+    if(!options_.dump_path.empty()){
+        dump_timer_ = std::make_unique<boost::asio::steady_timer>(io_);
+        schedule_dump_();
+    }
+    if(!acceptor_ && !dump_timer_){
+        return;
+    }
+    io_.restart();
+    thread_ = std::thread([this]{ io_.run(); });
+}
+void factdb::MetricsExporter::stop(){
+    if(!thread_.joinable()){
+        return;
+    }
+    io_.stop();
+    thread_.join();
+    acceptor_.reset();
+    dump_timer_.reset();
+    if(!options_.dump_path.empty()){
+        registry_.dump(options_.dump_path);
+    }
+}
+void factdb::MetricsExporter::accept_(){
+    acceptor_->async_accept([this](const boost::system::error_code& error, boost::asio::ip::tcp::socket socket){
+        if(error){
+            return;
+        }
+        std::make_shared<HttpExchange>(std::move(socket), registry_)->start();
+        accept_();
+    });
+}
+void factdb::MetricsExporter::schedule_dump_(){
+    dump_timer_->expires_after(options_.dump_interval);
+    dump_timer_->async_wait([this](const boost::system::error_code& error){
+        if(error){
+            return;
+        }
+        registry_.dump(options_.dump_path);
+        schedule_dump_();
+    });
+}
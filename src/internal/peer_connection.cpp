@@ -0,0 +1,164 @@
+#include <net/peer_connection.hpp>
+
+#include <boost/asio/buffer.hpp>
+#include <boost/asio/connect.hpp>
+#include <boost/asio/write.hpp>
+
+#include <cstring>
+#include <stdexcept>
+
+factdb::PeerConnection::PeerConnection(boost::asio::io_context& io, std::string host, uint16_t port, std::chrono::milliseconds timeout)
+    : io_(io), host_(std::move(host)), port_(port), timeout_(timeout), socket_(io), buffer_(64 * 1024){}
+
+factdb::Future<factdb::Response> factdb::PeerConnection::send(Request request){
+    if(pending_.size() + timed_out_.size() >= 1 << 16){
+        return make_exception_future<Response>(std::make_exception_ptr(std::runtime_error("too many requests in flight to " + host_)));
+    }
+    while(pending_.count(next_stream_) || timed_out_.count(next_stream_)){
+        next_stream_++;
+    }
+    request.stream = next_stream_++;
+    Pending& pending = pending_[request.stream];
+    auto result = pending.promise.get_future();
+    pending.deadline = std::make_unique<boost::asio::steady_timer>(io_, timeout_);
+    auto self = shared_from_this();
+    pending.deadline->async_wait([self, stream = request.stream](const boost::system::error_code& error){
+        if(!error){
+            self->expire_(stream);
+        }
+    });
+    queued_.push_back(encode_request(request));
+    if(state_ == State::DISCONNECTED){
+        connect_();
+    }else if(state_ == State::CONNECTED){
+        write_();
+    }
+    return result;
+}
+void factdb::PeerConnection::connect_(){
+    state_ = State::CONNECTING;
+    boost::system::error_code error;
+    auto address = boost::asio::ip::make_address(host_, error);
+    if(error){
+        fail_("bad peer address " + host_);
+        return;
+    }
+    auto self = shared_from_this();
+    socket_.async_connect(boost::asio::ip::tcp::endpoint(address, port_), [self](const boost::system::error_code& error){
+        if(error){
+            self->fail_("connect to " + self->host_ + ":" + std::to_string(self->port_) + " failed: " + error.message());
+            return;
+        }
+        self->state_ = State::CONNECTED;
+        self->socket_.set_option(boost::asio::ip::tcp::no_delay(true));
+        self->read_();
+        self->write_();
+    });
+}
+void factdb::PeerConnection::write_(){
+    if(write_active_ || queued_.empty()){
+        return;
+    }
+    writing_.clear();
+    while(!queued_.empty()){
+        writing_.push_back(std::move(queued_.front()));
+        queued_.pop_front();
+    }
+    std::vector<boost::asio::const_buffer> buffers;
+    buffers.reserve(writing_.size());
+    for(const auto& frame : writing_){
+        buffers.emplace_back(boost::asio::buffer(frame));
+    }
+    write_active_ = true;
+    auto self = shared_from_this();
+    boost::asio::async_write(socket_, buffers, [self](const boost::system::error_code& error, size_t){
+        self->write_active_ = false;
+        if(error){
+            self->fail_("write to " + self->host_ + " failed: " + error.message());
+            return;
+        }
+        self->write_();
+    });
+}
+void factdb::PeerConnection::read_(){
+    if(buffered_ == buffer_.size()){
+        buffer_.resize(buffer_.size() * 2);
+    }
+    auto self = shared_from_this();
+    socket_.async_read_some(boost::asio::buffer(buffer_.data() + buffered_, buffer_.size() - buffered_),
+        [self](const boost::system::error_code& error, size_t bytes){
+            if(error){
+                self->fail_("read from " + self->host_ + " failed: " + error.message());
+                return;
+            }
+            self->buffered_ += bytes;
+            size_t offset = 0;
+            std::vector<Response> responses;
+            try{
+                while(size_t frame = protocol_frame_size(self->buffer_.data() + offset, self->buffered_ - offset)){
+                    responses.push_back(decode_response(self->buffer_.data() + offset, frame));
+                    offset += frame;
+                }
+            }catch(const std::exception& e){
+                self->fail_(e.what());
+                return;
+            }
+            std::memmove(self->buffer_.data(), self->buffer_.data() + offset, self->buffered_ - offset);
+            self->buffered_ -= offset;
+            if(self->buffered_ >= PROTOCOL_HEADER_SIZE){
+                uint32_t body;
+                std::memcpy(&body, self->buffer_.data(), sizeof(body));
+                if(PROTOCOL_HEADER_SIZE + body > self->buffer_.size()){
+                    self->buffer_.resize(PROTOCOL_HEADER_SIZE + body);
+                }
+            }
+            self->read_();
+            // completions may send more requests, so they run after the next read is armed
+            for(auto& response : responses){
+                auto it = self->pending_.find(response.stream);
+                if(it == self->pending_.end()){
+                    self->timed_out_.erase(response.stream);
+                    continue;
+                }
+                auto promise = it->second.promise;
+                it->second.deadline->cancel();
+                self->pending_.erase(it);
+                promise.set_value(std::move(response));
+            }
+        });
+}
+void factdb::PeerConnection::expire_(uint16_t stream){
+    auto it = pending_.find(stream);
+    if(it == pending_.end()){
+        return;
+    }
+    auto promise = it->second.promise;
+    pending_.erase(it);
+    timed_out_.insert(stream);
+    promise.set_exception(std::make_exception_ptr(std::runtime_error("request to " + host_ + " timed out")));
+    if(timed_out_.size() > MAX_TIMED_OUT){
+        fail_("too many timed out requests to " + host_); // a fresh connection reuses every stream
+    }
+}
+void factdb::PeerConnection::fail_(const std::string& reason){
+    timed_out_.clear();
+    if(state_ == State::DISCONNECTED && pending_.empty()){
+        return;
+    }
+    boost::system::error_code ignored;
+    socket_.close(ignored);
+    socket_ = boost::asio::ip::tcp::socket(io_);
+    state_ = State::DISCONNECTED;
+    buffered_ = 0;
+    queued_.clear();
+    auto failed = std::move(pending_);
+    pending_.clear();
+    auto error = std::make_exception_ptr(std::runtime_error(reason));
+    for(auto& [stream, pending] : failed){
+        pending.deadline->cancel();
+        pending.promise.set_exception(error);
+    }
+}
+void factdb::PeerConnection::close(){
+    fail_("connection closed");
+}
@@ -0,0 +1,179 @@
+#include <net/protocol.hpp>
+#include <internal/encoding.hpp>
+
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+void write_header(std::string& out, uint16_t stream, uint8_t code, uint8_t consistency){
+    factdb::append_int<uint32_t>(out, 0); // patched by finish_frame
+    factdb::append_int<uint16_t>(out, stream);
+    factdb::append_int<uint8_t>(out, code);
+    factdb::append_int<uint8_t>(out, consistency);
+}
+void finish_frame(std::string& out){
+    uint32_t body = static_cast<uint32_t>(out.size() - factdb::PROTOCOL_HEADER_SIZE);
+    std::memcpy(out.data(), &body, sizeof(body));
+}
+void write_columns(std::string& out, const std::vector<factdb::WireColumn>& columns){
+    factdb::append_int<uint32_t>(out, static_cast<uint32_t>(columns.size()));
+    for(const auto& column : columns){
+        factdb::append_bytes(out, column.name);
+        factdb::append_bytes(out, column.value);
+    }
+}
+std::vector<factdb::WireColumn> read_columns(factdb::ByteReader& in){
+    std::vector<factdb::WireColumn> columns(in.read_count(2 * sizeof(uint32_t))); // two empty strings
+    for(auto& column : columns){
+        column.name = in.read_string();
+        column.value = in.read_string();
+    }
+    return columns;
+}
+void write_request_body(std::string& out, const factdb::Request& request){
+    switch(request.opcode){
+        case factdb::Opcode::GET:
+        case factdb::Opcode::REMOVE:
+            factdb::append_bytes(out, request.partition_key);
+            factdb::append_bytes(out, request.cluster_key);
+            break;
+        case factdb::Opcode::PUT:
+            factdb::append_bytes(out, request.partition_key);
+            factdb::append_bytes(out, request.cluster_key);
+            write_columns(out, request.columns);
+            break;
+        case factdb::Opcode::SCAN:
+            factdb::append_bytes(out, request.partition_key);
+            factdb::append_bytes(out, request.cluster_key);
+            factdb::append_bytes(out, request.end_key);
+            factdb::append_int<uint32_t>(out, request.limit);
+            break;
+        case factdb::Opcode::BATCH:
+            factdb::append_int<uint32_t>(out, static_cast<uint32_t>(request.batch.size()));
+            for(const auto& mutation : request.batch){
+                if(mutation.opcode != factdb::Opcode::PUT && mutation.opcode != factdb::Opcode::REMOVE){
+                    throw std::invalid_argument("BATCH only carries PUT and REMOVE");
+                }
+                factdb::append_int<uint8_t>(out, static_cast<uint8_t>(mutation.opcode));
+                write_request_body(out, mutation);
+            }
+            break;
+        case factdb::Opcode::MERKLE:
+        case factdb::Opcode::STREAM:
+        case factdb::Opcode::INGEST:
+            factdb::append_bytes(out, request.payload);
+            break;
+    }
+}
+void read_request_body(factdb::ByteReader& in, factdb::Request& request){
+    switch(request.opcode){
+        case factdb::Opcode::GET:
+        case factdb::Opcode::REMOVE:
+            request.partition_key = in.read_string();
+            request.cluster_key = in.read_string();
+            break;
+        case factdb::Opcode::PUT:
+            request.partition_key = in.read_string();
+            request.cluster_key = in.read_string();
+            request.columns = read_columns(in);
+            break;
+        case factdb::Opcode::SCAN:
+            request.partition_key = in.read_string();
+            request.cluster_key = in.read_string();
+            request.end_key = in.read_string();
+            request.limit = in.read_int<uint32_t>();
+            break;
+        case factdb::Opcode::BATCH: {
+            uint32_t count = in.read_int<uint32_t>();
+            for(uint32_t i = 0; i < count; i++){
+                factdb::Request mutation;
+                mutation.stream = request.stream;
+                mutation.opcode = static_cast<factdb::Opcode>(in.read_int<uint8_t>());
+                if(mutation.opcode != factdb::Opcode::PUT && mutation.opcode != factdb::Opcode::REMOVE){
+                    throw std::runtime_error("BATCH only carries PUT and REMOVE");
+                }
+                read_request_body(in, mutation);
+                request.batch.push_back(std::move(mutation));
+            }
+            break;
+        }
+        case factdb::Opcode::MERKLE:
+        case factdb::Opcode::STREAM:
+        case factdb::Opcode::INGEST:
+            request.payload = in.read_string();
+            break;
+        default:
+            throw std::runtime_error("Unknown opcode " + std::to_string(static_cast<int>(request.opcode)));
+    }
+}
+}
+
+size_t factdb::protocol_frame_size(const char* data, size_t available){
+    if(available < PROTOCOL_HEADER_SIZE){
+        return 0;
+    }
+    uint32_t body;
+    std::memcpy(&body, data, sizeof(body));
+    if(body > PROTOCOL_MAX_BODY){
+        throw std::runtime_error("Frame body of " + std::to_string(body) + " bytes exceeds the limit");
+    }
+    return available >= PROTOCOL_HEADER_SIZE + body ? PROTOCOL_HEADER_SIZE + body : 0;
+}
+std::string factdb::encode_request(const Request& request){
+    std::string out;
+    uint8_t consistency = static_cast<uint8_t>(request.consistency) | (request.trace ? PROTOCOL_TRACE_FLAG : 0);
+    write_header(out, request.stream, static_cast<uint8_t>(request.opcode), consistency);
+    write_request_body(out, request);
+    finish_frame(out);
+    return out;
+}
+factdb::Request factdb::decode_request(const char* frame, size_t length){
+    ByteReader in(frame, length);
+    in.skip(sizeof(uint32_t));
+    Request request;
+    request.stream = in.read_int<uint16_t>();
+    request.opcode = static_cast<Opcode>(in.read_int<uint8_t>());
+    uint8_t consistency = in.read_int<uint8_t>();
+    request.trace = (consistency & PROTOCOL_TRACE_FLAG) != 0;
+    request.consistency = static_cast<ConsistencyLevel>(consistency & ~PROTOCOL_TRACE_FLAG);
+    if(request.consistency > ConsistencyLevel::ALL){
+        throw std::runtime_error("Unknown consistency level");
+    }
+    read_request_body(in, request);
+    return request;
+}
+std::string factdb::encode_response(const Response& response){
+    std::string out;
+    write_header(out, response.stream, static_cast<uint8_t>(response.status), 0);
+    if(response.status == Status::ERROR){
+        append_bytes(out, response.message);
+    }else{
+        append_int<uint32_t>(out, static_cast<uint32_t>(response.rows.size()));
+        for(const auto& row : response.rows){
+            append_bytes(out, row.cluster_key);
+            write_columns(out, row.columns);
+        }
+        append_bytes(out, response.payload);
+    }
+    finish_frame(out);
+    return out;
+}
+factdb::Response factdb::decode_response(const char* frame, size_t length){
+    ByteReader in(frame, length);
+    in.skip(sizeof(uint32_t));
+    Response response;
+    response.stream = in.read_int<uint16_t>();
+    response.status = static_cast<Status>(in.read_int<uint8_t>());
+    in.skip(sizeof(uint8_t));
+    if(response.status == Status::ERROR){
+        response.message = in.read_string();
+    }else{
+        response.rows.resize(in.read_count(2 * sizeof(uint32_t))); // an empty key and no columns
+        for(auto& row : response.rows){
+            row.cluster_key = in.read_string();
+            row.columns = read_columns(in);
+        }
+        response.payload = in.read_string();
+    }
+    return response;
+}
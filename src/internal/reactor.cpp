@@ -0,0 +1,155 @@
+#include <runtime/reactor.hpp>
+
+#include <boost/asio/post.hpp>
+#include <boost/asio/steady_timer.hpp>
+
+#include <pthread.h>
+#include <sched.h>
+
+namespace {
+thread_local size_t current_shard = factdb::Reactor::NO_SHARD;
+
+void pin_to_cpu(std::thread& thread, size_t cpu){
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    pthread_setaffinity_np(thread.native_handle(), sizeof(set), &set); // best effort, e.g. inside a restricted cpuset
+}
+}
+
+factdb::Reactor::Reactor(ReactorOptions options){
+    size_t cpus = std::max<unsigned>(1, std::thread::hardware_concurrency());
+    size_t count = options.shards == 0 ? cpus : options.shards;
+    for(size_t i = 0; i < count; i++){
+        auto shard = std::make_unique<Shard>();
+        for(size_t source = 0; source < count; source++){
+            shard->inbound.push_back(std::make_unique<Inbound>(options.queue_capacity));
+        }
+        shards_.push_back(std::move(shard));
+    }
+    for(size_t i = 0; i < count; i++){
+        Shard& shard = *shards_[i];
+        shard.thread = std::thread([&shard, i]{
+            current_shard = i;
+            shard.io.run();
+        });
+        if(options.pin_threads){
+            pin_to_cpu(shard.thread, i % cpus);
+        }
+    }
+}
+factdb::Reactor::~Reactor(){
+    stop();
+}
+void factdb::Reactor::stop(){
+    if(stopped_.exchange(true)){
+        return;
+    }
+    for(auto& shard : shards_){
+        shard->work.reset();
+        shard->io.stop();
+    }
+    for(auto& shard : shards_){
+        if(shard->thread.joinable()){
+            shard->thread.join();
+        }
+    }
+    for(auto& shard : shards_){
+        for(auto& inbound : shard->inbound){
+            inbound->ring.consume_all([](Task* task){ delete task; });
+            for(Task* task : inbound->overflow){
+                delete task;
+            }
+            inbound->overflow.clear();
+        }
+    }
+}
+size_t factdb::Reactor::this_shard(){
+    return current_shard;
+}
+void factdb::Reactor::send(size_t shard, Task task){
+    Shard& target = *shards_.at(shard);
+    size_t source = current_shard;
+    if(source == NO_SHARD || source >= shards_.size()){
+        target.external++;
+        boost::asio::post(target.io, std::move(task));
+        return;
+    }
+    Task* message = new Task(std::move(task));
+    Inbound& inbound = *target.inbound[source];
+    // only the target clears overflowing, so while it is set the ring must
+    // not take messages that would overtake the ones waiting in the list
+    if(inbound.overflowing.load(std::memory_order_acquire) || !inbound.ring.push(message)){
+        target.overflows++;
+        std::lock_guard<std::mutex> guard(inbound.overflow_mutex);
+        inbound.overflow.push_back(message);
+        inbound.overflowing.store(true, std::memory_order_release);
+    }
+    wake_(target);
+}
+void factdb::Reactor::wake_(Shard& target){
+    // the drain handler clears the flag before it pops, so a push that finds
+    // the flag set is always seen by the drain already queued
+    if(!target.wakeup_pending.exchange(true)){
+        target.wakeups++;
+        boost::asio::post(target.io, [this, &target]{ drain_(target); });
+    }
+}
+void factdb::Reactor::drain_(Shard& shard){
+    shard.wakeup_pending.store(false);
+    auto run = [&shard](Task* task){
+        shard.messages.fetch_add(1, std::memory_order_relaxed);
+        (*task)();
+        delete task;
+    };
+    for(auto& inbound : shard.inbound){
+        // read before the ring: once set, every message pushed ahead of the
+        // overflow is visible in the ring and runs first
+        bool overflowing = inbound->overflowing.load(std::memory_order_acquire);
+        inbound->ring.consume_all(run);
+        if(overflowing){
+            std::deque<Task*> overflow;
+            {
+                std::lock_guard<std::mutex> guard(inbound->overflow_mutex);
+                overflow.swap(inbound->overflow);
+                inbound->overflowing.store(false, std::memory_order_release);
+            }
+            for(Task* task : overflow){
+                run(task);
+            }
+        }
+    }
+}
+factdb::Future<bool> factdb::Reactor::sleep(std::chrono::steady_clock::duration delay){
+    size_t shard = this_shard();
+    if(shard == NO_SHARD){
+        throw std::logic_error("sleep called outside the reactor");
+    }
+    Promise<bool> promise;
+    auto result = promise.get_future();
+    auto timer = std::make_shared<boost::asio::steady_timer>(shards_[shard]->io, delay);
+    timer->async_wait([timer, promise](const boost::system::error_code& error) mutable {
+        promise.set_value(!error);
+    });
+    return result;
+}
+void factdb::Reactor::schedule_after(size_t shard, std::chrono::steady_clock::duration delay, Task task){
+    send(shard, [this, delay, task]{
+        sleep(delay).then([task](bool fired){
+            if(fired){
+                task();
+            }
+            return fired;
+        });
+    });
+}
+factdb::ReactorStats factdb::Reactor::stats() const{
+    ReactorStats stats;
+    for(const auto& shard : shards_){
+        stats.messages += shard->messages.load();
+        stats.overflows += shard->overflows.load();
+        stats.wakeups += shard->wakeups.load();
+        stats.external += shard->external.load();
+    }
+    return stats;
+}
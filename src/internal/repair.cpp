@@ -0,0 +1,397 @@
+#include <cluster/repair.hpp>
+#include <internal/encoding.hpp>
+#include <net/peer_connection.hpp>
+
+#include <map>
+#include <stdexcept>
+
+// Repair payloads:
+//   MERKLE request   u32 depth, u32 range count, (i64 start, i64 end)...
+//   MERKLE response  per range u32 leaf count, u64 leaf hashes...
+//   STREAM request   u32 range count, (i64 start, i64 end)...
+//   STREAM response  SSTable section of the partitions in those ranges
+//   INGEST request   SSTable section to write as a new generation
+
+namespace {
+void write_ranges(std::string& out, const std::vector<factdb::TokenRange>& ranges){
+    factdb::append_int<uint32_t>(out, static_cast<uint32_t>(ranges.size()));
+    for(const auto& range : ranges){
+        factdb::append_int<int64_t>(out, range.start);
+        factdb::append_int<int64_t>(out, range.end);
+    }
+}
+std::vector<factdb::TokenRange> read_ranges(factdb::ByteReader& in){
+    std::vector<factdb::TokenRange> ranges(in.read_count(2 * sizeof(int64_t)));
+    for(auto& range : ranges){
+        range.start = in.read_int<int64_t>();
+        range.end = in.read_int<int64_t>();
+    }
+    return ranges;
+}
+// index of the first range holding `token`, or ranges.size()
+size_t range_of(const std::vector<factdb::TokenRange>& ranges, factdb::Token token){
+    for(size_t i = 0; i < ranges.size(); i++){
+        if(ranges[i].contains(token)){
+            return i;
+        }
+    }
+    return ranges.size();
+}
+factdb::Token partition_token(const factdb::Partition& partition){
+    return factdb::murmur3_token(partition.header_.key_.data(), partition.header_.key_.size());
+}
+std::vector<factdb::MerkleTree> build_trees(const std::vector<std::shared_ptr<factdb::Partition>>& partitions,
+                                            const std::vector<factdb::TokenRange>& ranges, size_t depth){
+    std::vector<factdb::MerkleTree> trees;
+    for(const auto& range : ranges){
+        trees.emplace_back(range, depth);
+    }
+    for(const auto& partition : partitions){
+        factdb::Token token = partition_token(*partition);
+        size_t i = range_of(ranges, token);
+        if(i == ranges.size()){
+            continue;
+        }
+        for(const auto& unfiltered : partition->unfiltereds_){
+            trees[i].add(token, factdb::row_digest(partition->header_.key_, *std::static_pointer_cast<factdb::Row>(unfiltered)));
+        }
+    }
+    return trees;
+}
+void append_row(std::vector<std::shared_ptr<factdb::Partition>>& partitions, const std::vector<char>& key, std::shared_ptr<factdb::Row> row){
+    if(partitions.empty() || partitions.back()->header_.key_ != key){
+        auto partition = std::make_shared<factdb::Partition>();
+        partition->header_.key_ = key;
+        partition->header_.key_length_ = key.size();
+        partitions.push_back(partition);
+    }
+    partitions.back()->unfiltereds_.push_back(std::move(row));
+}
+factdb::Response ok_response(uint16_t stream, std::string payload){
+    factdb::Response response;
+    response.stream = stream;
+    response.payload = std::move(payload);
+    return response;
+}
+void expect_ok(const factdb::Response& response, const char* step){
+    if(response.status != factdb::Status::OK){
+        throw std::runtime_error(std::string(step) + " failed on the peer: " + response.message);
+    }
+}
+
+struct RepairSession {
+    factdb::ShardedTable& table;
+    std::shared_ptr<factdb::PeerConnection> peer;
+    std::vector<factdb::TokenRange> ranges;
+    size_t depth;
+    factdb::RepairResult result;
+    std::vector<std::shared_ptr<factdb::Partition>> local;
+    std::vector<std::vector<bool>> mismatched;   // per range, per leaf
+    std::vector<factdb::TokenRange> stream_ranges;
+    std::vector<factdb::MerkleTree> trees;
+    std::vector<std::shared_ptr<factdb::Partition>> to_peer;
+
+    bool needs_repair(factdb::Token token) const{
+        size_t i = range_of(ranges, token);
+        return i < ranges.size() && mismatched[i][trees[i].leaf_of(token)];
+    }
+};
+
+factdb::Future<factdb::Response> send(RepairSession& session, factdb::Opcode opcode, std::string payload){
+    factdb::Request request;
+    request.opcode = opcode;
+    request.payload = std::move(payload);
+    return session.peer->send(std::move(request));
+}
+}
+
+uint64_t factdb::row_digest(const std::vector<char>& partition_key, const Row& row){
+    std::string key;
+    append_bytes(key, partition_key);
+    append_bytes(key, row_clustering_key(row));
+    append_int<uint8_t>(key, row_is_deleted(row) ? 1 : 0);
+    uint64_t digest = static_cast<uint64_t>(murmur3_token(key));
+    std::string cell_bytes;
+    for(const auto& cell : row.cells_){
+        cell_bytes.clear();
+        append_bytes(cell_bytes, cell.value_.key_);
+        append_bytes(cell_bytes, cell.value_.value_);
+        digest += static_cast<uint64_t>(murmur3_token(cell_bytes));
+    }
+    return digest;
+}
+
+factdb::MerkleTree::MerkleTree(TokenRange range, size_t depth)
+    : range_(range), depth_(std::min(depth, MERKLE_MAX_DEPTH)){
+    while(depth_ > 0 && leaf_count() > width_()){ // every leaf must cover at least one token
+        depth_--;
+    }
+    leaves_.assign(leaf_count(), 0);
+}
+unsigned __int128 factdb::MerkleTree::width_() const{
+    if(range_.start == range_.end){
+        return static_cast<unsigned __int128>(1) << 64;
+    }
+    return static_cast<uint64_t>(range_.end) - static_cast<uint64_t>(range_.start);
+}
+size_t factdb::MerkleTree::leaf_of(Token token) const{
+    unsigned __int128 offset = static_cast<uint64_t>(token) - static_cast<uint64_t>(range_.start);
+    if(offset == 0){ // the range is (start, end], so start itself is the last token of a full ring
+        offset = width_();
+    }
+    return static_cast<size_t>((offset * leaf_count() - 1) / width_());
+}
+factdb::TokenRange factdb::MerkleTree::leaf_range(size_t leaf) const{
+    auto boundary = [this](size_t i){
+        uint64_t offset = static_cast<uint64_t>(width_() * i / leaf_count());
+        return static_cast<Token>(static_cast<uint64_t>(range_.start) + offset);
+    };
+    return TokenRange{boundary(leaf), boundary(leaf + 1)};
+}
+void factdb::MerkleTree::add(Token token, uint64_t digest){
+    leaves_[leaf_of(token)] ^= digest;
+    dirty_ = true;
+}
+void factdb::MerkleTree::set_leaves(std::vector<uint64_t> leaves){
+    if(leaves.size() != leaf_count()){
+        throw std::invalid_argument("expected " + std::to_string(leaf_count()) + " leaves, got " + std::to_string(leaves.size()));
+    }
+    leaves_ = std::move(leaves);
+    dirty_ = true;
+}
+void factdb::MerkleTree::rehash_() const{
+    if(!dirty_){
+        return;
+    }
+    inner_.assign(leaf_count() - 1, 0);
+    for(size_t i = inner_.size(); i-- > 0;){
+        uint64_t children[2] = {node_(2 * i + 1), node_(2 * i + 2)};
+        inner_[i] = static_cast<uint64_t>(murmur3_token(reinterpret_cast<const char*>(children), sizeof(children)));
+    }
+    dirty_ = false;
+}
+uint64_t factdb::MerkleTree::node_(size_t index) const{
+    return index < inner_.size() ? inner_[index] : leaves_[index - inner_.size()];
+}
+uint64_t factdb::MerkleTree::root() const{
+    rehash_();
+    return node_(0);
+}
+std::vector<size_t> factdb::MerkleTree::difference(const MerkleTree& other) const{
+    if(depth_ != other.depth_ || range_.start != other.range_.start || range_.end != other.range_.end){
+        throw std::invalid_argument("Merkle trees cover different ranges");
+    }
+    rehash_();
+    other.rehash_();
+    std::vector<size_t> leaves;
+    std::vector<size_t> pending{0};
+    while(!pending.empty()){
+        size_t index = pending.back();
+        pending.pop_back();
+        if(node_(index) == other.node_(index)){
+            continue;
+        }
+        if(index >= inner_.size()){
+            leaves.push_back(index - inner_.size());
+        }else{
+            pending.push_back(2 * index + 2);
+            pending.push_back(2 * index + 1);
+        }
+    }
+    return leaves;
+}
+
+factdb::Future<factdb::Response> factdb::handle_repair_request(ShardedTable& table, const Request& request){
+    uint16_t stream = request.stream;
+    ByteReader in(request.payload);
+    switch(request.opcode){
+        case Opcode::MERKLE: {
+            size_t depth = in.read_int<uint32_t>();
+            auto ranges = read_ranges(in);
+            return table.merged_partitions().then([stream, depth, ranges](std::vector<std::shared_ptr<Partition>> partitions){
+                std::string payload;
+                for(const auto& tree : build_trees(partitions, ranges, depth)){
+                    append_int<uint32_t>(payload, static_cast<uint32_t>(tree.leaf_count()));
+                    for(uint64_t leaf : tree.leaves()){
+                        append_int<uint64_t>(payload, leaf);
+                    }
+                }
+                return ok_response(stream, std::move(payload));
+            });
+        }
+        case Opcode::STREAM: {
+            auto ranges = read_ranges(in);
+            return table.merged_partitions().then([stream, ranges](std::vector<std::shared_ptr<Partition>> partitions){
+                std::vector<std::shared_ptr<Partition>> selected;
+                for(auto& partition : partitions){
+                    if(range_of(ranges, partition_token(*partition)) < ranges.size()){
+                        selected.push_back(std::move(partition));
+                    }
+                }
+                std::string section = encode_sstable_section(selected);
+                if(section.size() + 1024 > PROTOCOL_MAX_BODY){
+                    throw std::runtime_error("section of " + std::to_string(section.size()) + " bytes exceeds a frame, repair smaller ranges");
+                }
+                return ok_response(stream, std::move(section));
+            });
+        }
+        case Opcode::INGEST:
+            return table.ingest(decode_sstable_section(request.payload.data(), request.payload.size()))
+                .then([stream](bool){ return ok_response(stream, std::string()); });
+        default:
+            throw std::invalid_argument("not a repair opcode");
+    }
+}
+
+factdb::Future<factdb::RepairResult> factdb::repair(Reactor& reactor, ShardedTable& table, const NodeEndpoint& peer,
+                                                   std::vector<TokenRange> ranges, RepairOptions options){
+    size_t shard = Reactor::this_shard();
+    if(shard == Reactor::NO_SHARD){
+        throw std::logic_error("repair called outside the reactor");
+    }
+    auto session = std::make_shared<RepairSession>(RepairSession{
+        table, std::make_shared<PeerConnection>(reactor.io_context(shard), peer.host, peer.port, options.timeout), std::move(ranges), options.depth,
+        {}, {}, {}, {}, {}, {}});
+    session->result.ranges = session->ranges.size();
+
+    auto repaired = table.merged_partitions().then([session](std::vector<std::shared_ptr<Partition>> partitions){
+        session->local = std::move(partitions);
+        session->result.dataset_bytes = encode_sstable_section(session->local).size();
+        session->trees = build_trees(session->local, session->ranges, session->depth);
+        std::string payload;
+        append_int<uint32_t>(payload, static_cast<uint32_t>(session->depth));
+        write_ranges(payload, session->ranges);
+        return send(*session, Opcode::MERKLE, std::move(payload));
+    }).then([session](Response response){
+        expect_ok(response, "MERKLE");
+        session->result.tree_bytes = response.payload.size();
+        ByteReader in(response.payload);
+        for(auto& local_tree : session->trees){
+            MerkleTree remote_tree(local_tree.range(), local_tree.depth());
+            std::vector<uint64_t> leaves(in.read_count(sizeof(uint64_t)));
+            for(auto& leaf : leaves){
+                leaf = in.read_int<uint64_t>();
+            }
+            remote_tree.set_leaves(std::move(leaves));
+            session->result.leaves += local_tree.leaf_count();
+            std::vector<bool> mismatched(local_tree.leaf_count(), false);
+            for(size_t leaf : local_tree.difference(remote_tree)){
+                mismatched[leaf] = true;
+                session->result.mismatched_leaves++;
+            }
+            for(size_t leaf = 0; leaf < mismatched.size(); leaf++){ // adjacent leaves stream as one range
+                if(!mismatched[leaf]){
+                    continue;
+                }
+                size_t last = leaf;
+                while(last + 1 < mismatched.size() && mismatched[last + 1]){
+                    last++;
+                }
+                session->stream_ranges.push_back(TokenRange{local_tree.leaf_range(leaf).start, local_tree.leaf_range(last).end});
+                leaf = last;
+            }
+            session->mismatched.push_back(std::move(mismatched));
+        }
+        if(session->stream_ranges.empty()){
+            return make_ready_future(Response());
+        }
+        std::string payload;
+        write_ranges(payload, session->stream_ranges);
+        return send(*session, Opcode::STREAM, std::move(payload));
+    }).then([session](Response response){
+        expect_ok(response, "STREAM");
+        if(session->stream_ranges.empty()){
+            return make_ready_future(true);
+        }
+        session->result.received_bytes = response.payload.size();
+        auto remote = decode_sstable_section(response.payload.data(), response.payload.size());
+
+        struct Versions {
+            std::vector<char> partition_key;
+            std::shared_ptr<Row> local;
+            std::shared_ptr<Row> remote;
+        };
+        std::map<std::pair<std::string, std::string>, Versions> rows; // byte order, like the SSTables
+        auto collect = [&](const std::vector<std::shared_ptr<Partition>>& partitions, bool is_local){
+            for(const auto& partition : partitions){
+                if(is_local && !session->needs_repair(partition_token(*partition))){
+                    continue;
+                }
+                const auto& key = partition->header_.key_;
+                for(const auto& unfiltered : partition->unfiltereds_){
+                    auto row = std::static_pointer_cast<Row>(unfiltered);
+                    const auto& cluster_key = row_clustering_key(*row);
+                    Versions& versions = rows[{std::string(key.begin(), key.end()), std::string(cluster_key.begin(), cluster_key.end())}];
+                    versions.partition_key = key;
+                    (is_local ? versions.local : versions.remote) = row;
+                }
+            }
+        };
+        collect(session->local, true);
+        collect(remote, false);
+
+        std::vector<std::shared_ptr<Partition>> to_local;
+        for(auto& [key, versions] : rows){
+            if(!versions.remote){
+                append_row(session->to_peer, versions.partition_key, versions.local);
+                continue;
+            }
+            if(!versions.local){
+                append_row(to_local, versions.partition_key, versions.remote);
+                continue;
+            }
+            uint64_t local_digest = row_digest(versions.partition_key, *versions.local);
+            uint64_t remote_digest = row_digest(versions.partition_key, *versions.remote);
+            if(local_digest == remote_digest){
+                continue;
+            }
+            std::shared_ptr<Row> reconciled;
+            if(row_is_deleted(*versions.local)){
+                reconciled = versions.local;
+            }else if(row_is_deleted(*versions.remote)){
+                reconciled = versions.remote;
+            }else{
+                reconciled = std::make_shared<Row>(*versions.remote);
+                merge_older_cells(*reconciled, *versions.local);
+            }
+            uint64_t reconciled_digest = row_digest(versions.partition_key, *reconciled);
+            if(reconciled_digest != local_digest){
+                append_row(to_local, versions.partition_key, reconciled);
+            }
+            if(reconciled_digest != remote_digest){
+                append_row(session->to_peer, versions.partition_key, reconciled);
+            }
+        }
+        for(const auto& partition : to_local){
+            session->result.rows_received += partition->unfiltereds_.size();
+        }
+        if(to_local.empty()){
+            return make_ready_future(true);
+        }
+        return session->table.ingest(std::move(to_local));
+    }).then([session](bool){
+        if(session->to_peer.empty()){
+            return make_ready_future(Response());
+        }
+        for(const auto& partition : session->to_peer){
+            session->result.rows_sent += partition->unfiltereds_.size();
+        }
+        std::string section = encode_sstable_section(session->to_peer);
+        session->result.sent_bytes = section.size();
+        return send(*session, Opcode::INGEST, std::move(section));
+    }).then([session](Response response){
+        expect_ok(response, "INGEST");
+        return session->result;
+    });
+    Promise<RepairResult> done;
+    auto result = done.get_future();
+    repaired.on_ready([repaired, session, done]() mutable {
+        session->peer->close(); // its read loop would otherwise keep it alive
+        if(repaired.failed()){
+            done.set_exception(repaired.error());
+        }else{
+            done.set_value(std::move(repaired.value()));
+        }
+    });
+    return result;
+}
@@ -0,0 +1,149 @@
+#include <data/schema_registry.hpp>
+
+#include <boost/crc.hpp>
+
+#include <filesystem>
+#include <stdexcept>
+
+#include <unistd.h>
+
+namespace {
+uint32_t crc32(const char* data, size_t length){
+    boost::crc_32_type crc;
+    crc.process_bytes(data, length);
+    return crc.checksum();
+}
+}
+
+void factdb::ColumnBitmap::serialize(std::string& out) const{
+    size_t words = 1 + rest_.size();
+    while(words > 0 && word_(words - 1) == 0){
+        words--;
+    }
+    size_t bytes = words * 8;
+    while(bytes > 0 && ((word_((bytes - 1) / 8) >> ((bytes - 1) % 8 * 8)) & 0xFF) == 0){
+        bytes--;
+    }
+    append_int<uint16_t>(out, static_cast<uint16_t>(bytes));
+    for(size_t b = 0; b < bytes; b++){
+        out.push_back(static_cast<char>(word_(b / 8) >> (b % 8 * 8)));
+    }
+}
+factdb::ColumnId factdb::ColumnDictionary::add(std::string_view name){
+    auto it = ids_.find(name);
+    if(it != ids_.end()){
+        return it->second;
+    }
+    if(names_.size() >= MAX_COLUMNS){
+        throw std::length_error("Too many columns");
+    }
+    auto id = static_cast<ColumnId>(names_.size());
+    names_.emplace_back(name);
+    ids_.emplace(names_.back(), id);
+    return id;
+}
+void factdb::ColumnDictionary::add_partitions(const std::vector<std::shared_ptr<Partition>>& partitions){
+    for(const auto& partition : partitions){
+        for(const auto& unfiltered : partition->unfiltereds_){
+            for(const auto& cell : static_cast<const Row&>(*unfiltered).cells_){
+                add(std::string_view(cell.value_.key_.data(), cell.value_.key_.size()));
+            }
+        }
+    }
+}
+void factdb::ColumnDictionary::serialize(std::string& out) const{
+    append_int<uint32_t>(out, schema_version_);
+    append_int<uint32_t>(out, static_cast<uint32_t>(names_.size()));
+    for(const auto& name : names_){
+        append_int<uint16_t>(out, static_cast<uint16_t>(name.size()));
+        out.append(name);
+    }
+}
+factdb::ColumnDictionary factdb::ColumnDictionary::deserialize(ByteReader& in){
+    ColumnDictionary dictionary;
+    dictionary.schema_version_ = in.read_int<uint32_t>();
+    uint32_t count = in.read_int<uint32_t>();
+    if(count > MAX_COLUMNS){
+        throw std::runtime_error("Column dictionary is too large");
+    }
+    for(uint32_t c = 0; c < count; c++){
+        uint16_t length = in.read_int<uint16_t>();
+        const char* name = in.position();
+        in.skip(length);
+        if(dictionary.add(std::string_view(name, length)) != c){
+            throw std::runtime_error("Column dictionary repeats a name");
+        }
+    }
+    return dictionary;
+}
+
+bool factdb::SchemaRegistry::load(){
+    if(path_.empty() || !std::filesystem::exists(path_)){
+        return false;
+    }
+    std::string contents;
+    if(!read_file(io_engine_, path_, contents)){
+        throw std::runtime_error("Failed to read schema " + path_);
+    }
+    if(contents.size() < sizeof(uint32_t)){
+        throw std::runtime_error("Corrupt schema " + path_);
+    }
+    size_t body = contents.size() - sizeof(uint32_t);
+    if(ByteReader(contents.data() + body, sizeof(uint32_t)).read_int<uint32_t>() != crc32(contents.data(), body)){
+        throw std::runtime_error("Corrupt schema " + path_);
+    }
+    ByteReader in(contents.data(), body);
+    if(in.read_int<uint32_t>() != SCHEMA_MAGIC){
+        throw std::runtime_error("Unknown schema format " + path_);
+    }
+    ColumnDictionary columns = ColumnDictionary::deserialize(in);
+    std::lock_guard<std::mutex> guard(mutex_);
+    columns_ = std::move(columns);
+    saved_ = columns_.size();
+    return true;
+}
+bool factdb::SchemaRegistry::save(){
+    std::string contents;
+    size_t count;
+    {
+        std::lock_guard<std::mutex> guard(mutex_);
+        if(path_.empty() || (saved_ == columns_.size() && std::filesystem::exists(path_))){
+            return true;
+        }
+        count = columns_.size();
+        append_int<uint32_t>(contents, SCHEMA_MAGIC);
+        ColumnDictionary snapshot = columns_;
+        snapshot.schema_version_ = static_cast<uint32_t>(count);
+        snapshot.serialize(contents);
+    }
+    append_int<uint32_t>(contents, crc32(contents.data(), contents.size()));
+    std::string tmp_path = path_ + ".tmp";
+    if(!write_file(io_engine_, tmp_path, contents.data(), contents.size(), true) || ::rename(tmp_path.c_str(), path_.c_str()) != 0){
+        return false;
+    }
+    std::lock_guard<std::mutex> guard(mutex_);
+    saved_ = std::max(saved_, count);
+    return true;
+}
+factdb::ColumnId factdb::SchemaRegistry::intern(std::string_view name){
+    std::lock_guard<std::mutex> guard(mutex_);
+    return columns_.add(name);
+}
+std::optional<factdb::ColumnId> factdb::SchemaRegistry::find(std::string_view name) const{
+    std::lock_guard<std::mutex> guard(mutex_);
+    return columns_.find(name);
+}
+std::string factdb::SchemaRegistry::name(ColumnId id) const{
+    std::lock_guard<std::mutex> guard(mutex_);
+    return columns_.name(id);
+}
+uint32_t factdb::SchemaRegistry::version() const{
+    std::lock_guard<std::mutex> guard(mutex_);
+    return static_cast<uint32_t>(columns_.size());
+}
+factdb::ColumnDictionary factdb::SchemaRegistry::snapshot() const{
+    std::lock_guard<std::mutex> guard(mutex_);
+    ColumnDictionary columns = columns_;
+    columns.schema_version_ = static_cast<uint32_t>(columns.size());
+    return columns;
+}
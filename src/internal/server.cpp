@@ -0,0 +1,310 @@
+#include <net/server.hpp>
+#include <cluster/repair.hpp>
+#include <metrics/tracing.hpp>
+
+#include <boost/asio/buffer.hpp>
+#include <boost/asio/write.hpp>
+
+#include <cstring>
+#include <deque>
+#include <future>
+
+namespace {
+factdb::MemtableRows to_memtable_rows(const std::vector<factdb::WireColumn>& columns){
+    auto row = std::make_shared<factdb::MemtableRow>();
+    for(const auto& column : columns){
+        row->addcol_(std::make_shared<factdb::MemtableColumn>(column.name, factdb::ColumnType::STRING, column.value));
+    }
+    return std::make_shared<std::vector<std::shared_ptr<factdb::MemtableRow>>>(1, row);
+}
+factdb::WireRow to_wire_row(const factdb::Row& row){
+    factdb::WireRow wire;
+    const auto& cluster_key = factdb::row_clustering_key(row);
+    wire.cluster_key.assign(cluster_key.begin(), cluster_key.end());
+    for(const auto& cell : row.cells_){
+        wire.columns.push_back(factdb::WireColumn{std::string(cell.value_.key_.begin(), cell.value_.key_.end()),
+                                                  std::string(cell.value_.value_.begin(), cell.value_.value_.end())});
+    }
+    return wire;
+}
+const char* request_name(factdb::Opcode opcode){
+    switch(opcode){
+        case factdb::Opcode::GET: return "GET";
+        case factdb::Opcode::PUT: return "PUT";
+        case factdb::Opcode::REMOVE: return "REMOVE";
+        case factdb::Opcode::SCAN: return "SCAN";
+        case factdb::Opcode::BATCH: return "BATCH";
+        case factdb::Opcode::MERKLE: return "MERKLE";
+        case factdb::Opcode::STREAM: return "STREAM";
+        case factdb::Opcode::INGEST: return "INGEST";
+    }
+    return "UNKNOWN";
+}
+factdb::Response error_response(uint16_t stream, const std::string& message){
+    factdb::Response response;
+    response.stream = stream;
+    response.status = factdb::Status::ERROR;
+    response.message = message;
+    return response;
+}
+}
+
+class factdb::Server::Connection : public std::enable_shared_from_this<factdb::Server::Connection> {
+public:
+    Connection(Server& server, boost::asio::ip::tcp::socket socket)
+        : server_(server), socket_(std::move(socket)), buffer_(64 * 1024), buffered_(0) {}
+
+    void start(){
+        socket_.set_option(boost::asio::ip::tcp::no_delay(true));
+        read_();
+    }
+
+private:
+    Server& server_;
+    boost::asio::ip::tcp::socket socket_;
+    std::vector<char> buffer_;
+    size_t buffered_;
+    size_t in_flight_ = 0;
+    bool reading_ = false;
+    bool closed_ = false;
+    std::deque<std::string> pending_;   // encoded responses waiting for the next write
+    std::vector<std::string> writing_;  // owned by the write in flight
+    bool writing_active_ = false;
+
+    void read_(){
+        if(closed_ || reading_ || in_flight_ >= server_.options_.max_in_flight_per_connection){
+            return;
+        }
+        if(buffered_ == buffer_.size()){
+            buffer_.resize(buffer_.size() * 2);
+        }
+        reading_ = true;
+        auto self = shared_from_this();
+        socket_.async_read_some(boost::asio::buffer(buffer_.data() + buffered_, buffer_.size() - buffered_),
+            [self](const boost::system::error_code& error, size_t bytes){
+                if(error){
+                    self->reading_ = false;
+                    self->close_();
+                    return;
+                }
+                self->buffered_ += bytes;
+                self->dispatch_frames_(); // responses completing inline must not start a read into buffer_ yet
+                self->reading_ = false;
+                self->read_();
+            });
+    }
+    void dispatch_frames_(){
+        size_t offset = 0;
+        try{
+            while(size_t frame = protocol_frame_size(buffer_.data() + offset, buffered_ - offset)){
+                Request request = decode_request(buffer_.data() + offset, frame);
+                offset += frame;
+                dispatch_(std::move(request));
+            }
+            if(offset < buffered_ && buffered_ - offset >= PROTOCOL_HEADER_SIZE){
+                uint32_t body;
+                std::memcpy(&body, buffer_.data() + offset, sizeof(body));
+                if(PROTOCOL_HEADER_SIZE + body > buffer_.size()){
+                    buffer_.resize(PROTOCOL_HEADER_SIZE + body);
+                }
+            }
+        }catch(const std::exception&){
+            server_.errors_++;
+            close_(); // a malformed frame leaves the stream unsynchronized
+            return;
+        }
+        std::memmove(buffer_.data(), buffer_.data() + offset, buffered_ - offset);
+        buffered_ -= offset;
+    }
+    void dispatch_(Request request){
+        in_flight_++;
+        server_.requests_++;
+        auto self = shared_from_this();
+        uint16_t stream = request.stream;
+        auto response = server_.route_(request);
+        response.on_ready([self, response, stream]() mutable {
+            self->in_flight_--;
+            if(response.failed()){
+                self->server_.errors_++;
+                std::string message = "request failed";
+                try{
+                    std::rethrow_exception(response.error());
+                }catch(const std::exception& error){
+                    message = error.what();
+                }catch(...){}
+                self->respond_(error_response(stream, message));
+            }else{
+                self->respond_(response.value());
+            }
+            self->read_();
+        });
+    }
+    void respond_(const Response& response){
+        if(closed_){
+            return;
+        }
+        pending_.push_back(encode_response(response));
+        write_();
+    }
+    void write_(){
+        if(writing_active_ || pending_.empty()){
+            return;
+        }
+        writing_.clear();
+        while(!pending_.empty()){
+            writing_.push_back(std::move(pending_.front()));
+            pending_.pop_front();
+        }
+        std::vector<boost::asio::const_buffer> buffers; // built once writing_ stops moving its strings
+        buffers.reserve(writing_.size());
+        for(const auto& frame : writing_){
+            buffers.emplace_back(boost::asio::buffer(frame));
+        }
+        writing_active_ = true;
+        auto self = shared_from_this();
+        boost::asio::async_write(socket_, buffers, [self](const boost::system::error_code& error, size_t){
+            self->writing_active_ = false;
+            if(error){
+                self->close_();
+                return;
+            }
+            self->write_();
+        });
+    }
+    void close_(){
+        if(closed_){
+            return;
+        }
+        closed_ = true;
+        boost::system::error_code ignored;
+        socket_.shutdown(boost::asio::ip::tcp::socket::shutdown_both, ignored);
+        socket_.close(ignored);
+    }
+};
+
+factdb::Server::Server(Reactor& reactor, ShardedTable& table, ServerOptions options)
+    : reactor_(reactor), table_(table), options_(std::move(options)){}
+factdb::Server::~Server(){
+    stop();
+}
+void factdb::Server::start(){
+    using boost::asio::ip::tcp;
+    std::promise<uint16_t> bound;
+    auto port = bound.get_future();
+    reactor_.send(0, [this, &bound]{
+        try{
+            tcp::endpoint endpoint(boost::asio::ip::make_address(options_.address), options_.port);
+            acceptor_ = std::make_unique<tcp::acceptor>(reactor_.io_context(0));
+            acceptor_->open(endpoint.protocol());
+            acceptor_->set_option(tcp::acceptor::reuse_address(true));
+            acceptor_->bind(endpoint);
+            acceptor_->listen();
+            bound.set_value(acceptor_->local_endpoint().port());
+            accept_();
+        }catch(...){
+            bound.set_exception(std::current_exception());
+        }
+    });
+    port_ = port.get();
+}
+void factdb::Server::accept_(){
+    size_t shard = next_shard_++ % reactor_.shard_count();
+    acceptor_->async_accept(reactor_.io_context(shard),
+        [this, shard](const boost::system::error_code& error, boost::asio::ip::tcp::socket socket){
+            if(error){
+                if(error != boost::asio::error::operation_aborted){
+                    accept_();
+                }
+                return;
+            }
+            connections_++;
+            auto connection = std::make_shared<Connection>(*this, std::move(socket));
+            reactor_.send(shard, [connection]{ connection->start(); });
+            accept_();
+        });
+}
+void factdb::Server::stop(){
+    if(!acceptor_){
+        return;
+    }
+    if(reactor_.stopped()){ // no shard thread left to race with
+        acceptor_.reset();
+        return;
+    }
+    std::promise<void> closed;
+    reactor_.send(0, [this, &closed]{
+        boost::system::error_code ignored;
+        acceptor_->close(ignored);
+        closed.set_value();
+    });
+    closed.get_future().wait();
+    acceptor_.reset();
+}
+factdb::ServerStats factdb::Server::stats() const{
+    ServerStats stats;
+    stats.connections = connections_.load();
+    stats.requests = requests_.load();
+    stats.errors = errors_.load();
+    return stats;
+}
+factdb::Future<factdb::Response> factdb::Server::route_(const Request& request){
+    // the trace lives on in the work handed to other shards and replicas
+    auto trace = TraceScope::request(request_name(request.opcode), request.trace);
+    if(options_.coordinator && request.consistency != ConsistencyLevel::LOCAL && request.opcode <= Opcode::BATCH){
+        return options_.coordinator->coordinate(request, [this](const Request& replica_request){ return handle(replica_request); });
+    }
+    return handle(request);
+}
+factdb::Future<factdb::Response> factdb::Server::handle(const Request& request){
+    uint16_t stream = request.stream;
+    auto ok = [stream](bool){
+        Response response;
+        response.stream = stream;
+        return response;
+    };
+    switch(request.opcode){
+        case Opcode::GET:
+            return table_.get(request.partition_key, request.cluster_key).then([stream](std::shared_ptr<Row> row){
+                Response response;
+                response.stream = stream;
+                if(row){
+                    response.rows.push_back(to_wire_row(*row));
+                }else{
+                    response.status = Status::NOT_FOUND;
+                }
+                return response;
+            });
+        case Opcode::PUT:
+            return table_.insert(request.partition_key, request.cluster_key, to_memtable_rows(request.columns)).then(ok);
+        case Opcode::REMOVE:
+            return table_.remove(request.partition_key, request.cluster_key).then(ok);
+        case Opcode::SCAN:
+            return table_.scan(request.partition_key, request.cluster_key, request.end_key, request.limit)
+                .then([stream](std::vector<std::shared_ptr<Row>> rows){
+                    Response response;
+                    response.stream = stream;
+                    for(const auto& row : rows){
+                        response.rows.push_back(to_wire_row(*row));
+                    }
+                    return response;
+                });
+        case Opcode::BATCH: {
+            MutationBatch batch;
+            for(const auto& mutation : request.batch){
+                if(mutation.opcode == Opcode::PUT){
+                    batch.insert(mutation.partition_key, mutation.cluster_key, to_memtable_rows(mutation.columns));
+                }else{
+                    batch.remove(mutation.partition_key, mutation.cluster_key);
+                }
+            }
+            return table_.apply(std::move(batch)).then(ok);
+        }
+        case Opcode::MERKLE:
+        case Opcode::STREAM:
+        case Opcode::INGEST: {
+            auto repair_request = [this, &request]{ return handle_repair_request(table_, request); };
+            return futurize_invoke(repair_request);
+        }
+    }
+    return make_ready_future(error_response(stream, "unknown opcode"));
+}
@@ -0,0 +1,45 @@
+#include <data/shard_map.hpp>
+#include <io/async_file.hpp>
+
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <stdexcept>
+
+size_t factdb::shard_of_token(Token token, size_t shards){
+    uint64_t offset = static_cast<uint64_t>(token) ^ (uint64_t(1) << 63); // the token's distance from the lowest one
+    return static_cast<size_t>((static_cast<unsigned __int128>(offset) * shards) >> 64);
+}
+std::string factdb::shard_dir(const std::string& data_dir, size_t shard){
+    return data_dir + "/shard-" + std::to_string(shard);
+}
+void factdb::check_shard_count(const std::string& data_dir, size_t shards){
+    std::string path = data_dir + "/SHARDS";
+    if(std::filesystem::exists(path)){
+        std::string contents;
+        if(!read_file(default_io_engine(), path, contents)){
+            throw std::runtime_error("Failed to read " + path);
+        }
+        size_t recorded = std::strtoull(contents.c_str(), nullptr, 10);
+        if(recorded != shards){
+            throw std::runtime_error(data_dir + " is laid out for " + std::to_string(recorded) + " shards, not " + std::to_string(shards));
+        }
+        return;
+    }
+    std::filesystem::create_directories(data_dir);
+    size_t existing = 0; // shard directories from before the count was recorded
+    for(const auto& entry : std::filesystem::directory_iterator(data_dir)){
+        if(entry.is_directory() && entry.path().filename().string().rfind("shard-", 0) == 0){
+            existing++;
+        }
+    }
+    if(existing != 0 && existing != shards){
+        throw std::runtime_error(data_dir + " holds " + std::to_string(existing) + " shard directories, not " + std::to_string(shards));
+    }
+    std::string contents = std::to_string(shards) + "\n";
+    std::string tmp_path = path + ".tmp";
+    if(!write_file(default_io_engine(), tmp_path, contents.data(), contents.size(), true) ||
+       ::rename(tmp_path.c_str(), path.c_str()) != 0 || !sync_directory(data_dir)){
+        throw std::runtime_error("Failed to record the shard count in " + path);
+    }
+}
@@ -0,0 +1,193 @@
+#include <data/sharded_table.hpp>
+#include <data/shard_map.hpp>
+#include <metrics/tracing.hpp>
+
+#include <algorithm>
+#include <functional>
+
+namespace {
+// how often a write refused at the memtable hard limit is tried again
+constexpr auto WRITE_STALL_RETRY = std::chrono::milliseconds(1);
+
+// runs fn inside the calling thread's trace, wherever it ends up running
+template <typename F>
+auto traced(F fn){
+    return [trace = factdb::current_trace(), fn = std::move(fn)]() mutable {
+        factdb::TraceScope scope(trace);
+        return fn();
+    };
+}
+}
+
+factdb::ShardedTable::ShardedTable(Reactor& reactor, TableOptions options)
+    : reactor_(reactor), options_(std::move(options)){
+    for(size_t i = 0; i < reactor_.shard_count(); i++){
+        TableOptions shard_options = options_;
+        shard_options.data_dir = shard_dir(options_.data_dir, i);
+        if(options_.memory){ // flushes run and writes wait on the shard's own thread
+            shard_options.flush_executor = [&reactor, i](std::function<void()> flush){ reactor.send(i, std::move(flush)); };
+            shard_options.wait_for_memory = false;
+        }
+        tables_.push_back(std::make_unique<Table>(shard_options));
+    }
+}
+bool factdb::ShardedTable::open(){
+    check_shard_count(options_.data_dir, tables_.size());
+    std::vector<std::future<bool>> opened;
+    for(size_t i = 0; i < tables_.size(); i++){
+        opened.push_back(reactor_.run_on(i, [this, i]{ return tables_[i]->open(); }));
+    }
+    bool ok = true;
+    for(auto& result : opened){
+        ok = result.get() && ok;
+    }
+    return ok;
+}
+size_t factdb::ShardedTable::shard_of(const std::string& partition_key) const{
+    return shard_of_key(partition_key, tables_.size());
+}
+factdb::Future<bool> factdb::ShardedTable::insert(const std::string& partition_key, const std::string& cluster_key, MemtableRows value){
+    size_t shard = shard_of(partition_key);
+    auto write = traced([this, shard, partition_key, cluster_key, value]{
+        tables_[shard]->insert(partition_key, cluster_key, value);
+        return true;
+    });
+    return reactor_.submit_to(shard, [this, write]{ return admitted_write_(write); });
+}
+factdb::Future<bool> factdb::ShardedTable::update(const std::string& partition_key, const std::string& cluster_key, MemtableRows value){
+    size_t shard = shard_of(partition_key);
+    auto write = traced([this, shard, partition_key, cluster_key, value]{
+        tables_[shard]->update(partition_key, cluster_key, value);
+        return true;
+    });
+    return reactor_.submit_to(shard, [this, write]{ return admitted_write_(write); });
+}
+factdb::Future<bool> factdb::ShardedTable::remove(const std::string& partition_key, const std::string& cluster_key){
+    size_t shard = shard_of(partition_key);
+    auto write = traced([this, shard, partition_key, cluster_key]{
+        tables_[shard]->remove(partition_key, cluster_key);
+        return true;
+    });
+    return reactor_.submit_to(shard, [this, write]{ return admitted_write_(write); });
+}
+factdb::Future<bool> factdb::ShardedTable::apply(MutationBatch batch){
+    std::vector<MutationBatch> per_shard(tables_.size());
+    for(auto& [partition_key, mutations] : batch.partitions()){
+        auto& shard_mutations = per_shard[shard_of(partition_key)];
+        for(auto& mutation : mutations){
+            if(mutation.remove){
+                shard_mutations.remove(partition_key, mutation.key);
+            }else{
+                shard_mutations.insert(partition_key, mutation.key, std::move(mutation.value));
+            }
+        }
+    }
+    std::vector<Future<bool>> applied;
+    for(size_t i = 0; i < tables_.size(); i++){
+        if(per_shard[i].empty()){
+            continue;
+        }
+        auto write = traced([this, i, shard = std::make_shared<MutationBatch>(std::move(per_shard[i]))]{
+            tables_[i]->apply(*shard);
+            return true;
+        });
+        applied.push_back(reactor_.submit_to(i, [this, write]{ return admitted_write_(write); }));
+    }
+    return when_all(std::move(applied)).then([](std::vector<bool>){ return true; });
+}
+factdb::Future<bool> factdb::ShardedTable::admitted_write_(std::function<bool()> write,
+                                                         std::optional<std::chrono::steady_clock::time_point> stalled_since){
+    MemoryManager* memory = options_.memory.get();
+    try{
+        write();
+    }catch(const MemoryLimitError&){
+        auto now = std::chrono::steady_clock::now();
+        if(!stalled_since){
+            stalled_since = now;
+        }
+        if(now - *stalled_since >= memory->max_write_stall()){
+            memory->record_write_stall(now - *stalled_since);
+            memory->record_rejected_write();
+            throw;
+        }
+        return reactor_.sleep(WRITE_STALL_RETRY).then([this, write, stalled_since](bool fired){
+            if(!fired){
+                throw MemoryLimitError("Reactor stopped while a write waited for memtable memory");
+            }
+            return admitted_write_(write, stalled_since);
+        });
+    }
+    if(stalled_since){
+        memory->record_write_stall(std::chrono::steady_clock::now() - *stalled_since);
+    }
+    return make_ready_future(true);
+}
+factdb::Future<std::shared_ptr<factdb::Row>> factdb::ShardedTable::get(const std::string& partition_key, const std::string& cluster_key){
+    size_t shard = shard_of(partition_key);
+    return reactor_.submit_to(shard, traced([this, shard, partition_key, cluster_key]{
+        return tables_[shard]->get(partition_key, cluster_key);
+    }));
+}
+factdb::Future<std::vector<std::shared_ptr<factdb::Row>>> factdb::ShardedTable::scan(const std::string& partition_key, const std::string& start,
+                                                                                     const std::string& end, size_t limit){
+    size_t shard = shard_of(partition_key);
+    return reactor_.submit_to(shard, traced([this, shard, partition_key, start, end, limit]{
+        return tables_[shard]->scan(partition_key, start, end, limit);
+    }));
+}
+factdb::Future<size_t> factdb::ShardedTable::flush(){
+    std::vector<Future<size_t>> flushed;
+    for(size_t i = 0; i < tables_.size(); i++){
+        flushed.push_back(reactor_.submit_to(i, [this, i]{
+            return static_cast<size_t>(tables_[i]->flush() ? 1 : 0);
+        }));
+    }
+    return when_all(std::move(flushed)).then([](std::vector<size_t> counts){
+        size_t total = 0;
+        for(size_t count : counts){
+            total += count;
+        }
+        return total;
+    });
+}
+factdb::Future<std::vector<std::string>> factdb::ShardedTable::snapshot(const std::string& name){
+    std::vector<Future<std::string>> snapshots;
+    for(size_t i = 0; i < tables_.size(); i++){
+        snapshots.push_back(reactor_.submit_to(i, [this, i, name]{ return tables_[i]->snapshot(name); }));
+    }
+    return when_all(std::move(snapshots));
+}
+factdb::Future<std::vector<std::shared_ptr<factdb::Partition>>> factdb::ShardedTable::merged_partitions(){
+    std::vector<Future<std::vector<std::shared_ptr<Partition>>>> shards;
+    for(size_t i = 0; i < tables_.size(); i++){
+        shards.push_back(reactor_.submit_to(i, [this, i]{ return tables_[i]->merged_partitions(); }));
+    }
+    return when_all(std::move(shards)).then([](std::vector<std::vector<std::shared_ptr<Partition>>> per_shard){
+        std::vector<std::shared_ptr<Partition>> partitions;
+        for(auto& shard : per_shard){
+            partitions.insert(partitions.end(), shard.begin(), shard.end());
+        }
+        std::sort(partitions.begin(), partitions.end(), [](const std::shared_ptr<Partition>& a, const std::shared_ptr<Partition>& b){
+            return compare_binary_keys(a->header_.key_, b->header_.key_) < 0;
+        });
+        return partitions;
+    });
+}
+factdb::Future<bool> factdb::ShardedTable::ingest(std::vector<std::shared_ptr<Partition>> partitions){
+    std::vector<std::vector<std::shared_ptr<Partition>>> per_shard(tables_.size());
+    for(auto& partition : partitions){ // stays sorted within each shard
+        const auto& key = partition->header_.key_;
+        per_shard[shard_of(std::string(key.begin(), key.end()))].push_back(std::move(partition));
+    }
+    std::vector<Future<bool>> ingested;
+    for(size_t i = 0; i < tables_.size(); i++){
+        if(per_shard[i].empty()){
+            continue;
+        }
+        ingested.push_back(reactor_.submit_to(i, [this, i, shard = std::move(per_shard[i])]{
+            tables_[i]->ingest(shard);
+            return true;
+        }));
+    }
+    return when_all(std::move(ingested)).then([](std::vector<bool>){ return true; });
+}
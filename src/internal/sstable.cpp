@@ -0,0 +1,889 @@
+#include <data/sstable.hpp>
+
+#include <internal/encoding.hpp>
+#include <io/direct_writer.hpp>
+
+#include <internal/keycompare.hpp>
+#include <metrics/metrics.hpp>
+#include <metrics/tracing.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+#include <unordered_set>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace {
+struct SSTableMetrics {
+    factdb::MetricsRegistry& registry = factdb::MetricsRegistry::global();
+    factdb::Histogram& write = registry.histogram("factdb_sstable_write_latency_ns", "Time to write all components of one SSTable");
+    factdb::Counter& bytes_written = registry.counter("factdb_sstable_bytes_written_total", "Bytes written to SSTable components");
+    factdb::Counter& large_partitions = registry.counter("factdb_large_partitions_written_total", "Partitions written of at least LARGE_PARTITION_BYTES");
+    factdb::Histogram& read = registry.histogram("factdb_sstable_read_latency_ns", "SSTable partition lookup latency");
+    factdb::Counter& filter_checks = registry.counter("factdb_bloom_filter_checks_total", "Partition lookups checked against an SSTable filter");
+    factdb::Counter& filter_negatives = registry.counter("factdb_bloom_filter_negatives_total", "Lookups the filter or key range ruled out");
+    factdb::Counter& filter_false_positives = registry.counter("factdb_bloom_filter_false_positives_total", "Lookups the filter let through that found no partition");
+};
+SSTableMetrics& metrics(){
+    static SSTableMetrics sstable_metrics;
+    return sstable_metrics;
+}
+constexpr uint8_t HAS_TIMESTAMP = static_cast<uint8_t>(factdb::RowFlags::HAS_TIMESTAMP);
+// a key, prefix or suffix length as the u16 the files store; Table refuses longer keys up front
+uint16_t checked_key_length(size_t length){
+    if(length > factdb::MAX_KEY_LENGTH){
+        throw std::length_error("Key of " + std::to_string(length) + " bytes exceeds MAX_KEY_LENGTH");
+    }
+    return static_cast<uint16_t>(length);
+}
+// Data file layout (all integers little endian):
+//   u32 magic, the ColumnDictionary the cells' ids refer to, u32 partition count
+//   per partition: u16 key length, key, u32 row count, u32 rows length,
+//     rows, then a u32 restart offset (from the first row) for every
+//     KEY_RESTART_INTERVAL-th row
+//   per row: u8 flags, u16 clustering cell count, the clustering key cell
+//     as u16 shared, u32 + suffix of its key, u32 + value, the other
+//     clustering cells, the ids of its columns as a ColumnBitmap, then
+//     u32 + value per column in id order; with HAS_TIMESTAMP in its flags,
+//     then the u64 write sequence of the row and of each column in id order
+//   per clustering cell: u32 key length, key, u32 value length, value
+// A row's clustering key shares `shared` bytes with the previous row's; rows
+// at restart offsets store it whole, so lookups can binary search them.
+void write_cell(std::string& out, const factdb::SimpleCell& cell){
+    factdb::append_bytes(out, cell.value_.key_);
+    factdb::append_bytes(out, cell.value_.value_);
+}
+factdb::SimpleCell read_cell(factdb::ByteReader& in){
+    factdb::CellValue value;
+    value.key_ = in.read_bytes();
+    value.value_ = in.read_bytes();
+    value.key_length_ = value.key_.size();
+    value.val_length_ = value.value_.size();
+    return factdb::SimpleCell(value);
+}
+size_t restart_count(size_t entries){
+    return (entries + factdb::KEY_RESTART_INTERVAL - 1) / factdb::KEY_RESTART_INTERVAL;
+}
+// The row's cells by column id, in id order; a name the row repeats keeps its first value.
+void columns_of(const factdb::Row& row, const factdb::ColumnDictionary& columns,
+                std::vector<std::pair<factdb::ColumnId, const factdb::SimpleCell*>>& out){
+    out.clear();
+    for(const auto& cell : row.cells_){
+        const auto& name = cell.value_.key_;
+        auto id = columns.find(std::string_view(name.data(), name.size()));
+        if(!id){
+            throw std::logic_error("Cell column missing from the SSTable's dictionary");
+        }
+        out.emplace_back(*id, &cell);
+    }
+    std::stable_sort(out.begin(), out.end(), [](const auto& a, const auto& b){ return a.first < b.first; });
+    out.erase(std::unique(out.begin(), out.end(), [](const auto& a, const auto& b){ return a.first == b.first; }), out.end());
+}
+void write_partition(std::string& out, const factdb::Partition& partition, const factdb::ColumnDictionary& columns){
+    const auto& key = partition.header_.key_;
+    factdb::append_int<uint16_t>(out, checked_key_length(key.size()));
+    out.append(key.data(), key.size());
+    factdb::append_int<uint32_t>(out, static_cast<uint32_t>(partition.unfiltereds_.size()));
+    size_t rows_length_at = out.size();
+    factdb::append_int<uint32_t>(out, 0);
+    size_t rows_start = out.size();
+    std::vector<uint32_t> restarts;
+    restarts.reserve(restart_count(partition.unfiltereds_.size()));
+    const std::vector<char>* previous = nullptr;
+    std::vector<std::pair<factdb::ColumnId, const factdb::SimpleCell*>> cells;
+    for(size_t r = 0; r < partition.unfiltereds_.size(); r++){
+        auto row = std::static_pointer_cast<factdb::Row>(partition.unfiltereds_[r]);
+        if(r % factdb::KEY_RESTART_INTERVAL == 0){
+            restarts.push_back(static_cast<uint32_t>(out.size() - rows_start));
+            previous = nullptr;
+        }
+        columns_of(*row, columns, cells);
+        bool sequenced = row->liveness_info_.has_value();
+        for(const auto& [id, cell] : cells){
+            sequenced = sequenced || cell->delta_timestamp_.has_value();
+        }
+        uint8_t flags = static_cast<uint8_t>(row->flags_) & ~HAS_TIMESTAMP;
+        factdb::append_int<uint8_t>(out, sequenced ? flags | HAS_TIMESTAMP : flags);
+        uint16_t clustering_count = 0;
+        for(const auto& block : row->clustering_blocks_){
+            clustering_count += block->clustering_cells_.size();
+        }
+        factdb::append_int<uint16_t>(out, clustering_count);
+        const std::vector<char>* clustering_key = nullptr;
+        for(const auto& block : row->clustering_blocks_){
+            for(const auto& cell : block->clustering_cells_){
+                if(clustering_key != nullptr){
+                    write_cell(out, cell);
+                    continue;
+                }
+                clustering_key = &cell.value_.key_;
+                checked_key_length(clustering_key->size());
+                size_t shared = previous ? factdb::shared_prefix_length(previous->data(), previous->size(), clustering_key->data(), clustering_key->size()) : 0;
+                factdb::append_int<uint16_t>(out, checked_key_length(shared));
+                factdb::append_bytes(out, clustering_key->data() + shared, clustering_key->size() - shared);
+                factdb::append_bytes(out, cell.value_.value_);
+            }
+        }
+        previous = clustering_key; // a row without one resets the prefix to empty
+        factdb::ColumnBitmap present;
+        for(const auto& [id, cell] : cells){
+            present.set(id);
+        }
+        present.serialize(out);
+        for(const auto& [id, cell] : cells){
+            factdb::append_bytes(out, cell->value_.value_);
+        }
+        if(sequenced){
+            factdb::append_int<uint64_t>(out, row->liveness_info_ ? row->liveness_info_->delta_timestamp_ : 0);
+            for(const auto& [id, cell] : cells){
+                factdb::append_int<uint64_t>(out, cell->delta_timestamp_.value_or(0));
+            }
+        }
+    }
+    uint32_t rows_length = static_cast<uint32_t>(out.size() - rows_start);
+    std::memcpy(out.data() + rows_length_at, &rows_length, sizeof(rows_length));
+    for(uint32_t restart : restarts){
+        factdb::append_int<uint32_t>(out, restart);
+    }
+}
+// Skips a row's column bitmap, the values it lists and, as `flags` say, their sequences.
+void skip_columns(factdb::ByteReader& in, uint8_t flags){
+    uint16_t bitmap_length = in.read_int<uint16_t>();
+    const char* bitmap = in.position();
+    in.skip(bitmap_length);
+    size_t columns = 0;
+    factdb::for_each_column(bitmap, bitmap_length, [&](factdb::ColumnId){
+        in.skip(in.read_int<uint32_t>());
+        columns++;
+    });
+    if(flags & HAS_TIMESTAMP){
+        in.skip((columns + 1) * sizeof(uint64_t));
+    }
+}
+// Reads the row `in` is at. `previous` holds the prior row's clustering key
+// and is left holding this one's.
+std::shared_ptr<factdb::Row> read_row_from(factdb::ByteReader& in, std::vector<char>& previous, const factdb::ColumnDictionary& columns){
+    auto row = std::make_shared<factdb::Row>();
+    row->flags_ = static_cast<char>(in.read_int<uint8_t>());
+    uint16_t clustering_count = in.read_int<uint16_t>();
+    if(clustering_count > 0){
+        auto block = std::make_shared<factdb::ClusteringBlock>();
+        uint16_t shared = in.read_int<uint16_t>();
+        if(shared > previous.size()){
+            throw std::runtime_error("Clustering key shares more than the previous key holds");
+        }
+        uint32_t suffix_length = in.read_int<uint32_t>();
+        const char* suffix = in.position();
+        in.skip(suffix_length);
+        previous.resize(shared);
+        previous.insert(previous.end(), suffix, suffix + suffix_length);
+        factdb::CellValue key_cell;
+        key_cell.key_ = previous;
+        key_cell.value_ = in.read_bytes();
+        key_cell.key_length_ = key_cell.key_.size();
+        key_cell.val_length_ = key_cell.value_.size();
+        block->clustering_cells_.emplace_back(key_cell);
+        for(uint16_t c = 1; c < clustering_count; c++){
+            block->clustering_cells_.emplace_back(read_cell(in));
+        }
+        row->clustering_blocks_.emplace_back(block);
+    }else{
+        previous.clear();
+    }
+    uint16_t bitmap_length = in.read_int<uint16_t>();
+    const char* bitmap = in.position();
+    in.skip(bitmap_length);
+    factdb::for_each_column(bitmap, bitmap_length, [&](factdb::ColumnId id){
+        if(id >= columns.size()){
+            throw std::runtime_error("Cell refers to a column past the SSTable's dictionary");
+        }
+        const std::string& name = columns.name(id);
+        factdb::CellValue value;
+        value.key_.assign(name.begin(), name.end());
+        value.value_ = in.read_bytes();
+        value.key_length_ = value.key_.size();
+        value.val_length_ = value.value_.size();
+        row->cells_.emplace_back(value);
+    });
+    if(row->flags_ & HAS_TIMESTAMP){
+        uint64_t sequence = in.read_int<uint64_t>();
+        if(sequence != 0){
+            row->liveness_info_.emplace();
+            row->liveness_info_->delta_timestamp_ = sequence;
+        }
+        for(auto& cell : row->cells_){
+            if((sequence = in.read_int<uint64_t>()) != 0){
+                cell.delta_timestamp_ = sequence;
+            }
+        }
+    }
+    return row;
+}
+std::shared_ptr<factdb::Partition> read_partition_from(factdb::ByteReader& in, const factdb::ColumnDictionary& columns){
+    auto partition = std::make_shared<factdb::Partition>();
+    uint16_t key_length = in.read_int<uint16_t>();
+    partition->header_.key_length_ = key_length;
+    partition->header_.key_ = in.read_raw(key_length);
+    uint32_t row_count = in.read_int<uint32_t>();
+    in.read_int<uint32_t>(); // rows length, for lookups
+    partition->unfiltereds_.reserve(row_count);
+    std::vector<char> previous;
+    for(uint32_t r = 0; r < row_count; r++){
+        partition->unfiltereds_.emplace_back(read_row_from(in, previous, columns));
+    }
+    in.skip(restart_count(row_count) * sizeof(uint32_t));
+    return partition;
+}
+// Decodes only the row of one encoded partition whose clustering key is
+// `key`: a binary search over the restart rows, then a walk of at most
+// KEY_RESTART_INTERVAL rows. Throws std::runtime_error on malformed input.
+std::shared_ptr<factdb::Row> find_row_in(const std::string& data, const std::vector<char>& key, const factdb::ColumnDictionary& columns){
+    factdb::ByteReader in(data);
+    in.skip(in.read_int<uint16_t>());
+    uint32_t row_count = in.read_int<uint32_t>();
+    uint32_t rows_length = in.read_int<uint32_t>();
+    const char* rows = in.position();
+    in.skip(rows_length);
+    size_t restarts = restart_count(row_count);
+    factdb::ByteReader restart_table(in.position(), in.remaining());
+    std::vector<uint32_t> offsets(restarts);
+    for(auto& offset : offsets){
+        offset = restart_table.read_int<uint32_t>();
+        if(offset >= rows_length){
+            throw std::runtime_error("Restart offset past the partition's rows");
+        }
+    }
+    uint64_t key_prefix = factdb::normalized_key_prefix(key.data(), key.size());
+    // the full clustering key of a restart row, as a view into `rows`; empty without one
+    auto restart_key = [&](size_t restart, const char*& at, size_t& length){
+        factdb::ByteReader row(rows + offsets[restart], rows_length - offsets[restart]);
+        row.skip(1);
+        if(row.read_int<uint16_t>() == 0){
+            at = nullptr;
+            length = 0;
+            return;
+        }
+        row.skip(sizeof(uint16_t)); // shared is 0 at a restart
+        length = row.read_int<uint32_t>();
+        at = row.position();
+        row.skip(length);
+    };
+    size_t low = 0;
+    size_t high = restarts; // first restart whose key is greater than `key`
+    while(low < high){
+        size_t middle = (low + high) / 2;
+        const char* at;
+        size_t length;
+        restart_key(middle, at, length);
+        if(factdb::compare_binary_keys(at, length, factdb::normalized_key_prefix(at, length), key.data(), key.size(), key_prefix) <= 0){
+            low = middle + 1;
+        }else{
+            high = middle;
+        }
+    }
+    if(low == 0){
+        return nullptr;
+    }
+    size_t restart = low - 1;
+    size_t end = restart + 1 < restarts ? offsets[restart + 1] : rows_length;
+    factdb::ByteReader row_in(rows + offsets[restart], end - offsets[restart]);
+    std::vector<char> previous;
+    while(!row_in.done()){
+        factdb::ByteReader probe = row_in; // reads the key only, and skips the row unless it matches
+        uint8_t flags = probe.read_int<uint8_t>();
+        uint16_t clustering_count = probe.read_int<uint16_t>();
+        if(clustering_count == 0){
+            previous.clear();
+        }else{
+            uint16_t shared = probe.read_int<uint16_t>();
+            uint32_t suffix_length = probe.read_int<uint32_t>();
+            if(shared > previous.size()){
+                throw std::runtime_error("Clustering key shares more than the previous key holds");
+            }
+            previous.resize(shared);
+            previous.insert(previous.end(), probe.position(), probe.position() + suffix_length);
+            probe.skip(suffix_length);
+        }
+        int order = factdb::compare_binary_keys(previous.data(), previous.size(), key.data(), key.size());
+        if(order == 0){
+            return read_row_from(row_in, previous, columns); // rebuilding the key from `previous` yields it again
+        }
+        if(order > 0){
+            break;
+        }
+        if(clustering_count > 0){
+            probe.skip(probe.read_int<uint32_t>());
+            for(uint16_t c = 1; c < clustering_count; c++){
+                probe.skip(probe.read_int<uint32_t>());
+                probe.skip(probe.read_int<uint32_t>());
+            }
+        }
+        skip_columns(probe, flags);
+        row_in = probe;
+    }
+    return nullptr;
+}
+// Index file: u32 entry count, then one chunk per summary entry. A chunk
+//   holds up to SUMMARY_INTERVAL entries, each u16 shared, u16 + suffix of
+//   the partition key, u64 data position, u32 data length; then a u32 offset
+//   (from the chunk start) of every KEY_RESTART_INTERVAL-th entry, which
+//   shares nothing with the key before it, and a u32 count of them.
+// Summary file: u32 magic, u32 interval, u32 partition count, u64 index size,
+//   u16 + first key, u16 + last key, the data file's ColumnDictionary,
+//   u32 entry count, then per entry u16 key length, key, u64 index position.
+// Filter file: BloomFilter::serialize() over the partition keys.
+void write_short_key(std::string& out, const std::vector<char>& key){
+    factdb::append_int<uint16_t>(out, checked_key_length(key.size()));
+    out.append(key.data(), key.size());
+}
+std::vector<char> read_short_key(factdb::ByteReader& in){
+    return in.read_raw(in.read_int<uint16_t>());
+}
+void finish_index_chunk(std::string& out, std::vector<uint32_t>& restarts){
+    for(uint32_t restart : restarts){
+        factdb::append_int<uint32_t>(out, restart);
+    }
+    factdb::append_int<uint32_t>(out, static_cast<uint32_t>(restarts.size()));
+    restarts.clear();
+}
+// Finds `key` in one index chunk without decoding it: a binary search over
+// the restart keys, compared in place, then a walk of at most
+// KEY_RESTART_INTERVAL entries. Throws std::runtime_error on a malformed chunk.
+bool find_index_entry(const std::string& chunk, const std::vector<char>& key, uint64_t& position, uint32_t& length){
+    factdb::ByteReader trailer(chunk.data() + chunk.size() - std::min<size_t>(chunk.size(), sizeof(uint32_t)), std::min<size_t>(chunk.size(), sizeof(uint32_t)));
+    uint32_t restarts = trailer.read_int<uint32_t>();
+    size_t table_length = (static_cast<size_t>(restarts) + 1) * sizeof(uint32_t);
+    if(restarts == 0 || table_length > chunk.size()){
+        throw std::runtime_error("Malformed index chunk");
+    }
+    size_t entries_length = chunk.size() - table_length;
+    const char* table = chunk.data() + entries_length;
+    auto offset = [&](size_t restart){
+        uint32_t value;
+        std::memcpy(&value, table + restart * sizeof(uint32_t), sizeof(value));
+        if(value >= entries_length){
+            throw std::runtime_error("Malformed index chunk");
+        }
+        return value;
+    };
+    uint64_t key_prefix = factdb::normalized_key_prefix(key.data(), key.size());
+    size_t low = 0;
+    size_t high = restarts; // first restart whose key is greater than `key`
+    while(low < high){
+        size_t middle = (low + high) / 2;
+        factdb::ByteReader entry(chunk.data() + offset(middle), entries_length - offset(middle));
+        entry.skip(sizeof(uint16_t)); // shared is 0 at a restart
+        uint16_t key_length = entry.read_int<uint16_t>();
+        const char* restart_key = entry.position();
+        entry.skip(key_length);
+        if(factdb::compare_binary_keys(restart_key, key_length, factdb::normalized_key_prefix(restart_key, key_length),
+                                       key.data(), key.size(), key_prefix) <= 0){
+            low = middle + 1;
+        }else{
+            high = middle;
+        }
+    }
+    if(low == 0){
+        return false;
+    }
+    size_t begin = offset(low - 1);
+    size_t end = low < restarts ? offset(low) : entries_length;
+    factdb::ByteReader in(chunk.data() + begin, end - begin);
+    std::vector<char> current;
+    current.reserve(key.size() + 16);
+    while(!in.done()){
+        uint16_t shared = in.read_int<uint16_t>();
+        uint16_t suffix_length = in.read_int<uint16_t>();
+        if(shared > current.size()){
+            throw std::runtime_error("Malformed index chunk");
+        }
+        current.resize(shared);
+        current.insert(current.end(), in.position(), in.position() + suffix_length);
+        in.skip(suffix_length);
+        uint64_t entry_position = in.read_int<uint64_t>();
+        uint32_t entry_length = in.read_int<uint32_t>();
+        int order = factdb::compare_binary_keys(current.data(), current.size(), key.data(), key.size());
+        if(order == 0){
+            position = entry_position;
+            length = entry_length;
+            return true;
+        }
+        if(order > 0){
+            break;
+        }
+    }
+    return false;
+}
+std::string filter_key(const std::vector<char>& key){
+    return std::string(key.begin(), key.end());
+}
+}
+
+std::string factdb::sstable_component_path(const std::string& data_path, SSTableComponent component){
+    static const std::string data_suffix = "-Data.db";
+    if(data_path.size() >= data_suffix.size() &&
+       data_path.compare(data_path.size() - data_suffix.size(), data_suffix.size(), data_suffix) == 0){
+        std::string base = data_path.substr(0, data_path.size() - data_suffix.size());
+        switch(component){
+            case SSTableComponent::DATA: return data_path;
+            case SSTableComponent::INDEX: return base + "-Index.db";
+            case SSTableComponent::SUMMARY: return base + "-Summary.db";
+            case SSTableComponent::FILTER: return base + "-Filter.db";
+            case SSTableComponent::STATISTICS: return base + "-Statistics.db";
+        }
+    }
+    switch(component){
+        case SSTableComponent::INDEX: return data_path + ".index";
+        case SSTableComponent::SUMMARY: return data_path + ".summary";
+        case SSTableComponent::FILTER: return data_path + ".filter";
+        case SSTableComponent::STATISTICS: return data_path + ".statistics";
+        default: return data_path;
+    }
+}
+
+std::string factdb::encode_sstable_section(const std::vector<std::shared_ptr<factdb::Partition>>& partitions){
+    ColumnDictionary columns;
+    columns.add_partitions(partitions);
+    std::string out;
+    append_int<uint32_t>(out, SSTABLE_MAGIC);
+    columns.serialize(out);
+    append_int<uint32_t>(out, static_cast<uint32_t>(partitions.size()));
+    for(const auto& partition : partitions){
+        write_partition(out, *partition, columns);
+    }
+    return out;
+}
+std::vector<std::shared_ptr<factdb::Partition>> factdb::decode_sstable_section(const char* data, size_t length){
+    ByteReader in(data, length);
+    if(in.read_int<uint32_t>() != SSTABLE_MAGIC){
+        throw std::runtime_error("Not an SSTable section");
+    }
+    ColumnDictionary columns = ColumnDictionary::deserialize(in);
+    uint32_t partition_count = in.read_int<uint32_t>();
+    std::vector<std::shared_ptr<factdb::Partition>> partitions;
+    partitions.reserve(partition_count);
+    for(uint32_t p = 0; p < partition_count; p++){
+        partitions.emplace_back(read_partition_from(in, columns));
+    }
+    return partitions;
+}
+const std::vector<char>& factdb::row_clustering_key(const factdb::Row& row){
+    static const std::vector<char> empty_key;
+    if(row.clustering_blocks_.empty() || row.clustering_blocks_[0]->clustering_cells_.empty()){
+        return empty_key;
+    }
+    return row.clustering_blocks_[0]->clustering_cells_[0].value_.key_;
+}
+uint64_t factdb::row_data_size(const factdb::Row& row){
+    uint64_t size = 0;
+    for(const auto& block : row.clustering_blocks_){
+        for(const auto& cell : block->clustering_cells_){
+            size += cell.value_.key_.size() + cell.value_.value_.size();
+        }
+    }
+    for(const auto& cell : row.cells_){
+        size += cell.value_.key_.size() + cell.value_.value_.size();
+    }
+    return size;
+}
+factdb::SSTable::~SSTable(){
+    if(remove_on_close_){
+        remove_files();
+    }
+}
+size_t factdb::SSTable::row_count() const{
+    size_t rows = 0;
+    for(const auto& partition : partitions_){
+        rows += partition->unfiltereds_.size();
+    }
+    return rows;
+}
+uint64_t factdb::SSTable::data_size() const{
+    uint64_t size = 0;
+    for(const auto& partition : partitions_){
+        size += partition->header_.key_.size();
+        for(const auto& unfiltered : partition->unfiltereds_){
+            size += row_data_size(*std::static_pointer_cast<factdb::Row>(unfiltered));
+        }
+    }
+    return size;
+}
+bool factdb::SSTable::write_to_file(){
+    return write_to_file(SSTableWriteOptions());
+}
+bool factdb::SSTable::write_to_file(const SSTableWriteOptions& options){
+    LatencyTimer timer(metrics().write);
+    std::filesystem::path path(file_path_);
+    if(path.has_parent_path()){
+        std::filesystem::create_directories(path.parent_path());
+    }
+    ColumnDictionary columns = options.schema ? options.schema->snapshot() : ColumnDictionary();
+    columns.add_partitions(partitions_);
+    std::string datafile;
+    append_int<uint32_t>(datafile, SSTABLE_MAGIC);
+    columns.serialize(datafile);
+    append_int<uint32_t>(datafile, static_cast<uint32_t>(partitions_.size()));
+    std::string indexfile;
+    append_int<uint32_t>(indexfile, static_cast<uint32_t>(partitions_.size()));
+    SummaryFile summary;
+    summary.partition_count_ = partitions_.size();
+    auto filter = std::make_unique<BloomFilter>(std::max<size_t>(1, partitions_.size() * FILTER_BITS_PER_PARTITION), FILTER_HASHES);
+    auto statistics = std::make_shared<StatisticsFile>();
+    BlockStatistics block;
+    size_t chunk_start = 0;
+    std::vector<uint32_t> restarts;   // of the index chunk being written
+    for(size_t i = 0; i < partitions_.size(); i++){
+        const auto& key = partitions_[i]->header_.key_;
+        uint64_t position = datafile.size();
+        write_partition(datafile, *partitions_[i], columns);
+        block.add_partition(*partitions_[i], position, datafile.size() - position);
+        statistics->partitions_.add_partition(*partitions_[i], datafile.size() - position);
+        if(datafile.size() - position >= LARGE_PARTITION_BYTES){
+            metrics().large_partitions.add();
+        }
+        if(block.rows_ + block.deleted_rows_ >= STATISTICS_BLOCK_ROWS || i + 1 == partitions_.size()){
+            statistics->totals_.merge(block);
+            statistics->blocks_.push_back(std::move(block));
+            block = BlockStatistics();
+        }
+        size_t shared = 0;
+        if(i % SUMMARY_INTERVAL == 0){
+            if(i > 0){
+                finish_index_chunk(indexfile, restarts);
+            }
+            chunk_start = indexfile.size();
+            summary.entries_.emplace_back(key, chunk_start);
+        }
+        if(i % KEY_RESTART_INTERVAL == 0){
+            restarts.push_back(static_cast<uint32_t>(indexfile.size() - chunk_start));
+        }else{
+            const auto& previous = partitions_[i - 1]->header_.key_;
+            shared = shared_prefix_length(previous.data(), previous.size(), key.data(), key.size());
+        }
+        append_int<uint16_t>(indexfile, checked_key_length(shared));
+        append_int<uint16_t>(indexfile, checked_key_length(key.size() - shared));
+        indexfile.append(key.data() + shared, key.size() - shared);
+        append_int<uint64_t>(indexfile, position);
+        append_int<uint32_t>(indexfile, static_cast<uint32_t>(datafile.size() - position));
+        filter->insert(filter_key(key));
+    }
+    if(!partitions_.empty()){
+        finish_index_chunk(indexfile, restarts);
+    }
+    summary.index_size_ = indexfile.size();
+    if(!partitions_.empty()){
+        summary.first_key_ = partitions_.front()->header_.key_;
+        summary.last_key_ = partitions_.back()->header_.key_;
+    }
+    std::string summaryfile;
+    append_int<uint32_t>(summaryfile, SUMMARY_MAGIC);
+    append_int<uint32_t>(summaryfile, SUMMARY_INTERVAL);
+    append_int<uint32_t>(summaryfile, summary.partition_count_);
+    append_int<uint64_t>(summaryfile, summary.index_size_);
+    write_short_key(summaryfile, summary.first_key_);
+    write_short_key(summaryfile, summary.last_key_);
+    columns.serialize(summaryfile);
+    summary.columns_ = std::move(columns);
+    append_int<uint32_t>(summaryfile, static_cast<uint32_t>(summary.entries_.size()));
+    for(const auto& entry : summary.entries_){
+        write_short_key(summaryfile, entry.key_);
+        append_int<uint64_t>(summaryfile, entry.index_position_);
+    }
+    std::string filterfile = filter->serialize();
+    std::string statisticsfile = statistics->serialize();
+
+    bool written;
+    if(options.direct_io){
+        DirectFileWriter writer(file_path_, options.buffer_pool ? *options.buffer_pool : default_buffer_pool(), io_engine_);
+        written = writer.append(datafile.data(), datafile.size()) && writer.seal();
+    }else{
+        written = write_file(io_engine_, file_path_, datafile.data(), datafile.size(), true);
+    }
+    std::string directory = std::filesystem::path(file_path_).parent_path().string();
+    written = written &&
+        write_file(io_engine_, sstable_component_path(file_path_, SSTableComponent::INDEX), indexfile.data(), indexfile.size(), true) &&
+        write_file(io_engine_, sstable_component_path(file_path_, SSTableComponent::FILTER), filterfile.data(), filterfile.size(), true) &&
+        write_file(io_engine_, sstable_component_path(file_path_, SSTableComponent::STATISTICS), statisticsfile.data(), statisticsfile.size(), true) &&
+        write_file(io_engine_, sstable_component_path(file_path_, SSTableComponent::SUMMARY), summaryfile.data(), summaryfile.size(), true) &&
+        sync_directory(directory.empty() ? "." : directory);
+    if(options.block_cache){
+        if(written){
+            options.block_cache->populate(file_path_, datafile.data(), datafile.size());
+            block_cache_ = options.block_cache;
+        }else{
+            options.block_cache->invalidate(file_path_);
+        }
+    }
+    if(written){
+        metrics().bytes_written.add(datafile.size() + indexfile.size() + filterfile.size() + summaryfile.size() + statisticsfile.size());
+        std::lock_guard<std::mutex> guard(index_mutex_);
+        summary_ = std::move(summary);
+        filter_ = std::move(filter);
+        index_chunks_.clear();
+        statistics_ = std::move(statistics);
+        statistics_loaded_ = true;
+        opened_ = true;
+    }
+    return written;
+}
+bool factdb::SSTable::read_data(std::string& out){
+    return block_cache_ ? block_cache_->read_file(io_engine_, file_path_, out)
+                        : read_file(io_engine_, file_path_, out);
+}
+std::shared_ptr<const factdb::StatisticsFile> factdb::SSTable::statistics(){
+    std::lock_guard<std::mutex> guard(index_mutex_);
+    if(!statistics_loaded_){
+        statistics_loaded_ = true;
+        std::string statisticsfile;
+        if(read_file(io_engine_, sstable_component_path(file_path_, SSTableComponent::STATISTICS), statisticsfile)){
+            try{
+                statistics_ = std::make_shared<StatisticsFile>(StatisticsFile::deserialize(statisticsfile));
+            }catch(const std::runtime_error&){
+                statistics_ = nullptr; // read without pruning, as before the component existed
+            }
+        }
+    }
+    return statistics_;
+}
+bool factdb::SSTable::read_blocks(const std::vector<size_t>& blocks, std::string& out){
+    auto stats = statistics();
+    if(!stats){
+        return false;
+    }
+    out.clear();
+    append_int<uint32_t>(out, SSTABLE_MAGIC);
+    summary_.columns_.serialize(out);
+    size_t count_at = out.size();
+    append_int<uint32_t>(out, 0);
+    uint32_t partitions = 0;
+    std::string range;
+    for(size_t b = 0; b < blocks.size();){
+        const BlockStatistics& first = stats->blocks_.at(blocks[b]);
+        uint64_t end = first.position_ + first.length_;
+        partitions += first.partitions_;
+        size_t next = b + 1;
+        for(; next < blocks.size() && blocks[next] == blocks[next - 1] + 1; next++){ // adjacent blocks are one read
+            const BlockStatistics& block = stats->blocks_.at(blocks[next]);
+            end = block.position_ + block.length_;
+            partitions += block.partitions_;
+        }
+        if(!read_range_(file_path_, first.position_, end - first.position_, range)){
+            return false;
+        }
+        out.append(range);
+        b = next;
+    }
+    std::memcpy(out.data() + count_at, &partitions, sizeof(partitions));
+    return true;
+}
+bool factdb::SSTable::read_from_file(){
+    std::string datafile;
+    if(!read_data(datafile)){
+        return false;
+    }
+    try{
+        ByteReader in(datafile);
+        if(in.read_int<uint32_t>() != SSTABLE_MAGIC){
+            return false;
+        }
+        ColumnDictionary columns = ColumnDictionary::deserialize(in);
+        uint32_t partition_count = in.read_int<uint32_t>();
+        std::vector<std::shared_ptr<factdb::Partition>> partitions;
+        partitions.reserve(partition_count);
+        for(uint32_t p = 0; p < partition_count; p++){
+            partitions.emplace_back(read_partition_from(in, columns));
+        }
+        partitions_ = std::move(partitions);
+    }catch(const std::runtime_error&){
+        return false;
+    }
+    return true;
+}
+bool factdb::SSTable::read_range_(const std::string& path, uint64_t offset, size_t length, std::string& out){
+    if(block_cache_){
+        return block_cache_->read_range(io_engine_, path, offset, length, out);
+    }
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if(fd < 0){
+        return false;
+    }
+    out.assign(length, '\0');
+    ssize_t n = io_engine_.read_fully(fd, out.data(), length, offset);
+    ::close(fd);
+    return n == static_cast<ssize_t>(length);
+}
+bool factdb::SSTable::open(){
+    std::string summaryfile;
+    std::string filterfile;
+    if(!read_file(io_engine_, sstable_component_path(file_path_, SSTableComponent::SUMMARY), summaryfile) ||
+       !read_file(io_engine_, sstable_component_path(file_path_, SSTableComponent::FILTER), filterfile)){
+        return false;
+    }
+    SummaryFile summary;
+    std::unique_ptr<BloomFilter> filter;
+    try{
+        ByteReader in(summaryfile);
+        if(in.read_int<uint32_t>() != SUMMARY_MAGIC || in.read_int<uint32_t>() != SUMMARY_INTERVAL){
+            return false;
+        }
+        summary.partition_count_ = in.read_int<uint32_t>();
+        summary.index_size_ = in.read_int<uint64_t>();
+        summary.first_key_ = read_short_key(in);
+        summary.last_key_ = read_short_key(in);
+        summary.columns_ = ColumnDictionary::deserialize(in);
+        uint32_t entry_count = in.read_int<uint32_t>();
+        summary.entries_.reserve(entry_count);
+        for(uint32_t i = 0; i < entry_count; i++){
+            std::vector<char> key = read_short_key(in);
+            summary.entries_.emplace_back(key, in.read_int<uint64_t>());
+        }
+        filter = std::make_unique<BloomFilter>(BloomFilter::deserialize(filterfile));
+    }catch(const std::runtime_error&){
+        return false;
+    }
+    std::lock_guard<std::mutex> guard(index_mutex_);
+    summary_ = std::move(summary);
+    filter_ = std::move(filter);
+    index_chunks_.clear();
+    opened_ = true;
+    return true;
+}
+bool factdb::SSTable::might_contain(const std::vector<char>& partition_key) const{
+    if(!opened_ || summary_.partition_count_ == 0){
+        return false;
+    }
+    if(compare_binary_keys(partition_key, summary_.first_key_) < 0 || compare_binary_keys(partition_key, summary_.last_key_) > 0){
+        return false;
+    }
+    return filter_->contains(filter_key(partition_key));
+}
+std::shared_ptr<const std::string> factdb::SSTable::index_chunk_(size_t slot){
+    {
+        std::lock_guard<std::mutex> guard(index_mutex_);
+        auto it = index_chunks_.find(slot);
+        if(it != index_chunks_.end()){
+            return it->second;
+        }
+    }
+    uint64_t begin = summary_.entries_[slot].index_position_;
+    uint64_t end = slot + 1 < summary_.entries_.size() ? summary_.entries_[slot + 1].index_position_ : summary_.index_size_;
+    auto chunk = std::make_shared<std::string>();
+    if(!read_range_(sstable_component_path(file_path_, SSTableComponent::INDEX), begin, end - begin, *chunk)){
+        return nullptr;
+    }
+    std::lock_guard<std::mutex> guard(index_mutex_);
+    return index_chunks_.emplace(slot, std::move(chunk)).first->second;
+}
+bool factdb::SSTable::read_partition_data_(const std::vector<char>& partition_key, std::string& data){
+    if(!opened_ && !open()){
+        return false;
+    }
+    LatencyTimer timer(metrics().read);
+    metrics().filter_checks.add();
+    bool maybe_present;
+    {
+        TraceScope span("bloom filter");
+        maybe_present = might_contain(partition_key);
+        if(span.active()){
+            span.note(std::filesystem::path(file_path_).filename().string() + (maybe_present ? " positive" : " negative"));
+        }
+    }
+    if(!maybe_present){
+        metrics().filter_negatives.add();
+        return false;
+    }
+    uint64_t position = 0;
+    uint32_t length = 0;
+    {
+        TraceScope span("index lookup");
+        // last summary entry whose key is <= partition_key
+        auto slot_it = std::upper_bound(summary_.entries_.begin(), summary_.entries_.end(), partition_key,
+            [](const std::vector<char>& key, const SummaryEntry& entry){
+                return compare_binary_keys(key, entry.key_) < 0;
+            });
+        if(slot_it == summary_.entries_.begin()){
+            return false;
+        }
+        auto chunk = index_chunk_(slot_it - summary_.entries_.begin() - 1);
+        if(!chunk){
+            return false;
+        }
+        bool found;
+        try{
+            found = find_index_entry(*chunk, partition_key, position, length);
+        }catch(const std::runtime_error&){
+            return false;
+        }
+        if(!found){
+            metrics().filter_false_positives.add();
+            if(span.active()){
+                span.note("filter false positive");
+            }
+            return false;
+        }
+    }
+    TraceScope span("data read");
+    if(span.active()){
+        span.note(std::to_string(length) + " bytes");
+    }
+    return read_range_(file_path_, position, length, data);
+}
+std::shared_ptr<factdb::Partition> factdb::SSTable::read_partition(const std::vector<char>& partition_key){
+    std::string data;
+    if(!read_partition_data_(partition_key, data)){
+        return nullptr;
+    }
+    try{
+        ByteReader in(data);
+        return read_partition_from(in, summary_.columns_);
+    }catch(const std::runtime_error&){
+        return nullptr;
+    }
+}
+std::shared_ptr<factdb::Row> factdb::SSTable::read_row(const std::vector<char>& partition_key, const std::vector<char>& clustering_key){
+    std::string data;
+    if(!read_partition_data_(partition_key, data)){
+        return nullptr;
+    }
+    try{
+        return find_row_in(data, clustering_key, summary_.columns_);
+    }catch(const std::runtime_error&){
+        return nullptr;
+    }
+}
+uint32_t factdb::SSTable::partition_count() const{
+    return opened_ ? summary_.partition_count_ : partitions_.size();
+}
+size_t factdb::SSTable::loaded_index_chunks() const{
+    std::lock_guard<std::mutex> guard(index_mutex_);
+    return index_chunks_.size();
+}
+bool factdb::SSTable::remove_files() const{
+    bool removed = true;
+    for(auto component : SSTABLE_COMPONENTS){
+        std::error_code error;
+        std::filesystem::remove(sstable_component_path(file_path_, component), error);
+        removed = removed && !error;
+    }
+    if(block_cache_){
+        block_cache_->invalidate(file_path_);
+    }
+    return removed;
+}
+bool factdb::row_is_deleted(const factdb::Row& row){
+    return (row.flags_ & static_cast<char>(factdb::RowFlags::HAS_DELETION)) != 0;
+}
+void factdb::merge_older_cells(factdb::Row& newer, const factdb::Row& older){
+    std::unordered_set<std::string> present;
+    for(const auto& cell : newer.cells_){
+        present.emplace(cell.value_.key_.begin(), cell.value_.key_.end());
+    }
+    for(const auto& cell : older.cells_){
+        if(present.emplace(cell.value_.key_.begin(), cell.value_.key_.end()).second){
+            newer.cells_.push_back(cell);
+        }
+    }
+}
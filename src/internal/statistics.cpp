@@ -0,0 +1,426 @@
+#include <data/sstable/statisticsfile.hpp>
+#include <data/sstable.hpp>
+
+#include <internal/encoding.hpp>
+#include <internal/keycompare.hpp>
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+template <typename T>
+bool parse_number(std::string_view text, T& value){
+    auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), value);
+    return error == std::errc() && end == text.data() + text.size();
+}
+void widen(std::vector<char>& min, std::vector<char>& max, bool first, const std::vector<char>& key_min, const std::vector<char>& key_max){
+    if(first || factdb::compare_binary_keys(key_min, min) < 0){
+        min = key_min;
+    }
+    if(first || factdb::compare_binary_keys(key_max, max) > 0){
+        max = key_max;
+    }
+}
+constexpr size_t MAX_HISTOGRAM_BUCKETS = 200; // bounds past this no longer fit 64 bits
+constexpr uint8_t HLL_DENSE = 0;
+constexpr uint8_t HLL_SPARSE = 1;
+
+const std::array<uint64_t, MAX_HISTOGRAM_BUCKETS>& histogram_bounds(){
+    static const std::array<uint64_t, MAX_HISTOGRAM_BUCKETS> bounds = []{
+        std::array<uint64_t, MAX_HISTOGRAM_BUCKETS> b{};
+        b[0] = 1;
+        for(size_t i = 1; i < b.size(); i++){
+            b[i] = std::max(b[i - 1] + 1, static_cast<uint64_t>(std::llround(b[i - 1] * 1.2)));
+        }
+        return b;
+    }();
+    return bounds;
+}
+// Statistics file (integers little endian, doubles as their bytes):
+//   u32 magic, block totals, u32 block count, blocks..., then the partition
+//   size and cell count EstimatedHistograms and the partition key HyperLogLog
+//   as they serialize themselves, absent from files written before them
+//   per block: u64 position, u64 length, u32 partitions, u64 rows,
+//   u64 deleted rows, u32 + first and last partition key, u32 + min and
+//   max clustering key, u32 column count, columns...
+//   per column: u32 + name, u64 values, u64 ints, i64 min, max, sum,
+//   u64 floats, f64 min, max, sum, u8 string bounds, u32 + min, u32 + max
+void write_block(std::string& out, const factdb::BlockStatistics& block){
+    factdb::append_int<uint64_t>(out, block.position_);
+    factdb::append_int<uint64_t>(out, block.length_);
+    factdb::append_int<uint32_t>(out, block.partitions_);
+    factdb::append_int<uint64_t>(out, block.rows_);
+    factdb::append_int<uint64_t>(out, block.deleted_rows_);
+    factdb::append_bytes(out, block.first_partition_);
+    factdb::append_bytes(out, block.last_partition_);
+    factdb::append_bytes(out, block.min_clustering_);
+    factdb::append_bytes(out, block.max_clustering_);
+    factdb::append_int<uint32_t>(out, static_cast<uint32_t>(block.columns_.size()));
+    for(const auto& [name, column] : block.columns_){
+        factdb::append_bytes(out, name);
+        factdb::append_int<uint64_t>(out, column.values_);
+        factdb::append_int<uint64_t>(out, column.ints_);
+        factdb::append_int<int64_t>(out, column.int_min_);
+        factdb::append_int<int64_t>(out, column.int_max_);
+        factdb::append_int<int64_t>(out, column.int_sum_);
+        factdb::append_int<uint64_t>(out, column.floats_);
+        factdb::append_int<double>(out, column.float_min_);
+        factdb::append_int<double>(out, column.float_max_);
+        factdb::append_int<double>(out, column.float_sum_);
+        factdb::append_int<uint8_t>(out, column.string_bounds_ ? 1 : 0);
+        factdb::append_bytes(out, column.string_min_);
+        factdb::append_bytes(out, column.string_max_);
+    }
+}
+factdb::BlockStatistics read_block(factdb::ByteReader& in){
+    factdb::BlockStatistics block;
+    block.position_ = in.read_int<uint64_t>();
+    block.length_ = in.read_int<uint64_t>();
+    block.partitions_ = in.read_int<uint32_t>();
+    block.rows_ = in.read_int<uint64_t>();
+    block.deleted_rows_ = in.read_int<uint64_t>();
+    block.first_partition_ = in.read_bytes();
+    block.last_partition_ = in.read_bytes();
+    block.min_clustering_ = in.read_bytes();
+    block.max_clustering_ = in.read_bytes();
+    uint32_t column_count = in.read_int<uint32_t>();
+    for(uint32_t c = 0; c < column_count; c++){
+        std::string name = in.read_string();
+        factdb::ColumnStatistics& column = block.columns_[name];
+        column.values_ = in.read_int<uint64_t>();
+        column.ints_ = in.read_int<uint64_t>();
+        column.int_min_ = in.read_int<int64_t>();
+        column.int_max_ = in.read_int<int64_t>();
+        column.int_sum_ = in.read_int<int64_t>();
+        column.floats_ = in.read_int<uint64_t>();
+        column.float_min_ = in.read_int<double>();
+        column.float_max_ = in.read_int<double>();
+        column.float_sum_ = in.read_int<double>();
+        column.string_bounds_ = in.read_int<uint8_t>() != 0;
+        column.string_min_ = in.read_string();
+        column.string_max_ = in.read_string();
+    }
+    return block;
+}
+}
+
+void factdb::ColumnStatistics::add(std::string_view value){
+    int64_t as_int;
+    if(parse_number(value, as_int)){
+        int_min_ = ints_ == 0 ? as_int : std::min(int_min_, as_int);
+        int_max_ = ints_ == 0 ? as_int : std::max(int_max_, as_int);
+        int_sum_ = static_cast<int64_t>(static_cast<uint64_t>(int_sum_) + static_cast<uint64_t>(as_int)); // wraps rather than overflowing
+        ints_++;
+    }
+    double as_float;
+    if(parse_number(value, as_float) && !std::isnan(as_float)){
+        float_min_ = floats_ == 0 ? as_float : std::min(float_min_, as_float);
+        float_max_ = floats_ == 0 ? as_float : std::max(float_max_, as_float);
+        float_sum_ += as_float;
+        floats_++;
+    }
+    if(value.size() > STATISTICS_MAX_STRING){
+        string_bounds_ = false;
+    }else if(string_bounds_){
+        if(values_ == 0 || value < string_min_){
+            string_min_ = value;
+        }
+        if(values_ == 0 || value > string_max_){
+            string_max_ = value;
+        }
+    }
+    values_++;
+}
+void factdb::ColumnStatistics::merge(const ColumnStatistics& other){
+    if(other.ints_ > 0){
+        int_min_ = ints_ == 0 ? other.int_min_ : std::min(int_min_, other.int_min_);
+        int_max_ = ints_ == 0 ? other.int_max_ : std::max(int_max_, other.int_max_);
+        int_sum_ = static_cast<int64_t>(static_cast<uint64_t>(int_sum_) + static_cast<uint64_t>(other.int_sum_));
+        ints_ += other.ints_;
+    }
+    if(other.floats_ > 0){
+        float_min_ = floats_ == 0 ? other.float_min_ : std::min(float_min_, other.float_min_);
+        float_max_ = floats_ == 0 ? other.float_max_ : std::max(float_max_, other.float_max_);
+        float_sum_ += other.float_sum_;
+        floats_ += other.floats_;
+    }
+    if(other.values_ > 0){
+        if(!other.string_bounds_){
+            string_bounds_ = false;
+        }else if(string_bounds_){
+            if(values_ == 0 || other.string_min_ < string_min_){
+                string_min_ = other.string_min_;
+            }
+            if(values_ == 0 || other.string_max_ > string_max_){
+                string_max_ = other.string_max_;
+            }
+        }
+        values_ += other.values_;
+    }
+}
+void factdb::BlockStatistics::add_partition(const Partition& partition, uint64_t position, uint64_t length){
+    if(partitions_ == 0){
+        position_ = position;
+        first_partition_ = partition.header_.key_;
+    }
+    length_ = position + length - position_;
+    last_partition_ = partition.header_.key_;
+    partitions_++;
+    for(const auto& unfiltered : partition.unfiltereds_){
+        const Row& row = static_cast<const Row&>(*unfiltered);
+        if(row_is_deleted(row)){
+            deleted_rows_++;
+            continue;
+        }
+        const auto& key = row_clustering_key(row);
+        widen(min_clustering_, max_clustering_, rows_ == 0, key, key);
+        rows_++;
+        for(const auto& cell : row.cells_){
+            const auto& name = cell.value_.key_;
+            columns_[std::string(name.begin(), name.end())].add(std::string_view(cell.value_.value_.data(), cell.value_.value_.size()));
+        }
+    }
+}
+void factdb::BlockStatistics::merge(const BlockStatistics& other){
+    if(other.partitions_ == 0){
+        return;
+    }
+    if(partitions_ == 0){
+        position_ = other.position_;
+        first_partition_ = other.first_partition_;
+    }
+    length_ = other.position_ + other.length_ - position_;
+    last_partition_ = other.last_partition_;
+    partitions_ += other.partitions_;
+    if(other.rows_ > 0){
+        widen(min_clustering_, max_clustering_, rows_ == 0, other.min_clustering_, other.max_clustering_);
+    }
+    rows_ += other.rows_;
+    deleted_rows_ += other.deleted_rows_;
+    for(const auto& [name, column] : other.columns_){
+        columns_[name].merge(column);
+    }
+}
+uint64_t factdb::EstimatedHistogram::bucket_bound(size_t i){
+    return histogram_bounds().at(i);
+}
+size_t factdb::EstimatedHistogram::bucket_(uint64_t value) const{
+    const auto& bounds = histogram_bounds();
+    return std::lower_bound(bounds.begin(), bounds.begin() + buckets(), value) - bounds.begin();
+}
+void factdb::EstimatedHistogram::merge(const EstimatedHistogram& other){
+    if(other.counts_.size() != counts_.size()){
+        throw std::invalid_argument("Histograms with different buckets do not merge");
+    }
+    for(size_t i = 0; i < counts_.size(); i++){
+        counts_[i] += other.counts_[i];
+    }
+}
+uint64_t factdb::EstimatedHistogram::count() const{
+    uint64_t total = 0;
+    for(uint64_t count : counts_){
+        total += count;
+    }
+    return total;
+}
+uint64_t factdb::EstimatedHistogram::percentile(double p) const{
+    uint64_t total = count();
+    if(total == 0){
+        return 0;
+    }
+    uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(std::clamp(p, 0.0, 1.0) * total)));
+    uint64_t seen = 0;
+    for(size_t i = 0; i < buckets(); i++){
+        seen += counts_[i];
+        if(seen >= rank){
+            return bucket_bound(i);
+        }
+    }
+    return UINT64_MAX;
+}
+double factdb::EstimatedHistogram::mean() const{
+    uint64_t total = count();
+    if(total == 0){
+        return 0;
+    }
+    double sum = 0;
+    for(size_t i = 0; i < counts_.size(); i++){
+        sum += static_cast<double>(counts_[i]) * bucket_bound(std::min(i, buckets() - 1));
+    }
+    return sum / total;
+}
+uint64_t factdb::EstimatedHistogram::count_at_least(uint64_t value) const{
+    uint64_t total = 0;
+    for(size_t i = bucket_(value); i < counts_.size(); i++){
+        total += counts_[i];
+    }
+    return total;
+}
+void factdb::EstimatedHistogram::serialize(std::string& out) const{
+    append_int<uint16_t>(out, static_cast<uint16_t>(buckets()));
+    uint16_t nonzero = static_cast<uint16_t>(counts_.size() - std::count(counts_.begin(), counts_.end(), 0));
+    append_int<uint16_t>(out, nonzero);
+    for(size_t i = 0; i < counts_.size(); i++){
+        if(counts_[i] != 0){
+            append_int<uint16_t>(out, static_cast<uint16_t>(i));
+            append_int<uint64_t>(out, counts_[i]);
+        }
+    }
+}
+factdb::EstimatedHistogram factdb::EstimatedHistogram::deserialize(ByteReader& in){
+    uint16_t buckets = in.read_int<uint16_t>();
+    if(buckets == 0 || buckets > MAX_HISTOGRAM_BUCKETS){
+        throw std::runtime_error("Corrupt partition histogram");
+    }
+    EstimatedHistogram histogram(buckets);
+    uint16_t nonzero = in.read_int<uint16_t>();
+    for(uint16_t n = 0; n < nonzero; n++){
+        uint16_t i = in.read_int<uint16_t>();
+        if(i > buckets){
+            throw std::runtime_error("Corrupt partition histogram");
+        }
+        histogram.counts_[i] = in.read_int<uint64_t>();
+    }
+    return histogram;
+}
+
+factdb::HyperLogLog::HyperLogLog(uint8_t precision) : precision_(precision){
+    if(precision < 4 || precision > 16){
+        throw std::invalid_argument("HyperLogLog precision must be between 4 and 16");
+    }
+    registers_.assign(size_t(1) << precision, 0);
+}
+uint64_t factdb::HyperLogLog::hash(const char* data, size_t length){
+    uint64_t h = 0xcbf29ce484222325ull; // FNV-1a, then MurmurHash3's finalizer to spread it into the top bits
+    for(size_t i = 0; i < length; i++){
+        h = (h ^ static_cast<unsigned char>(data[i])) * 0x100000001b3ull;
+    }
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdull;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ull;
+    h ^= h >> 33;
+    return h;
+}
+void factdb::HyperLogLog::add(uint64_t hash){
+    size_t index = hash >> (64 - precision_);
+    uint64_t rest = hash << precision_;
+    uint8_t rank = rest == 0 ? static_cast<uint8_t>(64 - precision_ + 1) : static_cast<uint8_t>(__builtin_clzll(rest) + 1);
+    registers_[index] = std::max(registers_[index], rank);
+}
+void factdb::HyperLogLog::merge(const HyperLogLog& other){
+    if(other.precision_ != precision_){
+        throw std::invalid_argument("HyperLogLog sketches of different precisions do not merge");
+    }
+    for(size_t i = 0; i < registers_.size(); i++){
+        registers_[i] = std::max(registers_[i], other.registers_[i]);
+    }
+}
+uint64_t factdb::HyperLogLog::estimate() const{
+    double m = static_cast<double>(registers_.size());
+    double sum = 0;
+    size_t zeros = 0;
+    for(uint8_t value : registers_){
+        sum += std::ldexp(1.0, -value);
+        zeros += value == 0;
+    }
+    double alpha = m == 16 ? 0.673 : m == 32 ? 0.697 : m == 64 ? 0.709 : 0.7213 / (1 + 1.079 / m);
+    double estimate = alpha * m * m / sum;
+    if(estimate <= 2.5 * m && zeros > 0){
+        estimate = m * std::log(m / zeros); // linear counting is closer while registers are still empty
+    }
+    return static_cast<uint64_t>(std::llround(estimate));
+}
+void factdb::HyperLogLog::serialize(std::string& out) const{
+    append_int<uint8_t>(out, precision_);
+    size_t nonzero = registers_.size() - std::count(registers_.begin(), registers_.end(), 0);
+    if(nonzero * 3 + sizeof(uint16_t) >= registers_.size()){
+        append_int<uint8_t>(out, HLL_DENSE);
+        out.append(reinterpret_cast<const char*>(registers_.data()), registers_.size());
+        return;
+    }
+    append_int<uint8_t>(out, HLL_SPARSE);
+    append_int<uint16_t>(out, static_cast<uint16_t>(nonzero));
+    for(size_t i = 0; i < registers_.size(); i++){
+        if(registers_[i] != 0){
+            append_int<uint16_t>(out, static_cast<uint16_t>(i));
+            append_int<uint8_t>(out, registers_[i]);
+        }
+    }
+}
+factdb::HyperLogLog factdb::HyperLogLog::deserialize(ByteReader& in){
+    uint8_t precision = in.read_int<uint8_t>();
+    if(precision < 4 || precision > 16){
+        throw std::runtime_error("Corrupt partition key sketch");
+    }
+    HyperLogLog sketch(precision);
+    uint8_t encoding = in.read_int<uint8_t>();
+    if(encoding == HLL_DENSE){
+        std::vector<char> registers = in.read_raw(sketch.registers_.size());
+        std::memcpy(sketch.registers_.data(), registers.data(), registers.size());
+    }else if(encoding == HLL_SPARSE){
+        uint16_t nonzero = in.read_int<uint16_t>();
+        for(uint16_t n = 0; n < nonzero; n++){
+            uint16_t i = in.read_int<uint16_t>();
+            if(i >= sketch.registers_.size()){
+                throw std::runtime_error("Corrupt partition key sketch");
+            }
+            sketch.registers_[i] = in.read_int<uint8_t>();
+        }
+    }else{
+        throw std::runtime_error("Corrupt partition key sketch");
+    }
+    return sketch;
+}
+
+void factdb::PartitionStatistics::add_partition(const Partition& partition, uint64_t length){
+    sizes_.add(length);
+    uint64_t cells = 0;
+    for(const auto& unfiltered : partition.unfiltereds_){
+        cells += static_cast<const Row&>(*unfiltered).cells_.size();
+    }
+    cells_.add(cells);
+    keys_.add(partition.header_.key_.data(), partition.header_.key_.size());
+}
+void factdb::PartitionStatistics::merge(const PartitionStatistics& other){
+    sizes_.merge(other.sizes_);
+    cells_.merge(other.cells_);
+    keys_.merge(other.keys_);
+}
+
+std::string factdb::StatisticsFile::serialize() const{
+    std::string out;
+    append_int<uint32_t>(out, STATISTICS_MAGIC);
+    write_block(out, totals_);
+    append_int<uint32_t>(out, static_cast<uint32_t>(blocks_.size()));
+    for(const auto& block : blocks_){
+        write_block(out, block);
+    }
+    partitions_.sizes_.serialize(out);
+    partitions_.cells_.serialize(out);
+    partitions_.keys_.serialize(out);
+    return out;
+}
+factdb::StatisticsFile factdb::StatisticsFile::deserialize(const std::string& data){
+    ByteReader in(data);
+    if(in.read_int<uint32_t>() != STATISTICS_MAGIC){
+        throw std::runtime_error("Not an SSTable statistics file");
+    }
+    StatisticsFile statistics;
+    statistics.totals_ = read_block(in);
+    uint32_t block_count = in.read_int<uint32_t>();
+    statistics.blocks_.reserve(block_count);
+    for(uint32_t b = 0; b < block_count; b++){
+        statistics.blocks_.push_back(read_block(in));
+    }
+    if(in.remaining() > 0){
+        statistics.partitions_.sizes_ = EstimatedHistogram::deserialize(in);
+        statistics.partitions_.cells_ = EstimatedHistogram::deserialize(in);
+        statistics.partitions_.keys_ = HyperLogLog::deserialize(in);
+    }
+    return statistics;
+}
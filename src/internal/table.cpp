@@ -0,0 +1,1148 @@
+#include <data/table.hpp>
+#include <internal/encoding.hpp>
+#include <internal/keycompare.hpp>
+#include <metrics/metrics.hpp>
+#include <metrics/tracing.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <map>
+#include <optional>
+#include <stdexcept>
+#include <thread>
+#include <unordered_map>
+
+// Commit log payload of one mutation:
+//   u8 type, u32 + partition key, u32 + cluster key, u32 row count, then per
+//   row u32 column count and per column u32 + name, u8 type, u32 + value.
+// A null value is written with a row count of zero. A BATCH record is
+//   u8 type, u32 partition count, then per partition u32 + partition key,
+//   u32 mutation count and per mutation u8 remove, u32 + cluster key, rows
+// with the rows laid out as above, so the whole batch replays or none of it.
+
+namespace {
+struct TableMetrics {
+    factdb::MetricsRegistry& registry = factdb::MetricsRegistry::global();
+    factdb::Histogram& insert = registry.histogram("factdb_table_insert_latency_ns", "Table::insert latency, commit log append included");
+    factdb::Histogram& update = registry.histogram("factdb_table_update_latency_ns", "Table::update latency, commit log append included");
+    factdb::Histogram& remove = registry.histogram("factdb_table_remove_latency_ns", "Table::remove latency, commit log append included");
+    factdb::Histogram& batch = registry.histogram("factdb_table_batch_latency_ns", "Table::apply latency per mutation batch");
+    factdb::Counter& mutations = registry.counter("factdb_table_mutations_total", "Rows inserted, updated or removed");
+    factdb::Histogram& get = registry.histogram("factdb_table_get_latency_ns", "Table::get latency");
+    factdb::Histogram& scan = registry.histogram("factdb_table_scan_latency_ns", "Table::scan latency");
+    factdb::Histogram& column_scan = registry.histogram("factdb_table_column_scan_latency_ns", "Table::scan_columns latency");
+    factdb::Histogram& flush = registry.histogram("factdb_flush_latency_ns", "Memtable flush duration");
+    factdb::Counter& flushes = registry.counter("factdb_flushes_total", "Memtables flushed to SSTables");
+    factdb::Counter& flushed_bytes = registry.counter("factdb_flush_bytes_total", "Key and value bytes flushed from memtables");
+    factdb::Counter& pressure_flushes = registry.counter("factdb_memory_pressure_flushes_total", "Flushes started by memtable memory past its soft limit");
+    factdb::Counter& failed_flushes = registry.counter("factdb_background_flush_failures_total", "Background flushes that threw; their rows stay frozen for the next flush");
+    factdb::Histogram& compaction = registry.histogram("factdb_compaction_latency_ns", "Compaction duration");
+    factdb::Counter& compacted_bytes = registry.counter("factdb_compaction_input_bytes_total", "Key and value bytes read by compactions");
+    factdb::Counter& compacted_rows = registry.counter("factdb_compaction_input_rows_total", "Rows read by compactions");
+    factdb::Counter& compaction_output_rows = registry.counter("factdb_compaction_output_rows_total", "Rows written by compactions");
+};
+TableMetrics& metrics(){
+    static TableMetrics table_metrics;
+    return table_metrics;
+}
+// SSTables store keys with u16 lengths, so longer ones are refused before they are logged
+void check_key_lengths(const std::string& partition_key, const std::string& cluster_key){
+    if(partition_key.size() > factdb::MAX_KEY_LENGTH || cluster_key.size() > factdb::MAX_KEY_LENGTH){
+        throw std::invalid_argument("Keys are limited to " + std::to_string(factdb::MAX_KEY_LENGTH) + " bytes");
+    }
+}
+// hard-links `from` as `to`, copying only when they are on different file systems
+void link_file(const std::string& from, const std::string& to){
+    std::error_code error;
+    std::filesystem::create_hard_link(from, to, error);
+    if(error == std::errc::cross_device_link){
+        error.clear();
+        std::filesystem::copy_file(from, to, error);
+    }
+    if(error){
+        throw std::runtime_error("Failed to link " + from + " as " + to + ": " + error.message());
+    }
+}
+// links each component of an SSTable into `directory` under its own name, unless already there
+void link_sstable(const std::string& data_path, const std::string& directory){
+    for(auto component : factdb::SSTABLE_COMPONENTS){
+        std::filesystem::path from = factdb::sstable_component_path(data_path, component);
+        std::string to = directory + "/" + from.filename().string();
+        if(std::filesystem::exists(from) && !std::filesystem::exists(to)){
+            link_file(from, to);
+        }
+    }
+}
+// links `from` over `to` through a temporary link and a rename, as the schema is saved
+void replace_link(const std::string& from, const std::string& to){
+    std::string tmp = to + ".tmp";
+    std::filesystem::remove(tmp);
+    link_file(from, tmp);
+    std::filesystem::rename(tmp, to);
+}
+void append_rows(std::string& payload, const factdb::MemtableRows& value){
+    factdb::append_int<uint32_t>(payload, value ? static_cast<uint32_t>(value->size()) : 0);
+    if(value){
+        for(const auto& row : *value){
+            auto columns = row->getallcols_();
+            factdb::append_int<uint32_t>(payload, static_cast<uint32_t>(columns.size()));
+            for(const auto& [name, column] : columns){
+                factdb::append_bytes(payload, name);
+                factdb::append_int<uint8_t>(payload, static_cast<uint8_t>(column->getcoltype_()));
+                factdb::append_bytes(payload, column->get_serialized_val_());
+            }
+        }
+    }
+}
+factdb::MemtableRows read_rows(factdb::ByteReader& in){
+    uint32_t row_count = in.read_int<uint32_t>();
+    factdb::MemtableRows value;
+    if(row_count > 0){
+        value = std::make_shared<std::vector<std::shared_ptr<factdb::MemtableRow>>>();
+        for(uint32_t r = 0; r < row_count; r++){
+            auto row = std::make_shared<factdb::MemtableRow>();
+            uint32_t column_count = in.read_int<uint32_t>();
+            for(uint32_t c = 0; c < column_count; c++){
+                std::string name = in.read_string();
+                auto column_type = static_cast<factdb::ColumnType>(in.read_int<uint8_t>());
+                row->addcol_(std::make_shared<factdb::MemtableColumn>(name, column_type, in.read_string()));
+            }
+            value->push_back(row);
+        }
+    }
+    return value;
+}
+const factdb::SimpleCell* find_cell(const factdb::Row& row, const std::string& column){
+    for(const auto& cell : row.cells_){
+        const auto& name = cell.value_.key_;
+        if(name.size() == column.size() && std::equal(name.begin(), name.end(), column.begin())){
+            return &cell;
+        }
+    }
+    return nullptr;
+}
+std::optional<std::string> cell_value(const factdb::Row& row, const std::string& column){
+    const factdb::SimpleCell* cell = find_cell(row, column);
+    if(!cell){
+        return std::nullopt;
+    }
+    return std::string(cell->value_.value_.begin(), cell->value_.value_.end());
+}
+}
+
+factdb::Table::Table(TableOptions options, IoEngine& io_engine)
+    : options_(std::move(options)), io_engine_(io_engine), manifest_(options_.data_dir, io_engine),
+      schema_(std::make_shared<SchemaRegistry>(options_.data_dir + "/SCHEMA", io_engine)){
+    options_.write_options.schema = schema_.get();
+    memtable_.set_schema(schema_);
+    if(options_.memory){
+        if(!options_.flush_executor){
+            flusher_ = std::thread([this](){ flusher_loop_(); });
+        }
+        memory_id_ = options_.memory->add_memtable([this](){ return flushable_.load(std::memory_order_relaxed); },
+                                                   [this](){ request_flush_(); });
+    }
+}
+factdb::Table::~Table(){
+    if(options_.memory){
+        options_.memory->remove_memtable(memory_id_); // no flush is asked for from here on
+    }
+    if(flusher_.joinable()){
+        {
+            std::lock_guard<std::mutex> guard(flusher_mutex_);
+            stopping_ = true;
+        }
+        flusher_cv_.notify_one();
+        flusher_.join(); // a flush in progress completes; a queued one is left to the commit log
+    }
+    if(options_.memory){
+        options_.memory->charge(MemorySubsystem::MEMTABLE, -static_cast<int64_t>(charged_.load()));
+    }
+}
+
+bool factdb::Table::open(){
+    manifest_.load();
+    schema_->load();
+    std::vector<uint64_t> generations = manifest_.generations();
+    std::vector<std::shared_ptr<SSTable>> tables(generations.size());
+    std::atomic<size_t> next(0);
+    std::atomic<bool> ok(true);
+    auto open_tables = [&](){
+        for(size_t i = next++; i < generations.size(); i = next++){
+            auto table = std::make_shared<SSTable>(manifest_.data_path(generations[i]), io_engine_);
+            table->set_block_cache(options_.write_options.block_cache);
+            if(!table->open()){
+                ok = false;
+            }
+            tables[i] = table;
+        }
+    };
+    size_t threads = std::min(options_.open_threads, generations.size());
+    if(threads <= 1){
+        open_tables();
+    }else{
+        std::vector<std::thread> workers;
+        for(size_t i = 0; i < threads; i++){
+            workers.emplace_back(open_tables);
+        }
+        for(auto& worker : workers){
+            worker.join();
+        }
+    }
+    if(!ok){
+        return false;
+    }
+    std::vector<std::string> new_indexes;
+    for(const auto& column : options_.indexed_columns){
+        TableOptions index_options = options_;
+        index_options.data_dir = options_.data_dir + "/index-" + column;
+        index_options.use_commitlog = false;
+        index_options.indexed_columns.clear();
+        index_options.memory = nullptr; // written and charged through this table's memtable
+        auto index = std::make_unique<Table>(index_options, io_engine_);
+        if(!std::filesystem::exists(index->manifest().get_file_path())){
+            new_indexes.push_back(column);
+        }
+        if(!index->open()){
+            return false;
+        }
+        memtable_.add_index(column, &index->memtable_);
+        indexes_[column] = std::move(index);
+    }
+    {
+        std::lock_guard<std::mutex> guard(mutex_);
+        sstables_ = std::move(tables);
+        generations_ = std::move(generations);
+        if(options_.use_commitlog){
+            // rows frozen by a flush that never finished are older than the live log's
+            if(std::filesystem::exists(flushing_commitlog_path())){
+                CommitLog::replay(flushing_commitlog_path(), [this](const std::string& payload){ replay_(payload); });
+                if(memtable_.empty()){
+                    std::filesystem::remove(flushing_commitlog_path());
+                }else{
+                    freeze_locked_(); // the log stays until they are written again
+                }
+            }
+            CommitLog::replay(commitlog_path(), [this](const std::string& payload){ replay_(payload); });
+            commitlog_ = std::make_shared<CommitLog>(commitlog_path(), io_engine_, options_.commitlog);
+        }
+        charge_memory_locked_();
+        backup_locked_(); // SSTables from before backups were enabled, or added by a bulk load
+    }
+    if(flushing_){
+        flush();
+    }
+    if(new_indexes.empty()){
+        return true;
+    }
+    // the replay indexed the memtable; rows already on disk are indexed here
+    std::vector<std::shared_ptr<Partition>> existing;
+    if(!generations_.empty()){
+        existing = merged_partitions();
+    }
+    std::lock_guard<std::mutex> guard(mutex_);
+    index_partitions_(existing, new_indexes);
+    for(const auto& column : new_indexes){
+        Table& index = *indexes_[column];
+        // an index with a manifest is complete and is not built again
+        if(!index.flush() && !index.manifest_.replace_tables({}, {})){
+            throw std::runtime_error("Failed to record index " + column + " in its manifest");
+        }
+    }
+    return true;
+}
+factdb::Table::LoggedWrite factdb::Table::log_mutation_(MutationType type, const std::string& partition_key, const std::string& cluster_key, const MemtableRows& value){
+    if(!commitlog_){
+        return LoggedWrite();
+    }
+    TraceScope span("commit log append");
+    std::string payload;
+    append_int<uint8_t>(payload, static_cast<uint8_t>(type));
+    append_bytes(payload, partition_key);
+    append_bytes(payload, cluster_key);
+    append_rows(payload, value);
+    return LoggedWrite{commitlog_, commitlog_->append(payload)};
+}
+factdb::Table::LoggedWrite factdb::Table::log_batch_(const MutationBatch& batch){
+    if(!commitlog_){
+        return LoggedWrite();
+    }
+    TraceScope span("commit log append");
+    std::string payload;
+    append_int<uint8_t>(payload, static_cast<uint8_t>(MutationType::BATCH));
+    append_int<uint32_t>(payload, static_cast<uint32_t>(batch.partitions().size()));
+    for(const auto& [partition_key, mutations] : batch.partitions()){
+        append_bytes(payload, partition_key);
+        append_int<uint32_t>(payload, static_cast<uint32_t>(mutations.size()));
+        for(const auto& mutation : mutations){
+            append_int<uint8_t>(payload, mutation.remove ? 1 : 0);
+            append_bytes(payload, mutation.key);
+            append_rows(payload, mutation.value);
+        }
+    }
+    return LoggedWrite{commitlog_, commitlog_->append(payload)};
+}
+void factdb::Table::durable_(const LoggedWrite& logged){
+    if(!logged.log){
+        return;
+    }
+    TraceScope span("commit log sync");
+    if(!logged.log->wait(logged.append)){
+        throw std::runtime_error("Failed to write the commit log " + logged.log->get_file_path());
+    }
+}
+void factdb::Table::replay_(const std::string& payload){
+    ByteReader in(payload);
+    auto type = static_cast<MutationType>(in.read_int<uint8_t>());
+    if(type == MutationType::BATCH){
+        MutationBatch batch;
+        uint32_t partition_count = in.read_int<uint32_t>();
+        for(uint32_t p = 0; p < partition_count; p++){
+            std::string partition_key = in.read_string();
+            uint32_t mutation_count = in.read_int<uint32_t>();
+            for(uint32_t m = 0; m < mutation_count; m++){
+                bool remove = in.read_int<uint8_t>() != 0;
+                std::string cluster_key = in.read_string();
+                MemtableRows value = read_rows(in);
+                if(remove){
+                    batch.remove(partition_key, cluster_key);
+                }else{
+                    batch.insert(partition_key, cluster_key, std::move(value));
+                }
+            }
+        }
+        batch.sort(); // logged sorted already, this only marks it
+        memtable_.apply(batch, next_sequence_locked_());
+        return;
+    }
+    std::string partition_key = in.read_string();
+    std::string cluster_key = in.read_string();
+    apply_locked_(type, partition_key, cluster_key, read_rows(in));
+}
+void factdb::Table::apply_locked_(MutationType type, const std::string& partition_key, const std::string& cluster_key, MemtableRows value){
+    TraceScope span("memtable apply");
+    uint64_t sequence = next_sequence_locked_();
+    switch(type){
+        case MutationType::INSERT:
+            memtable_.insert(partition_key, cluster_key, value, sequence);
+            break;
+        case MutationType::UPDATE:
+            if(!memtable_.update(partition_key, cluster_key, value, sequence)){ // the row may only exist on disk
+                memtable_.insert(partition_key, cluster_key, value, sequence);
+            }
+            break;
+        case MutationType::REMOVE:
+            if(!memtable_.remove(partition_key, cluster_key)){ // still needs a tombstone to shadow the sstables
+                memtable_.insert(partition_key, cluster_key, nullptr);
+                memtable_.remove(partition_key, cluster_key);
+            }
+            break;
+        case MutationType::BATCH:
+            throw std::logic_error("batches are applied through memtable_.apply");
+    }
+}
+uint64_t factdb::Table::next_sequence_locked_(){
+    // microseconds since the epoch, so a restart goes on above the sequences already on disk
+    auto now = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch());
+    sequence_ = std::max(sequence_ + 1, static_cast<uint64_t>(now.count()));
+    return sequence_;
+}
+void factdb::Table::insert(const std::string& partition_key, const std::string& cluster_key, MemtableRows value){
+    check_key_lengths(partition_key, cluster_key);
+    auto trace = TraceScope::request("Table::insert");
+    LatencyTimer timer(metrics().insert);
+    metrics().mutations.add();
+    admit_write_();
+    LoggedWrite logged;
+    {
+        std::lock_guard<std::mutex> guard(mutex_);
+        logged = log_mutation_(MutationType::INSERT, partition_key, cluster_key, value);
+        apply_locked_(MutationType::INSERT, partition_key, cluster_key, value);
+        charge_memory_locked_();
+    }
+    durable_(logged);
+}
+void factdb::Table::update(const std::string& partition_key, const std::string& cluster_key, MemtableRows value){
+    check_key_lengths(partition_key, cluster_key);
+    auto trace = TraceScope::request("Table::update");
+    LatencyTimer timer(metrics().update);
+    metrics().mutations.add();
+    admit_write_();
+    LoggedWrite logged;
+    {
+        std::lock_guard<std::mutex> guard(mutex_);
+        logged = log_mutation_(MutationType::UPDATE, partition_key, cluster_key, value);
+        apply_locked_(MutationType::UPDATE, partition_key, cluster_key, value);
+        charge_memory_locked_();
+    }
+    durable_(logged);
+}
+void factdb::Table::remove(const std::string& partition_key, const std::string& cluster_key){
+    check_key_lengths(partition_key, cluster_key);
+    auto trace = TraceScope::request("Table::remove");
+    LatencyTimer timer(metrics().remove);
+    metrics().mutations.add();
+    admit_write_();
+    LoggedWrite logged;
+    {
+        std::lock_guard<std::mutex> guard(mutex_);
+        logged = log_mutation_(MutationType::REMOVE, partition_key, cluster_key, nullptr);
+        apply_locked_(MutationType::REMOVE, partition_key, cluster_key, nullptr);
+        charge_memory_locked_();
+    }
+    durable_(logged);
+}
+void factdb::Table::apply(MutationBatch& batch){
+    if(batch.empty()){
+        return;
+    }
+    for(const auto& [partition_key, mutations] : batch.partitions()){
+        for(const auto& mutation : mutations){
+            check_key_lengths(partition_key, mutation.key);
+        }
+    }
+    auto trace = TraceScope::request("Table::apply");
+    LatencyTimer timer(metrics().batch);
+    metrics().mutations.add(batch.size());
+    batch.sort();
+    admit_write_();
+    LoggedWrite logged;
+    {
+        std::lock_guard<std::mutex> guard(mutex_);
+        logged = log_batch_(batch);
+        TraceScope span("memtable apply");
+        memtable_.apply(batch, next_sequence_locked_());
+        charge_memory_locked_();
+    }
+    durable_(logged);
+}
+void factdb::Table::admit_write_(){
+    MemoryManager* memory = options_.memory.get();
+    if(!memory){
+        return;
+    }
+    if(options_.wait_for_memory ? memory->wait_for_memtable_room() : memory->try_memtable_room()){
+        return;
+    }
+    if(options_.wait_for_memory){
+        memory->record_rejected_write();
+    }
+    throw MemoryLimitError("Memtable memory is at its limit in " + options_.data_dir);
+}
+void factdb::Table::request_flush_(){
+    {
+        std::lock_guard<std::mutex> guard(flusher_mutex_);
+        if(flush_requested_){
+            return;
+        }
+        flush_requested_ = true;
+    }
+    if(options_.flush_executor){
+        options_.flush_executor([this](){ run_requested_flush_(); });
+        return;
+    }
+    flusher_cv_.notify_one();
+}
+void factdb::Table::run_requested_flush_(){
+    {
+        std::lock_guard<std::mutex> guard(flusher_mutex_);
+        flush_requested_ = false; // a write asking while this one runs queues the next
+    }
+    metrics().pressure_flushes.add();
+    try{
+        flush();
+    }catch(const std::exception&){ // writers are refused at the hard limit until a later flush succeeds
+        metrics().failed_flushes.add();
+    }
+}
+void factdb::Table::flusher_loop_(){
+    std::unique_lock<std::mutex> lock(flusher_mutex_);
+    for(;;){
+        flusher_cv_.wait(lock, [this](){ return flush_requested_ || stopping_; });
+        if(stopping_){
+            return;
+        }
+        lock.unlock();
+        run_requested_flush_();
+        lock.lock();
+    }
+}
+void factdb::Table::charge_memory_locked_(){
+    if(!options_.memory){
+        return;
+    }
+    uint64_t active = memtable_.approximate_bytes();
+    uint64_t frozen = flushing_ ? flushing_->approximate_bytes() : 0;
+    for(const auto& [column, index] : indexes_){
+        std::lock_guard<std::mutex> guard(index->mutex_);
+        active += index->memtable_.approximate_bytes();
+        frozen += index->flushing_ ? index->flushing_->approximate_bytes() : 0;
+    }
+    uint64_t bytes = active + frozen;
+    flushable_.store(active, std::memory_order_relaxed);
+    uint64_t charged = charged_.exchange(bytes, std::memory_order_relaxed);
+    options_.memory->charge(MemorySubsystem::MEMTABLE, static_cast<int64_t>(bytes) - static_cast<int64_t>(charged));
+    if(active > 0 && options_.memory->should_flush(bytes)){
+        request_flush_();
+    }
+}
+std::shared_ptr<factdb::Row> factdb::Table::get(const std::string& partition_key, const std::string& cluster_key){
+    auto trace = TraceScope::request("Table::get");
+    LatencyTimer timer(metrics().get);
+    return read_row_(partition_key, cluster_key, nullptr, &trace);
+}
+std::shared_ptr<factdb::Row> factdb::Table::read_row_(const std::string& partition_key, const std::string& cluster_key,
+                                                      const std::function<bool(const Row&)>& visit, TraceScope* trace){
+    std::shared_ptr<Row> newest;
+    std::shared_ptr<Row> frozen;
+    std::vector<std::shared_ptr<SSTable>> tables;
+    {
+        std::lock_guard<std::mutex> guard(mutex_);
+        TraceScope span("memtable read");
+        newest = memtable_.get_row(partition_key, cluster_key);
+        if(flushing_){
+            frozen = flushing_->get_row(partition_key, cluster_key);
+        }
+        tables = sstables_;
+    }
+    if(trace && trace->active()){
+        trace->note(std::to_string(tables.size()) + " sstables");
+    }
+    std::shared_ptr<Row> result;
+    auto fold = [&](const std::shared_ptr<Row>& row){ // false once a deletion hides every older version
+        if(!row){
+            return true;
+        }
+        if(visit && !visit(*row)){
+            return false;
+        }
+        if(row_is_deleted(*row)){
+            return false;
+        }
+        if(!result){
+            result = row;
+        }else{
+            merge_older_cells(*result, *row);
+        }
+        return true;
+    };
+    if(!fold(newest) || !fold(frozen)){
+        return result;
+    }
+    std::vector<char> pkey(partition_key.begin(), partition_key.end());
+    std::vector<char> ckey(cluster_key.begin(), cluster_key.end());
+    for(auto it = tables.rbegin(); it != tables.rend(); ++it){
+        if(!fold((*it)->read_row(pkey, ckey))){
+            break;
+        }
+    }
+    return result;
+}
+std::vector<std::shared_ptr<factdb::Row>> factdb::Table::scan(const std::string& partition_key, const std::string& start,
+                                                             const std::string& end, size_t limit){
+    auto trace = TraceScope::request("Table::scan");
+    LatencyTimer timer(metrics().scan);
+    std::vector<std::vector<std::shared_ptr<Row>>> memtable_rows;
+    std::vector<std::shared_ptr<SSTable>> tables;
+    {
+        std::lock_guard<std::mutex> guard(mutex_);
+        TraceScope span("memtable read");
+        memtable_rows.push_back(memtable_.get_partition_rows(partition_key));
+        if(flushing_){
+            memtable_rows.push_back(flushing_->get_partition_rows(partition_key));
+        }
+        tables = sstables_;
+    }
+    if(trace.active()){
+        trace.note(std::to_string(tables.size()) + " sstables");
+    }
+    return merge_partition_(partition_key, memtable_rows, tables, start, end, limit);
+}
+size_t factdb::Table::scan_columns(const ColumnScan& scan, const ScanVisitor& visitor){
+    auto trace = TraceScope::request("Table::scan_columns");
+    LatencyTimer timer(metrics().column_scan);
+    ColumnAggregate pruning;
+    std::vector<std::string> data = scan_sources_(scan, "", pruning);
+    std::vector<std::string_view> sections(data.begin(), data.end());
+    size_t visited = scan_sections(sections, scan, visitor);
+    if(trace.active()){
+        trace.note(std::to_string(visited) + " rows, " + std::to_string(pruning.blocks_read) + " blocks read, " +
+                   std::to_string(pruning.blocks_skipped) + " skipped");
+    }
+    return visited;
+}
+factdb::ColumnAggregate factdb::Table::aggregate(const std::string& column, const ColumnScan& scan){
+    auto trace = TraceScope::request("Table::aggregate");
+    LatencyTimer timer(metrics().column_scan);
+    ColumnAggregate result;
+    std::vector<std::string> data = scan_sources_(scan, column, result);
+    std::vector<std::string_view> sections(data.begin(), data.end());
+    ColumnScan rows = scan;
+    rows.projection = {column};
+    result.rows += scan_sections(sections, rows, [&](const ScanRow& row){
+        if(row.values[0].data() != nullptr){
+            result.column.add(row.values[0]);
+        }
+    });
+    if(trace.active()){
+        trace.note(std::to_string(result.blocks_from_statistics) + " blocks from statistics, " + std::to_string(result.blocks_read) +
+                   " read, " + std::to_string(result.blocks_skipped) + " skipped");
+    }
+    return result;
+}
+std::vector<std::string> factdb::Table::scan_sources_(const ColumnScan& scan, const std::string& aggregate_column, ColumnAggregate& aggregate){
+    struct KeyRange {
+        std::vector<char> first;
+        std::vector<char> last;
+    };
+    std::vector<std::string> data;
+    std::vector<std::shared_ptr<SSTable>> tables;
+    std::vector<KeyRange> ranges; // partitions of every non-empty source
+    {
+        std::lock_guard<std::mutex> guard(mutex_);
+        TraceScope span("memtable read");
+        for(Memtable* memtable : {&memtable_, flushing_.get()}){
+            if(!memtable){
+                continue;
+            }
+            auto partitions = memtable->get_partitions();
+            if(!partitions.empty()){
+                ranges.push_back({partitions.front()->header_.key_, partitions.back()->header_.key_});
+            }
+            data.push_back(encode_sstable_section(partitions));
+        }
+        tables = sstables_; // holding them keeps retired files in place
+    }
+    for(const auto& table : tables){
+        if(table->partition_count() > 0){
+            ranges.push_back({table->summary().first_key_, table->summary().last_key_});
+        }
+    }
+    TraceScope span("data read");
+    BlockPruner pruner(scan);
+    for(auto it = tables.rbegin(); it != tables.rend(); ++it){
+        SSTable& table = **it;
+        const auto& first = table.summary().first_key_;
+        const auto& last = table.summary().last_key_;
+        size_t overlapping = 0; // itself included
+        for(const auto& range : ranges){
+            if(compare_binary_keys(range.first, last) <= 0 && compare_binary_keys(first, range.last) <= 0){
+                overlapping++;
+            }
+        }
+        // only rows no other source has a version of can be judged by their own statistics
+        auto statistics = table.partition_count() > 0 && overlapping <= 1 ? table.statistics() : nullptr;
+        std::vector<size_t> blocks;
+        if(statistics){
+            for(size_t b = 0; b < statistics->blocks_.size(); b++){
+                const BlockStatistics& block = statistics->blocks_[b];
+                switch(pruner.match(block)){
+                    case BlockMatch::NONE:
+                        aggregate.blocks_skipped++;
+                        continue;
+                    case BlockMatch::ALL:
+                        if(!aggregate_column.empty()){
+                            aggregate.rows += block.rows_;
+                            auto column = block.columns_.find(aggregate_column);
+                            if(column != block.columns_.end()){
+                                aggregate.column.merge(column->second);
+                            }
+                            aggregate.blocks_from_statistics++;
+                            continue;
+                        }
+                        break;
+                    case BlockMatch::SOME:
+                        break;
+                }
+                blocks.push_back(b);
+            }
+            if(blocks.empty()){
+                continue;
+            }
+        }
+        data.emplace_back();
+        bool read = statistics && blocks.size() < statistics->blocks_.size() ? table.read_blocks(blocks, data.back())
+                                                                             : table.read_data(data.back());
+        if(!read){
+            throw std::runtime_error("Failed to read " + table.get_file_path());
+        }
+        aggregate.blocks_read += statistics ? blocks.size() : 1;
+    }
+    return data;
+}
+std::vector<factdb::IndexedRow> factdb::Table::lookup(const std::string& column, const std::string& value, size_t limit){
+    auto trace = TraceScope::request("Table::lookup");
+    auto it = indexes_.find(column);
+    if(it == indexes_.end()){
+        throw std::invalid_argument("No index on column " + column);
+    }
+    Table& index = *it->second;
+    std::vector<std::vector<std::shared_ptr<Row>>> memtable_entries;
+    std::vector<std::shared_ptr<SSTable>> tables;
+    {
+        std::lock_guard<std::mutex> guard(mutex_);
+        TraceScope span("index memtable read");
+        memtable_entries.push_back(index.memtable_.get_partition_rows(value));
+        std::lock_guard<std::mutex> index_guard(index.mutex_); // its flushing_ and SSTables change together
+        if(index.flushing_){
+            memtable_entries.push_back(index.flushing_->get_partition_rows(value));
+        }
+        tables = index.sstables_;
+    }
+    std::vector<IndexedRow> rows;
+    size_t stale = 0;
+    for(const auto& entry : merge_partition_(value, memtable_entries, tables, "", "", 0)){
+        const auto& key = row_clustering_key(*entry);
+        IndexedRow indexed;
+        std::string cluster_key;
+        decode_index_key(std::string(key.begin(), key.end()), indexed.partition_key, cluster_key);
+        if(!indexed_row_(column, value, indexed.partition_key, cluster_key, *entry, &indexed.row)){ // overwritten or removed since it was indexed
+            stale++;
+            continue;
+        }
+        rows.push_back(std::move(indexed));
+        if(limit > 0 && rows.size() == limit){
+            break;
+        }
+    }
+    if(trace.active()){
+        trace.note(std::to_string(rows.size()) + " rows, " + std::to_string(stale) + " stale entries");
+    }
+    return rows;
+}
+bool factdb::Table::indexed_row_(const std::string& column, const std::string& value, const std::string& partition_key,
+                                 const std::string& cluster_key, const Row& entry, std::shared_ptr<Row>* row){
+    uint64_t sequence = entry.liveness_info_ ? entry.liveness_info_->delta_timestamp_ : 0;
+    bool decided = false;
+    bool live = false;
+    auto base = read_row_(partition_key, cluster_key, [&](const Row& version){
+        if(decided){
+            return true;
+        }
+        if(row_is_deleted(version)){
+            decided = true;
+            return false;
+        }
+        const SimpleCell* cell = find_cell(version, column);
+        if(!cell){ // an older version may hold it
+            return true;
+        }
+        decided = true;
+        uint64_t written = cell->delta_timestamp_.value_or(0);
+        if(sequence != 0 || written != 0){
+            live = written == sequence;
+        }else{ // both written before sequences
+            live = cell->value_.value_.size() == value.size() && std::equal(value.begin(), value.end(), cell->value_.value_.begin());
+        }
+        return live && row != nullptr; // older versions only fill in the row returned
+    }, nullptr);
+    if(live && row != nullptr){
+        *row = std::move(base);
+    }
+    return live;
+}
+std::vector<std::shared_ptr<factdb::Row>> factdb::Table::merge_partition_(const std::string& partition_key,
+                                                                         const std::vector<std::vector<std::shared_ptr<Row>>>& memtable_rows,
+                                                                         const std::vector<std::shared_ptr<SSTable>>& tables, const std::string& start,
+                                                                         const std::string& end, size_t limit){
+    struct Version {
+        std::shared_ptr<Row> row;   // null once a tombstone was seen first
+        bool closed;                // a deletion hides every older version
+    };
+    std::map<std::string, Version> versions;
+    auto fold = [&](const std::vector<std::shared_ptr<Row>>& rows){ // rows are freshly built, safe to merge into
+        for(const auto& row : rows){
+            const auto& key = row_clustering_key(*row);
+            std::string cluster_key(key.begin(), key.end());
+            if(cluster_key < start || (!end.empty() && cluster_key >= end)){
+                continue;
+            }
+            auto [it, inserted] = versions.try_emplace(cluster_key, Version{nullptr, false});
+            Version& version = it->second;
+            if(version.closed){
+                continue;
+            }
+            if(row_is_deleted(*row)){
+                version.closed = true;
+            }else if(!version.row){
+                version.row = row;
+            }else{
+                merge_older_cells(*version.row, *row);
+            }
+        }
+    };
+    for(const auto& rows : memtable_rows){
+        fold(rows);
+    }
+    std::vector<char> pkey(partition_key.begin(), partition_key.end());
+    for(auto it = tables.rbegin(); it != tables.rend(); ++it){
+        auto partition = (*it)->read_partition(pkey);
+        if(!partition){
+            continue;
+        }
+        std::vector<std::shared_ptr<Row>> rows;
+        rows.reserve(partition->unfiltereds_.size());
+        for(const auto& unfiltered : partition->unfiltereds_){
+            rows.push_back(std::static_pointer_cast<Row>(unfiltered));
+        }
+        fold(rows);
+    }
+    std::vector<std::shared_ptr<Row>> live;
+    for(auto& [cluster_key, version] : versions){
+        if(version.row){
+            live.push_back(version.row);
+            if(limit > 0 && live.size() == limit){
+                break;
+            }
+        }
+    }
+    return live;
+}
+std::shared_ptr<factdb::SSTable> factdb::Table::flush(){
+    std::lock_guard<std::mutex> flush_guard(flush_mutex_);
+    std::shared_ptr<SSTable> table;
+    if(flushing_){ // rows a failed flush left frozen go first
+        table = write_flushing_();
+    }
+    {
+        std::lock_guard<std::mutex> guard(mutex_);
+        if(memtable_.empty()){
+            return table;
+        }
+        freeze_locked_();
+        charge_memory_locked_(); // the frozen rows no longer count as flushable
+    }
+    return write_flushing_();
+}
+void factdb::Table::freeze_locked_(){
+    flushing_ = memtable_.freeze();
+    freeze_indexes_locked_();
+    if(commitlog_){ // the frozen rows keep their log until an SSTable holds them
+        commitlog_->sync(); // a failure reaches the writers waiting on their records
+        commitlog_.reset();
+        std::filesystem::rename(commitlog_path(), flushing_commitlog_path());
+        commitlog_ = std::make_shared<CommitLog>(commitlog_path(), io_engine_, options_.commitlog);
+        if(!sync_directory(options_.data_dir)){
+            throw std::runtime_error("Failed to sync " + options_.data_dir + " after moving its commit log aside");
+        }
+    }
+}
+void factdb::Table::freeze_indexes_locked_(){
+    for(auto& [column, index] : indexes_){ // each index's rows were flushed with the base's last time
+        std::lock_guard<std::mutex> guard(index->mutex_);
+        if(!index->memtable_.empty()){
+            index->flushing_ = index->memtable_.freeze();
+        }
+    }
+}
+std::shared_ptr<factdb::SSTable> factdb::Table::write_flushing_(){
+    LatencyTimer timer(metrics().flush);
+    // indexes go first: a crash before the base flush replays their entries again, which is harmless
+    for(auto& [column, index] : indexes_){
+        if(index->flushing_){
+            index->write_flushing_();
+        }
+    }
+    if(!flushing_){
+        return nullptr;
+    }
+    if(!schema_->save()){
+        throw std::runtime_error("Failed to save the schema " + schema_->get_file_path());
+    }
+    uint64_t generation = manifest_.allocate_generation();
+    std::string path = manifest_.data_path(generation);
+    // flushing_ only changes under flush_mutex_, which the caller holds, and the frozen rows are read-only
+    SSTable written(path, flushing_->get_partitions());
+    if(!written.write_to_file(options_.write_options)){
+        throw std::runtime_error("Failed to write SSTable " + path);
+    }
+    metrics().flushes.add();
+    metrics().flushed_bytes.add(written.data_size());
+    // reopen so the table serves lookups from disk instead of holding the flushed rows
+    auto table = std::make_shared<SSTable>(path, io_engine_);
+    table->set_block_cache(options_.write_options.block_cache);
+    if(!table->open()){
+        throw std::runtime_error("Failed to open flushed SSTable " + path);
+    }
+    std::lock_guard<std::mutex> guard(mutex_);
+    if(!manifest_.add_table(generation)){
+        throw std::runtime_error("Failed to record " + path + " in the manifest");
+    }
+    sstables_.push_back(table);
+    generations_.push_back(generation);
+    flushing_.reset(); // readers move from the frozen rows to the SSTable at once
+    backup_locked_();
+    if(options_.use_commitlog){ // the rows are now in an fsynced SSTable the fsynced manifest lists
+        std::filesystem::remove(flushing_commitlog_path());
+    }
+    charge_memory_locked_();
+    return table;
+}
+factdb::CompactionResult factdb::Table::compact(CompactionOptions options){
+    std::lock_guard<std::mutex> compaction_guard(compaction_mutex_);
+    std::vector<uint64_t> input_generations;
+    {
+        std::lock_guard<std::mutex> guard(mutex_);
+        input_generations = generations_;
+    }
+    if(input_generations.empty()){
+        return CompactionResult();
+    }
+    LatencyTimer timer(metrics().compaction);
+    std::vector<std::shared_ptr<SSTable>> inputs;
+    for(uint64_t generation : input_generations){
+        auto input = std::make_shared<SSTable>(manifest_.data_path(generation), io_engine_);
+        if(!input->read_from_file()){
+            throw std::runtime_error("Failed to read compaction input " + input->get_file_path());
+        }
+        inputs.push_back(input);
+    }
+    std::mutex output_mutex;
+    std::vector<std::pair<size_t, uint64_t>> outputs;
+    options.write_outputs = true;
+    options.write_options = options_.write_options;
+    options.output_path = [&](size_t range){
+        uint64_t generation = manifest_.allocate_generation();
+        std::lock_guard<std::mutex> guard(output_mutex);
+        outputs.emplace_back(range, generation);
+        return manifest_.data_path(generation);
+    };
+    CompactionResult result = Compactor(options).compact(inputs);
+    metrics().compacted_bytes.add(result.input_bytes);
+    metrics().compacted_rows.add(result.input_rows);
+    metrics().compaction_output_rows.add(result.output_rows);
+    std::sort(outputs.begin(), outputs.end());
+    std::vector<uint64_t> output_generations;
+    std::unordered_map<uint64_t, std::shared_ptr<SSTable>> opened;
+    for(const auto& [range, generation] : outputs){
+        auto table = std::make_shared<SSTable>(manifest_.data_path(generation), io_engine_);
+        table->set_block_cache(options_.write_options.block_cache);
+        if(!table->open()){
+            throw std::runtime_error("Failed to open compaction output " + table->get_file_path());
+        }
+        output_generations.push_back(generation);
+        opened[generation] = table;
+    }
+    {
+        std::lock_guard<std::mutex> guard(mutex_);
+        if(!manifest_.replace_tables(input_generations, output_generations)){
+            throw std::runtime_error("Failed to record compaction in the manifest");
+        }
+        for(size_t i = 0; i < generations_.size(); i++){
+            if(std::find(input_generations.begin(), input_generations.end(), generations_[i]) != input_generations.end()){
+                sstables_[i]->remove_on_close(); // readers still holding it finish first
+            }else{
+                opened[generations_[i]] = sstables_[i];
+            }
+        }
+        generations_ = manifest_.generations();
+        sstables_.clear();
+        for(uint64_t generation : generations_){
+            sstables_.push_back(opened[generation]);
+        }
+        backup_locked_();
+    }
+    for(auto& [column, index] : indexes_){ // an index's memtable is not involved, so no lock is needed
+        // Entries whose base row no longer holds their value are purged, so
+        // lookups skip stale entries only until the next compaction. An
+        // entry written again since is in the index memtable and survives.
+        CompactionOptions index_options = options;
+        index_options.drop = [this, column = column](const Partition& partition, const Row& entry){
+            std::string value(partition.header_.key_.begin(), partition.header_.key_.end());
+            const auto& key = row_clustering_key(entry);
+            std::string partition_key, cluster_key;
+            decode_index_key(std::string(key.begin(), key.end()), partition_key, cluster_key);
+            return !indexed_row_(column, value, partition_key, cluster_key, entry, nullptr);
+        };
+        index->compact(index_options);
+    }
+    return result;
+}
+std::vector<std::shared_ptr<factdb::Partition>> factdb::Table::merged_partitions(){
+    std::lock_guard<std::mutex> compaction_guard(compaction_mutex_); // keeps the generations' files in place
+    std::vector<uint64_t> generations;
+    std::shared_ptr<SSTable> frozen_rows;
+    std::shared_ptr<SSTable> memtable_rows;
+    {
+        std::lock_guard<std::mutex> guard(mutex_);
+        generations = generations_;
+        if(flushing_){
+            frozen_rows = std::make_shared<SSTable>("flushing", flushing_->get_partitions());
+        }
+        memtable_rows = std::make_shared<SSTable>("memtable", memtable_.get_partitions());
+    }
+    std::vector<std::shared_ptr<SSTable>> inputs;
+    for(uint64_t generation : generations){
+        auto input = std::make_shared<SSTable>(manifest_.data_path(generation), io_engine_);
+        if(!input->read_from_file()){
+            throw std::runtime_error("Failed to read " + input->get_file_path());
+        }
+        inputs.push_back(input);
+    }
+    if(frozen_rows){
+        inputs.push_back(frozen_rows);
+    }
+    inputs.push_back(memtable_rows);
+    CompactionOptions options;
+    options.write_outputs = false;
+    CompactionResult result = Compactor(options).compact(inputs);
+    std::vector<std::shared_ptr<Partition>> partitions;
+    for(const auto& output : result.outputs){
+        partitions.insert(partitions.end(), output->get_partitions().begin(), output->get_partitions().end());
+    }
+    return partitions;
+}
+std::shared_ptr<factdb::SSTable> factdb::Table::ingest(std::vector<std::shared_ptr<Partition>> partitions){
+    if(partitions.empty()){
+        return nullptr;
+    }
+    std::lock_guard<std::mutex> flush_guard(flush_mutex_); // no flush lists older rows after the ingested ones
+    if(flushing_){
+        write_flushing_();
+    }
+    {
+        std::lock_guard<std::mutex> guard(mutex_);
+        if(!memtable_.empty()){
+            freeze_locked_();
+        }
+    }
+    if(flushing_){
+        write_flushing_();
+    }
+    // written and opened unlisted, as a flush writes, so readers and writers go on meanwhile
+    uint64_t generation = manifest_.allocate_generation();
+    std::string path = manifest_.data_path(generation);
+    SSTable written(path, partitions);
+    if(!written.write_to_file(options_.write_options)){
+        throw std::runtime_error("Failed to write ingested SSTable " + path);
+    }
+    auto table = std::make_shared<SSTable>(path, io_engine_);
+    table->set_block_cache(options_.write_options.block_cache);
+    if(!table->open()){
+        throw std::runtime_error("Failed to open ingested SSTable " + path);
+    }
+    {
+        std::lock_guard<std::mutex> guard(mutex_);
+        if(!manifest_.add_table(generation)){
+            throw std::runtime_error("Failed to record " + path + " in the manifest");
+        }
+        sstables_.push_back(table);
+        generations_.push_back(generation);
+        backup_locked_();
+        if(indexes_.empty()){
+            return table;
+        }
+        // the rows bypassed the memtable, so index them here and write the entries out below
+        index_partitions_(partitions, options_.indexed_columns);
+        freeze_indexes_locked_();
+    }
+    for(auto& [column, index] : indexes_){
+        if(index->flushing_){
+            index->write_flushing_();
+        }
+    }
+    return table;
+}
+std::string factdb::Table::snapshot(const std::string& name){
+    if(name.empty() || name == "." || name == ".." || name.find('/') != std::string::npos){
+        throw std::invalid_argument("Invalid snapshot name \"" + name + "\"");
+    }
+    std::string directory = snapshot_dir(name);
+    if(std::filesystem::exists(directory)){
+        throw std::invalid_argument("Snapshot " + name + " already exists");
+    }
+    flush();
+    snapshot_to_(directory);
+    return directory;
+}
+void factdb::Table::snapshot_to_(const std::string& directory){
+    {
+        std::lock_guard<std::mutex> compaction_guard(compaction_mutex_); // keeps the generations' files in place
+        std::vector<uint64_t> generations;
+        {
+            std::lock_guard<std::mutex> guard(mutex_);
+            generations = generations_;
+        }
+        link_tables_(directory, generations);
+    }
+    for(auto& [column, index] : indexes_){
+        index->snapshot_to_(directory + "/index-" + column);
+    }
+}
+void factdb::Table::backup_locked_(){
+    if(options_.incremental_backups){
+        link_tables_(backup_dir(), generations_);
+    }
+}
+void factdb::Table::link_tables_(const std::string& directory, const std::vector<uint64_t>& generations) const{
+    std::filesystem::create_directories(directory);
+    for(uint64_t generation : generations){
+        link_sstable(manifest_.data_path(generation), directory);
+    }
+    // the schema is saved before each flush, so this one names every listed SSTable's columns
+    if(std::filesystem::exists(schema_->get_file_path())){
+        replace_link(schema_->get_file_path(), directory + "/SCHEMA");
+    }
+    if(!manifest_.save_as(directory, generations)){
+        throw std::runtime_error("Failed to write the manifest of " + directory);
+    }
+}
+void factdb::Table::restore(const std::string& source, const std::string& data_dir){
+    if(!std::filesystem::exists(source + "/MANIFEST")){
+        throw std::runtime_error("No manifest to restore in " + source);
+    }
+    if(std::filesystem::exists(data_dir + "/MANIFEST")){
+        throw std::runtime_error(data_dir + " already holds a table");
+    }
+    Manifest manifest(source);
+    manifest.load();
+    std::filesystem::create_directories(data_dir);
+    for(const auto& entry : std::filesystem::directory_iterator(source)){
+        std::string name = entry.path().filename().string();
+        if(entry.is_directory() && name.rfind("index-", 0) == 0 && std::filesystem::exists(entry.path() / "MANIFEST")){
+            restore(entry.path().string(), data_dir + "/" + name);
+        }
+    }
+    std::vector<uint64_t> generations = manifest.generations();
+    for(uint64_t generation : generations){
+        link_sstable(manifest.data_path(generation), data_dir);
+    }
+    if(std::filesystem::exists(source + "/SCHEMA")){
+        replace_link(source + "/SCHEMA", data_dir + "/SCHEMA");
+    }
+    if(!manifest.save_as(data_dir, generations)){
+        throw std::runtime_error("Failed to write the manifest of " + data_dir);
+    }
+}
+void factdb::Table::index_partitions_(const std::vector<std::shared_ptr<Partition>>& partitions, const std::vector<std::string>& columns){
+    for(const auto& column : columns){
+        Memtable& index = indexes_[column]->memtable_;
+        for(const auto& partition : partitions){
+            std::string partition_key(partition->header_.key_.begin(), partition->header_.key_.end());
+            for(const auto& unfiltered : partition->unfiltereds_){
+                const Row& row = *std::static_pointer_cast<Row>(unfiltered);
+                const SimpleCell* cell = row_is_deleted(row) ? nullptr : find_cell(row, column);
+                if(cell){
+                    const auto& key = row_clustering_key(row);
+                    index.insert(std::string(cell->value_.value_.begin(), cell->value_.value_.end()),
+                                 encode_index_key(partition_key, std::string(key.begin(), key.end())), nullptr, cell->delta_timestamp_.value_or(0));
+                }
+            }
+        }
+    }
+}
+std::vector<std::shared_ptr<factdb::SSTable>> factdb::Table::sstables() const{
+    std::lock_guard<std::mutex> guard(mutex_);
+    return sstables_;
+}
+factdb::PartitionStatistics factdb::Table::partition_statistics() const{
+    PartitionStatistics merged;
+    for(const auto& sstable : sstables()){
+        if(auto statistics = sstable->statistics()){
+            merged.merge(statistics->partitions_);
+        }
+    }
+    return merged;
+}
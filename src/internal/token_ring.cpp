@@ -0,0 +1,148 @@
+#include <cluster/token_ring.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+inline uint64_t rotl64(uint64_t x, int r){
+    return (x << r) | (x >> (64 - r));
+}
+inline uint64_t fmix64(uint64_t k){
+    k ^= k >> 33;
+    k *= 0xff51afd7ed558ccdULL;
+    k ^= k >> 33;
+    k *= 0xc4ceb9fe1a85ec53ULL;
+    k ^= k >> 33;
+    return k;
+}
+}
+
+factdb::Token factdb::murmur3_token(const char* data, size_t length){
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(data);
+    const size_t blocks = length / 16;
+    const uint64_t c1 = 0x87c37b91114253d5ULL;
+    const uint64_t c2 = 0x4cf5ad432745937fULL;
+    uint64_t h1 = 0;
+    uint64_t h2 = 0;
+
+    for(size_t i = 0; i < blocks; i++){
+        uint64_t k1;
+        uint64_t k2;
+        std::memcpy(&k1, bytes + i * 16, 8);
+        std::memcpy(&k2, bytes + i * 16 + 8, 8);
+        k1 *= c1; k1 = rotl64(k1, 31); k1 *= c2; h1 ^= k1;
+        h1 = rotl64(h1, 27); h1 += h2; h1 = h1 * 5 + 0x52dce729;
+        k2 *= c2; k2 = rotl64(k2, 33); k2 *= c1; h2 ^= k2;
+        h2 = rotl64(h2, 31); h2 += h1; h2 = h2 * 5 + 0x38495ab5;
+    }
+
+    const uint8_t* tail = bytes + blocks * 16;
+    uint64_t k1 = 0;
+    uint64_t k2 = 0;
+    switch(length & 15){
+        case 15: k2 ^= uint64_t(tail[14]) << 48; [[fallthrough]];
+        case 14: k2 ^= uint64_t(tail[13]) << 40; [[fallthrough]];
+        case 13: k2 ^= uint64_t(tail[12]) << 32; [[fallthrough]];
+        case 12: k2 ^= uint64_t(tail[11]) << 24; [[fallthrough]];
+        case 11: k2 ^= uint64_t(tail[10]) << 16; [[fallthrough]];
+        case 10: k2 ^= uint64_t(tail[9]) << 8; [[fallthrough]];
+        case 9:  k2 ^= uint64_t(tail[8]);
+                 k2 *= c2; k2 = rotl64(k2, 33); k2 *= c1; h2 ^= k2; [[fallthrough]];
+        case 8:  k1 ^= uint64_t(tail[7]) << 56; [[fallthrough]];
+        case 7:  k1 ^= uint64_t(tail[6]) << 48; [[fallthrough]];
+        case 6:  k1 ^= uint64_t(tail[5]) << 40; [[fallthrough]];
+        case 5:  k1 ^= uint64_t(tail[4]) << 32; [[fallthrough]];
+        case 4:  k1 ^= uint64_t(tail[3]) << 24; [[fallthrough]];
+        case 3:  k1 ^= uint64_t(tail[2]) << 16; [[fallthrough]];
+        case 2:  k1 ^= uint64_t(tail[1]) << 8; [[fallthrough]];
+        case 1:  k1 ^= uint64_t(tail[0]);
+                 k1 *= c1; k1 = rotl64(k1, 31); k1 *= c2; h1 ^= k1;
+    }
+
+    h1 ^= length;
+    h2 ^= length;
+    h1 += h2;
+    h2 += h1;
+    h1 = fmix64(h1);
+    h2 = fmix64(h2);
+    h1 += h2;
+    return static_cast<Token>(h1);
+}
+
+void factdb::TokenRing::add_node(const NodeEndpoint& node){
+    if(find_node(node.id)){
+        throw std::invalid_argument("node " + node.id + " is already in the ring");
+    }
+    nodes_.push_back(node);
+    size_t index = nodes_.size() - 1;
+    for(size_t v = 0; v < vnodes_; v++){
+        std::string seed = node.id + "#" + std::to_string(v);
+        Token token = murmur3_token(seed);
+        while(ring_.count(token)){ // keep every vnode token unique
+            token++;
+        }
+        ring_[token] = index;
+    }
+}
+void factdb::TokenRing::remove_node(const std::string& id){
+    auto it = std::find_if(nodes_.begin(), nodes_.end(), [&](const NodeEndpoint& node){ return node.id == id; });
+    if(it == nodes_.end()){
+        return;
+    }
+    std::vector<NodeEndpoint> remaining;
+    for(const auto& node : nodes_){
+        if(node.id != id){
+            remaining.push_back(node);
+        }
+    }
+    nodes_.clear();
+    ring_.clear();
+    for(const auto& node : remaining){
+        add_node(node);
+    }
+}
+const factdb::NodeEndpoint* factdb::TokenRing::find_node(const std::string& id) const{
+    for(const auto& node : nodes_){
+        if(node.id == id){
+            return &node;
+        }
+    }
+    return nullptr;
+}
+std::vector<factdb::NodeEndpoint> factdb::TokenRing::walk_(std::map<Token, size_t>::const_iterator from, size_t replication_factor) const{
+    std::vector<NodeEndpoint> replicas;
+    size_t wanted = std::min(replication_factor, nodes_.size());
+    auto it = from;
+    for(size_t steps = 0; steps < ring_.size() && replicas.size() < wanted; steps++, ++it){
+        if(it == ring_.end()){
+            it = ring_.begin();
+        }
+        const NodeEndpoint& node = nodes_[it->second];
+        if(std::find(replicas.begin(), replicas.end(), node) == replicas.end()){
+            replicas.push_back(node);
+        }
+    }
+    return replicas;
+}
+std::vector<factdb::NodeEndpoint> factdb::TokenRing::replicas(Token token, size_t replication_factor) const{
+    if(ring_.empty()){
+        return {};
+    }
+    return walk_(ring_.lower_bound(token), replication_factor);
+}
+std::vector<factdb::TokenRange> factdb::TokenRing::ranges_for(const std::string& id, size_t replication_factor) const{
+    std::vector<TokenRange> ranges;
+    if(ring_.empty()){
+        return ranges;
+    }
+    Token previous = std::prev(ring_.end())->first;
+    for(auto it = ring_.begin(); it != ring_.end(); ++it){
+        auto owners = walk_(it, replication_factor);
+        if(std::any_of(owners.begin(), owners.end(), [&](const NodeEndpoint& node){ return node.id == id; })){
+            ranges.push_back(TokenRange{previous, it->first});
+        }
+        previous = it->first;
+    }
+    return ranges;
+}
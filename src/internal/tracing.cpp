@@ -0,0 +1,149 @@
+#include <metrics/tracing.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <functional>
+#include <thread>
+
+namespace {
+// xorshift64*, seeded per thread; sampling needs speed, not quality
+uint64_t next_random(){
+    thread_local uint64_t state = std::hash<std::thread::id>()(std::this_thread::get_id()) | 1;
+    state ^= state >> 12;
+    state ^= state << 25;
+    state ^= state >> 27;
+    return state * 0x2545F4914F6CDD1Dull;
+}
+}
+
+factdb::Trace::Trace(uint64_t id, const char* request) : start_(std::chrono::steady_clock::now()){
+    record_.id = id;
+    record_.request = request;
+    record_.started_at_us = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+factdb::Trace::~Trace(){
+    record_.duration_ns = elapsed_ns();
+    Tracer::global().finish_(std::move(record_));
+}
+void factdb::Trace::add_span(const char* name, int64_t start_ns, int64_t duration_ns, std::string detail){
+    std::lock_guard<std::mutex> guard(mutex_);
+    record_.spans.push_back(TraceSpan{name, std::move(detail), start_ns, duration_ns});
+}
+
+factdb::Tracer& factdb::Tracer::global(){
+    static Tracer tracer;
+    return tracer;
+}
+void factdb::Tracer::set_probability(double probability){
+    uint64_t threshold = 0;
+    if(probability >= 1){
+        threshold = UINT64_MAX;
+    }else if(probability > 0){
+        double scaled = std::ldexp(probability, 64);
+        threshold = scaled >= std::ldexp(1.0, 64) ? UINT64_MAX : std::max<uint64_t>(1, static_cast<uint64_t>(scaled));
+    }
+    sample_threshold_.store(threshold, std::memory_order_relaxed);
+}
+double factdb::Tracer::probability() const{
+    uint64_t threshold = sample_threshold_.load(std::memory_order_relaxed);
+    return threshold == UINT64_MAX ? 1.0 : std::ldexp(static_cast<double>(threshold), -64);
+}
+void factdb::Tracer::set_capacity(size_t capacity){
+    std::lock_guard<std::mutex> guard(mutex_);
+    capacity_ = capacity;
+    while(finished_.size() > capacity_){
+        finished_.pop_front();
+    }
+}
+std::vector<factdb::TraceRecord> factdb::Tracer::recent(size_t limit) const{
+    std::lock_guard<std::mutex> guard(mutex_);
+    size_t count = limit == 0 ? finished_.size() : std::min(limit, finished_.size());
+    return std::vector<TraceRecord>(finished_.rbegin(), finished_.rbegin() + count);
+}
+std::string factdb::Tracer::text(size_t limit) const{
+    std::string out;
+    char line[256];
+    for(const auto& trace : recent(limit)){
+        std::snprintf(line, sizeof(line), "trace %llu %s started_at_us=%lld duration_us=%.1f\n",
+                      static_cast<unsigned long long>(trace.id), trace.request,
+                      static_cast<long long>(trace.started_at_us), trace.duration_ns / 1000.0);
+        out += line;
+        for(const auto& span : trace.spans){
+            std::snprintf(line, sizeof(line), "  +%.1fus %.1fus %s", span.start_ns / 1000.0, span.duration_ns / 1000.0, span.name);
+            out += line;
+            if(!span.detail.empty()){
+                out += " (" + span.detail + ")";
+            }
+            out += "\n";
+        }
+    }
+    return out;
+}
+void factdb::Tracer::clear(){
+    std::lock_guard<std::mutex> guard(mutex_);
+    finished_.clear();
+}
+bool factdb::Tracer::sample_(){
+    uint64_t threshold = sample_threshold_.load(std::memory_order_relaxed);
+    return threshold == UINT64_MAX || next_random() < threshold;
+}
+void factdb::Tracer::finish_(TraceRecord record){
+    std::lock_guard<std::mutex> guard(mutex_);
+    if(capacity_ == 0){
+        return;
+    }
+    if(finished_.size() == capacity_){
+        finished_.pop_front();
+    }
+    finished_.push_back(std::move(record));
+}
+
+struct factdb::TraceScope::Active {
+    Trace* trace;
+    std::shared_ptr<Trace> owned;   // a trace started or continued by this scope
+    Trace* previous = nullptr;      // current before it, restored on exit
+    bool records_span = false;
+    int64_t start_ns = 0;
+    std::string detail;
+};
+
+factdb::TraceScope::TraceScope(std::shared_ptr<Trace> trace) : name_(""){
+    if(!trace){
+        return;
+    }
+    active_ = new Active{trace.get(), std::move(trace), this_thread_trace, false, 0, {}};
+    this_thread_trace = active_->trace;
+}
+void factdb::TraceScope::note(std::string detail){
+    if(active_){
+        active_->detail = std::move(detail);
+    }
+}
+void factdb::TraceScope::join_(){
+    active_ = new Active{this_thread_trace, nullptr, nullptr, true, this_thread_trace->elapsed_ns(), {}};
+}
+void factdb::TraceScope::start_(bool force){
+    if(this_thread_trace != nullptr){
+        join_();
+        return;
+    }
+    if(!force && !Tracer::sample_()){
+        return;
+    }
+    Tracer& tracer = Tracer::global();
+    auto trace = std::make_shared<Trace>(tracer.next_id_.fetch_add(1, std::memory_order_relaxed), name_);
+    active_ = new Active{trace.get(), std::move(trace), nullptr, true, 0, {}};
+    this_thread_trace = active_->trace;
+}
+void factdb::TraceScope::exit_(){
+    std::unique_ptr<Active> active(active_);
+    if(active->records_span){
+        active->trace->add_span(name_, active->start_ns, active->trace->elapsed_ns() - active->start_ns, std::move(active->detail));
+    }
+    if(active->owned){
+        this_thread_trace = active->previous;
+        active->owned.reset(); // the last reference files the trace with the Tracer
+    }
+}
@@ -1,33 +1,249 @@
+#include <chrono>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
-#include "internal/skiplist.hpp"
-int main(){
-    std::cout << "Hello World" << std::endl; 
-    factdb::SkipList<int, int> skipList(4, 50.0f);
-
-    // Insert some values into the skip list
-    std::cout << "Inserting values into SkipList...\n";
-    skipList.insert(3, 3);
-    skipList.insert(4, 3);
-
-    // Display the current state of the skip list
-    std::cout << "Current state of the SkipList:\n";
-    skipList.display();
-    if(skipList.exists(4)){
-        std::cout <<  "Found 4"  << std::endl;
-    }
-    if(skipList.exists(5)){
-        std::cout <<  "FOUND 5" << std::endl;
-    }
-    skipList.update(4, 7);
-    // Test insertion of duplicate value
-    std::cout << "Inserting duplicate value (9)...\n";
-    skipList.insert(9, 3);
-
-    // Display the skip list again
-    std::cout << "State of the SkipList after attempting to insert duplicate:\n";
-    skipList.display();
-
-    // Additional tests could include removing values (if implemented), searching, etc.
-    
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <pthread.h>
+
+#include "cluster/coordinator.hpp"
+#include "cluster/repair.hpp"
+#include "data/sharded_table.hpp"
+#include "io/aligned_buffer_pool.hpp"
+#include "io/block_cache.hpp"
+#include "metrics/exporter.hpp"
+#include "metrics/tracing.hpp"
+#include "net/server.hpp"
+#include "runtime/memory_manager.hpp"
+#include "runtime/reactor.hpp"
+
+namespace {
+void usage(){
+    std::cerr << "usage: factdb [--address ADDR] [--port PORT] [--data DIR] [--shards N] [--no-commitlog]\n"
+                 "              [--commitlog-sync group|periodic] [--commitlog-sync-ms N] [--incremental-backups]\n"
+                 "              [--node-id ID --cluster ID=HOST:PORT,... [--rf N] [--vnodes N] [--timeout-ms N]\n"
+                 "               [--repair PEER_ID]]\n"
+                 "              [--metrics-port PORT] [--metrics-file PATH [--metrics-interval-ms N]]\n"
+                 "              [--trace-probability P] [--trace-capacity N]\n"
+                 "              [--memory-mb N [--max-write-stall-ms N]]\n";
+}
+// "a=127.0.0.1:9042,b=127.0.0.2:9042"
+bool parse_cluster(const std::string& spec, factdb::TokenRing& ring){
+    size_t begin = 0;
+    while(begin < spec.size()){
+        size_t end = spec.find(',', begin);
+        if(end == std::string::npos){
+            end = spec.size();
+        }
+        std::string node = spec.substr(begin, end - begin);
+        size_t equals = node.find('=');
+        size_t colon = node.rfind(':');
+        if(equals == std::string::npos || colon == std::string::npos || colon < equals){
+            return false;
+        }
+        ring.add_node(factdb::NodeEndpoint{node.substr(0, equals), node.substr(equals + 1, colon - equals - 1),
+                                           static_cast<uint16_t>(std::atoi(node.c_str() + colon + 1))});
+        begin = end + 1;
+    }
+    return !ring.nodes().empty();
+}
+}
+
+int main(int argc, char** argv){
+    factdb::ServerOptions server_options;
+    factdb::TableOptions table_options;
+    factdb::ReactorOptions reactor_options;
+    factdb::CoordinatorOptions coordinator_options;
+    std::string node_id;
+    std::string cluster;
+    size_t vnodes = 16;
+    std::string repair_peer;
+    factdb::MetricsExporterOptions metrics_options;
+    factdb::MemoryManagerOptions memory_options;
+    memory_options.budget_bytes = 0;
+    for(int i = 1; i < argc; i++){
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if(arg == "--address" && has_value){
+            server_options.address = argv[++i];
+        }else if(arg == "--port" && has_value){
+            server_options.port = static_cast<uint16_t>(std::atoi(argv[++i]));
+        }else if(arg == "--data" && has_value){
+            table_options.data_dir = argv[++i];
+        }else if(arg == "--shards" && has_value){
+            reactor_options.shards = std::strtoull(argv[++i], nullptr, 10);
+        }else if(arg == "--node-id" && has_value){
+            node_id = argv[++i];
+        }else if(arg == "--cluster" && has_value){
+            cluster = argv[++i];
+        }else if(arg == "--rf" && has_value){
+            coordinator_options.replication_factor = std::strtoull(argv[++i], nullptr, 10);
+        }else if(arg == "--vnodes" && has_value){
+            vnodes = std::strtoull(argv[++i], nullptr, 10);
+        }else if(arg == "--timeout-ms" && has_value){
+            coordinator_options.timeout = std::chrono::milliseconds(std::strtoull(argv[++i], nullptr, 10));
+        }else if(arg == "--repair" && has_value){
+            repair_peer = argv[++i];
+        }else if(arg == "--metrics-port" && has_value){
+            metrics_options.port = static_cast<uint16_t>(std::atoi(argv[++i]));
+        }else if(arg == "--metrics-file" && has_value){
+            metrics_options.dump_path = argv[++i];
+        }else if(arg == "--metrics-interval-ms" && has_value){
+            metrics_options.dump_interval = std::chrono::milliseconds(std::strtoull(argv[++i], nullptr, 10));
+        }else if(arg == "--trace-probability" && has_value){
+            factdb::Tracer::global().set_probability(std::atof(argv[++i]));
+        }else if(arg == "--trace-capacity" && has_value){
+            factdb::Tracer::global().set_capacity(std::strtoull(argv[++i], nullptr, 10));
+        }else if(arg == "--memory-mb" && has_value){
+            memory_options.budget_bytes = std::strtoull(argv[++i], nullptr, 10) << 20;
+        }else if(arg == "--max-write-stall-ms" && has_value){
+            memory_options.max_write_stall = std::chrono::milliseconds(std::strtoull(argv[++i], nullptr, 10));
+        }else if(arg == "--no-commitlog"){
+            table_options.use_commitlog = false;
+        }else if(arg == "--commitlog-sync" && has_value && (argv[i + 1] == std::string("group") || argv[i + 1] == std::string("periodic"))){
+            table_options.commitlog.sync = argv[++i] == std::string("group") ? factdb::CommitLogSync::GROUP : factdb::CommitLogSync::PERIODIC;
+        }else if(arg == "--commitlog-sync-ms" && has_value){
+            table_options.commitlog.sync_period = std::chrono::milliseconds(std::strtoull(argv[++i], nullptr, 10));
+        }else if(arg == "--incremental-backups"){
+            table_options.incremental_backups = true;
+        }else{
+            usage();
+            return 1;
+        }
+    }
+    factdb::TokenRing ring(vnodes);
+    if((!cluster.empty() && (node_id.empty() || !parse_cluster(cluster, ring) || !ring.find_node(node_id))) ||
+       (!repair_peer.empty() && !ring.find_node(repair_peer))){
+        usage();
+        return 1;
+    }
+
+    // block the shutdown signals before any thread starts so only sigwait sees them
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
+    // with a budget, memtables, the block cache and the flush buffers share it; declared before the tables they serve
+    std::unique_ptr<factdb::BlockCache> block_cache;
+    std::unique_ptr<factdb::AlignedBufferPool> buffer_pool;
+    if(memory_options.budget_bytes){
+        table_options.memory = std::make_shared<factdb::MemoryManager>(memory_options);
+        block_cache = std::make_unique<factdb::BlockCache>(UINT64_MAX, 64 * 1024, table_options.memory.get());
+        buffer_pool = std::make_unique<factdb::AlignedBufferPool>(256 * 1024, SIZE_MAX, table_options.memory.get());
+        table_options.write_options.block_cache = block_cache.get();
+        table_options.write_options.buffer_pool = buffer_pool.get();
+    }
+
+    factdb::Reactor reactor(reactor_options);
+    factdb::ShardedTable table(reactor, table_options);
+    bool opened = false;
+    try{
+        opened = table.open();
+    }catch(const std::exception& error){
+        std::cerr << error.what() << std::endl;
+    }
+    if(!opened){
+        std::cerr << "failed to open " << table_options.data_dir << std::endl;
+        return 1;
+    }
+    // declared after the reactor: peer sockets must close before the shards' io_contexts go away
+    factdb::ServerOptions options = server_options;
+    if(!cluster.empty()){
+        options.coordinator = std::make_shared<factdb::Coordinator>(reactor, ring, node_id, coordinator_options);
+    }
+    factdb::Server server(reactor, table, options);
+    server.start();
+
+    // components that keep their own counters are sampled when exported
+    auto& registry = factdb::MetricsRegistry::global();
+    using factdb::MetricType;
+    registry.register_callback("factdb_reactor_messages_total", "Messages delivered through the reactor's SPSC queues",
+                               MetricType::COUNTER, [&reactor]{ return static_cast<double>(reactor.stats().messages); });
+    registry.register_callback("factdb_reactor_overflows_total", "Messages posted because an SPSC queue was full",
+                               MetricType::COUNTER, [&reactor]{ return static_cast<double>(reactor.stats().overflows); });
+    registry.register_callback("factdb_io_submitted_total", "Operations submitted to the I/O engine", MetricType::COUNTER,
+                               []{ return static_cast<double>(factdb::default_io_engine().stats().submitted); });
+    registry.register_callback("factdb_io_batches_total", "Submission batches sent to the I/O engine's backend", MetricType::COUNTER,
+                               []{ return static_cast<double>(factdb::default_io_engine().stats().batches); });
+    registry.register_callback("factdb_server_requests_total", "Requests received by the server", MetricType::COUNTER,
+                               [&server]{ return static_cast<double>(server.stats().requests); });
+    std::vector<std::string> memory_metrics;
+    if(auto memory = table_options.memory){
+        for(size_t s = 0; s < factdb::MEMORY_SUBSYSTEM_COUNT; s++){
+            auto subsystem = static_cast<factdb::MemorySubsystem>(s);
+            std::string name = std::string("factdb_memory_") + factdb::memory_subsystem_name(subsystem);
+            registry.register_callback(name + "_bytes", "Bytes the subsystem holds of the memory budget", MetricType::GAUGE,
+                                       [memory, subsystem]{ return static_cast<double>(memory->usage(subsystem)); });
+            registry.register_callback(name + "_limit_bytes", "The subsystem's hard limit within the memory budget", MetricType::GAUGE,
+                                       [memory, subsystem]{ return static_cast<double>(memory->limit(subsystem)); });
+            memory_metrics.push_back(name + "_bytes");
+            memory_metrics.push_back(name + "_limit_bytes");
+        }
+        registry.register_callback("factdb_memory_write_stalls_total", "Writes that waited at the memtable memory limit", MetricType::COUNTER,
+                                   [memory]{ return static_cast<double>(memory->stats().write_stalls); });
+        registry.register_callback("factdb_memory_rejected_writes_total", "Writes refused at the memtable memory limit", MetricType::COUNTER,
+                                   [memory]{ return static_cast<double>(memory->stats().rejected_writes); });
+        memory_metrics.push_back("factdb_memory_write_stalls_total");
+        memory_metrics.push_back("factdb_memory_rejected_writes_total");
+    }
+    factdb::AlignedBufferPool* flush_buffers = buffer_pool ? buffer_pool.get() : &factdb::default_buffer_pool();
+    registry.register_callback("factdb_io_buffer_pool_occupancy", "Fraction of the flush buffer pool checked out", MetricType::GAUGE,
+                               [flush_buffers]{ return flush_buffers->occupancy(); });
+    factdb::MetricsExporter exporter(metrics_options);
+    exporter.start();
+    std::cout << "factdb listening on " << options.address << ":" << server.port()
+              << " with " << reactor.shard_count() << " shards";
+    if(options.coordinator){
+        std::cout << " as " << node_id << " of " << ring.nodes().size() << " nodes, rf "
+                  << coordinator_options.replication_factor;
+    }
+    std::cout << std::endl;
+    if(exporter.port()){
+        std::cout << "metrics on http://" << metrics_options.address << ":" << exporter.port() << "/metrics" << std::endl;
+    }
+
+    if(!repair_peer.empty()){
+        // the ranges both nodes hold a replica of
+        std::vector<factdb::TokenRange> shared;
+        for(const auto& range : ring.ranges_for(node_id, coordinator_options.replication_factor)){
+            for(const auto& replica : ring.replicas(range.end, coordinator_options.replication_factor)){
+                if(replica.id == repair_peer){
+                    shared.push_back(range);
+                }
+            }
+        }
+        const factdb::NodeEndpoint& peer = *ring.find_node(repair_peer);
+        try{
+            auto result = reactor.run_on(0, [&]{ return factdb::repair(reactor, table, peer, shared); }).get();
+            std::cout << "repaired " << result.ranges << " ranges with " << repair_peer << ": "
+                      << result.mismatched_leaves << "/" << result.leaves << " leaves differed, "
+                      << result.rows_received << " rows received, " << result.rows_sent << " rows sent, "
+                      << result.tree_bytes + result.received_bytes + result.sent_bytes << " of "
+                      << result.dataset_bytes << " dataset bytes transferred" << std::endl;
+        }catch(const std::exception& error){
+            std::cerr << "repair with " << repair_peer << " failed: " << error.what() << std::endl;
+        }
+    }
+
+    int received = 0;
+    sigwait(&signals, &received);
+    std::cout << "shutting down" << std::endl;
+    server.stop();
+    reactor.run_on(0, [&table]{ return table.flush(); }).wait();
+    reactor.stop();
+    exporter.stop(); // the final dump includes the shutdown flush
+    for(const char* name : {"factdb_reactor_messages_total", "factdb_reactor_overflows_total", "factdb_io_submitted_total",
+                            "factdb_io_batches_total", "factdb_server_requests_total",
+                            "factdb_io_buffer_pool_occupancy"}){
+        registry.remove_callback(name);
+    }
+    for(const auto& name : memory_metrics){
+        registry.remove_callback(name);
+    }
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,147 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <cstdio>
+#include <future>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include "data/commitlog.hpp"
+#include "io/async_file.hpp"
+
+namespace {
+class IoEngineTest : public ::testing::TestWithParam<std::string> {
+protected:
+    std::unique_ptr<factdb::IoEngine> engine;
+    std::string path = "test_async_file.dat";
+    int fd = -1;
+
+    void SetUp() override {
+        if (GetParam() == "io_uring") {
+            if (!factdb::IoUringEngine::supported()) {
+                GTEST_SKIP() << "io_uring is not available on this kernel";
+            }
+            engine = std::make_unique<factdb::IoUringEngine>(32);
+        } else {
+            engine = std::make_unique<factdb::ThreadPoolIoEngine>(2);
+        }
+        fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+        ASSERT_GE(fd, 0);
+    }
+    void TearDown() override {
+        if (fd >= 0) ::close(fd);
+        std::remove(path.c_str());
+    }
+};
+}
+
+TEST_P(IoEngineTest, WriteThenRead) {
+    std::string payload = "hello async io";
+    EXPECT_EQ(engine->write(fd, payload.data(), payload.size(), 0).get(), static_cast<ssize_t>(payload.size()));
+    EXPECT_EQ(engine->fsync(fd, true).get(), 0);
+    std::string buffer(payload.size(), '\0');
+    EXPECT_EQ(engine->read(fd, buffer.data(), buffer.size(), 0).get(), static_cast<ssize_t>(payload.size()));
+    EXPECT_EQ(buffer, payload);
+}
+
+TEST_P(IoEngineTest, ManyReadsInFlight) {
+    std::vector<char> data(64 * 4096);
+    for (size_t i = 0; i < data.size(); i++) data[i] = static_cast<char>(i / 4096);
+    ASSERT_EQ(engine->write_fully(fd, data.data(), data.size(), 0), static_cast<ssize_t>(data.size()));
+
+    // more requests than the 32-entry ring holds at once
+    std::vector<std::vector<char>> buffers(200, std::vector<char>(4096));
+    std::vector<std::future<ssize_t>> results;
+    for (size_t i = 0; i < buffers.size(); i++) {
+        results.push_back(engine->read(fd, buffers[i].data(), 4096, (i % 64) * 4096));
+    }
+    for (size_t i = 0; i < buffers.size(); i++) {
+        ASSERT_EQ(results[i].get(), 4096);
+        EXPECT_EQ(buffers[i][0], static_cast<char>(i % 64));
+    }
+    auto stats = engine->stats();
+    EXPECT_GE(stats.completed, buffers.size());
+}
+
+TEST_P(IoEngineTest, ErrorsAreNegativeErrno) {
+    char buffer[16];
+    EXPECT_LT(engine->read(-1, buffer, sizeof(buffer), 0).get(), 0);
+}
+
+TEST_P(IoEngineTest, RegisteredBuffers) {
+    std::vector<char> fixed(4096, 'r');
+    ASSERT_TRUE(engine->register_buffers({iovec{fixed.data(), fixed.size()}}));
+    EXPECT_EQ(engine->write_fixed(fd, 0, fixed.data(), fixed.size(), 0).get(), 4096);
+    std::fill(fixed.begin(), fixed.end(), 0);
+    EXPECT_EQ(engine->read_fixed(fd, 0, fixed.data(), fixed.size(), 0).get(), 4096);
+    EXPECT_EQ(fixed[4095], 'r');
+    EXPECT_TRUE(engine->register_buffers({}));
+}
+
+TEST_P(IoEngineTest, WholeFileHelpers) {
+    std::string contents(3 * factdb::ASYNC_FILE_CHUNK_SIZE + 17, 'x');
+    contents[factdb::ASYNC_FILE_CHUNK_SIZE] = 'y';
+    ASSERT_TRUE(factdb::write_file(*engine, path, contents.data(), contents.size(), true));
+    std::string loaded;
+    ASSERT_TRUE(factdb::read_file(*engine, path, loaded));
+    EXPECT_EQ(loaded, contents);
+    EXPECT_FALSE(factdb::read_file(*engine, "missing_async_file.dat", loaded));
+}
+
+INSTANTIATE_TEST_SUITE_P(Backends, IoEngineTest, ::testing::Values("threadpool", "io_uring"));
+
+TEST(CommitLogSuite, AppendSyncAndReplay) {
+    std::string path = "test_commitlog.log";
+    std::remove(path.c_str());
+    {
+        factdb::CommitLog log(path);
+        std::vector<factdb::CommitLog::Append> appends;
+        for (int i = 0; i < 50; i++) {
+            appends.push_back(log.append("mutation-" + std::to_string(i)));
+        }
+        EXPECT_TRUE(log.sync());
+        for (auto& a : appends) EXPECT_GT(a.written.get(), 0);
+    }
+    {
+        // reopening appends after the existing records
+        factdb::CommitLog log(path);
+        log.append("mutation-50");
+    }
+    std::vector<std::string> replayed;
+    EXPECT_EQ(factdb::CommitLog::replay(path, [&](const std::string& r) { replayed.push_back(r); }), 51);
+    ASSERT_EQ(replayed.size(), 51);
+    EXPECT_EQ(replayed[50], "mutation-50");
+
+    // a torn tail record is ignored
+    FILE* f = std::fopen(path.c_str(), "ab");
+    std::fwrite("\x10\x00\x00\x00garbage", 1, 11, f);
+    std::fclose(f);
+    EXPECT_EQ(factdb::CommitLog::replay(path, [](const std::string&) {}), 51);
+    std::remove(path.c_str());
+}
+
+TEST(CommitLogSuite, GroupCommitWaitsForASharedSync) {
+    std::string path = "test_commitlog_group.log";
+    std::remove(path.c_str());
+    {
+        factdb::CommitLogOptions options;
+        options.sync = factdb::CommitLogSync::GROUP;
+        factdb::CommitLog log(path, factdb::default_io_engine(), options);
+        std::vector<std::thread> writers;
+        std::atomic<int> durable{0};
+        for (int t = 0; t < 4; t++) {
+            writers.emplace_back([&log, &durable, t] {
+                for (int i = 0; i < 25; i++) {
+                    if (log.wait(log.append("w" + std::to_string(t) + "-" + std::to_string(i)))) durable++;
+                }
+            });
+        }
+        for (auto& writer : writers) writer.join();
+        EXPECT_EQ(durable.load(), 100);
+        EXPECT_FALSE(log.failed());
+    }
+    EXPECT_EQ(factdb::CommitLog::replay(path, [](const std::string&) {}), 100);
+    std::remove(path.c_str());
+}
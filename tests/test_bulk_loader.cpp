@@ -0,0 +1,174 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+#include "data/bulk_loader.hpp"
+#include "data/shard_map.hpp"
+#include "data/table.hpp"
+#include "test_util.hpp"
+
+namespace {
+void write_file(const std::string& path, const std::vector<std::string>& lines) {
+    std::ofstream out(path);
+    for (const auto& line : lines) {
+        out << line << "\n";
+    }
+}
+
+// the named cell's value, or "<none>"
+std::string cell(const std::shared_ptr<factdb::Row>& row, const std::string& name) {
+    for (const auto& c : row->cells_) {
+        if (std::string(c.value_.key_.begin(), c.value_.key_.end()) == name) {
+            return std::string(c.value_.value_.begin(), c.value_.value_.end());
+        }
+    }
+    return "<none>";
+}
+}
+
+TEST(BulkLoaderSuite, LoadsUnsortedCsvIntoSortedSSTables) {
+    std::string dir = fresh_dir("factdb_bulk_csv");
+    std::filesystem::create_directories(dir);
+    {
+        factdb::Table table(table_options(dir));
+        ASSERT_TRUE(table.open());
+        auto row = std::make_shared<factdb::MemtableRow>();
+        row->addcol_(std::make_shared<factdb::MemtableColumn>("name", factdb::ColumnType::STRING, "old"));
+        table.insert("p0", "c0", std::make_shared<std::vector<std::shared_ptr<factdb::MemtableRow>>>(1, row));
+        table.insert("existing", "c0", std::make_shared<std::vector<std::shared_ptr<factdb::MemtableRow>>>(1, row));
+        table.flush();
+    }
+
+    std::vector<std::string> lines;
+    for (int p = 0; p < 500; p++) {
+        for (int c = 0; c < 40; c++) {
+            lines.push_back("p" + std::to_string(p) + ",c" + std::to_string(c) + ",n" + std::to_string(p * 40 + c) + ",city" +
+                            std::to_string(c));
+        }
+    }
+    std::shuffle(lines.begin(), lines.end(), std::mt19937(7));
+    lines.push_back("p7,c3,renamed,");                          // later line wins; the empty field keeps the city
+    lines.push_back("p8,c4,\"quoted, with \"\"comma\"\"\",\"\"");  // a quoted empty field is kept
+    lines.insert(lines.begin(), "pk,ck,name,city");
+    write_file(dir + "/input.csv", lines);
+
+    factdb::BulkLoadOptions options;
+    options.data_dir = dir;
+    options.partition_column = "pk";
+    options.clustering_column = "ck";
+    options.threads = 4;
+    options.memory_bytes = 256 * 1024;
+    options.chunk_bytes = 16 * 1024;
+    options.sstable_bytes = 64 * 1024;
+    factdb::BulkLoadResult result = factdb::BulkLoader(options).load({dir + "/input.csv"});
+    EXPECT_EQ(result.rows, 500 * 40);
+    EXPECT_GT(result.runs, options.threads);
+    EXPECT_GT(result.sstables.size(), 1);
+    EXPECT_FALSE(std::filesystem::exists(dir + "/bulk-load.tmp"));
+
+    factdb::Table table(table_options(dir));
+    ASSERT_TRUE(table.open());
+    EXPECT_EQ(table.sstables().size(), result.sstables.size() + 1);
+    for (int p = 0; p < 500; p += 37) {
+        auto rows = table.scan("p" + std::to_string(p), "", "");
+        ASSERT_EQ(rows.size(), 40);
+        auto row = table.get("p" + std::to_string(p), "c12");
+        ASSERT_NE(row, nullptr);
+        EXPECT_EQ(cell(row, "name"), "n" + std::to_string(p * 40 + 12));
+        EXPECT_EQ(cell(row, "city"), "city12");
+    }
+    EXPECT_EQ(cell(table.get("p0", "c0"), "name"), "n0");  // shadows the flushed row
+    EXPECT_EQ(cell(table.get("existing", "c0"), "name"), "old");
+    EXPECT_EQ(cell(table.get("p7", "c3"), "name"), "renamed");
+    EXPECT_EQ(cell(table.get("p7", "c3"), "city"), "city3");
+    EXPECT_EQ(cell(table.get("p8", "c4"), "name"), "quoted, with \"comma\"");
+    EXPECT_EQ(cell(table.get("p8", "c4"), "city"), "");
+    std::filesystem::remove_all(dir);
+}
+
+TEST(BulkLoaderSuite, RoutesNdjsonRowsToShards) {
+    std::string dir = fresh_dir("factdb_bulk_ndjson");
+    std::filesystem::create_directories(dir);
+    std::vector<std::string> first;
+    std::vector<std::string> second;
+    for (int p = 0; p < 300; p++) {
+        auto& lines = p % 2 ? first : second;
+        lines.push_back("{\"id\": \"k" + std::to_string(p) + "\", \"ts\": \"t1\", \"count\": " + std::to_string(p) +
+                        ", \"ok\": true, \"gone\": null, \"text\": \"a\\\"b\\u00e9\\n\"}");
+    }
+    second.push_back("{\"id\":\"k1\",\"ts\":\"t1\",\"count\":-1}");  // the second file is newer
+    write_file(dir + "/a.json", first);
+    write_file(dir + "/b.json", second);
+
+    const size_t shards = 3;
+    factdb::BulkLoadOptions options;
+    options.data_dir = dir;
+    options.shards = shards;
+    options.format = factdb::BulkLoadFormat::NDJSON;
+    options.partition_column = "id";
+    options.clustering_column = "ts";
+    options.threads = 3;
+    factdb::BulkLoadResult result = factdb::BulkLoader(options).load({dir + "/a.json", dir + "/b.json"});
+    EXPECT_EQ(result.rows, 300);
+
+    std::vector<std::unique_ptr<factdb::Table>> tables;
+    for (size_t s = 0; s < shards; s++) {
+        tables.push_back(std::make_unique<factdb::Table>(table_options(dir + "/shard-" + std::to_string(s))));
+        ASSERT_TRUE(tables.back()->open());
+        EXPECT_FALSE(tables.back()->sstables().empty());
+    }
+    for (int p = 0; p < 300; p += 7) {
+        std::string key = "k" + std::to_string(p);
+        auto row = tables[factdb::shard_of_key(key, shards)]->get(key, "t1");
+        ASSERT_NE(row, nullptr) << key;
+        EXPECT_EQ(cell(row, "count"), std::to_string(p));
+        EXPECT_EQ(cell(row, "ok"), "true");
+        EXPECT_EQ(cell(row, "gone"), "<none>");
+        EXPECT_EQ(cell(row, "text"), "a\"b\xc3\xa9\n");
+    }
+    auto overridden = tables[factdb::shard_of_key("k1", shards)]->get("k1", "t1");
+    EXPECT_EQ(cell(overridden, "count"), "-1");
+    EXPECT_EQ(cell(overridden, "ok"), "true");
+    std::filesystem::remove_all(dir);
+}
+
+TEST(BulkLoaderSuite, MalformedInputRegistersNothing) {
+    std::string dir = fresh_dir("factdb_bulk_malformed");
+    std::filesystem::create_directories(dir);
+    std::vector<std::string> lines = {"pk,ck,v"};
+    for (int i = 0; i < 5000; i++) {
+        lines.push_back("p" + std::to_string(i) + ",c,v");
+    }
+    lines.push_back("p,c,\"unterminated");
+    write_file(dir + "/input.csv", lines);
+
+    factdb::BulkLoadOptions options;
+    options.data_dir = dir;
+    options.partition_column = "pk";
+    options.clustering_column = "ck";
+    options.threads = 2;
+    options.chunk_bytes = 4096;
+    try {
+        factdb::BulkLoader(options).load({dir + "/input.csv"});
+        FAIL() << "the load should have failed";
+    } catch (const std::runtime_error& e) {
+        EXPECT_NE(std::string(e.what()).find("input.csv at offset"), std::string::npos) << e.what();
+    }
+    options.partition_column = "missing";
+    EXPECT_THROW(factdb::BulkLoader(options).load({dir + "/input.csv"}), std::runtime_error);
+
+    for (const auto& entry : std::filesystem::directory_iterator(dir)) {
+        EXPECT_EQ(entry.path().filename().string().rfind("fdb-", 0), std::string::npos) << entry.path();
+        EXPECT_NE(entry.path().filename(), "bulk-load.tmp");
+    }
+    factdb::Table table(table_options(dir));
+    ASSERT_TRUE(table.open());
+    EXPECT_TRUE(table.sstables().empty());
+    EXPECT_EQ(table.get("p1", "c"), nullptr);
+    std::filesystem::remove_all(dir);
+}
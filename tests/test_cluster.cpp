@@ -0,0 +1,241 @@
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include "cluster/coordinator.hpp"
+#include "cluster/token_ring.hpp"
+#include "data/sharded_table.hpp"
+#include "net/client.hpp"
+#include "net/peer_connection.hpp"
+#include "net/server.hpp"
+#include "runtime/reactor.hpp"
+
+namespace {
+factdb::TokenRing make_ring(size_t nodes, size_t vnodes = 16) {
+    factdb::TokenRing ring(vnodes);
+    for (size_t i = 0; i < nodes; i++) {
+        ring.add_node(factdb::NodeEndpoint{"node" + std::to_string(i), "127.0.0.1", static_cast<uint16_t>(9000 + i)});
+    }
+    return ring;
+}
+uint16_t free_port() {
+    boost::asio::io_context io;
+    boost::asio::ip::tcp::acceptor acceptor(io, boost::asio::ip::tcp::endpoint(boost::asio::ip::make_address("127.0.0.1"), 0));
+    return acceptor.local_endpoint().port();
+}
+factdb::Request request(factdb::Opcode opcode, factdb::ConsistencyLevel consistency, const std::string& pk) {
+    factdb::Request request;
+    request.opcode = opcode;
+    request.consistency = consistency;
+    request.partition_key = pk;
+    request.cluster_key = "c";
+    if (opcode == factdb::Opcode::PUT) {
+        request.columns.push_back(factdb::WireColumn{"v", "value-" + pk});
+    }
+    return request;
+}
+
+// three in-process nodes on loopback, each a reactor, table and server of its own
+class ClusterTest : public ::testing::Test {
+protected:
+    struct Node {
+        std::unique_ptr<factdb::Reactor> reactor;
+        std::unique_ptr<factdb::ShardedTable> table;
+        std::unique_ptr<factdb::Server> server;
+    };
+
+    void SetUp() override {
+        dir = (std::filesystem::temp_directory_path() / "factdb_cluster_test").string();
+        std::filesystem::remove_all(dir);
+        factdb::TokenRing ring(8);
+        for (size_t i = 0; i < 3; i++) {
+            ring.add_node(factdb::NodeEndpoint{"node" + std::to_string(i), "127.0.0.1", free_port()});
+        }
+        factdb::CoordinatorOptions coordinator_options;
+        coordinator_options.replication_factor = 3;
+        coordinator_options.timeout = std::chrono::milliseconds(1000);
+        nodes.resize(3);
+        for (size_t i = 0; i < 3; i++) {
+            auto& node = nodes[i];
+            node.reactor = std::make_unique<factdb::Reactor>(factdb::ReactorOptions{2, 256, false});
+            factdb::TableOptions table_options;
+            table_options.data_dir = dir + "/node" + std::to_string(i);
+            table_options.use_commitlog = false;
+            node.table = std::make_unique<factdb::ShardedTable>(*node.reactor, table_options);
+            ASSERT_TRUE(node.table->open());
+            factdb::ServerOptions server_options;
+            server_options.port = ring.nodes()[i].port;
+            server_options.coordinator = std::make_shared<factdb::Coordinator>(*node.reactor, ring, ring.nodes()[i].id, coordinator_options);
+            node.server = std::make_unique<factdb::Server>(*node.reactor, *node.table, server_options);
+            node.server->start();
+            ports.push_back(node.server->port());
+        }
+    }
+    void TearDown() override {
+        for (size_t i = 0; i < nodes.size(); i++) {
+            stop_node(i);
+        }
+        std::filesystem::remove_all(dir);
+    }
+    void stop_node(size_t i) {
+        auto& node = nodes[i];
+        if (!node.reactor) return;
+        node.server->stop();
+        node.reactor->stop();
+        node.server.reset();
+        node.table.reset();
+        node.reactor.reset();
+    }
+    std::string dir;
+    std::vector<Node> nodes;
+    std::vector<uint16_t> ports;
+};
+}
+
+TEST(TokenRingSuite, Murmur3MatchesReferenceVector) {
+    EXPECT_EQ(factdb::murmur3_token("foo"), -2129773440516405919LL);
+    EXPECT_EQ(factdb::murmur3_token(""), 0);
+}
+
+TEST(TokenRingSuite, ReplicasAreDistinctAndCapped) {
+    auto ring = make_ring(5);
+    for (int i = 0; i < 500; i++) {
+        auto replicas = ring.replicas("key" + std::to_string(i), 3);
+        ASSERT_EQ(replicas.size(), 3);
+        std::set<std::string> ids;
+        for (const auto& node : replicas) ids.insert(node.id);
+        EXPECT_EQ(ids.size(), 3);
+    }
+    EXPECT_EQ(ring.replicas("key", 10).size(), 5);
+}
+
+TEST(TokenRingSuite, AddingANodeMovesAFractionOfKeys) {
+    auto ring = make_ring(4, 64);
+    const int keys = 4000;
+    std::vector<std::string> before;
+    for (int i = 0; i < keys; i++) {
+        before.push_back(ring.replicas("key" + std::to_string(i), 1)[0].id);
+    }
+    ring.add_node(factdb::NodeEndpoint{"node4", "127.0.0.1", 9004});
+    int moved = 0;
+    for (int i = 0; i < keys; i++) {
+        auto owner = ring.replicas("key" + std::to_string(i), 1)[0].id;
+        if (owner != before[i]) {
+            moved++;
+            EXPECT_EQ(owner, "node4");  // keys only move to the new node
+        }
+    }
+    EXPECT_GT(moved, keys / 10);
+    EXPECT_LT(moved, keys * 3 / 10);
+}
+
+TEST(TokenRingSuite, RangesCoverEveryReplica) {
+    auto ring = make_ring(4);
+    for (int i = 0; i < 200; i++) {
+        std::string key = "key" + std::to_string(i);
+        factdb::Token token = factdb::murmur3_token(key);
+        for (const auto& replica : ring.replicas(key, 2)) {
+            auto ranges = ring.ranges_for(replica.id, 2);
+            bool covered = false;
+            for (const auto& range : ranges) covered = covered || range.contains(token);
+            EXPECT_TRUE(covered) << key << " on " << replica.id;
+        }
+    }
+}
+
+TEST_F(ClusterTest, WriteAllThenReadOneFromEveryNode) {
+    factdb::Client writer("127.0.0.1", ports[0]);
+    for (int i = 0; i < 20; i++) {
+        auto response = writer.call(request(factdb::Opcode::PUT, factdb::ConsistencyLevel::ALL, "pk" + std::to_string(i)));
+        ASSERT_EQ(response.status, factdb::Status::OK) << response.message;
+    }
+    for (size_t n = 0; n < 3; n++) {
+        factdb::Client reader("127.0.0.1", ports[n]);
+        for (int i = 0; i < 20; i++) {
+            std::string pk = "pk" + std::to_string(i);
+            // LOCAL reads see the node's own copy, so every node holds every row
+            auto local = reader.call(request(factdb::Opcode::GET, factdb::ConsistencyLevel::LOCAL, pk));
+            ASSERT_EQ(local.status, factdb::Status::OK);
+            auto one = reader.call(request(factdb::Opcode::GET, factdb::ConsistencyLevel::ONE, pk));
+            ASSERT_EQ(one.status, factdb::Status::OK);
+            EXPECT_EQ(one.rows[0].columns[0].value, "value-" + pk);
+        }
+    }
+}
+
+TEST_F(ClusterTest, QuorumSurvivesOneNodeButAllDoesNot) {
+    stop_node(2);
+    factdb::Client client("127.0.0.1", ports[0]);
+    auto quorum = client.call(request(factdb::Opcode::PUT, factdb::ConsistencyLevel::QUORUM, "pk"));
+    EXPECT_EQ(quorum.status, factdb::Status::OK) << quorum.message;
+    auto read = client.call(request(factdb::Opcode::GET, factdb::ConsistencyLevel::QUORUM, "pk"));
+    EXPECT_EQ(read.status, factdb::Status::OK) << read.message;
+    auto all = client.call(request(factdb::Opcode::PUT, factdb::ConsistencyLevel::ALL, "pk"));
+    EXPECT_EQ(all.status, factdb::Status::ERROR);
+    EXPECT_NE(all.message.find("unavailable"), std::string::npos) << all.message;
+}
+
+TEST_F(ClusterTest, ReadsReturnRowsAnyReplicaHolds) {
+    factdb::Client client("127.0.0.1", ports[0]);
+    auto put = request(factdb::Opcode::PUT, factdb::ConsistencyLevel::ALL, "pk");
+    put.cluster_key = "a";
+    ASSERT_EQ(client.call(put).status, factdb::Status::OK);
+    // only node 1 sees "b" and the delete of "a", as if the others had missed them
+    factdb::Client replica("127.0.0.1", ports[1]);
+    put.consistency = factdb::ConsistencyLevel::LOCAL;
+    put.cluster_key = "b";
+    ASSERT_EQ(replica.call(put).status, factdb::Status::OK);
+    auto remove = request(factdb::Opcode::REMOVE, factdb::ConsistencyLevel::LOCAL, "pk");
+    remove.cluster_key = "a";
+    ASSERT_EQ(replica.call(remove).status, factdb::Status::OK);
+
+    auto get = request(factdb::Opcode::GET, factdb::ConsistencyLevel::LOCAL, "pk");
+    get.cluster_key = "b";
+    EXPECT_EQ(client.call(get).status, factdb::Status::NOT_FOUND);
+    get.consistency = factdb::ConsistencyLevel::ALL;
+    auto found = client.call(get);
+    ASSERT_EQ(found.status, factdb::Status::OK);
+    EXPECT_EQ(found.rows[0].columns.size(), 1);
+    // without timestamps the delete cannot shadow the other replicas' row
+    get.cluster_key = "a";
+    EXPECT_EQ(client.call(get).status, factdb::Status::OK);
+
+    auto scan = request(factdb::Opcode::SCAN, factdb::ConsistencyLevel::ALL, "pk");
+    scan.cluster_key = "";
+    auto rows = client.call(scan);
+    ASSERT_EQ(rows.status, factdb::Status::OK);
+    ASSERT_EQ(rows.rows.size(), 2);
+    EXPECT_EQ(rows.rows[0].cluster_key, "a");
+    EXPECT_EQ(rows.rows[1].cluster_key, "b");
+    scan.limit = 1;
+    rows = client.call(scan);
+    ASSERT_EQ(rows.status, factdb::Status::OK);
+    ASSERT_EQ(rows.rows.size(), 1);
+    EXPECT_EQ(rows.rows[0].cluster_key, "a");
+}
+
+TEST(PeerConnectionSuite, UnansweredRequestsTimeOut) {
+    boost::asio::io_context io;
+    boost::asio::ip::tcp::acceptor acceptor(io, boost::asio::ip::tcp::endpoint(boost::asio::ip::make_address("127.0.0.1"), 0));
+    boost::asio::ip::tcp::socket silent(io);  // accepts and never answers
+    acceptor.async_accept(silent, [](const boost::system::error_code&) {});
+    auto peer = std::make_shared<factdb::PeerConnection>(io, "127.0.0.1", acceptor.local_endpoint().port(),
+                                                         std::chrono::milliseconds(20));
+    std::vector<factdb::Future<factdb::Response>> responses;
+    for (int i = 0; i < 3; i++) {
+        responses.push_back(peer->send(request(factdb::Opcode::GET, factdb::ConsistencyLevel::LOCAL, "pk")));
+    }
+    EXPECT_EQ(peer->in_flight(), 3);
+    io.run_for(std::chrono::milliseconds(200));
+    for (auto& response : responses) {
+        ASSERT_TRUE(response.failed());
+        EXPECT_THROW(response.value(), std::runtime_error);
+    }
+    EXPECT_EQ(peer->in_flight(), 0);
+    EXPECT_TRUE(peer->connected());  // a slow peer is not a broken one
+    peer->close();
+}
@@ -0,0 +1,244 @@
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <vector>
+#include "data/columnar_scan.hpp"
+#include "data/memtable.hpp"
+#include "data/table.hpp"
+#include "test_util.hpp"
+
+namespace {
+std::string key(const char* prefix, size_t i) {
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), "%s%06zu", prefix, i);
+    return buffer;
+}
+
+// "cluster key=first projected value" of each row visited, in visiting order
+std::vector<std::string> collect(const std::vector<std::string_view>& sections, const factdb::ColumnScan& scan) {
+    std::vector<std::string> out;
+    size_t visited = factdb::scan_sections(sections, scan, [&](const factdb::ScanRow& row) {
+        std::string entry(row.clustering_key);
+        if (!scan.projection.empty()) {
+            entry += row.values[0].data() ? "=" + std::string(row.values[0]) : "=null";
+        }
+        out.push_back(entry);
+    });
+    EXPECT_EQ(visited, out.size());
+    return out;
+}
+
+factdb::ScanPredicate predicate(const std::string& column, factdb::ColumnType type, factdb::PredicateOp op,
+                                std::vector<std::string> operands) {
+    return factdb::ScanPredicate{column, type, op, std::move(operands)};
+}
+}
+
+TEST(ColumnarScanSuite, EvaluatesPredicatesPerType) {
+    factdb::Memtable memtable;
+    memtable.insert("p", "a", make_rows({{"qty", "5"}, {"price", "1.5"}, {"name", "apple"}}));
+    memtable.insert("p", "b", make_rows({{"qty", "12"}, {"price", "0.25"}, {"name", "banana"}}));
+    memtable.insert("p", "c", make_rows({{"qty", "-3"}, {"price", "9"}, {"name", "cherry"}}));
+    memtable.insert("p", "d", make_rows({{"qty", "many"}, {"name", "date"}})); // fails every numeric predicate
+    std::string section = factdb::encode_sstable_section(memtable.get_partitions());
+    using factdb::ColumnType;
+    using factdb::PredicateOp;
+
+    factdb::ColumnScan scan;
+    scan.projection = {"name"};
+    scan.predicates = {predicate("qty", ColumnType::INT, PredicateOp::GT, {"4"})};
+    EXPECT_EQ(collect({section}, scan), (std::vector<std::string>{"a=apple", "b=banana"}));
+    scan.predicates = {predicate("qty", ColumnType::INT, PredicateOp::RANGE, {"-3", "5"})};
+    EXPECT_EQ(collect({section}, scan), (std::vector<std::string>{"a=apple", "c=cherry"}));
+    scan.predicates = {predicate("price", ColumnType::FLOAT, PredicateOp::LT, {"1.5"})};
+    EXPECT_EQ(collect({section}, scan), std::vector<std::string>{"b=banana"});
+    scan.predicates = {predicate("name", ColumnType::STRING, PredicateOp::IN, {"date", "apple", "fig"})};
+    EXPECT_EQ(collect({section}, scan), (std::vector<std::string>{"a=apple", "d=date"}));
+    scan.predicates = {predicate("name", ColumnType::STRING, PredicateOp::RANGE, {"b", "c"}),
+                       predicate("qty", ColumnType::INT, PredicateOp::EQ, {"12"})};
+    EXPECT_EQ(collect({section}, scan), std::vector<std::string>{"b=banana"});
+    scan.projection = {"price"};
+    scan.predicates = {};
+    EXPECT_EQ(collect({section}, scan), (std::vector<std::string>{"a=1.5", "b=0.25", "c=9", "d=null"}));
+
+    scan.predicates = {predicate("qty", ColumnType::INT, PredicateOp::EQ, {"1.5"})};
+    EXPECT_THROW(collect({section}, scan), std::invalid_argument);
+    scan.predicates = {predicate("qty", ColumnType::INT, PredicateOp::RANGE, {"1"})};
+    EXPECT_THROW(collect({section}, scan), std::invalid_argument);
+    scan.predicates = {predicate("qty", ColumnType::BOOL, PredicateOp::EQ, {"1"})};
+    EXPECT_THROW(collect({section}, scan), std::invalid_argument);
+}
+
+TEST(ColumnarScanSuite, SpansManyBlocks) {
+    factdb::Memtable memtable;
+    size_t rows = 3 * factdb::SCAN_BLOCK_ROWS + 7; // a partial last block and a tail after the wide lanes
+    for (size_t i = 0; i < rows; i++) {
+        memtable.insert(key("p", i % 5), key("c", i), make_rows({{"n", std::to_string(i)}, {"x", std::to_string(i * 0.5)}}));
+    }
+    std::string section = factdb::encode_sstable_section(memtable.get_partitions());
+    factdb::ColumnScan scan;
+    scan.predicates = {predicate("n", factdb::ColumnType::INT, factdb::PredicateOp::IN, {"0", "1029", "3078", "3078", "99999"}),
+                       predicate("x", factdb::ColumnType::FLOAT, factdb::PredicateOp::GT, {"-1"})};
+    EXPECT_EQ(collect({section}, scan), (std::vector<std::string>{"c000000", "c003078", "c001029"}));
+
+    size_t count = factdb::scan_sections({section}, factdb::ColumnScan{{}, {predicate("n", factdb::ColumnType::INT, factdb::PredicateOp::LT, {"2000"})}},
+                                         [](const factdb::ScanRow&) {});
+    EXPECT_EQ(count, 2000u);
+}
+
+TEST(ColumnarScanSuite, TableMergesVersionsAcrossSources) {
+    std::string dir = fresh_dir("factdb_columnar_scan_test");
+    factdb::TableOptions options;
+    options.data_dir = dir;
+    factdb::Table table(options);
+    ASSERT_TRUE(table.open());
+    table.insert("p", "a", make_rows({{"qty", "1"}, {"tag", "old"}}));
+    table.insert("p", "b", make_rows({{"qty", "2"}, {"tag", "old"}}));
+    table.insert("p", "c", make_rows({{"qty", "3"}, {"tag", "old"}}));
+    table.insert("q", "d", make_rows({{"qty", "4"}, {"tag", "old"}}));
+    table.flush();
+    table.update("p", "a", make_rows({{"tag", "new"}}));   // qty only on disk
+    table.remove("p", "b");
+    table.flush();
+    table.update("p", "c", make_rows({{"qty", "30"}}));    // memtable shadows both sstables
+
+    factdb::ColumnScan scan;
+    scan.projection = {"tag"};
+    scan.predicates = {predicate("qty", factdb::ColumnType::INT, factdb::PredicateOp::LT, {"10"})};
+    std::vector<std::string> found;
+    table.scan_columns(scan, [&](const factdb::ScanRow& row) {
+        found.push_back(std::string(row.partition_key) + "/" + std::string(row.clustering_key) + "=" + std::string(row.values[0]));
+    });
+    EXPECT_EQ(found, (std::vector<std::string>{"p/a=new", "q/d=old"}));
+
+    scan.predicates = {predicate("qty", factdb::ColumnType::INT, factdb::PredicateOp::GT, {"10"})};
+    EXPECT_EQ(table.scan_columns(scan, [](const factdb::ScanRow& row) { EXPECT_EQ(row.values[0], "old"); }), 1u);
+    std::filesystem::remove_all(dir);
+}
+
+TEST(ColumnarScanSuite, StatisticsComponentHoldsZoneMaps) {
+    std::string dir = fresh_dir("factdb_statistics_test");
+    std::vector<std::shared_ptr<factdb::Partition>> partitions;
+    {
+        factdb::Memtable memtable;
+        for (size_t i = 0; i < 3000; i++) { // 30 partitions of 100 rows: blocks close at 1100, 2200 and the end
+            if (i % 7 == 0) {
+                memtable.insert(key("p", i / 100), key("c", i), make_rows({{"v", std::to_string(i)}}));
+            } else {
+                memtable.insert(key("p", i / 100), key("c", i), make_rows({{"v", std::to_string(i)}, {"label", i % 2 ? "odd" : "even"}}));
+            }
+        }
+        memtable.remove(key("p", 0), key("c", 0));
+        partitions = memtable.get_partitions();
+    }
+    std::string path = dir + "/fdb-1-Data.db";
+    factdb::SSTable(path, partitions).write_to_file();
+    factdb::SSTable table(path);
+    ASSERT_TRUE(table.open());
+    auto statistics = table.statistics();
+    ASSERT_NE(statistics, nullptr);
+    ASSERT_EQ(statistics->blocks_.size(), 3u);
+    const auto& first = statistics->blocks_[0];
+    EXPECT_EQ(first.partitions_, 11u);
+    EXPECT_EQ(first.rows_, 1099u);
+    EXPECT_EQ(first.deleted_rows_, 1u);
+    EXPECT_EQ(std::string(first.min_clustering_.begin(), first.min_clustering_.end()), key("c", 1));
+    EXPECT_EQ(first.columns_.at("v").int_min_, 1);
+    EXPECT_EQ(first.columns_.at("v").int_max_, 1099);
+    EXPECT_EQ(first.columns_.at("label").values_, 1099u - 157u); // every seventh row has no label
+    EXPECT_EQ(first.columns_.at("label").string_min_, "even");
+    EXPECT_EQ(first.columns_.at("label").ints_, 0u);
+
+    const auto& totals = statistics->totals_;
+    EXPECT_EQ(totals.rows_, 2999u);
+    EXPECT_EQ(totals.columns_.at("v").int_sum_, 2999 * 3000 / 2);
+    EXPECT_EQ(totals.columns_.at("v").float_max_, 2999.0);
+    EXPECT_EQ(totals.position_, statistics->blocks_[0].position_);
+    EXPECT_EQ(totals.length_, std::filesystem::file_size(path) - totals.position_);
+
+    std::string section;
+    ASSERT_TRUE(table.read_blocks({1, 2}, section));
+    factdb::ColumnScan scan;
+    EXPECT_EQ(factdb::scan_sections({section}, scan, [](const factdb::ScanRow&) {}), 1900u);
+    EXPECT_TRUE(table.remove_files());
+    EXPECT_FALSE(std::filesystem::exists(dir + "/fdb-1-Statistics.db"));
+    std::filesystem::remove_all(dir);
+}
+
+TEST(ColumnarScanSuite, MatchBlockReadsZoneMaps) {
+    factdb::Partition partition;
+    partition.header_.key_ = {'p'};
+    for (int i = 10; i <= 20; i++) {
+        factdb::Memtable memtable;
+        memtable.insert("p", key("c", i), make_rows({{"n", std::to_string(i)}, {"s", "m"}}));
+        partition.unfiltereds_.push_back(memtable.get_partitions()[0]->unfiltereds_[0]);
+    }
+    factdb::BlockStatistics block;
+    block.add_partition(partition, 0, 100);
+    using factdb::BlockMatch;
+    using factdb::ColumnType;
+    using factdb::PredicateOp;
+    auto match = [&](factdb::ScanPredicate p, std::string start = "", std::string end = "") {
+        return factdb::match_block(block, factdb::ColumnScan{{}, {std::move(p)}, std::move(start), std::move(end)});
+    };
+    EXPECT_EQ(match(predicate("n", ColumnType::INT, PredicateOp::GT, {"20"})), BlockMatch::NONE);
+    EXPECT_EQ(match(predicate("n", ColumnType::INT, PredicateOp::GT, {"15"})), BlockMatch::SOME);
+    EXPECT_EQ(match(predicate("n", ColumnType::INT, PredicateOp::GT, {"9"})), BlockMatch::ALL);
+    EXPECT_EQ(match(predicate("n", ColumnType::FLOAT, PredicateOp::RANGE, {"9.5", "20"})), BlockMatch::ALL);
+    EXPECT_EQ(match(predicate("n", ColumnType::INT, PredicateOp::IN, {"1", "30"})), BlockMatch::NONE);
+    EXPECT_EQ(match(predicate("s", ColumnType::STRING, PredicateOp::EQ, {"m"})), BlockMatch::ALL);
+    EXPECT_EQ(match(predicate("s", ColumnType::INT, PredicateOp::EQ, {"1"})), BlockMatch::NONE); // never parses
+    EXPECT_EQ(match(predicate("missing", ColumnType::STRING, PredicateOp::LT, {"z"})), BlockMatch::NONE);
+    EXPECT_EQ(match(predicate("n", ColumnType::INT, PredicateOp::GT, {"9"}), key("c", 15)), BlockMatch::SOME);
+    EXPECT_EQ(match(predicate("n", ColumnType::INT, PredicateOp::GT, {"9"}), key("c", 21)), BlockMatch::NONE);
+    EXPECT_THROW(match(predicate("n", ColumnType::INT, PredicateOp::LT, {"x"})), std::invalid_argument);
+}
+
+TEST(ColumnarScanSuite, TablePrunesBlocksAndAggregatesFromStatistics) {
+    std::string dir = fresh_dir("factdb_zone_map_test");
+    factdb::TableOptions options;
+    options.data_dir = dir;
+    factdb::Table table(options);
+    ASSERT_TRUE(table.open());
+    for (size_t i = 0; i < 4096; i++) { // one partition per day, 512 readings each
+        table.insert(key("day", i / 512), key("t", i), make_rows({{"reading", std::to_string(i % 100)}, {"at", std::to_string(i)}}));
+    }
+    table.flush();
+
+    factdb::ColumnAggregate all = table.aggregate("reading");
+    EXPECT_EQ(all.rows, 4096u);
+    EXPECT_EQ(all.column.ints_, 4096u);
+    EXPECT_EQ(all.column.int_max_, 99);
+    EXPECT_EQ(all.blocks_from_statistics, 4u);
+    EXPECT_EQ(all.blocks_read, 0u);
+
+    factdb::ColumnScan window; // the last three days
+    window.predicates = {predicate("at", factdb::ColumnType::INT, factdb::PredicateOp::GT, {"2559"})};
+    factdb::ColumnAggregate recent = table.aggregate("reading", window);
+    EXPECT_EQ(recent.rows, 1536u);
+    EXPECT_EQ(recent.blocks_skipped, 2u);
+    EXPECT_EQ(recent.blocks_read, 1u);
+    EXPECT_EQ(recent.blocks_from_statistics, 1u);
+    int64_t sum = 0;
+    for (size_t i = 2560; i < 4096; i++) {
+        sum += i % 100;
+    }
+    EXPECT_EQ(recent.column.int_sum_, sum);
+
+    window.start = key("t", 1000);
+    window.end = key("t", 1010);
+    window.predicates.clear();
+    std::vector<std::string> keys;
+    table.scan_columns(window, [&](const factdb::ScanRow& row) { keys.emplace_back(row.clustering_key); });
+    EXPECT_EQ(keys.size(), 10u);
+    EXPECT_EQ(keys.front(), key("t", 1000));
+
+    // a newer version in the memtable stops the SSTable from being judged alone
+    table.update(key("day", 7), key("t", 4095), make_rows({{"reading", "1000"}}));
+    factdb::ColumnAggregate updated = table.aggregate("reading");
+    EXPECT_EQ(updated.rows, 4096u);
+    EXPECT_EQ(updated.column.int_max_, 1000);
+    EXPECT_EQ(updated.blocks_from_statistics, 0u);
+    std::filesystem::remove_all(dir);
+}
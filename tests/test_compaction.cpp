@@ -0,0 +1,169 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+#include "data/compaction.hpp"
+#include "internal/losertree.hpp"
+
+namespace {
+std::vector<char> bytes(const std::string& s) {
+    return std::vector<char>(s.begin(), s.end());
+}
+std::string str(const std::vector<char>& v) {
+    return std::string(v.begin(), v.end());
+}
+std::shared_ptr<factdb::Row> make_row(const std::string& clustering, const std::string& col, const std::string& value) {
+    auto row = std::make_shared<factdb::Row>();
+    auto cb = std::make_shared<factdb::ClusteringBlock>();
+    factdb::CellValue key_cell;
+    key_cell.key_ = bytes(clustering);
+    cb->clustering_cells_.emplace_back(key_cell);
+    row->clustering_blocks_.push_back(cb);
+    factdb::CellValue cell;
+    cell.key_ = bytes(col);
+    cell.value_ = bytes(value);
+    row->cells_.emplace_back(cell);
+    return row;
+}
+// rows are (partition, clustering, column, value), already sorted
+std::shared_ptr<factdb::SSTable> make_sstable(const std::vector<std::vector<std::string>>& rows) {
+    std::vector<std::shared_ptr<factdb::Partition>> partitions;
+    for (const auto& r : rows) {
+        if (partitions.empty() || str(partitions.back()->header_.key_) != r[0]) {
+            partitions.push_back(std::make_shared<factdb::Partition>());
+            partitions.back()->header_.key_ = bytes(r[0]);
+        }
+        partitions.back()->unfiltereds_.push_back(make_row(r[1], r[2], r[3]));
+    }
+    return std::make_shared<factdb::SSTable>("unused.sst", partitions);
+}
+
+struct VectorSource {
+    std::vector<int> values;
+    size_t pos = 0;
+    bool exhausted() const { return pos >= values.size(); }
+    void advance() { pos++; }
+};
+struct VectorSourceLess {
+    bool operator()(const VectorSource& a, const VectorSource& b) const { return a.values[a.pos] < b.values[b.pos]; }
+};
+}
+
+TEST(CompactionSuite, BinaryKeyCompare) {
+    EXPECT_EQ(factdb::compare_binary_keys(bytes("abc"), bytes("abc")), 0);
+    EXPECT_LT(factdb::compare_binary_keys(bytes("ab"), bytes("abc")), 0);
+    EXPECT_GT(factdb::compare_binary_keys(bytes("abd"), bytes("abc")), 0);
+    EXPECT_LT(factdb::compare_binary_keys(bytes("tenant01/2024"), bytes("tenant01/2025")), 0);
+    EXPECT_LT(factdb::compare_binary_keys(bytes("tenant01"), bytes("tenant01/")), 0);
+    EXPECT_LT(factdb::compare_binary_keys(bytes("a"), bytes(std::string("a\0", 2))), 0);
+    EXPECT_GT(factdb::compare_binary_keys(bytes("\xff"), bytes("\x01")), 0);
+}
+
+TEST(CompactionSuite, LoserTreeMergesInOrder) {
+    for (size_t k : {1, 2, 3, 5, 8}) {
+        std::vector<VectorSource> sources(k);
+        std::vector<int> expected;
+        for (size_t i = 0; i < k; i++) {
+            for (int v = static_cast<int>(i); v < 40; v += static_cast<int>(k) + 1) {
+                sources[i].values.push_back(v);
+                expected.push_back(v);
+            }
+        }
+        std::sort(expected.begin(), expected.end());
+        std::vector<VectorSource*> ptrs;
+        for (auto& s : sources) ptrs.push_back(&s);
+        factdb::LoserTree<VectorSource, VectorSourceLess> tree(ptrs, VectorSourceLess());
+        std::vector<int> merged;
+        while (!tree.empty()) {
+            merged.push_back(tree.top().values[tree.top().pos]);
+            tree.pop();
+        }
+        EXPECT_EQ(merged, expected) << "k=" << k;
+    }
+}
+
+TEST(CompactionSuite, NewestVersionWinsAndCellsMerge) {
+    auto older = make_sstable({{"p1", "c1", "a", "old"}, {"p1", "c2", "a", "keep"}, {"p2", "c1", "b", "old"}});
+    auto newer = make_sstable({{"p1", "c1", "a", "new"}, {"p2", "c1", "c", "extra"}});
+    factdb::CompactionOptions options;
+    options.write_outputs = false;
+    factdb::Compactor compactor(options);
+    auto result = compactor.compact({older, newer});
+
+    ASSERT_EQ(result.outputs.size(), 1);
+    EXPECT_EQ(result.input_rows, 5);
+    EXPECT_EQ(result.output_rows, 3);
+    const auto& partitions = result.outputs[0]->get_partitions();
+    ASSERT_EQ(partitions.size(), 2);
+    auto p1c1 = std::static_pointer_cast<factdb::Row>(partitions[0]->unfiltereds_[0]);
+    ASSERT_EQ(p1c1->cells_.size(), 1);
+    EXPECT_EQ(str(p1c1->cells_[0].value_.value_), "new");
+    auto p2c1 = std::static_pointer_cast<factdb::Row>(partitions[1]->unfiltereds_[0]);
+    EXPECT_EQ(p2c1->cells_.size(), 2);
+}
+
+TEST(CompactionSuite, DeletionShadowsOlderRows) {
+    auto older = make_sstable({{"p1", "c1", "a", "old"}});
+    auto newer = make_sstable({{"p1", "c1", "a", ""}});
+    auto tombstone = std::static_pointer_cast<factdb::Row>(newer->get_partitions()[0]->unfiltereds_[0]);
+    tombstone->cells_.clear();
+    tombstone->flags_ |= static_cast<char>(factdb::RowFlags::HAS_DELETION);
+
+    factdb::CompactionOptions options;
+    options.write_outputs = false;
+    auto result = factdb::Compactor(options).compact({older, newer});
+    ASSERT_EQ(result.outputs.size(), 1);
+    auto row = std::static_pointer_cast<factdb::Row>(result.outputs[0]->get_partitions()[0]->unfiltereds_[0]);
+    EXPECT_TRUE(row->cells_.empty());
+}
+
+TEST(CompactionSuite, ParallelRangesAreDisjointAndComplete) {
+    std::vector<std::shared_ptr<factdb::SSTable>> inputs;
+    for (int t = 0; t < 4; t++) {
+        std::vector<std::vector<std::string>> rows;
+        for (int p = 0; p < 200; p++) {
+            char key[16];
+            std::snprintf(key, sizeof(key), "part%05d", p * 4 + t);
+            rows.push_back({key, "c", "v", std::to_string(t)});
+        }
+        inputs.push_back(make_sstable(rows));
+    }
+    factdb::CompactionOptions options;
+    options.write_outputs = false;
+    options.max_threads = 4;
+    options.min_rows_per_range = 100;
+    auto result = factdb::Compactor(options).compact(inputs);
+
+    EXPECT_EQ(result.ranges, 4);
+    ASSERT_EQ(result.outputs.size(), 4);
+    EXPECT_EQ(result.output_rows, 800);
+    std::vector<char> previous;
+    size_t partitions_seen = 0;
+    for (const auto& output : result.outputs) {
+        for (const auto& partition : output->get_partitions()) {
+            if (!previous.empty()) {
+                EXPECT_LT(factdb::compare_binary_keys(previous, partition->header_.key_), 0);
+            }
+            previous = partition->header_.key_;
+            partitions_seen++;
+        }
+    }
+    EXPECT_EQ(partitions_seen, 800);
+}
+
+TEST(CompactionSuite, WritesOutputFiles) {
+    auto a = make_sstable({{"p1", "c1", "a", "1"}});
+    auto b = make_sstable({{"p2", "c1", "a", "2"}});
+    factdb::CompactionOptions options;
+    options.output_path = [](size_t i) { return "test_compaction_out-" + std::to_string(i) + ".sst"; };
+    auto result = factdb::Compactor(options).compact({a, b});
+    ASSERT_EQ(result.outputs.size(), 1);
+
+    factdb::SSTable loaded(result.outputs[0]->get_file_path());
+    ASSERT_TRUE(loaded.read_from_file());
+    loaded.remove_files();
+    EXPECT_EQ(loaded.get_partitions().size(), 2);
+    EXPECT_EQ(loaded.row_count(), 2);
+}
@@ -0,0 +1,112 @@
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <thread>
+#include "data/sstable.hpp"
+#include "io/aligned_buffer_pool.hpp"
+#include "io/block_cache.hpp"
+#include "io/direct_writer.hpp"
+
+TEST(AlignedBufferPoolSuite, BoundedAndReused) {
+    factdb::AlignedBufferPool pool(5000, 2);
+    EXPECT_EQ(pool.buffer_size(), 8192); // rounded up to the alignment
+    {
+        auto a = pool.acquire();
+        auto b = pool.acquire();
+        EXPECT_EQ(reinterpret_cast<uintptr_t>(a.data()) % factdb::DIRECT_IO_ALIGNMENT, 0);
+        EXPECT_EQ(pool.in_use(), 2);
+        EXPECT_DOUBLE_EQ(pool.occupancy(), 1.0);
+        EXPECT_FALSE(pool.try_acquire());
+    }
+    EXPECT_EQ(pool.in_use(), 0);
+    auto c = pool.acquire();
+    EXPECT_EQ(pool.allocated(), 2);
+}
+
+TEST(AlignedBufferPoolSuite, AcquireBlocksUntilRelease) {
+    factdb::AlignedBufferPool pool(4096, 1);
+    auto held = std::make_unique<factdb::AlignedBuffer>(pool.acquire());
+    std::thread releaser([&] {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        held.reset();
+    });
+    auto next = pool.acquire();
+    EXPECT_TRUE(static_cast<bool>(next));
+    releaser.join();
+}
+
+TEST(DirectFileWriterSuite, PadsTailAndTruncates) {
+    std::string path = "test_direct_writer.dat";
+    factdb::AlignedBufferPool pool(8192, 2);
+    factdb::ThreadPoolIoEngine engine(2);
+    std::string payload(3 * 8192 + 123, 'd');
+    payload[8192] = 'e';
+    {
+        factdb::DirectFileWriter writer(path, pool, engine);
+        ASSERT_TRUE(writer.is_open());
+        ASSERT_TRUE(writer.append(payload.data(), 5000));
+        ASSERT_TRUE(writer.append(payload.data() + 5000, payload.size() - 5000));
+        EXPECT_EQ(writer.size(), payload.size());
+        EXPECT_TRUE(writer.seal());
+    }
+    EXPECT_EQ(pool.in_use(), 0);
+    EXPECT_EQ(std::filesystem::file_size(path), payload.size());
+    std::string loaded;
+    ASSERT_TRUE(factdb::read_file(engine, path, loaded));
+    EXPECT_EQ(loaded, payload);
+    std::remove(path.c_str());
+}
+
+TEST(BlockCacheSuite, LruEviction) {
+    factdb::BlockCache cache(3 * 10, 10);
+    cache.put("a", 0, std::string(10, 'x'));
+    cache.put("a", 1, std::string(10, 'y'));
+    cache.put("b", 0, std::string(10, 'z'));
+    EXPECT_NE(cache.get("a", 0), nullptr); // a/0 becomes most recent
+    cache.put("b", 1, std::string(10, 'w'));
+    EXPECT_EQ(cache.get("a", 1), nullptr);
+    EXPECT_NE(cache.get("a", 0), nullptr);
+    auto stats = cache.stats();
+    EXPECT_EQ(stats.evictions, 1);
+    EXPECT_EQ(stats.size_bytes, 30);
+    cache.invalidate("b");
+    EXPECT_EQ(cache.get("b", 0), nullptr);
+    EXPECT_EQ(cache.stats().size_bytes, 10);
+}
+
+TEST(DirectIoSSTableSuite, DirectWriteServedFromBlockCache) {
+    std::string path = "test_direct_sstable.sst";
+    std::vector<std::shared_ptr<factdb::Partition>> partitions;
+    for (int p = 0; p < 50; p++) {
+        auto partition = std::make_shared<factdb::Partition>();
+        std::string key = "partition" + std::to_string(1000 + p);
+        partition->header_.key_.assign(key.begin(), key.end());
+        auto row = std::make_shared<factdb::Row>();
+        factdb::CellValue cell;
+        cell.key_ = {'v'};
+        cell.value_.assign(500, 'v');
+        row->cells_.emplace_back(cell);
+        partition->unfiltereds_.push_back(row);
+        partitions.push_back(partition);
+    }
+    factdb::AlignedBufferPool pool(16384, 4);
+    factdb::BlockCache cache(1 << 20, 4096);
+    factdb::SSTableWriteOptions options;
+    options.direct_io = true;
+    options.buffer_pool = &pool;
+    options.block_cache = &cache;
+    factdb::SSTable written(path, partitions);
+    ASSERT_TRUE(written.write_to_file(options));
+    EXPECT_EQ(pool.in_use(), 0);
+
+    factdb::SSTable loaded(path);
+    loaded.set_block_cache(&cache);
+    auto misses_before = cache.stats().misses;
+    ASSERT_TRUE(loaded.read_from_file());
+    EXPECT_EQ(cache.stats().misses, misses_before);
+    EXPECT_GT(cache.stats().hits, 0);
+    EXPECT_EQ(loaded.row_count(), 50);
+    loaded.remove_files();
+}
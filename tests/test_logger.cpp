@@ -111,4 +111,75 @@ TEST_F(LoggerTest, LogSpecialCharacters) {
     Logger::get_instance().info(specialMessage);
     EXPECT_TRUE(getLastLogLine(logFilePath).find(specialMessage) != std::string::npos);
 }
+
+int countLines(const std::string& filePath) {
+    int lineCount = 0;
+    std::string line;
+    std::ifstream file(filePath);
+    while (std::getline(file, line)) {
+        lineCount++;
+    }
+    return lineCount;
+}
+
+TEST_F(LoggerTest, AsyncBlockKeepsEveryLine) {
+    Logger& logger = Logger::get_instance();
+    logger.configure(logFilePath, LogLevel::INFO);
+    AsyncLogOptions options;
+    options.ring_capacity = 16;  // small enough that producers wait on the writer
+    options.overflow = LogOverflow::BLOCK;
+    options.flush_interval = std::chrono::milliseconds(1);
+    uint64_t written_before = logger.stats().written;
+    logger.start_async(options);
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&logger, t]() {
+            for (int i = 0; i < 500; ++i) {
+                logger.logf(LogLevel::INFO, "thread %d line %d", t, i);
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    logger.stop_async();
+    EXPECT_FALSE(logger.is_async());
+    EXPECT_EQ(logger.stats().written - written_before, 2000u);
+    EXPECT_EQ(countLines(logFilePath), 2000);
+    EXPECT_NE(getLastLogLine(logFilePath).find("[INFO] thread"), std::string::npos);
+}
+
+TEST_F(LoggerTest, AsyncDropCountsOverflow) {
+    Logger& logger = Logger::get_instance();
+    logger.configure(logFilePath, LogLevel::INFO);
+    AsyncLogOptions options;
+    options.ring_capacity = 8;
+    options.overflow = LogOverflow::DROP;
+    options.flush_interval = std::chrono::milliseconds(1000);
+    LogStats before = logger.stats();
+    logger.start_async(options);
+    std::thread producer([&logger]() { // a fresh thread gets a ring of the new capacity
+        for (int i = 0; i < 100; ++i) {
+            logger.info("burst");
+        }
+    });
+    producer.join();
+    logger.stop_async();
+    LogStats after = logger.stats();
+    EXPECT_GT(after.dropped - before.dropped, 0u);
+    EXPECT_EQ((after.written - before.written) + (after.dropped - before.dropped), 100u);
+    EXPECT_EQ(countLines(logFilePath), static_cast<int>(after.written - before.written));
+}
+
+TEST_F(LoggerTest, MacrosSkipDisabledLevels) {
+    Logger::get_instance().configure(logFilePath, LogLevel::WARNING);
+    int evaluated = 0;
+    auto argument = [&evaluated]() { return ++evaluated; };
+    FACTDB_LOG_INFO("value %d", argument());
+    EXPECT_EQ(evaluated, 0);
+    FACTDB_LOG_ERROR("value %d", argument());
+    EXPECT_EQ(evaluated, 1);
+    EXPECT_NE(getLastLogLine(logFilePath).find("[ERROR] value 1"), std::string::npos);
+}
 }
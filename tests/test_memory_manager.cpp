@@ -0,0 +1,171 @@
+#include <gtest/gtest.h>
+#include <chrono>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "data/table.hpp"
+#include "io/aligned_buffer_pool.hpp"
+#include "io/block_cache.hpp"
+#include "runtime/memory_manager.hpp"
+#include "test_util.hpp"
+
+TEST(MemoryManagerSuite, DividesTheBudget) {
+    factdb::MemoryManagerOptions options;
+    options.budget_bytes = 1000;
+    options.shares = {0.5, 0.25, 0.0, 0.25};
+    options.soft_limit = 0.5;
+    factdb::MemoryManager memory(options);
+    EXPECT_EQ(memory.limit(factdb::MemorySubsystem::MEMTABLE), 500);
+    EXPECT_EQ(memory.soft_limit(factdb::MemorySubsystem::MEMTABLE), 250);
+    EXPECT_EQ(memory.limit(factdb::MemorySubsystem::ROW_CACHE), 0);
+
+    memory.add_memtable();
+    memory.add_memtable();
+    memory.charge(factdb::MemorySubsystem::MEMTABLE, 300);
+    EXPECT_TRUE(memory.over_soft_limit(factdb::MemorySubsystem::MEMTABLE));
+    EXPECT_FALSE(memory.over_limit(factdb::MemorySubsystem::MEMTABLE));
+    EXPECT_TRUE(memory.should_flush(200));
+    EXPECT_FALSE(memory.should_flush(100));  // below the average, the other memtable goes first
+    memory.charge(factdb::MemorySubsystem::MEMTABLE, -300);
+    EXPECT_EQ(memory.usage(factdb::MemorySubsystem::MEMTABLE), 0);
+    EXPECT_FALSE(memory.should_flush(200));
+
+    options.shares = {0.6, 0.6, 0.0, 0.0};
+    EXPECT_THROW(factdb::MemoryManager{options}, std::invalid_argument);
+}
+
+TEST(MemoryManagerSuite, CachesAndBuffersChargeTheirLimits) {
+    factdb::MemoryManagerOptions options;
+    options.budget_bytes = 1 << 20;
+    auto memory = std::make_shared<factdb::MemoryManager>(options);
+    {
+        factdb::BlockCache cache(UINT64_MAX, 4096, memory.get());
+        EXPECT_EQ(cache.stats().capacity_bytes, memory->limit(factdb::MemorySubsystem::BLOCK_CACHE));
+        std::string contents(300 * 1024, 'x');
+        cache.populate("/nonexistent/file", contents.data(), contents.size());
+        EXPECT_EQ(memory->usage(factdb::MemorySubsystem::BLOCK_CACHE), cache.stats().size_bytes);
+        cache.populate("/nonexistent/other", contents.data(), contents.size());
+        EXPECT_LE(memory->usage(factdb::MemorySubsystem::BLOCK_CACHE), memory->limit(factdb::MemorySubsystem::BLOCK_CACHE));
+        EXPECT_GT(cache.stats().evictions, 0);
+        cache.invalidate("/nonexistent/other");
+        EXPECT_EQ(memory->usage(factdb::MemorySubsystem::BLOCK_CACHE), cache.stats().size_bytes);
+    }
+    EXPECT_EQ(memory->usage(factdb::MemorySubsystem::BLOCK_CACHE), 0);
+    {
+        factdb::AlignedBufferPool pool(64 * 1024, 16, memory.get());
+        EXPECT_EQ(pool.capacity(), memory->limit(factdb::MemorySubsystem::IO_BUFFERS) / (64 * 1024));
+        auto first = pool.acquire();
+        auto second = pool.acquire();
+        EXPECT_EQ(memory->usage(factdb::MemorySubsystem::IO_BUFFERS), 2 * 64 * 1024);
+    }
+    EXPECT_EQ(memory->usage(factdb::MemorySubsystem::IO_BUFFERS), 0);
+}
+
+TEST(MemoryManagerSuite, MemtablesFlushPastTheSoftLimit) {
+    std::string dir = fresh_dir("factdb_memory_soft");
+    factdb::MemoryManagerOptions options;
+    options.budget_bytes = 64 * 1024;
+    options.shares = {1.0, 0.0, 0.0, 0.0};
+    auto memory = std::make_shared<factdb::MemoryManager>(options);
+    {
+        factdb::Table table(table_options(dir, memory));
+        ASSERT_TRUE(table.open());
+        for (int i = 0; i < 2000; i++) {
+            table.insert("p" + std::to_string(i % 10), "c" + std::to_string(i), make_rows("v", std::string(100, 'a' + i % 26)));
+            // flushes run in the background, so only the write just admitted can go past the limit
+            ASSERT_LT(memory->usage(factdb::MemorySubsystem::MEMTABLE), memory->limit(factdb::MemorySubsystem::MEMTABLE) + 1024);
+        }
+        EXPECT_GT(table.sstables().size(), 2);
+        EXPECT_EQ(memory->stats().rejected_writes, 0);
+        auto row = table.get("p3", "c1993");
+        ASSERT_NE(row, nullptr);
+        ASSERT_EQ(row->cells_.size(), 1);
+        EXPECT_EQ(row->cells_[0].value_.value_, std::vector<char>(100, 'a' + 1993 % 26));
+        table.flush();
+        EXPECT_EQ(memory->usage(factdb::MemorySubsystem::MEMTABLE), 0);
+    }
+    std::filesystem::remove_all(dir);
+}
+
+TEST(MemoryManagerSuite, SoftLimitFlushesInTheBackground) {
+    std::string dir = fresh_dir("factdb_memory_background");
+    factdb::MemoryManagerOptions options;
+    options.budget_bytes = 64 * 1024;
+    options.shares = {1.0, 0.0, 0.0, 0.0};
+    auto memory = std::make_shared<factdb::MemoryManager>(options);
+    {
+        factdb::Table table(table_options(dir, memory));
+        ASSERT_TRUE(table.open());
+        // one write takes the memtable past the soft limit but not the hard one
+        table.insert("p", "c", make_rows("v", std::string(56 * 1024, 'x')));
+        table.insert("p", "d", make_rows("v", "1"));
+        // nothing flushes explicitly, yet the memtable reaches an SSTable
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+        while (table.sstables().empty() && std::chrono::steady_clock::now() < deadline) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        ASSERT_FALSE(table.sstables().empty());
+        EXPECT_EQ(memory->stats().rejected_writes, 0);
+        EXPECT_NE(table.get("p", "c"), nullptr);
+        EXPECT_NE(table.get("p", "d"), nullptr);
+        table.insert("p", "e", make_rows("v", "2"));
+        table.flush();
+        EXPECT_EQ(memory->usage(factdb::MemorySubsystem::MEMTABLE), 0);
+    }
+    std::filesystem::remove_all(dir);
+}
+
+TEST(MemoryManagerSuite, WritersStallAtTheHardLimit) {
+    std::string dir = fresh_dir("factdb_memory_hard");
+    factdb::MemoryManagerOptions options;
+    options.budget_bytes = 64 * 1024;
+    options.shares = {1.0, 0.0, 0.0, 0.0};
+    options.max_write_stall = std::chrono::milliseconds(0);
+    auto memory = std::make_shared<factdb::MemoryManager>(options);
+    factdb::Table large(table_options(dir + "/large", memory));
+    factdb::Table small(table_options(dir + "/small", memory));
+    ASSERT_TRUE(large.open());
+    ASSERT_TRUE(small.open());
+    // neither write leaves its own table among the larger past the soft
+    // limit, yet together they reach the hard one with nothing flushing
+    large.insert("p", "c", make_rows("v", std::string(40 * 1024, 'x')));
+    small.insert("p", "b", make_rows("v", std::string(30 * 1024, 'x')));
+    ASSERT_TRUE(memory->over_limit(factdb::MemorySubsystem::MEMTABLE));
+    ASSERT_TRUE(large.sstables().empty());
+
+    // out of time at once, the small table is refused without flushing
+    // anything itself, but the large table, written no more, is flushed for it
+    EXPECT_THROW(small.insert("p", "c", make_rows("v", "1")), factdb::MemoryLimitError);
+    EXPECT_EQ(memory->stats().write_stalls, 1);
+    EXPECT_EQ(memory->stats().rejected_writes, 1);
+    EXPECT_EQ(small.get("p", "c"), nullptr);
+    EXPECT_TRUE(small.sstables().empty());
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (large.sstables().empty() && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    ASSERT_FALSE(large.sstables().empty());
+    small.insert("p", "c", make_rows("v", "1"));
+    EXPECT_NE(small.get("p", "c"), nullptr);
+
+    // a waiting writer resumes once the largest memtable, another table's, is flushed
+    factdb::MemoryManagerOptions patient = options;
+    patient.max_write_stall = std::chrono::seconds(30);
+    auto waiting = std::make_shared<factdb::MemoryManager>(patient);
+    factdb::Table holder(table_options(dir + "/holder", waiting));
+    factdb::Table writer(table_options(dir + "/writer", waiting));
+    ASSERT_TRUE(holder.open());
+    ASSERT_TRUE(writer.open());
+    holder.insert("p", "c", make_rows("v", std::string(40 * 1024, 'x')));
+    writer.insert("p", "b", make_rows("v", std::string(30 * 1024, 'x')));
+    ASSERT_TRUE(waiting->over_limit(factdb::MemorySubsystem::MEMTABLE));
+    writer.insert("p", "c", make_rows("v", "1"));
+    EXPECT_FALSE(holder.sstables().empty());
+    EXPECT_TRUE(writer.sstables().empty());
+    EXPECT_NE(writer.get("p", "c"), nullptr);
+    EXPECT_EQ(waiting->stats().write_stalls, 1);
+    EXPECT_EQ(waiting->stats().rejected_writes, 0);
+    std::filesystem::remove_all(dir);
+}
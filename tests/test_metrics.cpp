@@ -0,0 +1,146 @@
+#include <gtest/gtest.h>
+#include <boost/asio/connect.hpp>
+#include <boost/asio/read.hpp>
+#include <boost/asio/write.hpp>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "data/table.hpp"
+#include "metrics/exporter.hpp"
+#include "metrics/metrics.hpp"
+
+namespace {
+uint16_t free_port() {
+    boost::asio::io_context io;
+    boost::asio::ip::tcp::acceptor acceptor(io, boost::asio::ip::tcp::endpoint(boost::asio::ip::make_address("127.0.0.1"), 0));
+    return acceptor.local_endpoint().port();
+}
+
+std::string http_get(uint16_t port, const std::string& target) {
+    boost::asio::io_context io;
+    boost::asio::ip::tcp::socket socket(io);
+    socket.connect(boost::asio::ip::tcp::endpoint(boost::asio::ip::make_address("127.0.0.1"), port));
+    std::string request = "GET " + target + " HTTP/1.1\r\nHost: localhost\r\n\r\n";
+    boost::asio::write(socket, boost::asio::buffer(request));
+    std::string response;
+    boost::system::error_code error;
+    char buffer[4096];
+    while (size_t n = socket.read_some(boost::asio::buffer(buffer), error)) {
+        response.append(buffer, n);
+    }
+    return response;
+}
+}
+
+TEST(MetricsSuite, HistogramBucketsBoundTheError) {
+    for (uint64_t value : {0ull, 1ull, 7ull, 8ull, 15ull, 16ull, 17ull, 1000ull, 123456789ull, ~0ull}) {
+        size_t bucket = factdb::Histogram::bucket_of(value);
+        ASSERT_LT(bucket, factdb::Histogram::BUCKETS);
+        uint64_t lower = factdb::Histogram::bucket_lower(bucket);
+        EXPECT_LE(lower, value);
+        EXPECT_LE(value - lower, factdb::Histogram::bucket_width(bucket) - 1);
+        EXPECT_LE(static_cast<double>(factdb::Histogram::bucket_width(bucket)), std::max(1.0, value / 8.0));
+    }
+    auto histogram = std::make_unique<factdb::Histogram>();
+    for (uint64_t value = 1; value <= 10000; value++) {
+        histogram->record(value);
+    }
+    auto snapshot = histogram->snapshot();
+    EXPECT_EQ(snapshot.count, 10000u);
+    EXPECT_EQ(snapshot.sum, 50005000u);
+    EXPECT_NEAR(snapshot.quantile(0.5), 5000, 5000 * 0.125);
+    EXPECT_NEAR(snapshot.quantile(0.99), 9900, 9900 * 0.125);
+}
+
+TEST(MetricsSuite, CountersSumEveryThread) {
+    factdb::MetricsRegistry registry;
+    factdb::Counter& counter = registry.counter("test_events_total", "events");
+    auto histogram = std::make_unique<factdb::Histogram>();
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 8; t++) {
+        threads.emplace_back([&counter, &histogram]() {
+            for (int i = 0; i < 10000; i++) {
+                counter.add();
+                histogram->record(i);
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    EXPECT_EQ(counter.value(), 80000u);
+    EXPECT_EQ(histogram->snapshot().count, 80000u);
+    EXPECT_EQ(&registry.counter("test_events_total", "events"), &counter);
+    EXPECT_THROW(registry.gauge("test_events_total", "events"), std::logic_error);
+}
+
+TEST(MetricsSuite, PrometheusTextAndExporter) {
+    factdb::MetricsRegistry registry;
+    registry.counter("test_requests_total", "Requests").add(3);
+    registry.gauge("test_queue_depth", "Queue depth").set(-2);
+    registry.histogram("test_latency_ns", "Latency").record(5);
+    registry.register_callback("test_sampled", "Sampled", factdb::MetricType::GAUGE, [] { return 1.5; });
+    std::string text = registry.prometheus_text();
+    EXPECT_NE(text.find("# TYPE test_requests_total counter\ntest_requests_total 3\n"), std::string::npos);
+    EXPECT_NE(text.find("test_queue_depth -2\n"), std::string::npos);
+    EXPECT_NE(text.find("# TYPE test_latency_ns summary\n"), std::string::npos);
+    EXPECT_NE(text.find("test_latency_ns{quantile=\"0.5\"} 5\n"), std::string::npos);
+    EXPECT_NE(text.find("test_latency_ns_count 1\n"), std::string::npos);
+    EXPECT_NE(text.find("test_sampled 1.5\n"), std::string::npos);
+    registry.remove_callback("test_sampled");
+    EXPECT_EQ(registry.prometheus_text().find("test_sampled"), std::string::npos);
+
+    std::string dump = (std::filesystem::temp_directory_path() / "factdb_metrics_test.prom").string();
+    std::filesystem::remove(dump);
+    factdb::MetricsExporterOptions options;
+    options.port = free_port();
+    options.dump_path = dump;
+    factdb::MetricsExporter exporter(options, registry);
+    exporter.start();
+    std::string response = http_get(exporter.port(), "/metrics");
+    EXPECT_EQ(response.rfind("HTTP/1.1 200 OK", 0), 0u);
+    EXPECT_NE(response.find("test_requests_total 3\n"), std::string::npos);
+    EXPECT_EQ(http_get(exporter.port(), "/other").rfind("HTTP/1.1 404", 0), 0u);
+    exporter.stop();
+    std::ifstream file(dump);
+    std::stringstream contents;
+    contents << file.rdbuf();
+    EXPECT_EQ(contents.str(), registry.prometheus_text());
+    std::filesystem::remove(dump);
+}
+
+TEST(MetricsSuite, StorageHotPathsAreInstrumented) {
+    auto& registry = factdb::MetricsRegistry::global();
+    uint64_t inserts = registry.histogram("factdb_table_insert_latency_ns", "").snapshot().count;
+    uint64_t flushes = registry.counter("factdb_flushes_total", "").value();
+    uint64_t written = registry.counter("factdb_sstable_bytes_written_total", "").value();
+    uint64_t checks = registry.counter("factdb_bloom_filter_checks_total", "").value();
+    uint64_t negatives = registry.counter("factdb_bloom_filter_negatives_total", "").value();
+    uint64_t heights = registry.histogram("factdb_skiplist_node_height", "").snapshot().count;
+
+    std::string dir = (std::filesystem::temp_directory_path() / "factdb_metrics_table").string();
+    std::filesystem::remove_all(dir);
+    factdb::TableOptions options;
+    options.data_dir = dir;
+    options.use_commitlog = false;
+    factdb::Table table(options);
+    ASSERT_TRUE(table.open());
+    for (int i = 0; i < 10; i++) {
+        auto row = std::make_shared<factdb::MemtableRow>();
+        row->addcol_(std::make_shared<factdb::MemtableColumn>("a", factdb::ColumnType::STRING, "v"));
+        table.insert("p" + std::to_string(i), "c", std::make_shared<std::vector<std::shared_ptr<factdb::MemtableRow>>>(1, row));
+    }
+    ASSERT_NE(table.flush(), nullptr);
+    EXPECT_EQ(table.get("zzz", "c"), nullptr);  // outside the table's key range
+
+    EXPECT_EQ(registry.histogram("factdb_table_insert_latency_ns", "").snapshot().count - inserts, 10u);
+    EXPECT_EQ(registry.counter("factdb_flushes_total", "").value() - flushes, 1u);
+    EXPECT_GT(registry.counter("factdb_sstable_bytes_written_total", "").value(), written);
+    EXPECT_EQ(registry.counter("factdb_bloom_filter_checks_total", "").value() - checks, 1u);
+    EXPECT_EQ(registry.counter("factdb_bloom_filter_negatives_total", "").value() - negatives, 1u);
+    EXPECT_EQ(registry.histogram("factdb_skiplist_node_height", "").snapshot().count - heights, 10u);
+    std::filesystem::remove_all(dir);
+}
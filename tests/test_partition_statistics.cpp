@@ -0,0 +1,142 @@
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include "data/sstable/statisticsfile.hpp"
+#include "data/table.hpp"
+#include "internal/encoding.hpp"
+#include "test_util.hpp"
+
+namespace {
+uint64_t key_estimate(uint64_t first, uint64_t last, uint32_t precision = factdb::PARTITION_KEY_PRECISION) {
+    factdb::HyperLogLog sketch(precision);
+    for (uint64_t i = first; i < last; i++) {
+        std::string key = "key" + std::to_string(i);
+        sketch.add(key.data(), key.size());
+    }
+    return sketch.estimate();
+}
+}
+
+TEST(PartitionStatisticsSuite, HistogramBucketsAndPercentiles) {
+    factdb::EstimatedHistogram histogram(factdb::PARTITION_SIZE_BUCKETS);
+    EXPECT_TRUE(histogram.empty());
+    EXPECT_EQ(histogram.percentile(0.5), 0);
+    EXPECT_EQ(factdb::EstimatedHistogram::bucket_bound(0), 1);
+    for (size_t i = 1; i < 40; i++) {
+        EXPECT_GT(factdb::EstimatedHistogram::bucket_bound(i), factdb::EstimatedHistogram::bucket_bound(i - 1));
+    }
+    EXPECT_GT(factdb::EstimatedHistogram::bucket_bound(factdb::PARTITION_SIZE_BUCKETS - 1), 1000ull * 1000 * 1000 * 1000);
+
+    for (uint64_t value = 1; value <= 1000; value++) {
+        histogram.add(value);
+    }
+    EXPECT_EQ(histogram.count(), 1000);
+    // values land in buckets at most ~20% wide, so percentiles are within that
+    EXPECT_NEAR(static_cast<double>(histogram.percentile(0.5)), 500, 100);
+    EXPECT_NEAR(static_cast<double>(histogram.percentile(0.99)), 990, 200);
+    EXPECT_GE(histogram.max(), 1000);
+    EXPECT_NEAR(static_cast<double>(histogram.mean()), 500, 100);
+    EXPECT_NEAR(static_cast<double>(histogram.count_at_least(800)), 200, 60);
+    EXPECT_FALSE(histogram.overflowed());
+
+    factdb::EstimatedHistogram other(factdb::PARTITION_SIZE_BUCKETS);
+    other.add(5000, 10);
+    histogram.merge(other);
+    EXPECT_EQ(histogram.count(), 1010);
+    EXPECT_EQ(histogram.count_at_least(4000), 10);
+    EXPECT_THROW(histogram.merge(factdb::EstimatedHistogram(10)), std::invalid_argument);
+
+    factdb::EstimatedHistogram small(10);
+    small.add(1ull << 40);
+    EXPECT_TRUE(small.overflowed());
+    EXPECT_EQ(small.count_at_least(1), 1);
+
+    std::string out;
+    histogram.serialize(out);
+    factdb::ByteReader in(out);
+    factdb::EstimatedHistogram read = factdb::EstimatedHistogram::deserialize(in);
+    EXPECT_EQ(read.buckets(), histogram.buckets());
+    EXPECT_EQ(read.count(), histogram.count());
+    EXPECT_EQ(read.percentile(0.5), histogram.percentile(0.5));
+    EXPECT_EQ(read.count_at_least(4000), 10);
+}
+
+TEST(PartitionStatisticsSuite, HyperLogLogEstimatesDistinctKeys) {
+    EXPECT_EQ(key_estimate(0, 0), 0);
+    EXPECT_EQ(key_estimate(0, 10), 10);  // small sets are counted linearly, close to exactly
+    EXPECT_NEAR(static_cast<double>(key_estimate(0, 1000)), 1000, 30);
+    EXPECT_NEAR(static_cast<double>(key_estimate(0, 100000)), 100000, 3000);
+
+    factdb::HyperLogLog first(factdb::PARTITION_KEY_PRECISION);
+    factdb::HyperLogLog second(factdb::PARTITION_KEY_PRECISION);
+    for (int i = 0; i < 30000; i++) {
+        std::string key = "key" + std::to_string(i);
+        first.add(key.data(), key.size());
+        first.add(key.data(), key.size());  // duplicates count once
+    }
+    for (int i = 20000; i < 50000; i++) {
+        std::string key = "key" + std::to_string(i);
+        second.add(key.data(), key.size());
+    }
+    first.merge(second);
+    EXPECT_NEAR(static_cast<double>(first.estimate()), 50000, 1500);
+    EXPECT_THROW(first.merge(factdb::HyperLogLog(10)), std::invalid_argument);
+    EXPECT_THROW(factdb::HyperLogLog(3), std::invalid_argument);
+
+    for (uint64_t keys : {5ull, 20000ull}) {  // sparse and dense encodings
+        factdb::HyperLogLog sketch(factdb::PARTITION_KEY_PRECISION);
+        for (uint64_t i = 0; i < keys; i++) {
+            sketch.add(factdb::HyperLogLog::hash(reinterpret_cast<const char*>(&i), sizeof(i)));
+        }
+        std::string out;
+        sketch.serialize(out);
+        if (keys == 5) {
+            EXPECT_LT(out.size(), 64);
+        }
+        factdb::ByteReader in(out);
+        factdb::HyperLogLog read = factdb::HyperLogLog::deserialize(in);
+        EXPECT_EQ(read.precision(), sketch.precision());
+        EXPECT_EQ(read.estimate(), sketch.estimate());
+    }
+}
+
+TEST(PartitionStatisticsSuite, SSTablesCarrySketchesThroughCompaction) {
+    std::string dir = fresh_dir("factdb_partition_statistics_test");
+    factdb::Table table(table_options(dir));
+    ASSERT_TRUE(table.open());
+    // 350 partitions over three flushes, each flush overlapping the last by 50
+    for (int flush = 0; flush < 3; flush++) {
+        for (int p = flush * 100; p < flush * 100 + 150; p++) {
+            table.insert("p" + std::to_string(p), "c" + std::to_string(flush), make_rows("v", "value"));
+        }
+        table.flush();
+    }
+    auto sstables = table.sstables();
+    ASSERT_EQ(sstables.size(), 3);
+    auto statistics = sstables[0]->statistics();
+    ASSERT_NE(statistics, nullptr);
+    EXPECT_EQ(statistics->partitions_.sizes_.count(), 150);
+    EXPECT_EQ(statistics->partitions_.cells_.count(), 150);
+    EXPECT_NEAR(static_cast<double>(statistics->partitions_.estimated_partitions()), 150, 5);
+    EXPECT_EQ(statistics->partitions_.large_partitions(), 0);
+    EXPECT_EQ(statistics->partitions_.large_partitions(1), 150);
+
+    factdb::PartitionStatistics merged = table.partition_statistics();
+    EXPECT_EQ(merged.sizes_.count(), 450);
+    EXPECT_NEAR(static_cast<double>(merged.estimated_partitions()), 350, 10);
+
+    factdb::CompactionResult result = table.compact();
+    ASSERT_EQ(table.sstables().size(), 1);
+    size_t partitions = table.sstables()[0]->partition_count();
+    EXPECT_EQ(partitions, 350);
+    EXPECT_NEAR(static_cast<double>(result.estimated_partitions), partitions, 10);
+    EXPECT_NEAR(static_cast<double>(table.partition_statistics().estimated_partitions()), partitions, 10);
+
+    // reopened, the sketches are read back from the Statistics component
+    factdb::Table reopened(table_options(dir));
+    ASSERT_TRUE(reopened.open());
+    EXPECT_EQ(reopened.partition_statistics().sizes_.count(), 350);
+    std::filesystem::remove_all(dir);
+}
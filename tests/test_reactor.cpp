@@ -0,0 +1,240 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <future>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include "data/shard_map.hpp"
+#include "data/sharded_table.hpp"
+#include "runtime/future.hpp"
+#include "runtime/reactor.hpp"
+
+TEST(FutureSuite, ThenChainsAndFlattens) {
+    factdb::Promise<int> promise;
+    auto chained = promise.get_future()
+        .then([](int v) { return v + 1; })
+        .then([](int v) { return factdb::make_ready_future<std::string>(std::to_string(v)); });
+    EXPECT_FALSE(chained.available());
+    promise.set_value(41);
+    ASSERT_TRUE(chained.available());
+    EXPECT_EQ(chained.value(), "42");
+}
+
+TEST(FutureSuite, ErrorsSkipContinuations) {
+    bool called = false;
+    auto failed = factdb::make_ready_future<int>(1)
+        .then([](int) -> int { throw std::runtime_error("boom"); })
+        .then([&](int v) { called = true; return v; });
+    EXPECT_TRUE(failed.failed());
+    EXPECT_FALSE(called);
+    EXPECT_THROW(failed.value(), std::runtime_error);
+}
+
+TEST(FutureSuite, WhenAllGathersInOrder) {
+    factdb::Promise<int> a, b;
+    auto all = factdb::when_all<int>({a.get_future(), b.get_future()});
+    b.set_value(2);
+    EXPECT_FALSE(all.available());
+    a.set_value(1);
+    ASSERT_TRUE(all.available());
+    EXPECT_EQ(all.value(), (std::vector<int>{1, 2}));
+}
+
+TEST(ReactorSuite, SubmitToResolvesOnCallingShard) {
+    factdb::Reactor reactor(factdb::ReactorOptions{2, 16, false});
+    auto result = reactor.run_on(0, [&reactor] {
+        return reactor.submit_to(1, [] { return factdb::Reactor::this_shard(); })
+            .then([](size_t ran_on) { return std::make_pair(ran_on, factdb::Reactor::this_shard()); });
+    });
+    auto [ran_on, resolved_on] = result.get();
+    EXPECT_EQ(ran_on, 1);
+    EXPECT_EQ(resolved_on, 0);
+    EXPECT_EQ(factdb::Reactor::this_shard(), factdb::Reactor::NO_SHARD);
+    EXPECT_GE(reactor.stats().messages, 2);
+}
+
+TEST(ReactorSuite, OverflowStillDeliversEverything) {
+    factdb::Reactor reactor(factdb::ReactorOptions{2, 4, false});
+    auto total = reactor.run_on(0, [&reactor] {
+        std::vector<factdb::Future<int>> replies;
+        for (int i = 0; i < 200; i++) {
+            replies.push_back(reactor.submit_to(1, [i] { return i; }));
+        }
+        return factdb::when_all(std::move(replies)).then([](std::vector<int> values) {
+            int sum = 0;
+            for (int v : values) sum += v;
+            return sum;
+        });
+    });
+    EXPECT_EQ(total.get(), 199 * 200 / 2);
+    EXPECT_GT(reactor.stats().overflows, 0);
+}
+
+TEST(ReactorSuite, OverflowKeepsMessagesInOrder) {
+    factdb::Reactor reactor(factdb::ReactorOptions{2, 4, false});
+    std::atomic<bool> go{false};
+    std::vector<int> received;  // touched only on shard 1
+    auto blocked = reactor.run_on(1, [&go] {
+        while (!go.load()) {
+            std::this_thread::yield();
+        }
+        return true;
+    });
+    auto sent = reactor.run_on(0, [&reactor, &go, &received] {
+        for (int i = 0; i < 100; i++) {  // shard 1 is busy, so all but the first 4 overflow
+            reactor.send(1, [&received, i] { received.push_back(i); });
+        }
+        go.store(true);
+        for (int i = 100; i < 200; i++) {  // the ring has room again, yet these must wait their turn
+            reactor.send(1, [&received, i] { received.push_back(i); });
+        }
+        return reactor.submit_to(1, [&received] { return received; });
+    });
+    EXPECT_TRUE(blocked.get());
+    std::vector<int> values = sent.get();
+    ASSERT_EQ(values.size(), 200);
+    for (int i = 0; i < 200; i++) {
+        EXPECT_EQ(values[i], i);
+    }
+    EXPECT_GE(reactor.stats().overflows, 96);
+}
+
+TEST(ReactorSuite, TimersFireAfterDelay) {
+    factdb::Reactor reactor(factdb::ReactorOptions{1, 16, false});
+    auto start = std::chrono::steady_clock::now();
+    auto fired = reactor.run_on(0, [&reactor] { return reactor.sleep(std::chrono::milliseconds(20)); });
+    EXPECT_TRUE(fired.get());
+    EXPECT_GE(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(20));
+
+    std::promise<void> scheduled;
+    reactor.schedule_after(0, std::chrono::milliseconds(5), [&scheduled] { scheduled.set_value(); });
+    EXPECT_EQ(scheduled.get_future().wait_for(std::chrono::seconds(5)), std::future_status::ready);
+}
+
+TEST(ShardedTableSuite, RoutesKeysToOwningShard) {
+    std::string dir = (std::filesystem::temp_directory_path() / "factdb_sharded_table").string();
+    std::filesystem::remove_all(dir);
+    factdb::Reactor reactor(factdb::ReactorOptions{3, 64, false});
+    factdb::TableOptions options;
+    options.data_dir = dir;
+    factdb::ShardedTable table(reactor, options);
+    ASSERT_TRUE(table.open());
+
+    auto rows = [](const std::string& value) {
+        auto row = std::make_shared<factdb::MemtableRow>();
+        row->addcol_(std::make_shared<factdb::MemtableColumn>("v", factdb::ColumnType::STRING, value));
+        return std::make_shared<std::vector<std::shared_ptr<factdb::MemtableRow>>>(1, row);
+    };
+    auto written = reactor.run_on(0, [&] {
+        std::vector<factdb::Future<bool>> writes;
+        for (int i = 0; i < 30; i++) {
+            writes.push_back(table.insert("p" + std::to_string(i), "c", rows(std::to_string(i))));
+        }
+        return factdb::when_all(std::move(writes)).then([&](std::vector<bool>) { return table.flush(); });
+    });
+    EXPECT_EQ(written.get(), 3);
+
+    auto found = reactor.run_on(2, [&] { return table.get("p17", "c"); }).get();
+    ASSERT_NE(found, nullptr);
+    ASSERT_EQ(found->cells_.size(), 1);
+    EXPECT_EQ(std::string(found->cells_[0].value_.value_.begin(), found->cells_[0].value_.value_.end()), "17");
+    for (size_t shard = 0; shard < 3; shard++) {
+        EXPECT_EQ(table.local_table(shard).sstables().size(), 1);
+    }
+    reactor.stop();
+    std::filesystem::remove_all(dir);
+}
+
+TEST(ShardedTableSuite, StalledWritesWaitWithoutBlockingTheirShard) {
+    std::string dir = (std::filesystem::temp_directory_path() / "factdb_sharded_stall").string();
+    std::filesystem::remove_all(dir);
+    factdb::MemoryManagerOptions memory_options;
+    memory_options.budget_bytes = 64 * 1024;
+    memory_options.shares = {1.0, 0.0, 0.0, 0.0};
+    memory_options.max_write_stall = std::chrono::seconds(30);
+    auto memory = std::make_shared<factdb::MemoryManager>(memory_options);
+    factdb::Reactor reactor(factdb::ReactorOptions{2, 64, false});
+    factdb::TableOptions options;
+    options.data_dir = dir;
+    options.memory = memory;
+    factdb::ShardedTable table(reactor, options);
+    ASSERT_TRUE(table.open());
+
+    auto rows = [](const std::string& value) {
+        auto row = std::make_shared<factdb::MemtableRow>();
+        row->addcol_(std::make_shared<factdb::MemtableColumn>("v", factdb::ColumnType::STRING, value));
+        return std::make_shared<std::vector<std::shared_ptr<factdb::MemtableRow>>>(1, row);
+    };
+    std::string keys[2];
+    for (int i = 0; keys[0].empty() || keys[1].empty(); i++) {
+        std::string key = "p" + std::to_string(i);
+        keys[table.shard_of(key)] = key;
+    }
+    // neither write makes its shard flush, yet together they reach the hard limit
+    reactor.run_on(0, [&] {
+        return table.insert(keys[0], "c", rows(std::string(40 * 1024, 'x'))).then([&](bool) {
+            return table.insert(keys[1], "b", rows(std::string(30 * 1024, 'x')));
+        });
+    }).get();
+    ASSERT_TRUE(memory->over_limit(factdb::MemorySubsystem::MEMTABLE));
+
+    // with shard 0 busy, the flush it is sent cannot run, and shard 1 keeps
+    // serving reads while its write waits for it
+    std::promise<void> started, release;
+    auto busy = reactor.run_on(0, [&started, released = release.get_future().share()] {
+        started.set_value();
+        released.wait();
+        return true;
+    });
+    started.get_future().wait();
+    auto write = reactor.run_on(1, [&] { return table.insert(keys[1], "c", rows("1")); });
+    EXPECT_EQ(write.wait_for(std::chrono::milliseconds(50)), std::future_status::timeout);
+    EXPECT_NE(reactor.run_on(1, [&] { return table.get(keys[1], "b"); }).get(), nullptr);
+    EXPECT_TRUE(table.local_table(0).sstables().empty());
+
+    release.set_value();
+    busy.get();
+    EXPECT_TRUE(write.get());
+    EXPECT_EQ(table.local_table(0).sstables().size(), 1);
+    EXPECT_EQ(memory->stats().write_stalls, 1);
+    EXPECT_EQ(memory->stats().rejected_writes, 0);
+    reactor.stop();
+    std::filesystem::remove_all(dir);
+}
+
+TEST(ShardedTableSuite, ShardsOwnContiguousTokenRanges) {
+    EXPECT_EQ(factdb::shard_of_token(INT64_MIN, 4), 0);
+    EXPECT_EQ(factdb::shard_of_token(-1, 4), 1);
+    EXPECT_EQ(factdb::shard_of_token(0, 4), 2);
+    EXPECT_EQ(factdb::shard_of_token(INT64_MAX, 4), 3);
+    size_t previous = 0;
+    for (int64_t token = INT64_MIN; token < INT64_MAX - (INT64_MAX >> 6); token += (INT64_MAX >> 6)) {
+        size_t shard = factdb::shard_of_token(token, 7);
+        EXPECT_GE(shard, previous);
+        previous = shard;
+    }
+    EXPECT_EQ(factdb::shard_of_key("p17", 3), factdb::shard_of_token(factdb::murmur3_token("p17"), 3));
+}
+
+TEST(ShardedTableSuite, RefusesADirectoryLaidOutForAnotherShardCount) {
+    std::string dir = (std::filesystem::temp_directory_path() / "factdb_sharded_count").string();
+    std::filesystem::remove_all(dir);
+    factdb::TableOptions options;
+    options.data_dir = dir;
+    {
+        factdb::Reactor reactor(factdb::ReactorOptions{3, 64, false});
+        factdb::ShardedTable table(reactor, options);
+        ASSERT_TRUE(table.open());
+        reactor.stop();
+    }
+    factdb::Reactor reactor(factdb::ReactorOptions{2, 64, false});
+    factdb::ShardedTable table(reactor, options);
+    EXPECT_THROW(table.open(), std::runtime_error);
+    reactor.stop();
+    std::filesystem::remove_all(dir);
+}
@@ -0,0 +1,187 @@
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+#include "cluster/repair.hpp"
+#include "data/sharded_table.hpp"
+#include "net/client.hpp"
+#include "net/server.hpp"
+#include "runtime/reactor.hpp"
+
+namespace {
+factdb::Request put(const std::string& pk, const std::string& value) {
+    factdb::Request request;
+    request.opcode = factdb::Opcode::PUT;
+    request.partition_key = pk;
+    request.cluster_key = "c";
+    request.columns.push_back(factdb::WireColumn{"v", value});
+    return request;
+}
+factdb::Request keyed(factdb::Opcode opcode, const std::string& pk) {
+    factdb::Request request;
+    request.opcode = opcode;
+    request.partition_key = pk;
+    request.cluster_key = "c";
+    return request;
+}
+
+// two single-process nodes on loopback, repaired over the real protocol
+class RepairTest : public ::testing::Test {
+protected:
+    struct Node {
+        std::unique_ptr<factdb::Reactor> reactor;
+        std::unique_ptr<factdb::ShardedTable> table;
+        std::unique_ptr<factdb::Server> server;
+    };
+
+    void SetUp() override {
+        dir = (std::filesystem::temp_directory_path() / "factdb_repair_test").string();
+        std::filesystem::remove_all(dir);
+        for (size_t i = 0; i < 2; i++) {
+            Node node;
+            node.reactor = std::make_unique<factdb::Reactor>(factdb::ReactorOptions{2, 256, false});
+            factdb::TableOptions options;
+            options.data_dir = dir + "/node" + std::to_string(i);
+            options.use_commitlog = false;
+            node.table = std::make_unique<factdb::ShardedTable>(*node.reactor, options);
+            ASSERT_TRUE(node.table->open());
+            factdb::ServerOptions server_options;
+            server_options.port = 0;
+            node.server = std::make_unique<factdb::Server>(*node.reactor, *node.table, server_options);
+            node.server->start();
+            nodes.push_back(std::move(node));
+        }
+    }
+    void TearDown() override {
+        for (auto& node : nodes) {
+            node.server->stop();
+            node.reactor->stop();
+            node.server.reset();
+            node.table.reset();
+        }
+        std::filesystem::remove_all(dir);
+    }
+    void apply(size_t node, std::vector<factdb::Request> requests) {
+        factdb::Client client("127.0.0.1", nodes[node].server->port());
+        size_t count = requests.size();
+        client.send_all(std::move(requests));
+        for (size_t i = 0; i < count; i++) {
+            ASSERT_EQ(client.receive().status, factdb::Status::OK);
+        }
+    }
+    factdb::Response call(size_t node, factdb::Request request) {
+        factdb::Client client("127.0.0.1", nodes[node].server->port());
+        return client.call(std::move(request));
+    }
+    void flush(size_t node) {
+        auto& table = *nodes[node].table;
+        nodes[node].reactor->run_on(0, [&table] { return table.flush(); }).get();
+    }
+    uint64_t root(size_t node) {
+        auto& table = *nodes[node].table;
+        auto partitions = nodes[node].reactor->run_on(0, [&table] { return table.merged_partitions(); }).get();
+        factdb::MerkleTree tree(factdb::TokenRange{0, 0}, 12);
+        for (const auto& partition : partitions) {
+            factdb::Token token = factdb::murmur3_token(partition->header_.key_.data(), partition->header_.key_.size());
+            for (const auto& row : partition->unfiltereds_) {
+                tree.add(token, factdb::row_digest(partition->header_.key_, *std::static_pointer_cast<factdb::Row>(row)));
+            }
+        }
+        return tree.root();
+    }
+    factdb::RepairResult repair(size_t from, size_t to, size_t depth) {
+        factdb::NodeEndpoint peer{"peer", "127.0.0.1", nodes[to].server->port()};
+        auto& node = nodes[from];
+        factdb::RepairOptions options;
+        options.depth = depth;
+        return node.reactor->run_on(0, [&] {
+            return factdb::repair(*node.reactor, *node.table, peer, {factdb::TokenRange{0, 0}}, options);
+        }).get();
+    }
+
+    std::string dir;
+    std::vector<Node> nodes;
+};
+}
+
+TEST(MerkleTreeSuite, LeavesPartitionTheRange) {
+    std::mt19937_64 rng(7);
+    for (auto range : {factdb::TokenRange{0, 0}, factdb::TokenRange{-1000, 5000}, factdb::TokenRange{INT64_MAX - 10, INT64_MIN + 10}}) {
+        factdb::MerkleTree tree(range, 6);
+        EXPECT_EQ(tree.leaf_range(0).start, range.start);
+        EXPECT_EQ(tree.leaf_range(tree.leaf_count() - 1).end, range.end);
+        for (size_t leaf = 0; leaf + 1 < tree.leaf_count(); leaf++) {
+            EXPECT_EQ(tree.leaf_range(leaf).end, tree.leaf_range(leaf + 1).start);
+        }
+        for (int i = 0; i < 1000; i++) {
+            factdb::Token token = static_cast<factdb::Token>(rng());
+            if (i % 2) token = range.end - static_cast<factdb::Token>(rng() % 16); // close to the edge
+            if (!range.contains(token)) continue;
+            EXPECT_TRUE(tree.leaf_range(tree.leaf_of(token)).contains(token)) << token;
+        }
+    }
+    // a range narrower than 2^depth tokens gets fewer leaves instead of empty ones
+    EXPECT_EQ(factdb::MerkleTree(factdb::TokenRange{0, 5}, 6).leaf_count(), 4);
+}
+
+TEST(MerkleTreeSuite, DifferenceFindsOnlyChangedLeaves) {
+    factdb::MerkleTree a(factdb::TokenRange{0, 0}, 8);
+    factdb::MerkleTree b(factdb::TokenRange{0, 0}, 8);
+    for (int i = 0; i < 1000; i++) {
+        factdb::Token token = factdb::murmur3_token("key" + std::to_string(i));
+        a.add(token, i);
+        b.add(token, i);
+    }
+    EXPECT_EQ(a.root(), b.root());
+    EXPECT_TRUE(a.difference(b).empty());
+    factdb::Token changed = factdb::murmur3_token("key42");
+    b.add(changed, 0xdead);
+    EXPECT_NE(a.root(), b.root());
+    EXPECT_EQ(a.difference(b), std::vector<size_t>{a.leaf_of(changed)});
+}
+
+TEST_F(RepairTest, StreamsOnlyDivergentRangesAndConverges) {
+    const int rows = 4000;
+    const std::string value(100, 'v');
+    std::vector<factdb::Request> initial;
+    for (int i = 0; i < rows; i++) initial.push_back(put("key" + std::to_string(i), value));
+    apply(0, initial);
+    apply(1, initial);
+    flush(0);
+    flush(1);
+
+    // divergence: rows only the peer has, deletes only the local node saw, and conflicting values
+    std::vector<factdb::Request> peer_only, local_only;
+    for (int i = 0; i < 20; i++) peer_only.push_back(put("extra" + std::to_string(i), value));
+    for (int i = 0; i < 10; i++) peer_only.push_back(put("key" + std::to_string(i * 7), "changed"));
+    for (int i = 0; i < 10; i++) local_only.push_back(keyed(factdb::Opcode::REMOVE, "key" + std::to_string(1000 + i)));
+    apply(1, peer_only);
+    apply(0, local_only);
+    ASSERT_NE(root(0), root(1));
+
+    auto result = repair(0, 1, 12);
+    uint64_t transferred = result.tree_bytes + result.received_bytes + result.sent_bytes;
+    std::cout << "repair: " << result.mismatched_leaves << "/" << result.leaves << " leaves differed, "
+              << result.rows_received << " rows received, " << result.rows_sent << " rows sent, "
+              << transferred << " bytes transferred (" << result.tree_bytes << " of hashes) for a "
+              << result.dataset_bytes << " byte dataset" << std::endl;
+    RecordProperty("transferred_bytes", std::to_string(transferred));
+    RecordProperty("dataset_bytes", std::to_string(result.dataset_bytes));
+    EXPECT_GT(result.mismatched_leaves, 0);
+    EXPECT_LE(result.mismatched_leaves, 40);
+    EXPECT_EQ(result.rows_received, 30);  // the extra rows and the changed values
+    EXPECT_EQ(result.rows_sent, 10);      // the tombstones
+    EXPECT_LT(transferred, result.dataset_bytes / 4);
+
+    EXPECT_EQ(root(0), root(1));
+    EXPECT_EQ(call(0, keyed(factdb::Opcode::GET, "extra3")).status, factdb::Status::OK);
+    EXPECT_EQ(call(0, keyed(factdb::Opcode::GET, "key14")).rows[0].columns[0].value, "changed");
+    EXPECT_EQ(call(1, keyed(factdb::Opcode::GET, "key1004")).status, factdb::Status::NOT_FOUND);
+
+    auto again = repair(0, 1, 12);
+    EXPECT_EQ(again.mismatched_leaves, 0);
+    EXPECT_EQ(again.received_bytes + again.sent_bytes, 0);
+}
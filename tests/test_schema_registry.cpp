@@ -0,0 +1,180 @@
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <vector>
+#include "data/columnar_scan.hpp"
+#include "data/schema_registry.hpp"
+#include "data/sstable.hpp"
+#include "data/table.hpp"
+#include "test_util.hpp"
+
+namespace {
+std::string column_name(int c) { return "measurement_column_" + std::to_string(c); }
+
+// every fifth column left out, so rows exercise sparse bitmaps
+factdb::MemtableRows wide_rows(int row) {
+    auto out = std::make_shared<factdb::MemtableRow>();
+    for (int c = 0; c < 40; c++) {
+        if ((c + row) % 5 != 0) {
+            out->addcol_(std::make_shared<factdb::MemtableColumn>(column_name(c), factdb::ColumnType::STRING, std::to_string(row * 100 + c)));
+        }
+    }
+    return std::make_shared<std::vector<std::shared_ptr<factdb::MemtableRow>>>(1, out);
+}
+
+std::vector<char> key(const std::string& s) { return std::vector<char>(s.begin(), s.end()); }
+}
+
+TEST(SchemaRegistrySuite, BitmapSerializesUpToTheHighestColumn) {
+    factdb::ColumnBitmap bitmap;
+    std::string empty;
+    bitmap.serialize(empty);
+    EXPECT_EQ(empty.size(), sizeof(uint16_t));
+
+    for (factdb::ColumnId id : {3, 9, 64, 200}) {
+        bitmap.set(id);
+    }
+    EXPECT_EQ(bitmap.count(), 4);
+    EXPECT_TRUE(bitmap.test(64));
+    EXPECT_FALSE(bitmap.test(65));
+    EXPECT_EQ(bitmap.rank(64), 2);
+    EXPECT_EQ(bitmap.rank(201), 4);
+
+    std::string out;
+    bitmap.serialize(out);
+    ASSERT_EQ(out.size(), sizeof(uint16_t) + 200 / 8 + 1);
+    std::vector<factdb::ColumnId> ids;
+    factdb::for_each_column(out.data() + sizeof(uint16_t), out.size() - sizeof(uint16_t), [&](factdb::ColumnId id) { ids.push_back(id); });
+    EXPECT_EQ(ids, (std::vector<factdb::ColumnId>{3, 9, 64, 200}));
+}
+
+TEST(SchemaRegistrySuite, IdsAreStableAcrossReloads) {
+    std::string dir = fresh_dir("factdb_schema_registry");
+    std::filesystem::create_directories(dir);
+    std::string path = dir + "/SCHEMA";
+    {
+        factdb::SchemaRegistry schema(path);
+        EXPECT_FALSE(schema.load());
+        EXPECT_EQ(schema.intern("b"), 0);
+        EXPECT_EQ(schema.intern("a"), 1);
+        EXPECT_EQ(schema.intern("b"), 0);
+        ASSERT_TRUE(schema.save());
+        EXPECT_EQ(schema.intern("c"), 2);  // never saved
+    }
+    factdb::SchemaRegistry schema(path);
+    ASSERT_TRUE(schema.load());
+    EXPECT_EQ(schema.version(), 2);
+    EXPECT_EQ(schema.find("a"), factdb::ColumnId(1));
+    EXPECT_EQ(schema.find("c"), std::nullopt);
+    EXPECT_EQ(schema.name(0), "b");
+    EXPECT_EQ(schema.intern("d"), 2);
+    EXPECT_EQ(schema.snapshot().schema_version_, 3);
+
+    std::string contents;
+    {
+        std::ifstream in(path, std::ios::binary);
+        contents.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+    contents[6] ^= 1;
+    {
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        out.write(contents.data(), contents.size());
+    }
+    factdb::SchemaRegistry corrupt(path);
+    EXPECT_THROW(corrupt.load(), std::runtime_error);
+    std::filesystem::remove_all(dir);
+}
+
+TEST(SchemaRegistrySuite, WideRowsRoundTripThroughIds) {
+    std::string dir = fresh_dir("factdb_schema_table");
+    factdb::TableOptions options;
+    options.data_dir = dir;
+    {
+        factdb::Table table(options);
+        ASSERT_TRUE(table.open());
+        for (int r = 0; r < 50; r++) {
+            table.insert("p" + std::to_string(r % 3), "c" + std::to_string(r), wide_rows(r));
+        }
+        ASSERT_NE(table.flush(), nullptr);
+        EXPECT_TRUE(std::filesystem::exists(dir + "/SCHEMA"));
+        EXPECT_EQ(table.schema().version(), 40);
+        // a new column after the flush gets the next id; updates merge by id
+        auto extra = std::make_shared<factdb::MemtableRow>();
+        extra->addcol_(std::make_shared<factdb::MemtableColumn>("late", factdb::ColumnType::STRING, "x"));
+        extra->addcol_(std::make_shared<factdb::MemtableColumn>(column_name(1), factdb::ColumnType::STRING, "updated"));
+        table.update("p1", "c1", std::make_shared<std::vector<std::shared_ptr<factdb::MemtableRow>>>(1, extra));
+        ASSERT_NE(table.flush(), nullptr);
+    }
+    factdb::Table table(options);
+    ASSERT_TRUE(table.open());
+    EXPECT_EQ(table.schema().find("late"), factdb::ColumnId(40));
+    for (int r = 0; r < 50; r++) {
+        auto row = table.get("p" + std::to_string(r % 3), "c" + std::to_string(r));
+        ASSERT_NE(row, nullptr) << r;
+        for (int c = 0; c < 40; c++) {
+            std::string expected = (c + r) % 5 == 0 ? "" : std::to_string(r * 100 + c);
+            if (r == 1 && c == 1) {
+                expected = "updated";
+            }
+            EXPECT_EQ(cell_value(row, column_name(c)), expected) << r << " " << c;
+        }
+        EXPECT_EQ(cell_value(row, "late"), r == 1 ? "x" : "");
+    }
+
+    factdb::ColumnScan scan;
+    scan.projection = {"late", column_name(7)};
+    scan.predicates.push_back({column_name(1), factdb::ColumnType::STRING, factdb::PredicateOp::EQ, {"updated"}});
+    std::vector<std::string> seen;
+    table.scan_columns(scan, [&](const factdb::ScanRow& matched) {
+        seen.emplace_back(matched.values[0]);
+        seen.emplace_back(matched.values[1]);
+    });
+    EXPECT_EQ(seen, (std::vector<std::string>{"x", "107"}));
+    std::filesystem::remove_all(dir);
+}
+
+TEST(SchemaRegistrySuite, SSTablesCarryTheirDictionary) {
+    std::string dir = fresh_dir("factdb_schema_sstable");
+    std::string path = dir + "/fdb-1-Data.db";
+    auto schema = std::make_shared<factdb::SchemaRegistry>();
+    schema->intern("unused");
+    factdb::Memtable memtable;
+    memtable.set_schema(schema);
+    for (int r = 0; r < 20; r++) {
+        memtable.insert("p", "c" + std::to_string(r), wide_rows(r));
+    }
+    memtable.flush_to_sstable(path);
+
+    factdb::SSTable loaded(path);
+    ASSERT_TRUE(loaded.read_from_file());
+    const auto& row = std::static_pointer_cast<factdb::Row>(loaded.get_partitions()[0]->unfiltereds_[0]);
+    EXPECT_EQ(cell_value(row, column_name(1)), "1");
+
+    // a section decodes with its own dictionary, whatever ids another one uses
+    auto partition = std::make_shared<factdb::Partition>();
+    partition->header_.key_ = key("q");
+    auto written = std::make_shared<factdb::Row>();
+    auto block = std::make_shared<factdb::ClusteringBlock>();
+    factdb::CellValue clustering;
+    clustering.key_ = key("k");
+    block->clustering_cells_.emplace_back(clustering);
+    written->clustering_blocks_.push_back(block);
+    for (const char* name : {"z", "y"}) {
+        factdb::CellValue cell;
+        cell.key_ = key(name);
+        cell.value_ = key(std::string(name) + "-value");
+        written->cells_.emplace_back(cell);
+    }
+    partition->unfiltereds_.push_back(written);
+    std::string section = factdb::encode_sstable_section({partition});
+    auto decoded = factdb::decode_sstable_section(section.data(), section.size());
+    ASSERT_EQ(decoded.size(), 1);
+    auto read = std::static_pointer_cast<factdb::Row>(decoded[0]->unfiltereds_[0]);
+    EXPECT_EQ(cell_value(read, "z"), "z-value");
+    EXPECT_EQ(cell_value(read, "y"), "y-value");
+    EXPECT_THROW(factdb::decode_sstable_section(section.data(), section.size() - 1), std::runtime_error);
+    std::filesystem::remove_all(dir);
+}
@@ -0,0 +1,176 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <vector>
+#include "data/memtable.hpp"
+#include "data/secondary_index.hpp"
+#include "data/table.hpp"
+#include "test_util.hpp"
+
+namespace {
+// "partition/cluster" of each row found, sorted
+std::vector<std::string> found(const std::vector<factdb::IndexedRow>& rows) {
+    std::vector<std::string> keys;
+    for (const auto& indexed : rows) {
+        const auto& cluster_key = factdb::row_clustering_key(*indexed.row);
+        keys.push_back(indexed.partition_key + "/" + std::string(cluster_key.begin(), cluster_key.end()));
+    }
+    std::sort(keys.begin(), keys.end());
+    return keys;
+}
+
+factdb::TableOptions indexed_options(const std::string& dir) {
+    factdb::TableOptions options;
+    options.data_dir = dir;
+    options.indexed_columns = {"color"};
+    return options;
+}
+}
+
+TEST(SecondaryIndexSuite, IndexKeysRoundTrip) {
+    std::string partition_key;
+    std::string cluster_key;
+    factdb::decode_index_key(factdb::encode_index_key(std::string("p\0q", 3), "c"), partition_key, cluster_key);
+    EXPECT_EQ(partition_key, std::string("p\0q", 3));
+    EXPECT_EQ(cluster_key, "c");
+    EXPECT_THROW(factdb::decode_index_key("ab", partition_key, cluster_key), std::runtime_error);
+}
+
+TEST(SecondaryIndexSuite, MemtableWritesMaintainTheIndex) {
+    factdb::Memtable base;
+    factdb::Memtable index;
+    base.add_index("color", &index);
+    base.insert("p", "c1", make_rows({{"color", "red"}, {"size", "1"}}));
+    base.update("p", "c1", make_rows({{"size", "2"}})); // leaves the index alone
+    std::string key = factdb::encode_index_key("p", "c1");
+    ASSERT_NE(index.get_row("red", key), nullptr);
+    EXPECT_FALSE(factdb::row_is_deleted(*index.get_row("red", key)));
+
+    base.update("p", "c1", make_rows({{"color", "blue"}}));
+    EXPECT_TRUE(factdb::row_is_deleted(*index.get_row("red", key)));
+    EXPECT_FALSE(factdb::row_is_deleted(*index.get_row("blue", key)));
+
+    base.remove("p", "c1");
+    EXPECT_TRUE(factdb::row_is_deleted(*index.get_row("blue", key)));
+
+    factdb::MutationBatch batch;
+    batch.insert("p", "c2", make_rows({{"color", "red"}}));
+    batch.insert("p", "c2", make_rows({{"color", "green"}}));
+    batch.sort();
+    base.apply(batch);
+    EXPECT_TRUE(factdb::row_is_deleted(*index.get_row("red", factdb::encode_index_key("p", "c2"))));
+    EXPECT_FALSE(factdb::row_is_deleted(*index.get_row("green", factdb::encode_index_key("p", "c2"))));
+}
+
+TEST(SecondaryIndexSuite, LookupMergesMemtableAndSSTables) {
+    std::string dir = fresh_dir("factdb_index_lookup_test");
+    factdb::Table table(indexed_options(dir));
+    ASSERT_TRUE(table.open());
+    table.insert("p1", "a", make_rows({{"color", "red"}}));
+    table.insert("p2", "b", make_rows({{"color", "blue"}}));
+    table.flush();
+    table.insert("p1", "c", make_rows({{"color", "red"}}));
+    table.insert("p3", "d", make_rows({{"color", "red"}, {"size", "9"}}));
+
+    EXPECT_EQ(found(table.lookup("color", "red")), (std::vector<std::string>{"p1/a", "p1/c", "p3/d"}));
+    EXPECT_EQ(found(table.lookup("color", "blue")), std::vector<std::string>{"p2/b"});
+    EXPECT_TRUE(table.lookup("color", "green").empty());
+    EXPECT_EQ(table.lookup("color", "red", 2).size(), 2u);
+    EXPECT_THROW(table.lookup("size", "9"), std::invalid_argument);
+    std::filesystem::remove_all(dir);
+}
+
+TEST(SecondaryIndexSuite, StaleEntriesAreSkippedAndSurviveRestart) {
+    std::string dir = fresh_dir("factdb_index_stale_test");
+    {
+        factdb::Table table(indexed_options(dir));
+        ASSERT_TRUE(table.open());
+        table.insert("p", "a", make_rows({{"color", "red"}}));
+        table.insert("p", "b", make_rows({{"color", "red"}}));
+        table.insert("p", "c", make_rows({{"color", "red"}}));
+        table.flush();
+        // the old values are only on disk, so their index entries go stale
+        table.update("p", "a", make_rows({{"color", "blue"}}));
+        table.remove("p", "b");
+        EXPECT_EQ(found(table.lookup("color", "red")), std::vector<std::string>{"p/c"});
+        EXPECT_EQ(found(table.lookup("color", "blue")), std::vector<std::string>{"p/a"});
+    }
+    factdb::Table reopened(indexed_options(dir)); // the commit log replay rebuilds the index memtable
+    ASSERT_TRUE(reopened.open());
+    EXPECT_EQ(found(reopened.lookup("color", "red")), std::vector<std::string>{"p/c"});
+    EXPECT_EQ(found(reopened.lookup("color", "blue")), std::vector<std::string>{"p/a"});
+    reopened.flush();
+    reopened.compact();
+    EXPECT_EQ(found(reopened.lookup("color", "red")), std::vector<std::string>{"p/c"});
+    EXPECT_EQ(found(reopened.lookup("color", "blue")), std::vector<std::string>{"p/a"});
+
+    // compaction purged the stale entries instead of carrying them along
+    factdb::TableOptions index_options;
+    index_options.data_dir = dir + "/index-color";
+    index_options.use_commitlog = false;
+    factdb::Table index(index_options);
+    ASSERT_TRUE(index.open());
+    size_t entries = 0;
+    for (const auto& partition : index.merged_partitions()) {
+        entries += partition->unfiltereds_.size();
+    }
+    EXPECT_EQ(entries, 2);
+    std::filesystem::remove_all(dir);
+}
+
+TEST(SecondaryIndexSuite, EntriesCarryTheSequenceOfTheCellTheyIndex) {
+    std::string dir = fresh_dir("factdb_index_sequence_test");
+    factdb::Table table(indexed_options(dir));
+    ASSERT_TRUE(table.open());
+    table.insert("p", "a", make_rows({{"color", "red"}, {"size", "1"}}));
+    table.flush();
+    table.update("p", "a", make_rows({{"color", "blue"}}));
+    table.flush();
+    table.update("p", "a", make_rows({{"color", "red"}}));
+    table.update("p", "a", make_rows({{"size", "2"}})); // leaves the entry's sequence alone
+    table.flush();
+    EXPECT_EQ(found(table.lookup("color", "red")), std::vector<std::string>{"p/a"});
+    EXPECT_TRUE(table.lookup("color", "blue").empty());
+
+    auto row = table.get("p", "a");
+    ASSERT_NE(row, nullptr);
+    const factdb::SimpleCell* color = nullptr;
+    for (const auto& cell : row->cells_) {
+        if (std::string(cell.value_.key_.begin(), cell.value_.key_.end()) == "color") color = &cell;
+    }
+    ASSERT_NE(color, nullptr);
+    ASSERT_TRUE(color->delta_timestamp_.has_value());
+    ASSERT_TRUE(row->liveness_info_.has_value());
+    EXPECT_GT(row->liveness_info_->delta_timestamp_, *color->delta_timestamp_);
+
+    factdb::TableOptions index_options;
+    index_options.data_dir = dir + "/index-color";
+    index_options.use_commitlog = false;
+    factdb::Table index(index_options);
+    ASSERT_TRUE(index.open());
+    auto entry = index.get("red", factdb::encode_index_key("p", "a"));
+    ASSERT_NE(entry, nullptr);
+    ASSERT_TRUE(entry->liveness_info_.has_value());
+    EXPECT_EQ(entry->liveness_info_->delta_timestamp_, *color->delta_timestamp_);
+    std::filesystem::remove_all(dir);
+}
+
+TEST(SecondaryIndexSuite, NewIndexIsBuiltFromExistingData) {
+    std::string dir = fresh_dir("factdb_index_build_test");
+    {
+        factdb::TableOptions options;
+        options.data_dir = dir;
+        factdb::Table table(options);
+        ASSERT_TRUE(table.open());
+        table.insert("p", "a", make_rows({{"color", "red"}}));
+        table.flush();
+        table.insert("p", "b", make_rows({{"color", "red"}}));
+    }
+    factdb::Table table(indexed_options(dir));
+    ASSERT_TRUE(table.open());
+    EXPECT_EQ(found(table.lookup("color", "red")), (std::vector<std::string>{"p/a", "p/b"}));
+    EXPECT_TRUE(std::filesystem::exists(dir + "/index-color/MANIFEST"));
+    std::filesystem::remove_all(dir);
+}
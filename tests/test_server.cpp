@@ -0,0 +1,179 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+#include "data/sharded_table.hpp"
+#include "metrics/tracing.hpp"
+#include "net/client.hpp"
+#include "net/protocol.hpp"
+#include "net/server.hpp"
+#include "runtime/reactor.hpp"
+
+namespace {
+factdb::Request put(const std::string& pk, const std::string& ck, const std::string& value) {
+    factdb::Request request;
+    request.opcode = factdb::Opcode::PUT;
+    request.partition_key = pk;
+    request.cluster_key = ck;
+    request.columns.push_back(factdb::WireColumn{"v", value});
+    return request;
+}
+factdb::Request keyed(factdb::Opcode opcode, const std::string& pk, const std::string& ck) {
+    factdb::Request request;
+    request.opcode = opcode;
+    request.partition_key = pk;
+    request.cluster_key = ck;
+    return request;
+}
+
+class ServerTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        dir = (std::filesystem::temp_directory_path() / "factdb_server_test").string();
+        std::filesystem::remove_all(dir);
+        reactor = std::make_unique<factdb::Reactor>(factdb::ReactorOptions{2, 256, false});
+        factdb::TableOptions options;
+        options.data_dir = dir;
+        table = std::make_unique<factdb::ShardedTable>(*reactor, options);
+        ASSERT_TRUE(table->open());
+        factdb::ServerOptions server_options;
+        server_options.port = 0;
+        server = std::make_unique<factdb::Server>(*reactor, *table, server_options);
+        server->start();
+    }
+    void TearDown() override {
+        server->stop();
+        reactor->stop();
+        server.reset();
+        table.reset();
+        std::filesystem::remove_all(dir);
+    }
+    std::string dir;
+    std::unique_ptr<factdb::Reactor> reactor;
+    std::unique_ptr<factdb::ShardedTable> table;
+    std::unique_ptr<factdb::Server> server;
+};
+}
+
+TEST(ProtocolSuite, RoundTripsRequestsAndResponses) {
+    factdb::Request batch;
+    batch.opcode = factdb::Opcode::BATCH;
+    batch.stream = 7;
+    batch.batch.push_back(put("p", "c", "v"));
+    batch.batch.push_back(keyed(factdb::Opcode::REMOVE, "p", "d"));
+    std::string frame = factdb::encode_request(batch);
+    EXPECT_EQ(factdb::protocol_frame_size(frame.data(), frame.size() - 1), 0);
+    ASSERT_EQ(factdb::protocol_frame_size(frame.data(), frame.size()), frame.size());
+    auto decoded = factdb::decode_request(frame.data(), frame.size());
+    EXPECT_EQ(decoded.stream, 7);
+    ASSERT_EQ(decoded.batch.size(), 2);
+    EXPECT_EQ(decoded.batch[0].columns[0].value, "v");
+    EXPECT_EQ(decoded.batch[1].opcode, factdb::Opcode::REMOVE);
+
+    factdb::Response response;
+    response.stream = 9;
+    response.rows.push_back(factdb::WireRow{"c", {{"a", "1"}, {"b", "2"}}});
+    frame = factdb::encode_response(response);
+    auto back = factdb::decode_response(frame.data(), frame.size());
+    EXPECT_EQ(back.stream, 9);
+    ASSERT_EQ(back.rows.size(), 1);
+    EXPECT_EQ(back.rows[0].columns[1].value, "2");
+}
+
+TEST(ProtocolSuite, RejectsCountsBeyondTheFrame) {
+    uint32_t huge = 0xFFFFFFFF;
+    std::string frame = factdb::encode_request(put("p", "c", "v"));
+    std::memcpy(frame.data() + factdb::PROTOCOL_HEADER_SIZE + 10, &huge, sizeof(huge)); // the column count
+    EXPECT_THROW(factdb::decode_request(frame.data(), frame.size()), std::runtime_error);
+
+    frame = factdb::encode_response(factdb::Response{});
+    std::memcpy(frame.data() + factdb::PROTOCOL_HEADER_SIZE, &huge, sizeof(huge)); // the row count
+    EXPECT_THROW(factdb::decode_response(frame.data(), frame.size()), std::runtime_error);
+}
+
+TEST_F(ServerTest, GetPutRemove) {
+    factdb::Client client("127.0.0.1", server->port());
+    EXPECT_EQ(client.call(put("p1", "c1", "hello")).status, factdb::Status::OK);
+    auto found = client.call(keyed(factdb::Opcode::GET, "p1", "c1"));
+    ASSERT_EQ(found.status, factdb::Status::OK);
+    ASSERT_EQ(found.rows.size(), 1);
+    EXPECT_EQ(found.rows[0].cluster_key, "c1");
+    EXPECT_EQ(found.rows[0].columns[0].value, "hello");
+    EXPECT_EQ(client.call(keyed(factdb::Opcode::REMOVE, "p1", "c1")).status, factdb::Status::OK);
+    EXPECT_EQ(client.call(keyed(factdb::Opcode::GET, "p1", "c1")).status, factdb::Status::NOT_FOUND);
+}
+
+TEST_F(ServerTest, ScanAndBatch) {
+    factdb::Client client("127.0.0.1", server->port());
+    factdb::Request batch;
+    batch.opcode = factdb::Opcode::BATCH;
+    for (int i = 0; i < 6; i++) {
+        batch.batch.push_back(put("events", "t" + std::to_string(i), std::to_string(i)));
+    }
+    batch.batch.push_back(keyed(factdb::Opcode::REMOVE, "events", "t2"));
+    ASSERT_EQ(client.call(batch).status, factdb::Status::OK);
+
+    factdb::Request scan = keyed(factdb::Opcode::SCAN, "events", "t1");
+    scan.end_key = "t5";
+    auto rows = client.call(scan).rows;
+    ASSERT_EQ(rows.size(), 3);
+    EXPECT_EQ(rows[0].cluster_key, "t1");
+    EXPECT_EQ(rows[1].cluster_key, "t3");
+    EXPECT_EQ(rows[2].cluster_key, "t4");
+    scan.end_key.clear();
+    scan.limit = 2;
+    EXPECT_EQ(client.call(scan).rows.size(), 2);
+}
+
+TEST_F(ServerTest, PipelinesManyStreams) {
+    factdb::Client client("127.0.0.1", server->port());
+    std::vector<factdb::Request> requests;
+    for (int i = 0; i < 200; i++) {
+        requests.push_back(put("k" + std::to_string(i), "c", std::to_string(i)));
+    }
+    auto streams = client.send_all(std::move(requests));
+    std::set<uint16_t> pending(streams.begin(), streams.end());
+    for (int i = 0; i < 200; i++) {
+        auto response = client.receive();
+        EXPECT_EQ(response.status, factdb::Status::OK);
+        EXPECT_EQ(pending.erase(response.stream), 1);
+    }
+    EXPECT_TRUE(pending.empty());
+    EXPECT_EQ(client.call(keyed(factdb::Opcode::GET, "k150", "c")).rows[0].columns[0].value, "150");
+    EXPECT_EQ(server->stats().requests, 201);
+}
+
+TEST_F(ServerTest, TracesFlaggedRequests) {
+    auto& tracer = factdb::Tracer::global();
+    tracer.clear();
+    factdb::Request request = put("traced", "c", "v");
+    request.trace = true;
+    std::string frame = factdb::encode_request(request);
+    EXPECT_TRUE(factdb::decode_request(frame.data(), frame.size()).trace);
+
+    factdb::Client client("127.0.0.1", server->port());
+    ASSERT_EQ(client.call(request).status, factdb::Status::OK);
+    // filed once the shard drops its reference, which may follow the response
+    for (int i = 0; i < 100 && tracer.recent().empty(); i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    auto traces = tracer.recent();
+    ASSERT_EQ(traces.size(), 1u);
+    EXPECT_STREQ(traces[0].request, "PUT");
+    std::vector<std::string> spans;
+    for (const auto& span : traces[0].spans) {
+        spans.push_back(span.name);
+    }
+    EXPECT_NE(std::find(spans.begin(), spans.end(), "Table::insert"), spans.end());
+    EXPECT_NE(std::find(spans.begin(), spans.end(), "commit log append"), spans.end());
+
+    ASSERT_EQ(client.call(keyed(factdb::Opcode::GET, "traced", "c")).status, factdb::Status::OK);
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    EXPECT_EQ(tracer.recent().size(), 1u);
+    tracer.clear();
+}
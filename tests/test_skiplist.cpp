@@ -1,6 +1,9 @@
 #include <gtest/gtest.h>
 #include <internal/skiplist.hpp>
+#include <algorithm>
 #include <optional>
+#include <random>
+#include <vector>
 
 TEST(SkipListSuite, BasicInsert1) {
     factdb::SkipList<int, int> skipList(4, 50.0f);
@@ -77,6 +80,57 @@ TEST(SkipListSuite, BasicUpdate3) {
     EXPECT_EQ(skipList.find_value(4), 11);
     EXPECT_EQ(skipList.find_value(3), 7);
 }
+namespace {
+struct TestMutation {
+    int key;
+    int value;
+    bool remove;
+};
+}
+
+TEST(SkipListSuite, ApplySortedMatchesSingleOperations) {
+    factdb::SkipList<int, int> batched(12, 0.5f);
+    factdb::SkipList<int, int> single(12, 0.5f);
+    std::mt19937 rng(7);
+    for (int round = 0; round < 20; round++) {
+        std::vector<TestMutation> mutations;
+        for (int i = 0; i < 200; i++) {
+            mutations.push_back(TestMutation{static_cast<int>(rng() % 2000), static_cast<int>(rng()), rng() % 5 == 0});
+        }
+        std::stable_sort(mutations.begin(), mutations.end(), [](const TestMutation& a, const TestMutation& b) {
+            return a.key < b.key;
+        });
+        batched.apply_sorted(mutations);
+        for (const auto& mutation : mutations) {
+            if (mutation.remove) {
+                if (!single.remove(mutation.key)) {
+                    single.insert(mutation.key, 0);
+                    single.remove(mutation.key);
+                }
+            } else {
+                single.insert(mutation.key, mutation.value);
+            }
+        }
+    }
+    auto it = single.begin();
+    size_t count = 0;
+    for (auto& entry : batched) {
+        ASSERT_NE(it, single.end());
+        ASSERT_EQ(entry.key_, it->key_);
+        ASSERT_EQ(entry.is_deleted_, it->is_deleted_);
+        if (!entry.is_deleted_) {
+            ASSERT_EQ(entry.values_.back()->value_, it->values_.back()->value_);
+        }
+        auto found = batched.find_entry(entry.key_); // upper levels stay linked in order
+        ASSERT_NE(found, nullptr);
+        ASSERT_EQ(found->key_, entry.key_);
+        ++it;
+        count++;
+    }
+    EXPECT_EQ(it, single.end());
+    EXPECT_GT(count, 1000u);
+}
+
 TEST(SkipListIteratorSuite, BasicIteration) {
     factdb::SkipList<int, std::string> skip_list_(4, 50.0f);
     skip_list_.insert(1, "one");
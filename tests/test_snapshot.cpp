@@ -0,0 +1,138 @@
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <vector>
+#include <sys/stat.h>
+#include "data/manifest.hpp"
+#include "data/table.hpp"
+#include "test_util.hpp"
+
+namespace {
+ino_t inode(const std::string& path) {
+    struct stat st;
+    return ::stat(path.c_str(), &st) == 0 ? st.st_ino : 0;
+}
+}
+
+TEST(SnapshotSuite, SnapshotsLinkLiveSSTablesAndRestore) {
+    std::string dir = fresh_dir("factdb_snapshot_test");
+    std::string restored = fresh_dir("factdb_snapshot_restored");
+    factdb::Table table(table_options(dir));
+    ASSERT_TRUE(table.open());
+    for (int i = 0; i < 20; i++) {
+        table.insert("p" + std::to_string(i % 4), "c" + std::to_string(i), make_rows("v", "old" + std::to_string(i)));
+        if (i % 5 == 4) {
+            table.flush();
+        }
+    }
+    table.update("p0", "c0", make_rows("v", "memtable")); // flushed by the snapshot
+
+    std::string snapshot = table.snapshot("before");
+    EXPECT_EQ(snapshot, table.snapshot_dir("before"));
+    EXPECT_EQ(table.sstables().size(), 5);
+    factdb::Manifest manifest(snapshot);
+    ASSERT_TRUE(manifest.load());
+    EXPECT_EQ(manifest.generations(), table.manifest().generations());
+    for (uint64_t generation : manifest.generations()) {
+        std::string linked = manifest.data_path(generation);
+        EXPECT_EQ(inode(linked), inode(table.manifest().data_path(generation))) << linked;  // linked, not copied
+        EXPECT_EQ(std::filesystem::hard_link_count(linked), 2);
+    }
+    EXPECT_TRUE(std::filesystem::exists(snapshot + "/SCHEMA"));
+    EXPECT_THROW(table.snapshot("before"), std::invalid_argument);
+    EXPECT_THROW(table.snapshot("../escape"), std::invalid_argument);
+
+    // later writes and the compaction retiring the snapshot's tables leave it intact
+    table.insert("p9", "c", make_rows("v", "after"));
+    table.update("p1", "c1", make_rows("v", "after"));
+    table.flush();
+    table.compact();
+    EXPECT_FALSE(std::filesystem::exists(table.manifest().data_path(manifest.generations().front())));
+
+    factdb::Table::restore(snapshot, restored);
+    EXPECT_THROW(factdb::Table::restore(snapshot, restored), std::runtime_error);
+    EXPECT_THROW(factdb::Table::restore(dir + "/nothing", restored + "2"), std::runtime_error);
+    factdb::Table copy(table_options(restored));
+    ASSERT_TRUE(copy.open());
+    EXPECT_EQ(copy.sstables().size(), 5);
+    EXPECT_EQ(cell_value(copy.get("p0", "c0"), "v"), "memtable");
+    EXPECT_EQ(cell_value(copy.get("p1", "c1"), "v"), "old1");
+    EXPECT_EQ(cell_value(copy.get("p3", "c19"), "v"), "old19");
+    EXPECT_EQ(copy.get("p9", "c"), nullptr);
+    EXPECT_EQ(copy.scan("p2", "", "").size(), 5);
+    // the restored table hands out generations past the snapshot's
+    copy.insert("p9", "c", make_rows("v", "restored"));
+    ASSERT_NE(copy.flush(), nullptr);
+    EXPECT_EQ(copy.sstables().size(), 6);
+    EXPECT_EQ(cell_value(copy.get("p9", "c"), "v"), "restored");
+    std::filesystem::remove_all(dir);
+    std::filesystem::remove_all(restored);
+}
+
+TEST(SnapshotSuite, SnapshotsCarryIndexes) {
+    std::string dir = fresh_dir("factdb_snapshot_index_test");
+    std::string restored = fresh_dir("factdb_snapshot_index_restored");
+    factdb::TableOptions options = table_options(dir);
+    options.indexed_columns = {"color"};
+    {
+        factdb::Table table(options);
+        ASSERT_TRUE(table.open());
+        table.insert("p", "a", make_rows("color", "red"));
+        table.insert("q", "b", make_rows("color", "blue"));
+        std::string snapshot = table.snapshot("indexed");
+        EXPECT_TRUE(std::filesystem::exists(snapshot + "/index-color/MANIFEST"));
+        factdb::Table::restore(snapshot, restored);
+    }
+    EXPECT_TRUE(std::filesystem::exists(restored + "/index-color/MANIFEST"));  // opened as is, not rebuilt
+    options.data_dir = restored;
+    factdb::Table copy(options);
+    ASSERT_TRUE(copy.open());
+    auto red = copy.lookup("color", "red");
+    ASSERT_EQ(red.size(), 1);
+    EXPECT_EQ(red[0].partition_key, "p");
+    std::filesystem::remove_all(dir);
+    std::filesystem::remove_all(restored);
+}
+
+TEST(SnapshotSuite, IncrementalBackupsFollowFlushesAndCompactions) {
+    std::string dir = fresh_dir("factdb_backup_test");
+    std::string restored = fresh_dir("factdb_backup_restored");
+    {
+        factdb::Table table(table_options(dir));  // written before backups were enabled
+        ASSERT_TRUE(table.open());
+        table.insert("p", "a", make_rows("v", "1"));
+        table.flush();
+    }
+    factdb::TableOptions options = table_options(dir);
+    options.incremental_backups = true;
+    factdb::Table table(options);
+    ASSERT_TRUE(table.open());
+    factdb::Manifest backup(table.backup_dir());
+    ASSERT_TRUE(backup.load());
+    EXPECT_EQ(backup.generations(), table.manifest().generations());
+
+    table.insert("p", "b", make_rows("v", "2"));
+    table.flush();
+    table.update("p", "a", make_rows("v", "3"));
+    table.flush();
+    std::vector<uint64_t> flushed = table.manifest().generations();
+    ASSERT_EQ(flushed.size(), 3);
+    table.compact();
+    ASSERT_TRUE(backup.load());
+    EXPECT_EQ(backup.generations(), table.manifest().generations());
+    for (uint64_t generation : flushed) {  // compaction inputs stay backed up
+        EXPECT_TRUE(std::filesystem::exists(backup.data_path(generation))) << generation;
+    }
+    EXPECT_EQ(inode(backup.data_path(table.manifest().generations().front())),
+              inode(table.manifest().data_path(table.manifest().generations().front())));
+
+    factdb::Table::restore(table.backup_dir(), restored);
+    factdb::Table copy(table_options(restored));
+    ASSERT_TRUE(copy.open());
+    EXPECT_EQ(copy.sstables().size(), table.sstables().size());
+    EXPECT_EQ(cell_value(copy.get("p", "a"), "v"), "3");
+    EXPECT_EQ(cell_value(copy.get("p", "b"), "v"), "2");
+    std::filesystem::remove_all(dir);
+    std::filesystem::remove_all(restored);
+}
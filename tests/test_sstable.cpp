@@ -55,4 +55,42 @@ TEST_F(MemtableTest, ConvertObjToRow_ClusterKey) {
 //     ASSERT_EQ(row->cells_.size(), 2);
 //     //ASSERT_EQ(row->cells_[0].value_->value_, "value1");
 //     //ASSERT_EQ(row->cells_[1].value_->value_, "value2");
-// }
\ No newline at end of file
+// }
+TEST_F(MemtableTest, FlushWritesSortedReadableSSTable) {
+    auto make_rows = [this](const std::string& col, const std::string& value) {
+        auto row = std::make_shared<factdb::MemtableRow>();
+        auto column = create_column(value);
+        column->setcolname_(col);
+        row->addcol_(column);
+        return std::make_shared<std::vector<std::shared_ptr<factdb::MemtableRow>>>(1, row);
+    };
+    memtable.insert("pb", "c2", make_rows("v", "b2"));
+    memtable.insert("pa", "c1", make_rows("v", "a1"));
+    memtable.insert("pb", "c1", make_rows("v", "b1"));
+    memtable.remove("pa", "c1");
+
+    std::string path = "test_flush.sst";
+    auto flushed = memtable.flush_to_sstable(path);
+    factdb::SSTable loaded(path);
+    ASSERT_TRUE(loaded.read_from_file());
+    loaded.remove_files();
+
+    const auto& partitions = loaded.get_partitions();
+    ASSERT_EQ(partitions.size(), 2);
+    EXPECT_EQ(std::string(partitions[0]->header_.key_.begin(), partitions[0]->header_.key_.end()), "pa");
+    EXPECT_EQ(std::string(partitions[1]->header_.key_.begin(), partitions[1]->header_.key_.end()), "pb");
+    EXPECT_EQ(loaded.row_count(), 3);
+
+    auto deleted = std::static_pointer_cast<factdb::Row>(partitions[0]->unfiltereds_[0]);
+    EXPECT_TRUE(deleted->flags_ & static_cast<char>(factdb::RowFlags::HAS_DELETION));
+    auto row = std::static_pointer_cast<factdb::Row>(partitions[1]->unfiltereds_[1]);
+    const auto& key = factdb::row_clustering_key(*row);
+    EXPECT_EQ(std::string(key.begin(), key.end()), "c2");
+    ASSERT_EQ(row->cells_.size(), 1);
+    EXPECT_EQ(std::string(row->cells_[0].value_.value_.begin(), row->cells_[0].value_.value_.end()), "b2");
+}
+
+TEST(SSTableSuite, ReadMissingFileFails) {
+    factdb::SSTable sstable("does_not_exist.sst");
+    EXPECT_FALSE(sstable.read_from_file());
+}
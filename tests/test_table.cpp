@@ -0,0 +1,299 @@
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+#include "data/manifest.hpp"
+#include "data/sstable.hpp"
+#include "data/table.hpp"
+#include "test_util.hpp"
+
+namespace {
+std::vector<char> key(const std::string& s) { return std::vector<char>(s.begin(), s.end()); }
+}
+
+TEST(ManifestSuite, CommitsAndReloads) {
+    std::string dir = fresh_dir("factdb_manifest_test");
+    {
+        factdb::Manifest manifest(dir);
+        EXPECT_FALSE(manifest.load());
+        uint64_t a = manifest.allocate_generation();
+        uint64_t b = manifest.allocate_generation();
+        uint64_t c = manifest.allocate_generation();
+        ASSERT_TRUE(manifest.add_table(a));
+        ASSERT_TRUE(manifest.add_table(b));
+        ASSERT_TRUE(manifest.add_table(c));
+        uint64_t merged = manifest.allocate_generation();
+        ASSERT_TRUE(manifest.replace_tables({a, b}, {merged}));
+        EXPECT_EQ(manifest.generations(), (std::vector<uint64_t>{merged, c}));
+    }
+    EXPECT_FALSE(std::filesystem::exists(dir + "/MANIFEST.tmp"));
+    factdb::Manifest reloaded(dir);
+    ASSERT_TRUE(reloaded.load());
+    EXPECT_EQ(reloaded.generations(), (std::vector<uint64_t>{4, 3}));
+    EXPECT_EQ(reloaded.next_generation(), 5);
+    EXPECT_EQ(reloaded.data_path(4), dir + "/fdb-4-Data.db");
+    std::filesystem::remove_all(dir);
+}
+
+TEST(ManifestSuite, CorruptManifestThrows) {
+    std::string dir = fresh_dir("factdb_manifest_corrupt");
+    {
+        factdb::Manifest manifest(dir);
+        ASSERT_TRUE(manifest.add_table(manifest.allocate_generation()));
+    }
+    {
+        std::fstream file(dir + "/MANIFEST", std::ios::in | std::ios::out | std::ios::binary);
+        file.seekp(10);
+        file.put('\x7f');
+    }
+    factdb::Manifest reloaded(dir);
+    EXPECT_THROW(reloaded.load(), std::runtime_error);
+    std::filesystem::remove_all(dir);
+}
+
+TEST(SSTableSuite, OpenLoadsIndexLazily) {
+    std::string dir = fresh_dir("factdb_lazy_sstable");
+    std::string path = dir + "/fdb-1-Data.db";
+    factdb::Memtable memtable;
+    for (int i = 0; i < 1000; i++) {
+        char pk[16];
+        snprintf(pk, sizeof(pk), "p%05d", i);
+        memtable.insert(pk, "c", make_rows("v", std::to_string(i)));
+    }
+    memtable.flush_to_sstable(path);
+    EXPECT_TRUE(std::filesystem::exists(dir + "/fdb-1-Index.db"));
+    EXPECT_TRUE(std::filesystem::exists(dir + "/fdb-1-Summary.db"));
+    EXPECT_TRUE(std::filesystem::exists(dir + "/fdb-1-Filter.db"));
+
+    factdb::SSTable sstable(path);
+    ASSERT_TRUE(sstable.open());
+    EXPECT_EQ(sstable.partition_count(), 1000);
+    EXPECT_EQ(sstable.summary().entries_.size(), (1000 + factdb::SUMMARY_INTERVAL - 1) / factdb::SUMMARY_INTERVAL);
+    EXPECT_EQ(sstable.loaded_index_chunks(), 0);
+    EXPECT_TRUE(sstable.get_partitions().empty());
+
+    auto row = sstable.read_row(key("p00517"), key("c"));
+    ASSERT_NE(row, nullptr);
+    EXPECT_EQ(cell_value(row, "v"), "517");
+    EXPECT_EQ(sstable.loaded_index_chunks(), 1);
+    EXPECT_NE(sstable.read_partition(key("p00000")), nullptr);
+    EXPECT_NE(sstable.read_partition(key("p00999")), nullptr);
+    EXPECT_EQ(sstable.read_partition(key("p00517x")), nullptr);
+    EXPECT_FALSE(sstable.might_contain(key("zzz")));
+    EXPECT_EQ(sstable.read_row(key("p00517"), key("d")), nullptr);
+
+    EXPECT_TRUE(sstable.remove_files());
+    EXPECT_FALSE(std::filesystem::exists(dir + "/fdb-1-Summary.db"));
+    std::filesystem::remove_all(dir);
+}
+
+TEST(SSTableSuite, PrefixCompressedKeysRoundTrip) {
+    std::string dir = fresh_dir("factdb_prefix_sstable");
+    std::string path = dir + "/fdb-1-Data.db";
+    auto partition_key = [](int i) { return "tenant-0042/region-eu-west/metric-" + std::to_string(1000 + i); };
+    auto clustering_key = [](int r) { return "2024-03-01T10:00:00." + std::to_string(100 + 2 * r); };
+    factdb::Memtable memtable;
+    for (int i = 0; i < 300; i++) {
+        for (int r = 0; r < 40; r++) { // three restart runs per partition
+            memtable.insert(partition_key(i), clustering_key(r), make_rows("v", std::to_string(i * 40 + r)));
+        }
+    }
+    memtable.flush_to_sstable(path);
+
+    factdb::SSTable sstable(path);
+    ASSERT_TRUE(sstable.open());
+    for (int i = 0; i < 300; i += 7) {
+        for (int r = 0; r < 40; r++) {
+            auto row = sstable.read_row(key(partition_key(i)), key(clustering_key(r)));
+            ASSERT_NE(row, nullptr) << i << " " << r;
+            EXPECT_EQ(cell_value(row, "v"), std::to_string(i * 40 + r));
+        }
+        EXPECT_EQ(sstable.read_row(key(partition_key(i)), key("2024-03-01T10:00:00.0")), nullptr);
+        EXPECT_EQ(sstable.read_row(key(partition_key(i)), key(clustering_key(16) + "1")), nullptr);
+        EXPECT_EQ(sstable.read_row(key(partition_key(i)), key("2024-03-01T10:00:00.9")), nullptr);
+    }
+    EXPECT_EQ(sstable.read_partition(key("tenant-0042/region-eu-west/metric-")), nullptr);
+    EXPECT_EQ(sstable.read_partition(key(partition_key(128) + "0")), nullptr);
+
+    factdb::SSTable loaded(path);
+    ASSERT_TRUE(loaded.read_from_file());
+    ASSERT_EQ(loaded.get_partitions().size(), 300);
+    const auto& partition = *loaded.get_partitions()[299];
+    ASSERT_EQ(partition.unfiltereds_.size(), 40);
+    auto last = std::static_pointer_cast<factdb::Row>(partition.unfiltereds_[39]);
+    const auto& last_key = factdb::row_clustering_key(*last);
+    EXPECT_EQ(std::string(last_key.begin(), last_key.end()), clustering_key(39));
+    std::filesystem::remove_all(dir);
+}
+
+TEST(TableSuite, FlushReopenAndReplay) {
+    std::string dir = fresh_dir("factdb_table_reopen");
+    factdb::TableOptions options;
+    options.data_dir = dir;
+    {
+        factdb::Table table(options);
+        ASSERT_TRUE(table.open());
+        table.insert("p1", "c1", make_rows("a", "1"));
+        table.insert("p2", "c1", make_rows("a", "2"));
+        ASSERT_NE(table.flush(), nullptr);
+        EXPECT_EQ(table.flush(), nullptr);
+        table.update("p1", "c1", make_rows("b", "3"));  // only on disk so far
+        table.remove("p2", "c1");
+        table.insert("p3", "c1", make_rows("a", "4"));
+    }
+    factdb::Table table(options);
+    ASSERT_TRUE(table.open());
+    EXPECT_EQ(table.sstables().size(), 1);
+    auto p1 = table.get("p1", "c1");
+    ASSERT_NE(p1, nullptr);
+    EXPECT_EQ(cell_value(p1, "a"), "1");
+    EXPECT_EQ(cell_value(p1, "b"), "3");
+    EXPECT_EQ(table.get("p2", "c1"), nullptr);
+    ASSERT_NE(table.get("p3", "c1"), nullptr);
+    EXPECT_EQ(table.get("p4", "c1"), nullptr);
+    std::filesystem::remove_all(dir);
+}
+
+TEST(TableSuite, RefusesKeysTooLongForTheFiles) {
+    std::string dir = fresh_dir("factdb_table_long_keys");
+    factdb::TableOptions options;
+    options.data_dir = dir;
+    factdb::Table table(options);
+    ASSERT_TRUE(table.open());
+    std::string longest(factdb::MAX_KEY_LENGTH, 'k');
+    std::string too_long(factdb::MAX_KEY_LENGTH + 1, 'k');
+    EXPECT_THROW(table.insert(too_long, "c", make_rows("a", "1")), std::invalid_argument);
+    EXPECT_THROW(table.remove("p", too_long), std::invalid_argument);
+    factdb::MutationBatch batch;
+    batch.insert("p", "c", make_rows("a", "1"));
+    batch.insert("p", too_long, make_rows("a", "2"));
+    EXPECT_THROW(table.apply(batch), std::invalid_argument);
+    EXPECT_EQ(table.get("p", "c"), nullptr); // nothing of the refused batch went in
+
+    table.insert(longest, longest, make_rows("a", "3"));
+    ASSERT_NE(table.flush(), nullptr);
+    factdb::Table reopened(options);
+    ASSERT_TRUE(reopened.open());
+    ASSERT_NE(reopened.get(longest, longest), nullptr);
+    std::filesystem::remove_all(dir);
+}
+
+TEST(TableSuite, BatchIsOneCommitLogRecord) {
+    std::string dir = fresh_dir("factdb_table_batch");
+    factdb::TableOptions options;
+    options.data_dir = dir;
+    {
+        factdb::Table table(options);
+        ASSERT_TRUE(table.open());
+        table.insert("p1", "c0", make_rows("a", "flushed"));
+        ASSERT_NE(table.flush(), nullptr);
+
+        factdb::MutationBatch batch;
+        for (int i = 9; i >= 1; i--) { // out of order on purpose
+            batch.insert("p1", "c" + std::to_string(i), make_rows("a", std::to_string(i)));
+            batch.insert("p2", "c" + std::to_string(i), make_rows("a", std::to_string(i)));
+        }
+        batch.insert("p2", "c5", make_rows("a", "last"));
+        batch.remove("p1", "c0");  // shadows the flushed row
+        batch.remove("p2", "c1");
+        EXPECT_EQ(batch.size(), 21u);
+        table.apply(batch);
+        EXPECT_EQ(table.get("p1", "c0"), nullptr);
+        EXPECT_EQ(cell_value(table.get("p2", "c5"), "a"), "last");
+    }
+    size_t records = factdb::CommitLog::replay(dir + "/commitlog.log", [](const std::string&) {});
+    EXPECT_EQ(records, 1u);
+
+    factdb::Table table(options);
+    ASSERT_TRUE(table.open());
+    EXPECT_EQ(table.get("p1", "c0"), nullptr);
+    EXPECT_EQ(table.get("p2", "c1"), nullptr);
+    EXPECT_EQ(cell_value(table.get("p2", "c5"), "a"), "last");
+    auto rows = table.scan("p1", "", "");
+    ASSERT_EQ(rows.size(), 9u);
+    EXPECT_EQ(cell_value(rows[0], "a"), "1");
+    EXPECT_EQ(cell_value(rows[8], "a"), "9");
+    std::filesystem::remove_all(dir);
+}
+
+TEST(TableSuite, ReplaysTheLogOfAnUnfinishedFlush) {
+    std::string dir = fresh_dir("factdb_table_unfinished_flush");
+    factdb::TableOptions options;
+    options.data_dir = dir;
+    {
+        factdb::Table table(options);
+        ASSERT_TRUE(table.open());
+        table.insert("p", "c1", make_rows("a", "frozen"));
+        table.insert("p", "c2", make_rows("a", "frozen"));
+    }
+    // as a crash leaves it after the memtable froze but before its SSTable was listed
+    std::filesystem::rename(dir + "/commitlog.log", dir + "/commitlog.log.flushing");
+    {
+        factdb::Table table(options);
+        ASSERT_TRUE(table.open());
+        EXPECT_EQ(table.sstables().size(), 1u);  // open writes the frozen rows out first
+        EXPECT_FALSE(std::filesystem::exists(table.flushing_commitlog_path()));
+        table.insert("p", "c2", make_rows("a", "newer"));
+    }
+    factdb::Table table(options);
+    ASSERT_TRUE(table.open());
+    EXPECT_EQ(cell_value(table.get("p", "c1"), "a"), "frozen");
+    EXPECT_EQ(cell_value(table.get("p", "c2"), "a"), "newer");
+    std::filesystem::remove_all(dir);
+}
+
+TEST(TableSuite, CompactionReplacesGenerations) {
+    std::string dir = fresh_dir("factdb_table_compact");
+    factdb::TableOptions options;
+    options.data_dir = dir;
+    options.use_commitlog = false;
+    factdb::Table table(options);
+    ASSERT_TRUE(table.open());
+    table.insert("p1", "c1", make_rows("a", "old"));
+    table.insert("p2", "c1", make_rows("a", "gone"));
+    table.flush();
+    table.insert("p1", "c1", make_rows("a", "new"));
+    table.remove("p2", "c1");
+    table.flush();
+    std::string old_path = table.sstables()[0]->get_file_path();
+
+    auto result = table.compact();
+    EXPECT_EQ(result.input_rows, 4);
+    EXPECT_EQ(result.output_rows, 2);
+    EXPECT_EQ(table.manifest().generations(), (std::vector<uint64_t>{3}));
+    EXPECT_FALSE(std::filesystem::exists(old_path));
+    EXPECT_EQ(cell_value(table.get("p1", "c1"), "a"), "new");
+    EXPECT_EQ(table.get("p2", "c1"), nullptr);
+
+    factdb::Table reopened(options);
+    ASSERT_TRUE(reopened.open());
+    EXPECT_EQ(cell_value(reopened.get("p1", "c1"), "a"), "new");
+    std::filesystem::remove_all(dir);
+}
+
+TEST(TableSuite, ScanMergesMemtableAndSSTables) {
+    std::string dir = fresh_dir("factdb_table_scan");
+    factdb::TableOptions options;
+    options.data_dir = dir;
+    options.use_commitlog = false;
+    factdb::Table table(options);
+    ASSERT_TRUE(table.open());
+    for (int i = 0; i < 5; i++) {
+        table.insert("p", "c" + std::to_string(i), make_rows("a", std::to_string(i)));
+    }
+    table.flush();
+    table.remove("p", "c1");
+    table.update("p", "c3", make_rows("b", "x"));
+    table.insert("p", "c5", make_rows("a", "5"));
+
+    auto rows = table.scan("p", "c0", "");
+    ASSERT_EQ(rows.size(), 5);
+    EXPECT_EQ(cell_value(rows[2], "a"), "3");
+    EXPECT_EQ(cell_value(rows[2], "b"), "x");
+    EXPECT_EQ(table.scan("p", "c2", "c4").size(), 2);
+    EXPECT_EQ(table.scan("p", "", "", 3).size(), 3);
+    EXPECT_TRUE(table.scan("q", "", "").empty());
+    std::filesystem::remove_all(dir);
+}
@@ -0,0 +1,121 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <vector>
+#include "data/table.hpp"
+#include "metrics/tracing.hpp"
+#include "test_util.hpp"
+
+namespace {
+const factdb::TraceSpan* find_span(const factdb::TraceRecord& trace, const std::string& name) {
+    auto it = std::find_if(trace.spans.begin(), trace.spans.end(), [&](const factdb::TraceSpan& span) { return name == span.name; });
+    return it == trace.spans.end() ? nullptr : &*it;
+}
+
+class TracingTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        dir = (std::filesystem::temp_directory_path() / "factdb_tracing_test").string();
+        std::filesystem::remove_all(dir);
+        factdb::Tracer::global().set_probability(0);
+        factdb::Tracer::global().set_capacity(1024);
+        factdb::Tracer::global().clear();
+    }
+    void TearDown() override {
+        factdb::Tracer::global().set_probability(0);
+        factdb::Tracer::global().clear();
+        std::filesystem::remove_all(dir);
+    }
+    std::string dir;
+};
+}
+
+TEST_F(TracingTest, UntracedRequestsRecordNothing) {
+    factdb::TableOptions options;
+    options.data_dir = dir;
+    factdb::Table table(options);
+    ASSERT_TRUE(table.open());
+    table.insert("p", "c", make_rows("v", "v"));
+    table.flush();
+    EXPECT_NE(table.get("p", "c"), nullptr);
+    EXPECT_TRUE(factdb::Tracer::global().recent().empty());
+    EXPECT_EQ(factdb::this_thread_trace, nullptr);
+}
+
+TEST_F(TracingTest, ForcedTraceShowsEachReadStage) {
+    factdb::TableOptions options;
+    options.data_dir = dir;
+    factdb::Table table(options);
+    ASSERT_TRUE(table.open());
+    table.insert("p", "c", make_rows("v", "v"));
+    table.flush();
+    {
+        auto request = factdb::TraceScope::request("lookup", true);
+        ASSERT_TRUE(request.active());
+        EXPECT_NE(table.get("p", "c"), nullptr);
+    }
+    EXPECT_EQ(factdb::this_thread_trace, nullptr);
+    auto traces = factdb::Tracer::global().recent();
+    ASSERT_EQ(traces.size(), 1u);
+    auto trace = traces[0];
+    EXPECT_STREQ(trace.request, "lookup");
+    for (const char* stage : {"Table::get", "memtable read", "bloom filter", "index lookup", "data read", "lookup"}) {
+        EXPECT_NE(find_span(trace, stage), nullptr) << stage;
+    }
+    EXPECT_EQ(find_span(trace, "Table::get")->detail, "1 sstables");
+    EXPECT_NE(find_span(trace, "bloom filter")->detail.find("positive"), std::string::npos);
+    EXPECT_LE(find_span(trace, "lookup")->duration_ns, trace.duration_ns);
+    EXPECT_NE(factdb::Tracer::global().text().find("data read"), std::string::npos);
+
+    {
+        auto request = factdb::TraceScope::request("write", true);
+        table.insert("p", "d", make_rows("v", "w"));
+    }
+    trace = factdb::Tracer::global().recent(1)[0];
+    EXPECT_NE(find_span(trace, "commit log append"), nullptr);
+    EXPECT_NE(find_span(trace, "memtable apply"), nullptr);
+}
+
+TEST_F(TracingTest, SamplesByProbabilityAndKeepsTheNewest) {
+    auto& tracer = factdb::Tracer::global();
+    tracer.set_probability(1);
+    tracer.set_capacity(5);
+    for (int i = 0; i < 10; i++) {
+        auto request = factdb::TraceScope::request("op");
+    }
+    auto traces = tracer.recent();
+    ASSERT_EQ(traces.size(), 5u);
+    EXPECT_GT(traces[0].id, traces[4].id);
+    EXPECT_EQ(tracer.recent(2).size(), 2u);
+
+    tracer.clear();
+    tracer.set_capacity(10000);
+    tracer.set_probability(0.25);
+    EXPECT_DOUBLE_EQ(tracer.probability(), 0.25);
+    for (int i = 0; i < 4000; i++) {
+        auto request = factdb::TraceScope::request("op");
+    }
+    EXPECT_NEAR(static_cast<double>(tracer.recent().size()), 1000, 150);
+}
+
+TEST_F(TracingTest, TraceFollowsWorkToOtherThreads) {
+    std::shared_ptr<factdb::Trace> handed_off;
+    {
+        auto request = factdb::TraceScope::request("fan-out", true);
+        handed_off = factdb::current_trace();
+        ASSERT_NE(handed_off, nullptr);
+    }
+    EXPECT_TRUE(factdb::Tracer::global().recent().empty()); // still referenced
+    std::thread worker([trace = std::move(handed_off)]() mutable {
+        factdb::TraceScope scope(std::move(trace));
+        factdb::TraceScope span("remote work");
+        EXPECT_TRUE(span.active());
+    });
+    worker.join();
+    auto traces = factdb::Tracer::global().recent();
+    ASSERT_EQ(traces.size(), 1u);
+    EXPECT_NE(find_span(traces[0], "fan-out"), nullptr);
+    EXPECT_NE(find_span(traces[0], "remote work"), nullptr);
+}
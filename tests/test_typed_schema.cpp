@@ -0,0 +1,108 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cstdint>
+#include <filesystem>
+#include <limits>
+#include <string>
+#include <vector>
+#include "data/typed_schema.hpp"
+#include "test_util.hpp"
+
+namespace {
+struct Reading {
+    std::string sensor;
+    int64_t at;
+    double value;
+    bool calibrated;
+    std::string unit;
+    int32_t quality;
+
+    static constexpr auto columns = std::make_tuple(
+        factdb::column("sensor", &Reading::sensor, factdb::ColumnRole::PARTITION),
+        factdb::column("at", &Reading::at, factdb::ColumnRole::CLUSTERING),
+        factdb::column("value", &Reading::value),
+        factdb::column("calibrated", &Reading::calibrated),
+        factdb::column("unit", &Reading::unit),
+        factdb::column("quality", &Reading::quality));
+};
+using ReadingSchema = factdb::TypedSchema<Reading>;
+
+static_assert(ReadingSchema::PARTITION == 0 && ReadingSchema::CLUSTERING == 1);
+static_assert(ReadingSchema::FIXED_SIZE == sizeof(int64_t) + sizeof(double) + sizeof(bool) + sizeof(int32_t));
+static_assert(ReadingSchema::type<2>() == factdb::ColumnType::FLOAT && ReadingSchema::type<3>() == factdb::ColumnType::BOOL);
+
+bool same(const Reading& a, const Reading& b) {
+    return a.sensor == b.sensor && a.at == b.at && a.value == b.value && a.calibrated == b.calibrated && a.unit == b.unit &&
+           a.quality == b.quality;
+}
+}
+
+TEST(TypedSchemaSuite, RowCodecRoundTrips) {
+    Reading reading{"s-1", -42, 3.25, true, "kPa", -7};
+    std::string encoded = ReadingSchema::encode(reading);
+    EXPECT_EQ(encoded.size(), ReadingSchema::FIXED_SIZE + 2 * sizeof(uint32_t) + reading.sensor.size() + reading.unit.size());
+    EXPECT_TRUE(same(ReadingSchema::decode(encoded), reading));
+    EXPECT_THROW(ReadingSchema::decode(encoded.data(), encoded.size() - 1), std::runtime_error);
+    EXPECT_THROW(ReadingSchema::decode(encoded.data(), ReadingSchema::FIXED_SIZE - 1), std::runtime_error);
+}
+
+TEST(TypedSchemaSuite, KeysSortAsValues) {
+    std::vector<int64_t> ints = {std::numeric_limits<int64_t>::min(), -1000, -1, 0, 1, 255, 256, std::numeric_limits<int64_t>::max()};
+    for (size_t i = 1; i < ints.size(); i++) {
+        EXPECT_LT(ReadingSchema::encode_key(ints[i - 1]), ReadingSchema::encode_key(ints[i]));
+        EXPECT_EQ(factdb::detail::decode_key<int64_t>(ReadingSchema::encode_key(ints[i])), ints[i]);
+    }
+    std::vector<double> doubles = {-std::numeric_limits<double>::infinity(), -2.5, -0.0, 0.0, 1e-300, 2.5, std::numeric_limits<double>::infinity()};
+    for (size_t i = 1; i < doubles.size(); i++) {
+        EXPECT_LT(ReadingSchema::encode_key(doubles[i - 1]), ReadingSchema::encode_key(doubles[i]));
+        EXPECT_EQ(factdb::detail::decode_key<double>(ReadingSchema::encode_key(doubles[i])), doubles[i]);
+    }
+
+    std::vector<Reading> readings = {{"b", 5, 0, false, "", 0}, {"a", 7, 0, false, "", 0}, {"b", -5, 0, false, "", 0}, {"a", -7, 0, false, "", 0}};
+    std::sort(readings.begin(), readings.end(), ReadingSchema::Less());
+    for (size_t i = 1; i < readings.size(); i++) {
+        auto previous = ReadingSchema::partition_key(readings[i - 1]) + '\0' + ReadingSchema::clustering_key(readings[i - 1]);
+        auto current = ReadingSchema::partition_key(readings[i]) + '\0' + ReadingSchema::clustering_key(readings[i]);
+        EXPECT_LT(previous, current);
+    }
+    EXPECT_EQ(readings[0].at, -7);
+    EXPECT_EQ(readings[3].at, 5);
+}
+
+TEST(TypedSchemaSuite, TypedTableUsesTheDynamicPath) {
+    std::string dir = fresh_dir("factdb_typed_table");
+    factdb::TableOptions options;
+    options.data_dir = dir;
+    factdb::Table table(options);
+    ASSERT_TRUE(table.open());
+    factdb::TypedTable<Reading> readings(table);
+    for (int64_t at = -20; at < 20; at++) {
+        readings.insert(Reading{"s-1", at, at * 0.5, at % 2 == 0, "kPa", static_cast<int32_t>(at)});
+    }
+    table.flush();
+    readings.insert(Reading{"s-1", 3, 99.5, true, "bar", 1});
+    readings.remove("s-1", -20);
+
+    auto found = readings.get("s-1", 3);
+    ASSERT_TRUE(found.has_value());
+    EXPECT_TRUE(same(*found, Reading{"s-1", 3, 99.5, true, "bar", 1}));
+    EXPECT_FALSE(readings.get("s-1", -20).has_value());
+    EXPECT_FALSE(readings.get("s-2", 3).has_value());
+
+    auto range = readings.scan("s-1", -3, 2);
+    ASSERT_EQ(range.size(), 5);
+    EXPECT_EQ(range.front().at, -3);
+    EXPECT_EQ(range.back().at, 1);
+    EXPECT_TRUE(same(range[1], Reading{"s-1", -2, -1.0, true, "kPa", -2}));
+
+    // dynamically typed readers see the regular columns in their text form
+    auto row = table.get("s-1", ReadingSchema::encode_key(int64_t(-3)));
+    ASSERT_NE(row, nullptr);
+    factdb::ColumnScan scan;
+    scan.projection = {"quality"};
+    scan.predicates.push_back({"value", factdb::ColumnType::FLOAT, factdb::PredicateOp::GT, {"8"}});
+    std::vector<std::string> qualities;
+    table.scan_columns(scan, [&](const factdb::ScanRow& matched) { qualities.emplace_back(matched.values[0]); });
+    EXPECT_EQ(qualities, (std::vector<std::string>{"1", "17", "18", "19"}));
+    std::filesystem::remove_all(dir);
+}
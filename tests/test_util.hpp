@@ -0,0 +1,59 @@
+#ifndef TEST_UTIL_FACTDB_HPP
+#define TEST_UTIL_FACTDB_HPP
+
+#include <filesystem>
+#include <initializer_list>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "data/memtable.hpp"
+#include "data/table.hpp"
+#include "runtime/memory_manager.hpp"
+
+// Fixtures shared by the test files.
+
+// a path under the temp directory, emptied of anything an earlier run left
+inline std::string fresh_dir(const std::string& name) {
+    std::string dir = (std::filesystem::temp_directory_path() / name).string();
+    std::filesystem::remove_all(dir);
+    return dir;
+}
+
+// one write setting a single string column
+inline factdb::MemtableRows make_rows(const std::string& col, const std::string& value) {
+    auto row = std::make_shared<factdb::MemtableRow>();
+    row->addcol_(std::make_shared<factdb::MemtableColumn>(col, factdb::ColumnType::STRING, value));
+    return std::make_shared<std::vector<std::shared_ptr<factdb::MemtableRow>>>(1, row);
+}
+
+// one write setting each (name, value) as a string column
+inline factdb::MemtableRows make_rows(std::initializer_list<std::pair<std::string, std::string>> columns) {
+    auto row = std::make_shared<factdb::MemtableRow>();
+    for (const auto& [name, value] : columns) {
+        row->addcol_(std::make_shared<factdb::MemtableColumn>(name, factdb::ColumnType::STRING, value));
+    }
+    return std::make_shared<std::vector<std::shared_ptr<factdb::MemtableRow>>>(1, row);
+}
+
+// a table in `dir` without a commit log, charged to `memory` when given
+inline factdb::TableOptions table_options(const std::string& dir, std::shared_ptr<factdb::MemoryManager> memory = nullptr) {
+    factdb::TableOptions options;
+    options.data_dir = dir;
+    options.use_commitlog = false;
+    options.memory = std::move(memory);
+    return options;
+}
+
+// the named cell's value, or "" when the row lacks it
+inline std::string cell_value(const std::shared_ptr<factdb::Row>& row, const std::string& col) {
+    for (const auto& cell : row->cells_) {
+        if (std::string(cell.value_.key_.begin(), cell.value_.key_.end()) == col) {
+            return std::string(cell.value_.value_.begin(), cell.value_.value_.end());
+        }
+    }
+    return "";
+}
+
+#endif